@@ -0,0 +1,291 @@
+//
+//  openbench.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+/*
+ * Description
+ *
+ * Measures the latency of open(2); read only and for write, of each file given.  With
+ * -D the daemon command given is started (it must print a line once its ready) and 
+ * the files are measured with it off and on, so the latency it adds is reported.  With
+ * -P they're measured again by a copy of ourself run with the library preloaded, so 
+ * the latency it adds over the unwrapped libc is reported.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_openbench_iterations			100000
+
+
+/*
+ * Definitions
+ */
+
+static const int g_modes[] = {O_RDONLY, O_WRONLY};
+static const char* g_mode_names[] = {"O_RDONLY", "O_WRONLY"};
+#define k_openbench_modes				(sizeof(g_modes) / sizeof(g_modes[0]))
+
+
+/*
+ * Implementation
+ */
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ull) + (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * @brief	times opening (and closing) a file
+ *
+ * @param	path		the file
+ * @param	mode		the open mode
+ * @param	iterations	the number of opens
+ * @param	denied		on return the number of opens which failed
+ *
+ * @return	the mean ns per open
+ */
+static double measure(const char* path, int mode, unsigned long iterations, unsigned long* denied) {
+	for (unsigned long i = 0; i < (iterations / 10) + 1; i++) {
+		int fd = open(path, mode | O_CLOEXEC); // warm the caches
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+	uint64_t start = now_ns();
+	*denied = 0;
+	for (unsigned long i = 0; i < iterations; i++) {
+		int fd = open(path, mode | O_CLOEXEC);
+		if (fd == -1) {
+			(*denied)++;
+		} else {
+			close(fd);
+		}
+	}
+	return (double) (now_ns() - start) / (double) iterations;
+}
+
+
+/**
+ * @brief	starts the daemon and waits until it says its ready
+ *
+ * @return	the daemons pid
+ */
+static pid_t start_daemon(const char* cmd) {
+	int fds[2];
+	pid_t pid = -1;
+	char line[256];
+	FILE* f = NULL;
+	
+	if (pipe(fds) != 0) {
+		perror("pipe");
+		exit(1);
+	}
+	if ((pid = fork()) == 0) {
+		(void) dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		char* exec = NULL;
+		if (asprintf(&exec, "exec %s", cmd) != -1) {
+			execl("/bin/sh", "sh", "-c", exec, (char*) NULL); // exec; so the daemon gets our signal
+		}
+		_exit(127);
+	}
+	close(fds[1]);
+	if (	(pid == -1)
+		 || ((f = fdopen(fds[0], "r")) == NULL)
+		 || (fgets(line, sizeof(line), f) == NULL)) {
+		fprintf(stderr, "the daemon didn't start; %s\n", cmd);
+		exit(1);
+	}
+	fclose(f);
+	return pid;
+}
+
+
+/**
+ * @brief	measures the files again in a copy of ourself with a library preloaded
+ *
+ * @param	library		the library to preload
+ * @param	iterations	the number of opens
+ * @param	files		the files
+ * @param	count		the number of files
+ * @param	on			on return the mean ns per open; per file and mode
+ * @param	denied		on return the number of opens which failed; per file and mode
+ */
+static void measure_preloaded(const char* library, unsigned long iterations, char** files, int count, double* on, unsigned long* denied) {
+	int fds[2];
+	pid_t pid = -1;
+	FILE* f = NULL;
+	
+	if (pipe(fds) != 0) {
+		perror("pipe");
+		exit(1);
+	}
+	if ((pid = fork()) == 0) {
+		char n[32];
+		char** args = calloc((size_t) count + 5, sizeof(char*));
+		(void) snprintf(n, sizeof(n), "%lu", iterations);
+		(void) dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		if (args != NULL) {
+			args[0] = "openbench";
+			args[1] = "-r";
+			args[2] = "-n";
+			args[3] = n;
+			memcpy(&args[4], files, (size_t) count * sizeof(char*));
+			(void) setenv("LD_PRELOAD", library, 1);
+			execv("/proc/self/exe", args);
+		}
+		_exit(127);
+	}
+	close(fds[1]);
+	if ((pid == -1) || ((f = fdopen(fds[0], "r")) == NULL)) {
+		perror("fork");
+		exit(1);
+	}
+	for (size_t i = 0; i < (size_t) count * k_openbench_modes; i++) {
+		if (fscanf(f, "%lf %lu", &on[i], &denied[i]) != 2) {
+			fprintf(stderr, "unable to measure with %s preloaded\n", library);
+			exit(1);
+		}
+	}
+	fclose(f);
+	(void) waitpid(pid, NULL, 0);
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-n iterations] [-D daemon-command | -P library] file ...\n", name);
+	fprintf(stderr, "  -n  opens per file and mode (default %d)\n", k_openbench_iterations);
+	fprintf(stderr, "  -D  measure with the daemon off, then on; e.g. -D \"./build/wormfand -q /data\"\n");
+	fprintf(stderr, "  -P  measure without, then with, the library preloaded; e.g. -P ./build/libwormpreload.so\n");
+	exit(2);
+}
+
+
+int main(int argc, char* argv[]) {
+	unsigned long iterations = k_openbench_iterations;
+	const char* daemon = NULL;
+	const char* library = NULL;
+	int raw = 0;
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "n:D:P:rh")) != -1) {
+		switch (ch) {
+			case 'n':
+				iterations = strtoul(optarg, NULL, 10);
+				break;
+			case 'D':
+				daemon = optarg;
+				break;
+			case 'P':
+				library = optarg;
+				break;
+			case 'r':
+				raw = 1; // as run by measure_preloaded
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if ((optind == argc) || (iterations == 0) || (daemon && library)) {
+		usage(argv[0]);
+	}
+	
+	int files = argc - optind;
+	double* off = calloc((size_t) files * k_openbench_modes, sizeof(double));
+	double* on = calloc((size_t) files * k_openbench_modes, sizeof(double));
+	unsigned long* denied = calloc((size_t) files * k_openbench_modes, sizeof(unsigned long));
+	if ((off == NULL) || (on == NULL) || (denied == NULL)) {
+		perror("calloc");
+		return 1;
+	}
+	for (int f = 0; f < files; f++) {
+		for (size_t m = 0; m < k_openbench_modes; m++) {
+			size_t i = f * k_openbench_modes + m;
+			off[i] = measure(argv[optind + f], g_modes[m], iterations, &denied[i]);
+			if (raw) {
+				printf("%f %lu\n", off[i], denied[i]);
+			}
+		}
+	}
+	if (raw) {
+		return 0;
+	}
+	if (library) {
+		measure_preloaded(library, iterations, &argv[optind], files, on, denied);
+		daemon = library; // reported the same way
+	} else if (daemon) {
+		pid_t pid = start_daemon(daemon);
+		for (int f = 0; f < files; f++) {
+			for (size_t m = 0; m < k_openbench_modes; m++) {
+				size_t i = f * k_openbench_modes + m;
+				on[i] = measure(argv[optind + f], g_modes[m], iterations, &denied[i]);
+			}
+		}
+		(void) kill(pid, SIGTERM);
+		(void) waitpid(pid, NULL, 0);
+	}
+	
+	printf("iterations: %lu\n\n", iterations);
+	if (daemon) {
+		printf("%-40s %-9s %10s %10s %10s %10s\n", "file", "mode", "off ns", "on ns", "added ns", "denied");
+	} else {
+		printf("%-40s %-9s %10s\n", "file", "mode", "ns");
+	}
+	for (int f = 0; f < files; f++) {
+		for (size_t m = 0; m < k_openbench_modes; m++) {
+			size_t i = f * k_openbench_modes + m;
+			if (daemon) {
+				printf("%-40s %-9s %10.0f %10.0f %10.0f %10lu\n", argv[optind + f], g_mode_names[m],
+					   off[i], on[i], on[i] - off[i], denied[i]);
+			} else {
+				printf("%-40s %-9s %10.0f\n", argv[optind + f], g_mode_names[m], off[i]);
+			}
+		}
+	}
+	free(off);
+	free(on);
+	free(denied);
+	return 0;
+}
@@ -0,0 +1,499 @@
+//
+//  walk.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "walk.h"
+#include "worm_dirindex.h"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a directory waiting to be (or being) walked
+ *
+ * @field	path		the path relative to the root; "" for the root
+ * @field	parent		the directory it's in; NULL for the root
+ * @field	pending		1 until its been walked, plus one for each subdirectory whose
+ *						subtree isn't complete
+ * @field	state		the caller's state; see walk_callbacks_t
+ */
+typedef struct walk_dir {
+	char*				path;
+	struct walk_dir*	parent;
+	volatile long		pending;
+	uint64_t			state;
+} walk_dir_t;
+
+/**
+ * @brief	a thread's deque of directories
+ */
+typedef struct {
+	pthread_mutex_t		lock;
+	walk_dir_t**		items;
+	size_t				head;		// the next to steal
+	size_t				count;
+	size_t				space;
+} walk_deque_t;
+
+struct walk {
+	int						root;
+	unsigned				threads;
+	walk_callbacks_t		callbacks;
+	void*					arg;
+	bool					indexed;		// list sealed directories from their index
+	walk_deque_t			deques[k_walk_threads_max];
+	volatile long			outstanding;	// directories queued or being walked
+	volatile long			queued;			// directories queued; the frontier
+	volatile uint64_t		dirs;
+};
+
+typedef struct {
+	walk_t*		w;
+	unsigned	thread;
+	char*		buffer;		// for directories taken from the deques
+	unsigned	depth;		// directories being walked in place
+} walk_thread_t;
+
+#ifdef __linux__
+struct walk_dirent64 {
+	uint64_t		d_ino;
+	int64_t			d_off;
+	unsigned short	d_reclen;
+	unsigned char	d_type;
+	char			d_name[];
+};
+#endif
+
+static void walk_dir(walk_t* w, walk_thread_t* t, walk_dir_t* d);
+static bool walk_index(walk_t* w, walk_thread_t* t, walk_dir_t* d, int fd, char* path, size_t len);
+
+
+/*
+ * Implementation
+ */
+
+static void deque_push(walk_deque_t* q, walk_dir_t* d) {
+	(void) pthread_mutex_lock(&q->lock);
+	if (q->count == q->space) {
+		size_t space = q->space ? q->space * 2: 64;
+		walk_dir_t** items = malloc(space * sizeof(*items));
+		if (items == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		for (size_t i = 0; i < q->count; i++) {
+			items[i] = q->items[(q->head + i) % q->space];
+		}
+		free(q->items);
+		q->items = items;
+		q->head = 0;
+		q->space = space;
+	}
+	q->items[(q->head + q->count++) % q->space] = d;
+	(void) pthread_mutex_unlock(&q->lock);
+}
+
+
+/**
+ * @brief	takes a directory from a deque; the owner takes the newest, thieves the oldest
+ */
+static walk_dir_t* deque_take(walk_deque_t* q, bool steal) {
+	walk_dir_t* retval = NULL;
+	(void) pthread_mutex_lock(&q->lock);
+	if (q->count > 0) {
+		if (steal) {
+			retval = q->items[q->head];
+			q->head = (q->head + 1) % q->space;
+		} else {
+			retval = q->items[(q->head + q->count - 1) % q->space];
+		}
+		q->count--;
+	}
+	(void) pthread_mutex_unlock(&q->lock);
+	return retval;
+}
+
+
+/**
+ * @brief	accounts for a directory (or a subdirectories subtree) finishing; completing
+ *			its subtree, and perhaps its parents, once nothing below it is pending
+ */
+static void walk_complete(walk_t* w, unsigned thread, walk_dir_t* d) {
+	while ((d != NULL) && (__sync_sub_and_fetch(&d->pending, 1) == 0)) {
+		walk_dir_t* parent = d->parent;
+		if (w->callbacks.done) {
+			w->callbacks.done(w, thread, d->path);
+		}
+		free(d->path);
+		free(d);
+		d = parent;
+	}
+}
+
+
+static void walk_error(walk_t* w, unsigned thread, const char* path, int err) {
+	if (w->callbacks.error) {
+		w->callbacks.error(w, thread, path, err);
+	}
+}
+
+
+/**
+ * @brief	visits an entry of a directory; queueing (or walking) subdirectories
+ *
+ * @param	path	the path of the entry; the buffer may be changed
+ */
+static void walk_visit(walk_t* w, walk_thread_t* t, walk_dir_t* d, int fd, const char* name, char* path, unsigned char type) {
+	if (	(name[0] == '.')
+		 && ((name[1] == '\0') || ((name[1] == '.') && (name[2] == '\0')))) {
+		return;
+	}
+	if (type == DT_UNKNOWN) {
+		struct stat st;
+		if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+			type = S_ISDIR(st.st_mode) ? DT_DIR: S_ISREG(st.st_mode) ? DT_REG: S_ISLNK(st.st_mode) ? DT_LNK: DT_UNKNOWN;
+		}
+	}
+	if (type != DT_DIR) {
+		if (w->callbacks.entry) {
+			w->callbacks.entry(w, t->thread, fd, name, path, type, d->state);
+		}
+	} else if (	(w->callbacks.skip == NULL)
+			   || !w->callbacks.skip(w, path)) {
+		walk_dir_t* child = calloc(1, sizeof(*child));
+		if (	(child == NULL)
+			 || ((child->path = strdup(path)) == NULL)) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		child->parent = d;
+		child->pending = 1;
+		child->state = d->state;
+		(void) __sync_fetch_and_add(&d->pending, 1);
+		if (w->queued < k_walk_frontier_max) {
+			(void) __sync_fetch_and_add(&w->outstanding, 1);
+			(void) __sync_fetch_and_add(&w->queued, 1);
+			deque_push(&w->deques[t->thread], child);
+		} else {
+			// the frontier is full; walk it now rather than grow it
+			t->depth++;
+			walk_dir(w, t, child);
+			t->depth--;
+			walk_complete(w, t->thread, child);
+		}
+	}
+}
+
+
+/**
+ * @brief	visits the entries of a sealed directory from its index (see worm_dirindex.h)
+ *			rather than reading it
+ *
+ * @param	path	the directory's path, with a trailing / unless its the root
+ * @param	len		the length of path
+ *
+ * @return	true if it was, false if it has no usable index
+ */
+static bool walk_index(walk_t* w, walk_thread_t* t, walk_dir_t* d, int fd, char* path, size_t len) {
+	bool retval = false;
+	worm_dirindex_t index;
+	
+	if (	w->indexed
+		 && (worm_dirindex_open(&index, fd) == 0)) {
+		for (uint32_t i = 0; i < index.count; i++) {
+			const char* name = worm_dirindex_name(&index, &index.entries[i]);
+			size_t namelen = index.entries[i].len;
+			
+			if (!worm_dirindex_valid(&index, &index.entries[i])) {
+				continue; // open refuses these; never join it to a path
+			} else if (len + namelen >= PATH_MAX) {
+				walk_error(w, t->thread, name, ENAMETOOLONG);
+				continue;
+			}
+			memcpy(path + len, name, namelen + 1);
+			walk_visit(w, t, d, fd, name, path, index.entries[i].type);
+		}
+		worm_dirindex_close(&index);
+		retval = true;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	walks one directory; visiting its entries and queueing its subdirectories
+ */
+static void walk_dir(walk_t* w, walk_thread_t* t, walk_dir_t* d) {
+	int fd = openat(w->root, (d->path[0] == '\0') ? ".": d->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	size_t len = strlen(d->path);
+	char path[PATH_MAX];
+	int err = 0;
+	
+	(void) __sync_fetch_and_add(&w->dirs, 1);
+	if (fd == -1) {
+		walk_error(w, t->thread, d->path, errno);
+		return;
+	}
+	if (w->callbacks.dir) {
+		w->callbacks.dir(w, t->thread, fd, d->path, &d->state);
+	}
+	memcpy(path, d->path, len);
+	if (len > 0) {
+		path[len++] = '/';
+	}
+	if (walk_index(w, t, d, fd, path, len)) {
+		// listed without reading it
+	}
+#ifdef __linux__
+	else {
+		// getdents64 fills the buffer with as many entries as fit
+		size_t size = (t->depth == 0) ? k_walk_buffer_size: k_walk_nested_buffer_size;
+		char* buffer = (t->depth == 0) ? t->buffer: malloc(size);
+		long n = 0;
+		
+		if (buffer == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		while ((n = syscall(SYS_getdents64, fd, buffer, size)) > 0) {
+			for (long off = 0; off < n;) {
+				struct walk_dirent64* ent = (struct walk_dirent64*) (buffer + off);
+				size_t namelen = strlen(ent->d_name);
+				
+				off += ent->d_reclen;
+				if (len + namelen >= sizeof(path)) {
+					walk_error(w, t->thread, ent->d_name, ENAMETOOLONG);
+					continue;
+				}
+				memcpy(path + len, ent->d_name, namelen + 1);
+				walk_visit(w, t, d, fd, ent->d_name, path, ent->d_type);
+			}
+		}
+		if (n < 0) {
+			err = errno;
+		}
+		if (buffer != t->buffer) {
+			free(buffer);
+		}
+	}
+#else
+	else {
+		DIR* dir = NULL;
+		struct dirent* ent = NULL;
+		int dfd = dup(fd); // closedir closes it
+		
+		if (	(dfd == -1)
+			 || ((dir = fdopendir(dfd)) == NULL)) {
+			err = errno;
+			if (dfd != -1) {
+				close(dfd);
+			}
+		} else {
+			while ((errno = 0, ent = readdir(dir)) != NULL) {
+				size_t namelen = strlen(ent->d_name);
+				if (len + namelen >= sizeof(path)) {
+					walk_error(w, t->thread, ent->d_name, ENAMETOOLONG);
+					continue;
+				}
+				memcpy(path + len, ent->d_name, namelen + 1);
+				walk_visit(w, t, d, fd, ent->d_name, path, ent->d_type);
+			}
+			err = errno;
+			closedir(dir);
+		}
+	}
+#endif
+	if (err != 0) {
+		walk_error(w, t->thread, d->path, err);
+	}
+	if (w->callbacks.after) {
+		w->callbacks.after(w, t->thread, d->path);
+	}
+	close(fd);
+}
+
+
+static void* walk_thread(void* arg) {
+	walk_thread_t* t = arg;
+	walk_t* w = t->w;
+	
+	if ((t->buffer = malloc(k_walk_buffer_size)) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	while (w->outstanding > 0) {
+		walk_dir_t* d = deque_take(&w->deques[t->thread], false);
+		for (unsigned i = 1; (d == NULL) && (i < w->threads); i++) {
+			d = deque_take(&w->deques[(t->thread + i) % w->threads], true);
+		}
+		if (d == NULL) {
+			(void) sched_yield(); // others are still walking; they may queue more
+			continue;
+		}
+		(void) __sync_fetch_and_sub(&w->queued, 1);
+		walk_dir(w, t, d);
+		walk_complete(w, t->thread, d);
+		(void) __sync_fetch_and_sub(&w->outstanding, 1);
+	}
+	free(t->buffer);
+	return NULL;
+}
+
+
+/**
+ * @brief	creates a walk
+ *
+ * @param	root		the directory to walk
+ * @param	threads		the number of threads
+ * @param	callbacks	the callbacks
+ * @param	arg			passed through to callbacks; see walk_arg
+ *
+ * @return	the walk, else NULL and errno is set
+ */
+walk_t* walk_create(const char* root, unsigned threads, const walk_callbacks_t* callbacks, void* arg) {
+	walk_t* retval = NULL;
+	
+	if ((threads == 0) || (threads > k_walk_threads_max)) {
+		errno = EINVAL;
+	} else if ((retval = calloc(1, sizeof(*retval))) != NULL) {
+		retval->root = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (retval->root == -1) {
+			free(retval);
+			retval = NULL;
+		} else {
+			retval->threads = threads;
+			retval->callbacks = *callbacks;
+			retval->arg = arg;
+			for (unsigned i = 0; i < threads; i++) {
+				(void) pthread_mutex_init(&retval->deques[i].lock, NULL);
+			}
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	lists sealed directories from their index, where they have one, rather than
+ *			reading them; set before the walk is run.  Costs a lookup of each directory's
+ *			index, so is only worth it for trees with large sealed directories
+ *
+ * @param	w		the walk
+ * @param	indexed	true to use the indexes
+ */
+void walk_indexed(walk_t* w, bool indexed) {
+	w->indexed = indexed;
+}
+
+
+/**
+ * @brief	walks the tree; returning once its all been walked
+ *
+ * @param	w	the walk
+ *
+ * @return	0 on success, else an errno if the threads couldn't be started
+ */
+int walk_run(walk_t* w) {
+	int retval = 0;
+	pthread_t tids[k_walk_threads_max];
+	walk_thread_t threads[k_walk_threads_max];
+	walk_dir_t* root = calloc(1, sizeof(*root));
+	unsigned started = 0;
+	
+	if (	(root == NULL)
+		 || ((root->path = strdup("")) == NULL)) {
+		free(root);
+		return ENOMEM;
+	}
+	root->pending = 1;
+	w->outstanding = 1;
+	w->queued = 1;
+	deque_push(&w->deques[0], root);
+	for (started = 0; started < w->threads; started++) {
+		threads[started].w = w;
+		threads[started].thread = started;
+		threads[started].buffer = NULL;
+		threads[started].depth = 0;
+		if ((retval = pthread_create(&tids[started], NULL, walk_thread, &threads[started])) != 0) {
+			break;
+		}
+	}
+	if (started == 0) {
+		walk_dir_t* d = deque_take(&w->deques[0], false);
+		free(d->path);
+		free(d);
+		w->outstanding = 0;
+	}
+	for (unsigned i = 0; i < started; i++) {
+		(void) pthread_join(tids[i], NULL);
+	}
+	return (started == 0) ? retval: 0;
+}
+
+
+void* walk_arg(walk_t* w) {
+	return w->arg;
+}
+
+
+/**
+ * @brief	the root of the walk; paths passed to the callbacks are relative to it
+ */
+int walk_root(walk_t* w) {
+	return w->root;
+}
+
+
+/**
+ * @brief	the number of directories walked so far
+ */
+uint64_t walk_dirs(walk_t* w) {
+	return w->dirs;
+}
+
+
+void walk_destroy(walk_t* w) {
+	for (unsigned i = 0; i < w->threads; i++) {
+		free(w->deques[i].items);
+		(void) pthread_mutex_destroy(&w->deques[i].lock);
+	}
+	close(w->root);
+	free(w);
+}
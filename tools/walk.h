@@ -0,0 +1,106 @@
+//
+//  walk.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_walk_h
+#define tools_walk_h
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * Walks a tree in parallel.  Each thread has a deque of directories; it pushes the 
+ * subdirectories it finds onto, and pops its next directory from, the bottom (so it
+ * works depth first and the deques stay small) and when its own is empty it steals 
+ * from the top of another thread's (taking the shallowest, so the biggest, subtrees).
+ *
+ * Entries are visited with fd relative calls; the directory they're in is open and
+ * passed to the callbacks.  A directory's subtree is complete once it and all its
+ * subdirectories have been walked; callers use that to checkpoint progress.  Each
+ * directory carries a caller defined state, which starts as its parent's; so what's
+ * known about a directory can be handed down to its entries without reading it again.
+ *
+ * On Linux directories are read with getdents64 into a large per thread buffer; a 
+ * few system calls for even a large directory.  The frontier (the directories queued)
+ * is bounded; once its full the thread which finds a subdirectory walks it there and 
+ * then, so memory is bounded by the depth of the tree rather than its breadth.
+ *
+ * Optionally (walk_indexed) sealed directories are listed from their index rather 
+ * than read; see worm_dirindex.h.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_walk_threads_max				64
+#define k_walk_frontier_max				65536	// directories queued across all threads
+#define k_walk_buffer_size				(256 * 1024)
+#define k_walk_nested_buffer_size		(32 * 1024)	// for directories walked in place
+
+
+/*
+ * Definitions
+ */
+
+typedef struct walk walk_t;
+
+/**
+ * @brief	the callbacks a walk makes; any may be NULL.  Called concurrently from the 
+ *			walker threads; thread is the callers index (0 to threads - 1)
+ *
+ * @field	dir		a directory is being walked; before its entries are visited.  Its
+ *					state starts as its parent's (0 for the root) and may be changed
+ * @field	entry	an entry which isn't a directory is visited; with the state of
+ *					the directory its in
+ * @field	after	a directory's entries have all been visited (its subdirectories 
+ *					are walked separately)
+ * @field	done	a directory's whole subtree has been walked
+ * @field	skip	checks if a subdirectory should be walked; true to skip it
+ * @field	error	an entry couldn't be opened or read
+ */
+typedef struct {
+	void	(*dir)(walk_t* w, unsigned thread, int dirfd, const char* path, uint64_t* state);
+	void	(*entry)(walk_t* w, unsigned thread, int dirfd, const char* name, const char* path, unsigned char type, uint64_t state);
+	void	(*after)(walk_t* w, unsigned thread, const char* path);
+	void	(*done)(walk_t* w, unsigned thread, const char* path);
+	bool	(*skip)(walk_t* w, const char* path);
+	void	(*error)(walk_t* w, unsigned thread, const char* path, int err);
+} walk_callbacks_t;
+
+extern walk_t* walk_create(const char* root, unsigned threads, const walk_callbacks_t* callbacks, void* arg);
+extern void walk_indexed(walk_t* w, bool indexed);
+extern int walk_run(walk_t* w);
+extern void* walk_arg(walk_t* w);
+extern int walk_root(walk_t* w);
+extern uint64_t walk_dirs(walk_t* w);
+extern void walk_destroy(walk_t* w);
+
+
+#endif
@@ -0,0 +1,142 @@
+//
+//  worm_cache.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <time.h>
+
+#include "worm_cache.h"
+
+struct label; // the policy header declares kernel routines which take one
+#include "wormxattr.h"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a cached WORM state
+ *
+ * @field	dev		the device
+ * @field	ino		the inode
+ * @field	ctime	the inodes ctime when the state was read; a change invalidates it
+ * @field	value	the state, as a label value; k_wormxattr_label_unknown if empty
+ */
+typedef struct {
+	dev_t				dev;
+	ino_t				ino;
+	struct timespec		ctime;
+	intptr_t			value;
+} cache_entry_t;
+
+
+static cache_entry_t g_cache[1 << k_worm_cache_bits];
+static volatile int g_locks[k_worm_cache_stripes];
+
+
+/*
+ * Implementation
+ */
+
+static inline size_t cache_index(const struct stat* st) {
+	uint64_t h = ((uint64_t) st->st_ino * 0x9e3779b97f4a7c15ull) ^ ((uint64_t) st->st_dev * 0xc2b2ae3d27d4eb4full);
+	return (size_t) (h >> (64 - k_worm_cache_bits));
+}
+
+
+static inline void cache_lock(size_t i) {
+	volatile int* lock = &g_locks[i % k_worm_cache_stripes];
+	while (__sync_lock_test_and_set(lock, 1)) {
+		while (*lock) {
+			// spin; entries are only held for a copy
+		}
+	}
+}
+
+
+static inline void cache_unlock(size_t i) {
+	__sync_lock_release(&g_locks[i % k_worm_cache_stripes]);
+}
+
+
+/**
+ * @brief	looks up an inodes WORM state
+ *
+ * @param	st		the inodes (current) stat
+ *
+ * @return	the state as a label value; k_wormxattr_label_unknown if it isn't cached,
+ *			or has changed since it was
+ */
+intptr_t worm_cache_get(const struct stat* st) {
+	intptr_t retval = k_wormxattr_label_unknown;
+	size_t i = cache_index(st);
+	cache_entry_t* e = &g_cache[i];
+	
+	cache_lock(i);
+	if (	(e->dev == st->st_dev)
+		 && (e->ino == st->st_ino)
+		 && (e->ctime.tv_sec == st->st_ctim.tv_sec)
+		 && (e->ctime.tv_nsec == st->st_ctim.tv_nsec)) {
+		retval = e->value;
+	}
+	cache_unlock(i);
+	return retval;
+}
+
+
+/**
+ * @brief	caches an inodes WORM state
+ *
+ * @param	st		the inodes stat; from before the state was read
+ * @param	value	the state as a label value
+ */
+void worm_cache_set(const struct stat* st, intptr_t value) {
+	size_t i = cache_index(st);
+	cache_entry_t* e = &g_cache[i];
+	
+	cache_lock(i);
+	e->dev = st->st_dev;
+	e->ino = st->st_ino;
+	e->ctime = st->st_ctim;
+	e->value = value;
+	cache_unlock(i);
+}
+
+
+/**
+ * @brief	forgets an inodes WORM state; e.g. as its attribute has been changed
+ *
+ * @param	st		the inodes stat
+ */
+void worm_cache_invalidate(const struct stat* st) {
+	size_t i = cache_index(st);
+	cache_entry_t* e = &g_cache[i];
+	
+	cache_lock(i);
+	if (	(e->dev == st->st_dev)
+		 && (e->ino == st->st_ino)) {
+		e->value = k_wormxattr_label_unknown;
+	}
+	cache_unlock(i);
+}
@@ -0,0 +1,66 @@
+//
+//  worm_cache.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_cache_h
+#define tools_worm_cache_h
+
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+
+/*
+ * Description
+ *
+ * A process wide cache of WORM state keyed by device and inode.  Entries hold the 
+ * inode's ctime when the state was read; setting or removing an attribute changes it
+ * so a stale entry is never returned for an inode that's been stat'd since.  The cache
+ * is direct mapped (a colliding inode replaces an entry) and guarded by lock stripes,
+ * so it needs no initialization and can be used from a preloaded library.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_cache_bits				16
+#define k_worm_cache_stripes			256
+
+#ifdef __APPLE__
+#define st_ctim							st_ctimespec
+#endif
+
+
+/*
+ * Definitions
+ */
+
+extern intptr_t worm_cache_get(const struct stat* st);
+extern void worm_cache_set(const struct stat* st, intptr_t value);
+extern void worm_cache_invalidate(const struct stat* st);
+
+
+#endif
@@ -0,0 +1,389 @@
+//
+//  worm_digest.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "worm_digest.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Definitions
+ */
+
+#ifndef __APPLE__
+typedef void (*digest_blocks_t)(uint32_t h[8], const uint8_t* data, size_t blocks);
+
+static void digest_blocks_portable(uint32_t h[8], const uint8_t* data, size_t blocks);
+#if defined(__x86_64__) || defined(__i386__)
+static void digest_blocks_shani(uint32_t h[8], const uint8_t* data, size_t blocks);
+#endif
+
+static const uint32_t k_digest_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static digest_blocks_t g_digest_blocks = NULL;
+static const char* g_digest_impl = NULL;
+#endif
+
+
+/*
+ * Implementation
+ */
+
+#ifndef __APPLE__
+#define ror(x, n)		(((x) >> (n)) | ((x) << (32 - (n))))
+
+static void digest_blocks_portable(uint32_t h[8], const uint8_t* data, size_t blocks) {
+	for (; blocks > 0; blocks--, data += 64) {
+		uint32_t w[64];
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+		
+		for (int i = 0; i < 16; i++) {
+			w[i] = ((uint32_t) data[i * 4] << 24) | ((uint32_t) data[i * 4 + 1] << 16) | ((uint32_t) data[i * 4 + 2] << 8) | data[i * 4 + 3];
+		}
+		for (int i = 16; i < 64; i++) {
+			uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+		for (int i = 0; i < 64; i++) {
+			uint32_t t1 = hh + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + k_digest_k[i] + w[i];
+			uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			hh = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+		h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+	}
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief	the SHA extensions; two rounds an instruction, with the message schedule 
+ *			in four vectors of four words
+ */
+__attribute__((target("sha,sse4.1")))
+static void digest_blocks_shani(uint32_t h[8], const uint8_t* data, size_t blocks) {
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i tmp = _mm_loadu_si128((const __m128i*) &h[0]);
+	__m128i state1 = _mm_loadu_si128((const __m128i*) &h[4]);
+	__m128i state0;
+	
+	// the instructions take the state as ABEF and CDGH
+	tmp = _mm_shuffle_epi32(tmp, 0xb1);
+	state1 = _mm_shuffle_epi32(state1, 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+	
+	for (; blocks > 0; blocks--, data += 64) {
+		__m128i abef = state0;
+		__m128i cdgh = state1;
+		__m128i w[4];
+		
+		for (int i = 0; i < 16; i++) {
+			__m128i msg;
+			if (i < 4) {
+				w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + i * 16)), mask);
+			} else {
+				// w[t] = w[t-16] + s0(w[t-15]) + w[t-7] + s1(w[t-2])
+				msg = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+				msg = _mm_add_epi32(msg, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+				w[i & 3] = _mm_sha256msg2_epu32(msg, w[(i + 3) & 3]);
+			}
+			msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*) &k_digest_k[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+		}
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+	
+	// and back to ABCD and EFGH
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+	_mm_storeu_si128((__m128i*) &h[0], state0);
+	_mm_storeu_si128((__m128i*) &h[4], state1);
+}
+#endif
+
+
+/**
+ * @brief	picks the fastest implementation the CPU supports
+ */
+static void digest_select(void) {
+	digest_blocks_t blocks = digest_blocks_portable;
+	const char* impl = "portable";
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (	__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+		 && (ecx & bit_SSE4_1)
+		 && (ecx & bit_SSSE3)
+		 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+		 && (ebx & bit_SHA)) {
+		blocks = digest_blocks_shani;
+		impl = "sha-ni";
+	}
+#endif
+	g_digest_impl = impl;
+	__atomic_store_n(&g_digest_blocks, blocks, __ATOMIC_RELEASE);
+}
+#endif
+
+
+/**
+ * @brief	starts a digest
+ */
+void worm_digest_init(worm_digest_t* d) {
+#ifdef __APPLE__
+	CC_SHA256_Init(&d->cc);
+#else
+	static const uint32_t iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	if (__atomic_load_n(&g_digest_blocks, __ATOMIC_ACQUIRE) == NULL) {
+		digest_select(); // racing callers pick the same one
+	}
+	memcpy(d->h, iv, sizeof(iv));
+	d->len = 0;
+	d->used = 0;
+#endif
+}
+
+
+/**
+ * @brief	adds data to a digest
+ */
+void worm_digest_update(worm_digest_t* d, const void* data, size_t len) {
+#ifdef __APPLE__
+	// CC_SHA256_Update takes a 32 bit length
+	for (const uint8_t* p = data; len > 0;) {
+		CC_LONG n = (len > 0x40000000) ? 0x40000000: (CC_LONG) len;
+		CC_SHA256_Update(&d->cc, p, n);
+		p += n;
+		len -= n;
+	}
+#else
+	const uint8_t* p = data;
+	
+	d->len += len;
+	if (d->used > 0) {
+		size_t n = (len < 64 - d->used) ? len: 64 - d->used;
+		memcpy(d->block + d->used, p, n);
+		d->used += n;
+		p += n;
+		len -= n;
+		if (d->used < 64) {
+			return;
+		}
+		g_digest_blocks(d->h, d->block, 1);
+		d->used = 0;
+	}
+	if (len >= 64) {
+		g_digest_blocks(d->h, p, len / 64);
+		p += len & ~(size_t) 63;
+		len &= 63;
+	}
+	memcpy(d->block, p, len);
+	d->used = len;
+#endif
+}
+
+
+/**
+ * @brief	completes a digest
+ */
+void worm_digest_final(worm_digest_t* d, uint8_t digest[k_worm_digest_len]) {
+#ifdef __APPLE__
+	CC_SHA256_Final(digest, &d->cc);
+#else
+	uint64_t bits = d->len * 8;
+	uint8_t pad[72] = { 0x80 };
+	size_t n = ((d->used < 56) ? 56: 120) - d->used;
+	
+	for (int i = 0; i < 8; i++) {
+		pad[n + i] = (uint8_t) (bits >> (56 - i * 8));
+	}
+	worm_digest_update(d, pad, n + 8);
+	for (int i = 0; i < 8; i++) {
+		digest[i * 4] = (uint8_t) (d->h[i] >> 24);
+		digest[i * 4 + 1] = (uint8_t) (d->h[i] >> 16);
+		digest[i * 4 + 2] = (uint8_t) (d->h[i] >> 8);
+		digest[i * 4 + 3] = (uint8_t) d->h[i];
+	}
+#endif
+}
+
+
+/**
+ * @brief	the name of the implementation in use; for reports
+ */
+const char* worm_digest_impl(void) {
+#ifdef __APPLE__
+	return "commoncrypto";
+#else
+	if (__atomic_load_n(&g_digest_blocks, __ATOMIC_ACQUIRE) == NULL) {
+		digest_select();
+	}
+	return g_digest_impl;
+#endif
+}
+
+
+/**
+ * @brief	digests the contents of an open file; mapping it a window at a time
+ *
+ * @param	fd		the file; opened for reading
+ * @param	digest	on success its digest
+ * @param	bytes	if not NULL, on success the number of bytes digested
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_digest_fd(int fd, uint8_t digest[k_worm_digest_len], uint64_t* bytes) {
+	int retval = -1;
+	worm_digest_t d;
+	struct stat st;
+	
+	if (fstat(fd, &st) != 0) {
+		goto out;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		errno = EINVAL;
+		goto out;
+	}
+	worm_digest_init(&d);
+	for (off_t off = 0; off < st.st_size; off += k_worm_digest_window) {
+		size_t len = (st.st_size - off < k_worm_digest_window) ? (size_t) (st.st_size - off): k_worm_digest_window;
+		void* p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, off);
+		if (p == MAP_FAILED) {
+			goto out;
+		}
+		(void) madvise(p, len, MADV_SEQUENTIAL | MADV_WILLNEED);
+		worm_digest_update(&d, p, len);
+		(void) munmap(p, len);
+	}
+	worm_digest_final(&d, digest);
+	if (bytes != NULL) {
+		*bytes = (uint64_t) st.st_size;
+	}
+	retval = 0;
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	reads the digest stored with an open file
+ *
+ * @param	fd		the file
+ * @param	digest	on success the stored digest
+ *
+ * @return	0 on success, else -1 and errno is set; ENOATTR/ENODATA if it has none and
+ *			EINVAL if it isn't a digest we understand
+ */
+int worm_digest_get(int fd, uint8_t digest[k_worm_digest_len]) {
+	int retval = -1;
+	char value[k_worm_digest_value_len + 1];
+#ifdef __APPLE__
+	ssize_t len = fgetxattr(fd, k_worm_digest_xattr_name, value, sizeof(value), 0, 0);
+#else
+	ssize_t len = fgetxattr(fd, k_worm_digest_xattr_name, value, sizeof(value));
+#endif
+	const char* hex = value + sizeof(k_worm_digest_prefix) - 1;
+	
+	if (len < 0) {
+		if (errno == ERANGE) {
+			errno = EINVAL;
+		}
+		goto out;
+	}
+	if (	((size_t) len != k_worm_digest_value_len)
+		 || (memcmp(value, k_worm_digest_prefix, sizeof(k_worm_digest_prefix) - 1) != 0)) {
+		errno = EINVAL;
+		goto out;
+	}
+	for (int i = 0; i < k_worm_digest_len; i++) {
+		unsigned int byte = 0;
+		if (sscanf(hex + i * 2, "%2x", &byte) != 1) {
+			errno = EINVAL;
+			goto out;
+		}
+		digest[i] = (uint8_t) byte;
+	}
+	retval = 0;
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	stores a digest with an open file; before it's sealed
+ *
+ * @param	fd		the file
+ * @param	digest	its digest
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_digest_set(int fd, const uint8_t digest[k_worm_digest_len]) {
+	char value[k_worm_digest_value_len + 1];
+	size_t len = (size_t) snprintf(value, sizeof(value), "%s", k_worm_digest_prefix);
+	
+	for (int i = 0; i < k_worm_digest_len; i++) {
+		len += (size_t) snprintf(value + len, sizeof(value) - len, "%02x", digest[i]);
+	}
+#ifdef __APPLE__
+	return fsetxattr(fd, k_worm_digest_xattr_name, value, len, 0, 0);
+#else
+	return fsetxattr(fd, k_worm_digest_xattr_name, value, len, 0);
+#endif
+}
@@ -0,0 +1,89 @@
+//
+//  worm_digest.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_digest_h
+#define tools_worm_digest_h
+
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef __APPLE__
+#include <CommonCrypto/CommonDigest.h>
+#endif
+
+
+/*
+ * Description
+ *
+ * The content digest stored next to our attribute when a file is sealed; a SHA-256
+ * of its contents, held as "sha256:<hex>" in k_worm_digest_xattr_name.  It has to be
+ * set before the file is sealed as a sealed file's attributes can't be changed.
+ *
+ * On x86 the SHA extensions are used when the CPU has them (checked once, at the 
+ * first digest); otherwise a portable implementation.  On macOS CommonCrypto, which
+ * uses the hardware, does the work.  Files are mapped and digested a window at a 
+ * time so the digest runs at the speed of the disk rather than of copies.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_digest_len				32
+#define k_worm_digest_prefix			"sha256:"
+#define k_worm_digest_value_len			(sizeof(k_worm_digest_prefix) - 1 + k_worm_digest_len * 2)
+#define k_worm_digest_window			(64 * 1024 * 1024)	// bytes mapped at once
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a digest in progress
+ */
+typedef struct {
+#ifdef __APPLE__
+	CC_SHA256_CTX		cc;
+#else
+	uint32_t			h[8];
+	uint64_t			len;		// bytes digested
+	uint8_t				block[64];	// a partial block
+	size_t				used;
+#endif
+} worm_digest_t;
+
+extern void worm_digest_init(worm_digest_t* d);
+extern void worm_digest_update(worm_digest_t* d, const void* data, size_t len);
+extern void worm_digest_final(worm_digest_t* d, uint8_t digest[k_worm_digest_len]);
+extern const char* worm_digest_impl(void);
+
+extern int worm_digest_fd(int fd, uint8_t digest[k_worm_digest_len], uint64_t* bytes);
+extern int worm_digest_get(int fd, uint8_t digest[k_worm_digest_len]);
+extern int worm_digest_set(int fd, const uint8_t digest[k_worm_digest_len]);
+
+
+#endif
@@ -0,0 +1,379 @@
+//
+//  worm_dirindex.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "worm_dirindex.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	an entry being sorted; name points into the names read
+ */
+typedef struct {
+	const char*			name;
+	uint64_t			ino;
+	uint16_t			len;
+	uint8_t				type;
+} worm_dirindex_sort_t;
+
+static int index_list(int dirfd, char** names, size_t* size, worm_dirindex_sort_t** entries, size_t* count);
+static int index_compare(const void* a, const void* b);
+static int index_pwrite(int fd, const void* buf, size_t len, off_t offset);
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	lists a directory; the names (each NUL terminated) and an entry for each
+ *
+ * @param	dirfd		the directory
+ * @param	names		on success the names; free'd by the caller
+ * @param	size		on success the size of names
+ * @param	entries		on success the entries, pointing into names; free'd by the caller
+ * @param	count		on success the number of entries
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int index_list(int dirfd, char** names, size_t* size, worm_dirindex_sort_t** entries, size_t* count) {
+	int retval = -1;
+	int fd = dup(dirfd); // closedir closes it
+	DIR* dir = NULL;
+	struct dirent* ent = NULL;
+	char* blob = NULL;
+	size_t used = 0, space = 0;
+	worm_dirindex_sort_t* list = NULL;
+	size_t n = 0, slots = 0;
+	
+	if (	(fd == -1)
+		 || ((dir = fdopendir(fd)) == NULL)) {
+		if (fd != -1) {
+			close(fd);
+		}
+		goto out;
+	}
+	rewinddir(dir);
+	while ((errno = 0, ent = readdir(dir)) != NULL) {
+		size_t len = strlen(ent->d_name);
+		
+		if (	(ent->d_name[0] == '.')
+			 && ((ent->d_name[1] == '\0') || ((ent->d_name[1] == '.') && (ent->d_name[2] == '\0')))) {
+			continue;
+		}
+		if (used + len + 1 > UINT32_MAX) {
+			errno = EFBIG; // too big to index
+			goto out;
+		}
+		if (used + len + 1 > space) {
+			char* grown = realloc(blob, space = (space ? space * 2: 64 * 1024) + len + 1);
+			if (grown == NULL) {
+				goto out;
+			}
+			blob = grown;
+		}
+		if (n == slots) {
+			worm_dirindex_sort_t* grown = realloc(list, (slots = slots ? slots * 2: 1024) * sizeof(*list));
+			if (grown == NULL) {
+				goto out;
+			}
+			list = grown;
+		}
+		memcpy(blob + used, ent->d_name, len + 1);
+		list[n].name = (const char*) (uintptr_t) used; // an offset until the names stop moving
+		list[n].ino = (uint64_t) ent->d_ino;
+		list[n].len = (uint16_t) len;
+		list[n].type = ent->d_type;
+		if (list[n].type == DT_UNKNOWN) {
+			struct stat st;
+			if (fstatat(dirfd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+				list[n].type = S_ISDIR(st.st_mode) ? DT_DIR: S_ISREG(st.st_mode) ? DT_REG: S_ISLNK(st.st_mode) ? DT_LNK: DT_UNKNOWN;
+			}
+		}
+		used += len + 1;
+		n++;
+	}
+	if (errno != 0) {
+		goto out;
+	}
+	for (size_t i = 0; i < n; i++) {
+		list[i].name = blob + (uintptr_t) list[i].name;
+	}
+	*names = blob;
+	*size = used;
+	*entries = list;
+	*count = n;
+	blob = NULL;
+	list = NULL;
+	retval = 0;
+out:
+	if (dir != NULL) {
+		int err = errno;
+		closedir(dir);
+		errno = err;
+	}
+	free(blob);
+	free(list);
+	return retval;
+}
+
+
+static int index_compare(const void* a, const void* b) {
+	return strcmp(((const worm_dirindex_sort_t*) a)->name, ((const worm_dirindex_sort_t*) b)->name);
+}
+
+
+static int index_pwrite(int fd, const void* buf, size_t len, off_t offset) {
+	int retval = 0;
+	while (	(retval == 0)
+		   && (len > 0)) {
+		ssize_t n = pwrite(fd, buf, len, offset);
+		if (n > 0) {
+			buf = (const char*) buf + n;
+			len -= (size_t) n;
+			offset += n;
+		} else if ((n == -1) && (errno == EINTR)) {
+			// again
+		} else {
+			if (n == 0) {
+				errno = EIO;
+			}
+			retval = -1;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	lists a (sealed) directory and writes its index; synced, header last
+ *
+ * @param	dirfd	the directory
+ * @param	fd		the index; open for writing and empty
+ * @param	count	on success the number of entries indexed; may be NULL
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_dirindex_write(int dirfd, int fd, uint32_t* count) {
+	int retval = -1;
+	worm_dirindex_header_t header = {k_worm_dirindex_magic, k_worm_dirindex_version};
+	worm_dirindex_entry_t* entries = NULL;
+	worm_dirindex_sort_t* list = NULL;
+	char* names = NULL;
+	size_t size = 0, n = 0;
+	struct stat st;
+	
+	if (	(fstat(dirfd, &st) != 0)
+		 || (index_list(dirfd, &names, &size, &list, &n) != 0)) {
+		goto out;
+	}
+	if (n > UINT32_MAX) {
+		errno = EFBIG;
+		goto out;
+	}
+	qsort(list, n, sizeof(*list), index_compare);
+	if ((entries = calloc(n ? n: 1, sizeof(*entries))) == NULL) {
+		goto out;
+	}
+	for (size_t i = 0; i < n; i++) {
+		entries[i].ino = list[i].ino;
+		entries[i].name = (uint32_t) (list[i].name - names);
+		entries[i].len = list[i].len;
+		entries[i].type = list[i].type;
+	}
+	header.count = (uint32_t) n;
+	header.dir = (uint64_t) st.st_ino;
+	header.names = size;
+	if (	(index_pwrite(fd, entries, n * sizeof(*entries), sizeof(header)) == 0)
+		 && (index_pwrite(fd, names, size, (off_t) (sizeof(header) + n * sizeof(*entries))) == 0)
+		 && (fsync(fd) == 0)
+		 && (index_pwrite(fd, &header, sizeof(header), 0) == 0)
+		 && (fsync(fd) == 0)) {
+		if (count) {
+			*count = header.count;
+		}
+		retval = 0;
+	}
+out:
+	free(entries);
+	free(list);
+	free(names);
+	return retval;
+}
+
+
+/**
+ * @brief	maps a sealed directory's index; the directory must be sealed, and the index
+ *			must be for it and complete
+ *
+ * @param	index	the index to open
+ * @param	dirfd	the directory
+ *
+ * @return	0 on success, else -1 and errno is set; ENOENT if it has no index, ESTALE if
+ *			it isn't sealed (so the index can't be trusted) and EINVAL if its invalid
+ *			(including an entry which isn't worm_dirindex_valid)
+ */
+int worm_dirindex_open(worm_dirindex_t* index, int dirfd) {
+	int retval = -1;
+	int fd = openat(dirfd, k_worm_dirindex_name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+	const worm_dirindex_header_t* header = NULL;
+	struct stat st, dst;
+	int sealed = 0;
+	
+	memset(index, 0, sizeof(*index));
+	if (fd == -1) {
+		goto out;
+	}
+	if (	(fstat(fd, &st) != 0)
+		 || (fstat(dirfd, &dst) != 0)
+		 || ((sealed = worm_xattr_fsealed(dirfd)) == -1)) {
+		goto out;
+	}
+	if (sealed == 0) {
+		errno = ESTALE;
+		goto out;
+	}
+	if (	!S_ISREG(st.st_mode)
+		 || ((size_t) st.st_size < sizeof(*header))) {
+		errno = EINVAL;
+		goto out;
+	}
+	index->size = (size_t) st.st_size;
+	if ((index->base = mmap(NULL, index->size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		index->base = NULL;
+		goto out;
+	}
+	header = index->base;
+	if (	(memcmp(header->magic, k_worm_dirindex_magic, sizeof(header->magic)) != 0)
+		 || (header->version != k_worm_dirindex_version)
+		 || (header->dir != (uint64_t) dst.st_ino)
+		 || (header->names > UINT32_MAX)
+		 || (sizeof(*header) + (uint64_t) header->count * sizeof(worm_dirindex_entry_t) + header->names != index->size)
+		 || (	(header->names > 0)
+			 && (((const char*) index->base)[index->size - 1] != '\0'))) {
+		errno = EINVAL;
+		goto out;
+	}
+	index->count = header->count;
+	index->entries = (const worm_dirindex_entry_t*) (header + 1);
+	index->names = (const char*) (index->entries + index->count);
+	for (uint32_t i = 0; i < index->count; i++) {
+		if (!worm_dirindex_valid(index, &index->entries[i])) {
+			errno = EINVAL; // written before sealing, by anyone; readers open its names
+			goto out;
+		}
+	}
+	retval = 0;
+out:
+	if (fd != -1) {
+		close(fd);
+	}
+	if (retval != 0) {
+		int err = errno;
+		worm_dirindex_close(index);
+		errno = err;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks an entry's name can be used as one; within the names, len long and a
+ *			single component (not empty, ".", ".." or containing a '/')
+ *
+ * @return	true if it can
+ */
+bool worm_dirindex_valid(const worm_dirindex_t* index, const worm_dirindex_entry_t* entry) {
+	bool retval = false;
+	size_t names = index->size - (size_t) (index->names - (const char*) index->base);
+	if (	((size_t) entry->name + entry->len < names)
+		 && (entry->len > 0)) {
+		const char* name = index->names + entry->name;
+		retval = (	(name[entry->len] == '\0')
+				  && (memchr(name, '\0', entry->len) == NULL)
+				  && (memchr(name, '/', entry->len) == NULL)
+				  && (strcmp(name, ".") != 0)
+				  && (strcmp(name, "..") != 0));
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets the name of an entry; "" if the entry's out of bounds
+ */
+const char* worm_dirindex_name(const worm_dirindex_t* index, const worm_dirindex_entry_t* entry) {
+	const char* retval = "";
+	size_t names = index->size - (size_t) (index->names - (const char*) index->base);
+	if ((size_t) entry->name + entry->len < names) {
+		retval = index->names + entry->name;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	looks a name up; a binary search of the entries
+ *
+ * @return	its entry, else NULL if the directory has no such entry
+ */
+const worm_dirindex_entry_t* worm_dirindex_lookup(const worm_dirindex_t* index, const char* name) {
+	const worm_dirindex_entry_t* retval = NULL;
+	size_t lo = 0, hi = index->count;
+	
+	while (	(retval == NULL)
+		   && (lo < hi)) {
+		size_t mid = lo + (hi - lo) / 2;
+		int order = strcmp(name, worm_dirindex_name(index, &index->entries[mid]));
+		if (order == 0) {
+			retval = &index->entries[mid];
+		} else if (order < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return retval;
+}
+
+
+void worm_dirindex_close(worm_dirindex_t* index) {
+	if (index->base != NULL) {
+		(void) munmap(index->base, index->size);
+	}
+	memset(index, 0, sizeof(*index));
+}
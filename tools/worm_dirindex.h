@@ -0,0 +1,126 @@
+//
+//  worm_dirindex.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_dirindex_h
+#define tools_worm_dirindex_h
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * The index of a sealed directory; a sidecar file (k_worm_dirindex_name, within the
+ * directory) listing its entries sorted by name, so readers can list it or look a
+ * name up from a memory mapping rather than reading the directory.  A sealed
+ * directory's entries can't change (see wormxattr_policy.h) so the index, once
+ * written and made WORM, stays exact.
+ *
+ * wormseal -S creates the (empty) index first, as nothing can be created in the
+ * directory once its sealed, then seals the directory, lists it and writes the index.
+ * The header is written last, after the entries are synced; an index without one (a
+ * crash part way) is invalid and readers fall back to reading the directory.  The
+ * index lists itself.
+ *
+ * The file is a header, the entries (sorted by name, as strcmp orders them) and the
+ * names; each NUL terminated.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_dirindex_version			1
+#define k_worm_dirindex_magic			"WORMDIR"
+#define k_worm_dirindex_name			".wormindex"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the header at the start of an index
+ *
+ * @field	magic		k_worm_dirindex_magic
+ * @field	version		k_worm_dirindex_version
+ * @field	count		the number of entries
+ * @field	dir			the inode of the directory indexed
+ * @field	names		the size of the names
+ */
+typedef struct {
+	char				magic[8];
+	uint32_t			version;
+	uint32_t			count;
+	uint64_t			dir;
+	uint64_t			names;
+} worm_dirindex_header_t;
+
+/**
+ * @brief	an entry of the directory
+ *
+ * @field	ino			its inode
+ * @field	name		the offset of its name in the names
+ * @field	len			the length of its name
+ * @field	type		its type; DT_*
+ */
+typedef struct {
+	uint64_t			ino;
+	uint32_t			name;
+	uint16_t			len;
+	uint8_t				type;
+	uint8_t				reserved;
+} worm_dirindex_entry_t;
+
+/**
+ * @brief	an index mapped for reading
+ *
+ * @field	base		the mapping
+ * @field	size		the size of the mapping
+ * @field	count		the number of entries
+ * @field	entries		the entries; sorted by name
+ * @field	names		the names
+ */
+typedef struct {
+	void*							base;
+	size_t							size;
+	uint32_t						count;
+	const worm_dirindex_entry_t*	entries;
+	const char*						names;
+} worm_dirindex_t;
+
+extern int worm_dirindex_write(int dirfd, int fd, uint32_t* count);
+extern int worm_dirindex_open(worm_dirindex_t* index, int dirfd);
+extern const worm_dirindex_entry_t* worm_dirindex_lookup(const worm_dirindex_t* index, const char* name);
+extern const char* worm_dirindex_name(const worm_dirindex_t* index, const worm_dirindex_entry_t* entry);
+extern bool worm_dirindex_valid(const worm_dirindex_t* index, const worm_dirindex_entry_t* entry);
+extern void worm_dirindex_close(worm_dirindex_t* index);
+
+
+#endif
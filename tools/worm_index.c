@@ -0,0 +1,355 @@
+//
+//  worm_index.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "worm_index.h"
+
+
+/*
+ * Definitions
+ */
+
+static int bucket_open(const char* path, int flags);
+static int bucket_compare(const void* a, const void* b);
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	opens and exclusively locks a bucket; retrying if it was replaced (by a rewrite)
+ *			between it being opened and locked
+ *
+ * @param	path	the bucket
+ * @param	flags	the open flags
+ *
+ * @return	the locked file descriptor, else -1 and errno is set
+ */
+static int bucket_open(const char* path, int flags) {
+	int retval = -1;
+	struct stat st = {0};
+	
+	while ((retval = open(path, flags, 0644)) != -1) {
+		if (	flock(retval, LOCK_EX) != 0
+			 || fstat(retval, &st) != 0) {
+			close(retval);
+			retval = -1;
+			break;
+		}
+		if (st.st_nlink > 0) {
+			break; // still the live bucket
+		}
+		close(retval);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	appends a record for a file to the bucket for the day it expires
+ *
+ * @param	index	the index directory; created if it doesn't exist
+ * @param	expires	the time the file expires (seconds since the epoch)
+ * @param	path	the absolute path of the file
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_index_append(const char* index, uint64_t expires, const char* path) {
+	return worm_index_append_paths(index, expires, &path, 1);
+}
+
+
+/**
+ * @brief	appends records for several files which expire at the same time; with one
+ *			lock and one sync, so bulk sealers aren't bound by the sync rate
+ *
+ * @param	index	the index directory; created if it doesn't exist
+ * @param	expires	the time the files expire (seconds since the epoch)
+ * @param	paths	the absolute paths of the files
+ * @param	count	the number of paths
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_index_append_paths(const char* index, uint64_t expires, const char* const* paths, size_t count) {
+	int retval = -1;
+	char bucket[PATH_MAX] = {0};
+	char prefix[32] = {0};
+	struct iovec iov[k_worm_index_batch_max * 2];
+	size_t total = 0;
+	int fd = -1;
+	ssize_t len = 0;
+	
+	if (mkdir(index, 0755) != 0 && errno != EEXIST) {
+		goto out;
+	}
+	snprintf(bucket, sizeof(bucket), "%s/%08" PRIu64 k_worm_index_suffix, index, expires / k_worm_index_bucket_secs);
+	snprintf(prefix, sizeof(prefix), "%" PRIu64 " ", expires);
+	if ((fd = bucket_open(bucket, O_WRONLY | O_APPEND | O_CREAT)) != -1) {
+		retval = 0;
+		for (size_t i = 0; (retval == 0) && (i < count); i += k_worm_index_batch_max) {
+			size_t n = (count - i < k_worm_index_batch_max) ? count - i: k_worm_index_batch_max;
+			
+			// a single write so a crash never leaves half a record before a later one
+			total = 0;
+			for (size_t j = 0; j < n; j++) {
+				iov[j * 2].iov_base = prefix;
+				iov[j * 2].iov_len = strlen(prefix);
+				iov[j * 2 + 1].iov_base = (void*) paths[i + j];
+				iov[j * 2 + 1].iov_len = strlen(paths[i + j]) + 1;
+				total += iov[j * 2].iov_len + iov[j * 2 + 1].iov_len;
+			}
+			len = writev(fd, iov, (int) n * 2);
+			if (len != (ssize_t) total) {
+				if (len >= 0) {
+					errno = EIO;
+				}
+				retval = -1;
+			}
+		}
+		if (retval == 0) {
+			retval = fsync(fd);
+		}
+		close(fd);
+	}
+out:
+	return retval;
+}
+
+
+static int bucket_compare(const void* a, const void* b) {
+	return strcmp(*(const char**) a, *(const char**) b);
+}
+
+
+/**
+ * @brief	lists the buckets which hold records which may have expired; oldest first
+ *
+ * @param	index	the index directory
+ * @param	now		the current time (seconds since the epoch)
+ * @param	buckets	on success an allocated array of allocated bucket paths; free both
+ * @param	count	on success the number of buckets
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_index_due(const char* index, uint64_t now, char*** buckets, size_t* count) {
+	int retval = -1;
+	uint64_t today = now / k_worm_index_bucket_secs;
+	DIR* dir = NULL;
+	struct dirent* ent = NULL;
+	char** list = NULL;
+	size_t n = 0;
+	size_t space = 0;
+	
+	*buckets = NULL;
+	*count = 0;
+	if ((dir = opendir(index)) == NULL) {
+		goto out;
+	}
+	while ((ent = readdir(dir)) != NULL) {
+		char* end = NULL;
+		uint64_t day = strtoull(ent->d_name, &end, 10);
+		char* path = NULL;
+		
+		if (	end == ent->d_name
+			 || strcmp(end, k_worm_index_suffix) != 0
+			 || day > today) {
+			continue;
+		}
+		if (n == space) {
+			char** grown = NULL;
+			
+			space = space ? space * 2: 16;
+			if ((grown = realloc(list, space * sizeof(*list))) == NULL) {
+				goto fail;
+			}
+			list = grown;
+		}
+		if (asprintf(&path, "%s/%s", index, ent->d_name) == -1) {
+			goto fail;
+		}
+		list[n++] = path;
+	}
+	qsort(list, n, sizeof(*list), bucket_compare);
+	*buckets = list;
+	*count = n;
+	list = NULL;
+	retval = 0;
+
+fail:
+	if (list != NULL) {
+		while (n > 0) {
+			free(list[--n]);
+		}
+		free(list);
+	}
+	closedir(dir);
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	opens, locks and parses a bucket; it stays locked (stopping the sealer appending
+ *			to it) until it's closed
+ *
+ * @param	bucket	the bucket path
+ * @param	b		on success the loaded bucket; close it with worm_index_close
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_index_load(const char* bucket, worm_index_bucket_t* b) {
+	int retval = -1;
+	struct stat st = {0};
+	size_t off = 0;
+	size_t space = 0;
+	
+	memset(b, 0, sizeof(*b));
+	b->fd = -1;
+	if (	(b->path = strdup(bucket)) == NULL
+		 || (b->fd = bucket_open(bucket, O_RDWR)) == -1
+		 || fstat(b->fd, &st) != 0
+		 || (b->data = malloc((size_t) st.st_size + 1)) == NULL) {
+		goto out;
+	}
+	while (off < (size_t) st.st_size) {
+		ssize_t len = pread(b->fd, b->data + off, (size_t) st.st_size - off, (off_t) off);
+		if (len <= 0) {
+			if (len == 0) {
+				errno = EIO;
+			}
+			goto out;
+		}
+		off += (size_t) len;
+	}
+	b->data[off] = '\0'; // a torn final record is terminated (and dropped below)
+	
+	for (char* rec = b->data; rec < b->data + off; rec += strlen(rec) + 1) {
+		char* end = NULL;
+		uint64_t expires = strtoull(rec, &end, 10);
+		
+		if (	end == rec
+			 || *end != ' '
+			 || end[1] != '/') {
+			continue; // not a record we wrote; drop it
+		}
+		if (b->count == space) {
+			worm_index_record_t* grown = NULL;
+			
+			space = space ? space * 2: 64;
+			if ((grown = realloc(b->records, space * sizeof(*grown))) == NULL) {
+				goto out;
+			}
+			b->records = grown;
+		}
+		b->records[b->count].expires = expires;
+		b->records[b->count].path = end + 1;
+		b->count++;
+	}
+	retval = 0;
+
+out:
+	if (retval != 0) {
+		int err = errno;
+		worm_index_close(b);
+		errno = err;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	replaces the contents of a loaded bucket, removing it if there are no records
+ *			left.  The new contents are written to a temporary file and renamed over it
+ *
+ * @param	b		the loaded bucket
+ * @param	records	the records to keep
+ * @param	count	the number of records
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_index_rewrite(worm_index_bucket_t* b, const worm_index_record_t* records, size_t count) {
+	int retval = -1;
+	char tmp[PATH_MAX] = {0};
+	FILE* f = NULL;
+	size_t i = 0;
+	
+	if (count == 0) {
+		retval = unlink(b->path);
+		goto out;
+	}
+	snprintf(tmp, sizeof(tmp), "%s.%d.tmp", b->path, (int) getpid());
+	if ((f = fopen(tmp, "w")) == NULL) {
+		goto out;
+	}
+	for (i = 0; i < count; i++) {
+		if (fprintf(f, "%" PRIu64 " %s%c", records[i].expires, records[i].path, '\0') < 0) {
+			break;
+		}
+	}
+	if (	i != count
+		 || fflush(f) != 0
+		 || fsync(fileno(f)) != 0) {
+		fclose(f);
+		unlink(tmp);
+		goto out;
+	}
+	fclose(f);
+	if ((retval = rename(tmp, b->path)) != 0) {
+		unlink(tmp);
+	}
+
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	unlocks and frees a loaded bucket
+ *
+ * @param	b	the bucket
+ */
+void worm_index_close(worm_index_bucket_t* b) {
+	if (b->fd != -1) {
+		close(b->fd);
+	}
+	free(b->records);
+	free(b->data);
+	free(b->path);
+	memset(b, 0, sizeof(*b));
+	b->fd = -1;
+}
@@ -0,0 +1,96 @@
+//
+//  worm_index.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_index_h
+#define tools_worm_index_h
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * The expiry index is a directory of buckets, one per day, named for the day (seconds
+ * since the epoch / 86400) so that sorting the names sorts them by time.  The sealer 
+ * appends "<expires> <path>\0" records to the bucket for the day a file expires and
+ * the sweeper only reads buckets which are due, so neither walks the file system.
+ *
+ * Buckets are locked (flock) while they're appended to or rewritten; a writer which
+ * finds the bucket it locked was replaced whilst it waited opens it again.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_index_bucket_secs		86400
+#define k_worm_index_suffix				".idx"
+#define k_worm_index_batch_max			512		// records per write; within IOV_MAX
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a single record in a bucket
+ *
+ * @field	expires		the time the file expires (seconds since the epoch)
+ * @field	path		the absolute path of the file
+ */
+typedef struct {
+	uint64_t		expires;
+	const char*		path;
+} worm_index_record_t;
+
+/**
+ * @brief	a bucket loaded (and locked) for rewriting
+ *
+ * @field	path		the path of the bucket file
+ * @field	fd			the open and locked bucket
+ * @field	data		the contents of the bucket; records point into it
+ * @field	records		the records parsed from the bucket
+ * @field	count		the number of records
+ */
+typedef struct {
+	char*					path;
+	int						fd;
+	char*					data;
+	worm_index_record_t*	records;
+	size_t					count;
+} worm_index_bucket_t;
+
+extern int worm_index_append(const char* index, uint64_t expires, const char* path);
+extern int worm_index_append_paths(const char* index, uint64_t expires, const char* const* paths, size_t count);
+extern int worm_index_due(const char* index, uint64_t now, char*** buckets, size_t* count);
+extern int worm_index_load(const char* bucket, worm_index_bucket_t* b);
+extern int worm_index_rewrite(worm_index_bucket_t* b, const worm_index_record_t* records, size_t count);
+extern void worm_index_close(worm_index_bucket_t* b);
+
+
+#endif
@@ -0,0 +1,732 @@
+//
+//  worm_log.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "worm_log.h"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a segment (or index) mapped for reading
+ *
+ * @field	fd		the file
+ * @field	base	the mapping
+ * @field	size	the size of the mapping
+ */
+typedef struct {
+	int					fd;
+	void*				base;
+	size_t				size;
+} worm_log_map_t;
+
+/**
+ * @brief	a record number and the uid which made it; sorted to build the postings
+ */
+typedef struct {
+	uint32_t			uid;
+	uint32_t			record;
+} worm_log_posting_t;
+
+static void log_path(char* path, size_t len, const char* dir, uint64_t number, const char* suffix);
+static int log_map(const char* path, int flags, worm_log_map_t* map);
+static void log_unmap(worm_log_map_t* map);
+static worm_log_header_t* log_header(const worm_log_map_t* map);
+static int log_create(worm_log_t* log, uint64_t number, uint64_t session, uint64_t next);
+static int log_rotate(worm_log_t* log);
+static int posting_compare(const void* a, const void* b);
+static int number_compare(const void* a, const void* b);
+static bool record_matches(const worm_log_filter_t* filter, const audit_export_t* r);
+static bool range_matches(const worm_log_filter_t* filter, uint64_t minTime, uint64_t maxTime, uint32_t hooks);
+static const worm_log_index_header_t* index_map(const char* dir, uint64_t number, uint64_t records, worm_log_map_t* map);
+static const worm_log_uid_t* index_uid(const worm_log_index_header_t* index, uint32_t uid);
+
+
+/*
+ * Implementation
+ */
+
+static void log_path(char* path, size_t len, const char* dir, uint64_t number, const char* suffix) {
+	snprintf(path, len, "%s/%010" PRIu64 "%s", dir, number, suffix);
+}
+
+
+/**
+ * @brief	maps the whole of a file
+ *
+ * @param	path	the file
+ * @param	flags	O_RDONLY or O_RDWR
+ * @param	map		on success the mapping; unmap it with log_unmap
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int log_map(const char* path, int flags, worm_log_map_t* map) {
+	int retval = -1;
+	struct stat st = {0};
+	int prot = (flags == O_RDWR) ? PROT_READ | PROT_WRITE: PROT_READ;
+	
+	map->base = MAP_FAILED;
+	map->size = 0;
+	if ((map->fd = open(path, flags)) == -1) {
+		goto out;
+	}
+	if (fstat(map->fd, &st) != 0) {
+		goto fail;
+	}
+	if (st.st_size < (off_t) sizeof(worm_log_index_header_t)) {
+		errno = EPROTO;
+		goto fail;
+	}
+	map->size = (size_t) st.st_size;
+	if ((map->base = mmap(NULL, map->size, prot, MAP_SHARED, map->fd, 0)) == MAP_FAILED) {
+		goto fail;
+	}
+	retval = 0;
+	goto out;
+	
+fail:
+	log_unmap(map);
+out:
+	return retval;
+}
+
+
+static void log_unmap(worm_log_map_t* map) {
+	if (map->base != MAP_FAILED) {
+		munmap(map->base, map->size);
+	}
+	if (map->fd != -1) {
+		close(map->fd);
+	}
+	map->base = MAP_FAILED;
+	map->fd = -1;
+}
+
+
+/**
+ * @brief	checks a mapped segment is one we can read
+ *
+ * @return	its header, else NULL and errno is set
+ */
+static worm_log_header_t* log_header(const worm_log_map_t* map) {
+	worm_log_header_t* retval = map->base;
+	
+	if (	map->size < k_worm_log_header_size
+		 || memcmp(retval->magic, k_worm_log_magic, sizeof(k_worm_log_magic)) != 0
+		 || retval->version != k_worm_log_version
+		 || retval->recordSize != sizeof(audit_export_t)
+		 || retval->capacity > (map->size - k_worm_log_header_size) / sizeof(audit_export_t)
+		 || retval->count > retval->capacity) {
+		errno = EPROTO;
+		retval = NULL;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	creates, at its full size, and maps a new segment for writing
+ *
+ * @param	log		the log
+ * @param	number	the segment number
+ * @param	session	the session of the last record written; carried so the recorder can resume
+ * @param	next	the seq after the last record written
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int log_create(worm_log_t* log, uint64_t number, uint64_t session, uint64_t next) {
+	int retval = -1;
+	char path[PATH_MAX] = {0};
+	size_t size = k_worm_log_header_size + log->capacity * sizeof(audit_export_t);
+	void* base = MAP_FAILED;
+	
+	log_path(path, sizeof(path), log->dir, number, k_worm_log_segment_suffix);
+	if ((log->fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644)) == -1) {
+		goto out;
+	}
+	if (	ftruncate(log->fd, (off_t) size) != 0
+		 || (base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0)) == MAP_FAILED) {
+		int err = errno;
+		close(log->fd);
+		unlink(path);
+		log->fd = -1;
+		errno = err;
+		goto out;
+	}
+	log->number = number;
+	log->header = base;
+	log->records = (audit_export_t*) ((char*) base + k_worm_log_header_size);
+	log->header->version = k_worm_log_version;
+	log->header->recordSize = sizeof(audit_export_t);
+	log->header->capacity = log->capacity;
+	log->header->session = session;
+	log->header->next = next;
+	__sync_synchronize();
+	memcpy(log->header->magic, k_worm_log_magic, sizeof(k_worm_log_magic)); // last; its a segment now
+	retval = 0;
+	
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	seals the full segment, indexes it and starts the next
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int log_rotate(worm_log_t* log) {
+	int retval = -1;
+	uint64_t number = log->number;
+	uint64_t session = log->header->session;
+	uint64_t next = log->header->next;
+	size_t size = k_worm_log_header_size + log->header->capacity * sizeof(audit_export_t);
+	
+	log->header->sealed = 1;
+	if (	msync(log->header, size, MS_SYNC) != 0
+		 || fsync(log->fd) != 0) {
+		goto out;
+	}
+	munmap(log->header, size);
+	close(log->fd);
+	log->header = NULL;
+	log->records = NULL;
+	log->fd = -1;
+	
+	if (worm_log_index(log->dir, number) != 0) {
+		// the query scans a segment without an index; so carry on
+		fprintf(stderr, "worm_log: unable to index segment %" PRIu64 "; %s\n", number, strerror(errno));
+	}
+	retval = log_create(log, number + 1, session, next);
+	
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	opens a log for writing; creating its directory if needed.  Writing resumes
+ *			in the last segment unless its sealed
+ *
+ * @param	log			on success the open log; close it with worm_log_close
+ * @param	dir			the log directory
+ * @param	segmentSize	the size of new segments; 0 for k_worm_log_segment_size
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_log_open(worm_log_t* log, const char* dir, size_t segmentSize) {
+	int retval = -1;
+	uint64_t* numbers = NULL;
+	size_t count = 0;
+	worm_log_map_t map = {-1, MAP_FAILED, 0};
+	worm_log_header_t* header = NULL;
+	char path[PATH_MAX] = {0};
+	
+	memset(log, 0, sizeof(*log));
+	log->fd = -1;
+	if (segmentSize == 0) {
+		segmentSize = k_worm_log_segment_size;
+	}
+	log->capacity = (segmentSize > k_worm_log_header_size) ? (segmentSize - k_worm_log_header_size) / sizeof(audit_export_t): 0;
+	if (log->capacity == 0) {
+		log->capacity = 1;
+	} else if (log->capacity > UINT32_MAX) {
+		log->capacity = UINT32_MAX; // the index numbers records with 32 bits
+	}
+	if (	(log->dir = strdup(dir)) == NULL
+		 || (mkdir(dir, 0755) != 0 && errno != EEXIST)
+		 || worm_log_segments(dir, &numbers, &count) != 0) {
+		goto out;
+	}
+	if (count == 0) {
+		retval = log_create(log, 1, 0, 0);
+		goto out;
+	}
+	
+	log_path(path, sizeof(path), dir, numbers[count - 1], k_worm_log_segment_suffix);
+	if (log_map(path, O_RDWR, &map) != 0) {
+		goto out;
+	}
+	if ((header = log_header(&map)) == NULL) {
+		fprintf(stderr, "worm_log: %s isn't a segment\n", path);
+		log_unmap(&map);
+		goto out;
+	}
+	if (header->count > 0) {
+		// the count is advanced before session and next; repair them after a crash
+		const audit_export_t* last = (const audit_export_t*) ((char*) map.base + k_worm_log_header_size) + header->count - 1;
+		header->session = last->session;
+		header->next = last->seq + 1;
+	}
+	if (header->sealed) {
+		uint64_t session = header->session;
+		uint64_t next = header->next;
+		
+		log_unmap(&map);
+		retval = log_create(log, numbers[count - 1] + 1, session, next);
+	} else {
+		log->number = numbers[count - 1];
+		log->fd = map.fd;
+		log->header = header;
+		log->records = (audit_export_t*) ((char*) map.base + k_worm_log_header_size);
+		log->capacity = header->capacity; // its size was fixed when it was created
+		retval = 0;
+	}
+	
+out:
+	free(numbers);
+	if (retval != 0) {
+		int err = errno;
+		free(log->dir);
+		log->dir = NULL;
+		errno = err;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	appends records to the log; rotating segments as they fill
+ *
+ * @param	log		the open log
+ * @param	records	the records
+ * @param	count	the number of records
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_log_append(worm_log_t* log, const audit_export_t* records, size_t count) {
+	int retval = 0;
+	
+	while (count > 0) {
+		uint64_t space = log->header->capacity - log->header->count;
+		size_t n = (count < space) ? count: (size_t) space;
+		
+		if (n == 0) {
+			if ((retval = log_rotate(log)) != 0) {
+				break;
+			}
+			continue;
+		}
+		memcpy(&log->records[log->header->count], records, n * sizeof(*records));
+		__sync_synchronize();
+		log->header->count += n; // only now are they in the log
+		log->header->session = records[n - 1].session;
+		log->header->next = records[n - 1].seq + 1;
+		records += n;
+		count -= n;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	flushes the segment being written to disk
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_log_sync(worm_log_t* log) {
+	return msync(log->header, k_worm_log_header_size + log->header->capacity * sizeof(audit_export_t), MS_SYNC);
+}
+
+
+/**
+ * @brief	unmaps the segment being written (leaving it unsealed) and frees the log
+ */
+void worm_log_close(worm_log_t* log) {
+	if (log->header != NULL) {
+		munmap(log->header, k_worm_log_header_size + log->header->capacity * sizeof(audit_export_t));
+	}
+	if (log->fd != -1) {
+		close(log->fd);
+	}
+	free(log->dir);
+	memset(log, 0, sizeof(*log));
+	log->fd = -1;
+}
+
+
+static int posting_compare(const void* a, const void* b) {
+	const worm_log_posting_t* pa = a;
+	const worm_log_posting_t* pb = b;
+	int retval = (pa->uid > pb->uid) - (pa->uid < pb->uid);
+	
+	if (retval == 0) {
+		retval = (pa->record > pb->record) - (pa->record < pb->record);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	(re)writes a segment's index from the records it holds.  Its written to a
+ *			temporary file and renamed into place
+ *
+ * @param	dir		the log directory
+ * @param	number	the segment number
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_log_index(const char* dir, uint64_t number) {
+	int retval = -1;
+	char path[PATH_MAX] = {0};
+	char tmp[PATH_MAX] = {0};
+	worm_log_map_t map = {-1, MAP_FAILED, 0};
+	const worm_log_header_t* header = NULL;
+	const audit_export_t* records = NULL;
+	worm_log_index_header_t index = {{0}};
+	worm_log_block_t* blocks = NULL;
+	worm_log_posting_t* postings = NULL;
+	worm_log_uid_t* uids = NULL;
+	uint32_t* numbers = NULL;
+	FILE* f = NULL;
+	
+	log_path(path, sizeof(path), dir, number, k_worm_log_segment_suffix);
+	if (log_map(path, O_RDONLY, &map) != 0) {
+		goto out;
+	}
+	if ((header = log_header(&map)) == NULL) {
+		goto out;
+	}
+	records = (const audit_export_t*) ((const char*) map.base + k_worm_log_header_size);
+	memcpy(index.magic, k_worm_log_index_magic, sizeof(k_worm_log_index_magic));
+	index.version = k_worm_log_version;
+	index.records = header->count;
+	index.blocks = (uint32_t) ((index.records + k_worm_log_block - 1) / k_worm_log_block);
+	index.minTime = UINT64_MAX;
+	if (	(blocks = calloc(index.blocks + 1, sizeof(*blocks))) == NULL
+		 || (postings = calloc(index.records + 1, sizeof(*postings))) == NULL
+		 || (uids = calloc(index.records + 1, sizeof(*uids))) == NULL
+		 || (numbers = calloc(index.records + 1, sizeof(*numbers))) == NULL) {
+		goto out;
+	}
+	
+	for (uint64_t i = 0; i < index.records; i++) {
+		const audit_export_t* r = &records[i];
+		worm_log_block_t* block = &blocks[i / k_worm_log_block];
+		uint32_t hook = (r->hook < 32) ? 1u << r->hook: 0;
+		
+		if (i % k_worm_log_block == 0) {
+			block->minTime = UINT64_MAX;
+		}
+		block->minTime = (r->time < block->minTime) ? r->time: block->minTime;
+		block->maxTime = (r->time > block->maxTime) ? r->time: block->maxTime;
+		block->hooks |= hook;
+		index.minTime = (r->time < index.minTime) ? r->time: index.minTime;
+		index.maxTime = (r->time > index.maxTime) ? r->time: index.maxTime;
+		index.hooks |= hook;
+		postings[i].uid = r->uid;
+		postings[i].record = (uint32_t) i;
+	}
+	qsort(postings, (size_t) index.records, sizeof(*postings), posting_compare);
+	for (uint64_t i = 0; i < index.records; i++) {
+		if (	index.uids == 0
+			 || uids[index.uids - 1].uid != postings[i].uid) {
+			uids[index.uids].uid = postings[i].uid;
+			uids[index.uids].offset = i;
+			index.uids++;
+		}
+		uids[index.uids - 1].count++;
+		numbers[i] = postings[i].record;
+	}
+	
+	log_path(path, sizeof(path), dir, number, k_worm_log_index_suffix);
+	snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int) getpid());
+	if ((f = fopen(tmp, "w")) == NULL) {
+		goto out;
+	}
+	if (	fwrite(&index, sizeof(index), 1, f) != 1
+		 || fwrite(blocks, sizeof(*blocks), index.blocks, f) != index.blocks
+		 || fwrite(uids, sizeof(*uids), index.uids, f) != index.uids
+		 || fwrite(numbers, sizeof(*numbers), (size_t) index.records, f) != index.records
+		 || fflush(f) != 0
+		 || fsync(fileno(f)) != 0) {
+		fclose(f);
+		unlink(tmp);
+		goto out;
+	}
+	fclose(f);
+	if ((retval = rename(tmp, path)) != 0) {
+		unlink(tmp);
+	}
+	
+out:
+	free(numbers);
+	free(uids);
+	free(postings);
+	free(blocks);
+	log_unmap(&map);
+	return retval;
+}
+
+
+static int number_compare(const void* a, const void* b) {
+	uint64_t na = *(const uint64_t*) a;
+	uint64_t nb = *(const uint64_t*) b;
+	return (na > nb) - (na < nb);
+}
+
+
+/**
+ * @brief	lists the segments in a log; oldest first
+ *
+ * @param	dir		the log directory
+ * @param	numbers	on success an allocated array of segment numbers; free it
+ * @param	count	on success the number of segments
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_log_segments(const char* dir, uint64_t** numbers, size_t* count) {
+	int retval = -1;
+	DIR* d = NULL;
+	struct dirent* ent = NULL;
+	uint64_t* list = NULL;
+	size_t n = 0;
+	size_t space = 0;
+	
+	*numbers = NULL;
+	*count = 0;
+	if ((d = opendir(dir)) == NULL) {
+		goto out;
+	}
+	while ((ent = readdir(d)) != NULL) {
+		char* end = NULL;
+		uint64_t number = strtoull(ent->d_name, &end, 10);
+		
+		if (	end == ent->d_name
+			 || strcmp(end, k_worm_log_segment_suffix) != 0) {
+			continue;
+		}
+		if (n == space) {
+			uint64_t* grown = NULL;
+			
+			space = space ? space * 2: 16;
+			if ((grown = realloc(list, space * sizeof(*list))) == NULL) {
+				free(list);
+				goto fail;
+			}
+			list = grown;
+		}
+		list[n++] = number;
+	}
+	qsort(list, n, sizeof(*list), number_compare);
+	*numbers = list;
+	*count = n;
+	retval = 0;
+	
+fail:
+	closedir(d);
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	does a record match a filter
+ */
+static bool record_matches(const worm_log_filter_t* filter, const audit_export_t* r) {
+	return	(filter->hasUid == false || r->uid == filter->uid)
+		 && (filter->hooks == 0 || (r->hook < 32 && (filter->hooks & (1u << r->hook))))
+		 && (filter->since == 0 || r->time >= filter->since)
+		 && (filter->until == 0 || r->time <= filter->until)
+		 && (filter->hasFile == false || (r->fsid == filter->fsid && (r->fileid == filter->fileid || r->parent == filter->fileid)));
+}
+
+
+/**
+ * @brief	could a range of records, summarized by their time range and hooks, match a
+ *			filter
+ */
+static bool range_matches(const worm_log_filter_t* filter, uint64_t minTime, uint64_t maxTime, uint32_t hooks) {
+	return	(filter->hooks == 0 || (hooks & filter->hooks))
+		 && (filter->since == 0 || maxTime >= filter->since)
+		 && (filter->until == 0 || minTime <= filter->until);
+}
+
+
+/**
+ * @brief	maps a segment's index; if it indexes all of the segment's records
+ *
+ * @param	dir		the log directory
+ * @param	number	the segment number
+ * @param	records	the number of records in the segment
+ * @param	map		on success the mapped index
+ *
+ * @return	the index header, else NULL if there's no up to date index
+ */
+static const worm_log_index_header_t* index_map(const char* dir, uint64_t number, uint64_t records, worm_log_map_t* map) {
+	const worm_log_index_header_t* retval = NULL;
+	char path[PATH_MAX] = {0};
+	
+	log_path(path, sizeof(path), dir, number, k_worm_log_index_suffix);
+	if (log_map(path, O_RDONLY, map) == 0) {
+		retval = map->base;
+		if (	memcmp(retval->magic, k_worm_log_index_magic, sizeof(k_worm_log_index_magic)) != 0
+			 || retval->version != k_worm_log_version
+			 || retval->records != records
+			 || map->size != sizeof(*retval)
+							 + retval->blocks * sizeof(worm_log_block_t)
+							 + retval->uids * sizeof(worm_log_uid_t)
+							 + retval->records * sizeof(uint32_t)) {
+			retval = NULL; // stale, or not ours; scan the segment
+			log_unmap(map);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	finds a uid in an index
+ *
+ * @return	its entry, else NULL if it made none of the segment's records
+ */
+static const worm_log_uid_t* index_uid(const worm_log_index_header_t* index, uint32_t uid) {
+	const worm_log_uid_t* uids = (const worm_log_uid_t*) ((const worm_log_block_t*) (index + 1) + index->blocks);
+	size_t lo = 0;
+	size_t hi = index->uids;
+	
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (uids[mid].uid < uid) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return (lo < index->uids && uids[lo].uid == uid) ? &uids[lo]: NULL;
+}
+
+
+/**
+ * @brief	finds the records in a log which match a filter.  Segments are skipped, and
+ *			segments read, using their index when it's up to date; the others are scanned
+ *
+ * @param	dir		the log directory
+ * @param	filter	what to match
+ * @param	match	called with each match in log order
+ * @param	arg		passed to match
+ * @param	stats	if non NULL, on return the work done
+ *
+ * @return	0 on success (or if match stopped the query), else -1 and errno is set
+ */
+int worm_log_query(const char* dir, const worm_log_filter_t* filter, worm_log_match_t match, void* arg, worm_log_stats_t* stats) {
+	int retval = -1;
+	worm_log_stats_t work = {0};
+	uint64_t* numbers = NULL;
+	size_t count = 0;
+	int stop = 0;
+	
+	if (worm_log_segments(dir, &numbers, &count) != 0) {
+		goto out;
+	}
+	work.segments = count;
+	for (size_t s = 0; (s < count) && (stop == 0); s++) {
+		char path[PATH_MAX] = {0};
+		worm_log_map_t map = {-1, MAP_FAILED, 0};
+		worm_log_map_t imap = {-1, MAP_FAILED, 0};
+		const worm_log_header_t* header = NULL;
+		const worm_log_index_header_t* index = NULL;
+		const audit_export_t* records = NULL;
+		uint64_t n = 0;
+		
+		log_path(path, sizeof(path), dir, numbers[s], k_worm_log_segment_suffix);
+		if (	log_map(path, O_RDONLY, &map) != 0
+			 || (header = log_header(&map)) == NULL) {
+			fprintf(stderr, "worm_log: %s; %s\n", path, strerror(errno));
+			log_unmap(&map);
+			continue;
+		}
+		records = (const audit_export_t*) ((const char*) map.base + k_worm_log_header_size);
+		n = header->count; // the writer may be appending; we read what's committed
+		__sync_synchronize();
+		
+		if ((index = index_map(dir, numbers[s], n, &imap)) == NULL) {
+			for (uint64_t i = 0; (i < n) && (stop == 0); i++) {
+				work.scanned++;
+				if (record_matches(filter, &records[i])) {
+					stop = match(&records[i], arg);
+				}
+			}
+		} else {
+			const worm_log_block_t* blocks = (const worm_log_block_t*) (index + 1);
+			const worm_log_uid_t* uid = NULL;
+			
+			if (	range_matches(filter, index->minTime, index->maxTime, index->hooks) == false
+				 || (filter->hasUid && (uid = index_uid(index, filter->uid)) == NULL)) {
+				work.skipped++;
+			} else if (uid != NULL) {
+				// just the uid's records
+				const uint32_t* postings = (const uint32_t*) ((const worm_log_uid_t*) (blocks + index->blocks) + index->uids) + uid->offset;
+				for (uint32_t i = 0; (i < uid->count) && (stop == 0); i++) {
+					const worm_log_block_t* block = &blocks[postings[i] / k_worm_log_block];
+					if (range_matches(filter, block->minTime, block->maxTime, block->hooks)) {
+						work.scanned++;
+						if (record_matches(filter, &records[postings[i]])) {
+							stop = match(&records[postings[i]], arg);
+						}
+					}
+				}
+			} else {
+				// just the blocks which could match
+				for (uint32_t b = 0; (b < index->blocks) && (stop == 0); b++) {
+					uint64_t end = ((uint64_t) b + 1) * k_worm_log_block;
+					
+					if (range_matches(filter, blocks[b].minTime, blocks[b].maxTime, blocks[b].hooks) == false) {
+						continue;
+					}
+					for (uint64_t i = (uint64_t) b * k_worm_log_block; (i < end) && (i < n) && (stop == 0); i++) {
+						work.scanned++;
+						if (record_matches(filter, &records[i])) {
+							stop = match(&records[i], arg);
+						}
+					}
+				}
+			}
+			log_unmap(&imap);
+		}
+		log_unmap(&map);
+	}
+	retval = 0;
+	
+out:
+	free(numbers);
+	if (stats != NULL) {
+		*stats = work;
+	}
+	return retval;
+}
@@ -0,0 +1,207 @@
+//
+//  worm_log.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_log_h
+#define tools_worm_log_h
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "audit_export.h"
+
+
+/*
+ * Description
+ *
+ * The binary audit log is a directory of segments; files of fixed width records
+ * (audit_export_t, exactly as the kext exports them) named for their number so that
+ * sorting the names sorts them by time.  A segment is created at its full size and
+ * memory mapped; records are copied in and the count in its header is only advanced
+ * after them, so a crash loses at most the records after the count.  When a segment
+ * is full it's sealed; its sidecar index is written and a new segment is started.
+ *
+ * A segment's index (<number>.idx) summarizes it so that queries skip what can't
+ * match; the time range and hooks of the whole segment and of each block of
+ * k_worm_log_block records, and for each uid the records it made.  The segment
+ * being written has no index; its scanned.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_log_version				1
+#define k_worm_log_magic				"WORMLOG"
+#define k_worm_log_index_magic			"WORMIDX"
+#define k_worm_log_header_size			4096	// records start on a page boundary
+#define k_worm_log_segment_size			(64 * 1024 * 1024)
+#define k_worm_log_block				1024	// records per index block
+#define k_worm_log_segment_suffix		".seg"
+#define k_worm_log_index_suffix			".idx"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the header at the start of a segment
+ *
+ * @field	magic		k_worm_log_magic
+ * @field	version		k_worm_log_version
+ * @field	recordSize	sizeof(audit_export_t)
+ * @field	capacity	the number of records the segment holds
+ * @field	count		the number of records written
+ * @field	sealed		non zero once the segment is full and indexed
+ * @field	session		the session of the last record; so the recorder can resume
+ * @field	next		the seq after the last record
+ */
+typedef struct {
+	char				magic[8];
+	uint32_t			version;
+	uint32_t			recordSize;
+	uint64_t			capacity;
+	volatile uint64_t	count;
+	uint64_t			sealed;
+	uint64_t			session;
+	uint64_t			next;
+} worm_log_header_t;
+
+/**
+ * @brief	the header of a segment's index; followed by its blocks, uids and postings
+ *
+ * @field	magic		k_worm_log_index_magic
+ * @field	version		k_worm_log_version
+ * @field	blocks		the number of worm_log_block_t
+ * @field	records		the number of records in the segment
+ * @field	uids		the number of worm_log_uid_t; sorted by uid
+ * @field	hooks		a mask of the hooks (1 << hook) in the segment
+ * @field	minTime		the earliest record time
+ * @field	maxTime		the latest record time
+ */
+typedef struct {
+	char				magic[8];
+	uint32_t			version;
+	uint32_t			blocks;
+	uint64_t			records;
+	uint32_t			uids;
+	uint32_t			hooks;
+	uint64_t			minTime;
+	uint64_t			maxTime;
+} worm_log_index_header_t;
+
+/**
+ * @brief	the summary of a block of k_worm_log_block records
+ */
+typedef struct {
+	uint64_t			minTime;
+	uint64_t			maxTime;
+	uint32_t			hooks;
+	uint32_t			reserved;
+} worm_log_block_t;
+
+/**
+ * @brief	the records made by a uid; offset is the first of its count postings (record
+ *			numbers, ascending) in the postings which follow the uids
+ */
+typedef struct {
+	uint32_t			uid;
+	uint32_t			count;
+	uint64_t			offset;
+} worm_log_uid_t;
+
+/**
+ * @brief	a log open for writing
+ *
+ * @field	dir			the log directory
+ * @field	capacity	records per new segment
+ * @field	number		the number of the segment being written
+ * @field	fd			the segment being written
+ * @field	header		the mapped segment
+ * @field	records		the records in the mapped segment
+ */
+typedef struct {
+	char*				dir;
+	uint64_t			capacity;
+	uint64_t			number;
+	int					fd;
+	worm_log_header_t*	header;
+	audit_export_t*		records;
+} worm_log_t;
+
+/**
+ * @brief	what a query matches; a record must match every field that's set
+ *
+ * @field	uid			the uid; if hasUid
+ * @field	hooks		a mask of the hooks (1 << hook); 0 for any
+ * @field	since		the earliest time (ns since the epoch); 0 for any
+ * @field	until		the latest time; 0 for any
+ * @field	fsid		the file system of the file; if hasFile
+ * @field	fileid		the file id of the file (as the file, or its parent directory)
+ */
+typedef struct {
+	bool				hasUid;
+	uint32_t			uid;
+	uint32_t			hooks;
+	uint64_t			since;
+	uint64_t			until;
+	bool				hasFile;
+	uint64_t			fsid;
+	uint64_t			fileid;
+} worm_log_filter_t;
+
+/**
+ * @brief	called with each record a query matches, in log order
+ *
+ * @return	0 to continue, non zero to stop the query
+ */
+typedef int (*worm_log_match_t)(const audit_export_t* record, void* arg);
+
+/**
+ * @brief	the work a query did
+ *
+ * @field	segments	segments in the log
+ * @field	skipped		segments skipped by their index
+ * @field	scanned		records read
+ */
+typedef struct {
+	uint64_t			segments;
+	uint64_t			skipped;
+	uint64_t			scanned;
+} worm_log_stats_t;
+
+extern int worm_log_open(worm_log_t* log, const char* dir, size_t segmentSize);
+extern int worm_log_append(worm_log_t* log, const audit_export_t* records, size_t count);
+extern int worm_log_sync(worm_log_t* log);
+extern void worm_log_close(worm_log_t* log);
+extern int worm_log_index(const char* dir, uint64_t number);
+extern int worm_log_segments(const char* dir, uint64_t** numbers, size_t* count);
+extern int worm_log_query(const char* dir, const worm_log_filter_t* filter, worm_log_match_t match, void* arg, worm_log_stats_t* stats);
+
+
+#endif
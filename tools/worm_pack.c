@@ -0,0 +1,518 @@
+//
+//  worm_pack.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "worm_pack.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_pack_buffer				(1024 * 1024)
+
+
+/*
+ * Definitions
+ */
+
+static int pack_write(int fd, const void* buf, size_t len);
+static int pack_compare(const void* a, const void* b);
+static int pack_name(char* name, size_t len, uint32_t number);
+
+static __thread const char* g_pack_names = NULL; // the names being sorted
+
+
+/*
+ * Implementation
+ */
+
+static int pack_write(int fd, const void* buf, size_t len) {
+	int retval = 0;
+	while (	(retval == 0)
+		   && (len > 0)) {
+		ssize_t n = write(fd, buf, len);
+		if (n > 0) {
+			buf = (const char*) buf + n;
+			len -= (size_t) n;
+		} else if ((n == -1) && (errno == EINTR)) {
+			// again
+		} else {
+			if (n == 0) {
+				errno = EIO;
+			}
+			retval = -1;
+		}
+	}
+	return retval;
+}
+
+
+static int pack_compare(const void* a, const void* b) {
+	return strcmp(g_pack_names + ((const worm_pack_entry_t*) a)->name, g_pack_names + ((const worm_pack_entry_t*) b)->name);
+}
+
+
+static int pack_name(char* name, size_t len, uint32_t number) {
+	int retval = snprintf(name, len, "%s%u", k_worm_pack_prefix, number);
+	if (retval >= (int) len) {
+		errno = ENAMETOOLONG;
+		retval = -1;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	creates the directory's next pack
+ *
+ * @param	writer	the pack to create
+ * @param	dirfd	the directory
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_pack_create(worm_pack_writer_t* writer, int dirfd) {
+	int retval = -1;
+	char name[64];
+	
+	memset(writer, 0, sizeof(*writer));
+	writer->fd = -1;
+	for (uint32_t n = 0; n < k_worm_pack_max; n++) {
+		if (pack_name(name, sizeof(name), n) == -1) {
+			break;
+		}
+		writer->fd = openat(dirfd, name, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_NOFOLLOW | O_CLOEXEC, 0444);
+		if (writer->fd != -1) {
+			writer->number = n;
+			retval = 0;
+			break;
+		} else if (errno != EEXIST) {
+			break;
+		} else if (n + 1 == k_worm_pack_max) {
+			errno = ENOSPC;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	appends a file to the pack; its data is copied and its entry recorded.  To
+ *			read the pack sequentially add files in name order
+ *
+ * @param	writer	the pack
+ * @param	name	the name of the file
+ * @param	fd		the file; open for reading at its start
+ * @param	expires	the file's retention; the pack is WORM until the latest of them
+ *
+ * @return	0 on success, else -1 and errno is set.  If the pack has been written to, it
+ *			has failed and must be aborted
+ */
+int worm_pack_add(worm_pack_writer_t* writer, const char* name, int fd, uint64_t expires) {
+	int retval = -1;
+	size_t len = strlen(name);
+	char* buf = NULL;
+	uint64_t size = 0;
+	struct stat st;
+	
+	if (writer->failed) {
+		errno = EIO;
+		goto out;
+	}
+	if (	(fstat(fd, &st) != 0)
+		 || ((buf = malloc(k_worm_pack_buffer)) == NULL)) {
+		goto out;
+	}
+	if (	(len > UINT16_MAX)
+		 || (writer->used + len + 1 > UINT32_MAX)) {
+		errno = EFBIG;
+		goto out;
+	}
+	if (writer->used + len + 1 > writer->space) {
+		size_t space = (writer->space ? writer->space * 2: 64 * 1024) + len + 1;
+		char* grown = realloc(writer->names, space);
+		if (grown == NULL) {
+			goto out;
+		}
+		writer->names = grown;
+		writer->space = space;
+	}
+	if (writer->count == writer->slots) {
+		size_t slots = writer->slots ? writer->slots * 2: 1024;
+		worm_pack_entry_t* grown = realloc(writer->entries, slots * sizeof(*grown));
+		if (grown == NULL) {
+			goto out;
+		}
+		writer->entries = grown;
+		writer->slots = slots;
+	}
+	
+	// from here on a failure leaves the pack part written
+	for (;;) {
+		ssize_t n = read(fd, buf, k_worm_pack_buffer);
+		if (n > 0) {
+			if (pack_write(writer->fd, buf, (size_t) n) != 0) {
+				writer->failed = 1;
+				goto out;
+			}
+			size += (uint64_t) n;
+		} else if (n == 0) {
+			break;
+		} else if (errno != EINTR) {
+			writer->failed = 1;
+			goto out;
+		}
+	}
+	if (size != (uint64_t) st.st_size) {
+		errno = EIO; // its changed; it can't have been WORM
+		writer->failed = 1;
+		goto out;
+	}
+	
+	memcpy(writer->names + writer->used, name, len + 1);
+	memset(&writer->entries[writer->count], 0, sizeof(writer->entries[0]));
+	writer->entries[writer->count].offset = writer->offset;
+	writer->entries[writer->count].size = size;
+	writer->entries[writer->count].mtime = (int64_t) st.st_mtime;
+	writer->entries[writer->count].expires = expires;
+	writer->entries[writer->count].mode = (uint32_t) st.st_mode;
+	writer->entries[writer->count].uid = (uint32_t) st.st_uid;
+	writer->entries[writer->count].gid = (uint32_t) st.st_gid;
+	writer->entries[writer->count].name = (uint32_t) writer->used;
+	writer->entries[writer->count].len = (uint16_t) len;
+	writer->count++;
+	writer->used += len + 1;
+	writer->offset += size;
+	if (expires > writer->expires) {
+		writer->expires = expires;
+	}
+	retval = 0;
+out:
+	free(buf);
+	return retval;
+}
+
+
+/**
+ * @brief	finishes a pack; its entries, names and trailer are appended, its synced and
+ *			then made WORM until the latest retention of its members.  The writer is
+ *			closed, whether it succeeds or not
+ *
+ * @param	writer	the pack
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_pack_finish(worm_pack_writer_t* writer) {
+	int retval = -1;
+	worm_pack_trailer_t trailer = {k_worm_pack_magic, k_worm_pack_version};
+	static const char pad[sizeof(uint64_t)] = {0};
+	size_t padding = (size_t) ((sizeof(uint64_t) - (writer->offset % sizeof(uint64_t))) % sizeof(uint64_t));
+	size_t names = (writer->used + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+	
+	if (writer->failed) {
+		errno = EIO;
+		goto out;
+	}
+	if (writer->count > UINT32_MAX) {
+		errno = EFBIG;
+		goto out;
+	}
+	g_pack_names = writer->names;
+	qsort(writer->entries, writer->count, sizeof(writer->entries[0]), pack_compare);
+	g_pack_names = NULL;
+	trailer.count = (uint32_t) writer->count;
+	trailer.entries = writer->offset + padding; // the entries are aligned for reading in place
+	trailer.names = names; // NUL padded, so the trailer is aligned too
+	if (	(pack_write(writer->fd, pad, padding) == 0)
+		 && (pack_write(writer->fd, writer->entries, writer->count * sizeof(writer->entries[0])) == 0)
+		 && (pack_write(writer->fd, writer->names, writer->used) == 0)
+		 && (pack_write(writer->fd, pad, names - writer->used) == 0)
+		 && (fsync(writer->fd) == 0)
+		 && (pack_write(writer->fd, &trailer, sizeof(trailer)) == 0)
+		 && (fsync(writer->fd) == 0)) {
+		uint64_t expires = writer->count ? writer->expires: k_wormxattr_retain_forever;
+		uint64_t inherited = 0;
+		
+		// in a WORM directory its inherited the directory's attribute, which may do
+		if (	(worm_xattr_fget(writer->fd, &inherited) == 0)
+			 && (worm_xattr_fappend(writer->fd) == 0)
+			 && (inherited >= expires)) {
+			retval = 0;
+		} else if (worm_xattr_fset(writer->fd, expires) == 0) {
+			retval = 0;
+		}
+	}
+out:
+	if (writer->fd != -1) {
+		close(writer->fd);
+	}
+	free(writer->entries);
+	free(writer->names);
+	memset(writer, 0, sizeof(*writer));
+	writer->fd = -1;
+	return retval;
+}
+
+
+/**
+ * @brief	abandons a pack; its removed if it can be, otherwise (once its WORM) it stays
+ *			without a trailer, so its never read
+ *
+ * @param	writer	the pack
+ * @param	dirfd	the directory its in
+ */
+void worm_pack_abort(worm_pack_writer_t* writer, int dirfd) {
+	char name[64];
+	
+	if (writer->fd != -1) {
+		close(writer->fd);
+		if (pack_name(name, sizeof(name), writer->number) != -1) {
+			(void) unlinkat(dirfd, name, 0);
+		}
+	}
+	free(writer->entries);
+	free(writer->names);
+	memset(writer, 0, sizeof(*writer));
+	writer->fd = -1;
+}
+
+
+/**
+ * @brief	maps a pack; it must be WORM (and finalized) and complete
+ *
+ * @param	pack	the pack to open
+ * @param	fd		the pack's file
+ *
+ * @return	0 on success, else -1 and errno is set; ESTALE if it isn't WORM (so it can't
+ *			be trusted) and EINVAL if its invalid
+ */
+int worm_pack_open(worm_pack_t* pack, int fd) {
+	int retval = -1;
+	const worm_pack_trailer_t* trailer = NULL;
+	uint64_t expires = 0;
+	int append = 0;
+	struct stat st;
+	
+	memset(pack, 0, sizeof(*pack));
+	if (fstat(fd, &st) != 0) {
+		goto out;
+	}
+	if (	(worm_xattr_fget(fd, &expires) != 0)
+		 || ((append = worm_xattr_fappend(fd)) != 0)) {
+		if (	(append == 1)
+			 || (errno == ENOATTR)) {
+			errno = ESTALE;
+		}
+		goto out;
+	}
+	if (	!S_ISREG(st.st_mode)
+		 || ((size_t) st.st_size < sizeof(*trailer))) {
+		errno = EINVAL;
+		goto out;
+	}
+	pack->size = (size_t) st.st_size;
+	if ((pack->base = mmap(NULL, pack->size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		pack->base = NULL;
+		goto out;
+	}
+	trailer = (const worm_pack_trailer_t*) ((const char*) pack->base + pack->size - sizeof(*trailer));
+	if (	(memcmp(trailer->magic, k_worm_pack_magic, sizeof(trailer->magic)) != 0)
+		 || (trailer->version != k_worm_pack_version)
+		 || (trailer->names > UINT32_MAX)
+		 || (trailer->entries > pack->size)
+		 || (trailer->entries + (uint64_t) trailer->count * sizeof(worm_pack_entry_t) + trailer->names + sizeof(*trailer) != pack->size)
+		 || ((trailer->entries % sizeof(uint64_t)) != 0)
+		 || ((pack->size % sizeof(uint64_t)) != 0)
+		 || (	(trailer->names > 0)
+			 && (((const char*) trailer)[-1] != '\0'))) {
+		errno = EINVAL;
+		goto out;
+	}
+	pack->count = trailer->count;
+	pack->entries = (const worm_pack_entry_t*) ((const char*) pack->base + trailer->entries);
+	pack->names = (const char*) (pack->entries + pack->count);
+	retval = 0;
+out:
+	if (retval != 0) {
+		int err = errno;
+		worm_pack_close(pack);
+		errno = err;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets the name of an entry; "" if the entry's out of bounds
+ */
+const char* worm_pack_name(const worm_pack_t* pack, const worm_pack_entry_t* entry) {
+	const char* retval = "";
+	size_t names = pack->size - sizeof(worm_pack_trailer_t) - (size_t) (pack->names - (const char*) pack->base);
+	if ((size_t) entry->name + entry->len < names) {
+		retval = pack->names + entry->name;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets the data of an entry; its size bytes, mapped
+ *
+ * @return	its data, else NULL if the entry's out of bounds
+ */
+const void* worm_pack_data(const worm_pack_t* pack, const worm_pack_entry_t* entry) {
+	const void* retval = NULL;
+	uint64_t data = (uint64_t) ((const char*) pack->entries - (const char*) pack->base);
+	if (	(entry->offset <= data)
+		 && (entry->size <= data - entry->offset)) {
+		retval = (const char*) pack->base + entry->offset;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	looks a name up; a binary search of the entries
+ *
+ * @return	its entry, else NULL if the pack has no such entry
+ */
+const worm_pack_entry_t* worm_pack_lookup(const worm_pack_t* pack, const char* name) {
+	const worm_pack_entry_t* retval = NULL;
+	size_t lo = 0, hi = pack->count;
+	
+	while (	(retval == NULL)
+		   && (lo < hi)) {
+		size_t mid = lo + (hi - lo) / 2;
+		int order = strcmp(name, worm_pack_name(pack, &pack->entries[mid]));
+		if (order == 0) {
+			retval = &pack->entries[mid];
+		} else if (order < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return retval;
+}
+
+
+void worm_pack_close(worm_pack_t* pack) {
+	if (pack->base != NULL) {
+		(void) munmap(pack->base, pack->size);
+	}
+	memset(pack, 0, sizeof(*pack));
+}
+
+
+/**
+ * @brief	maps the packs of a directory; packs which are invalid or not WORM (e.g. one
+ *			a crash left part written) are skipped
+ *
+ * @param	packs	the packs to open
+ * @param	dirfd	the directory
+ *
+ * @return	0 on success (even if it has no packs), else -1 and errno is set
+ */
+int worm_packs_open(worm_packs_t* packs, int dirfd) {
+	int retval = 0;
+	char name[64];
+	
+	memset(packs, 0, sizeof(*packs));
+	for (uint32_t n = 0; (retval == 0) && (n < k_worm_pack_max); n++) {
+		int fd = -1;
+		
+		if (pack_name(name, sizeof(name), n) == -1) {
+			retval = -1;
+		} else if ((fd = openat(dirfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) == -1) {
+			if (errno != ENOENT) {
+				retval = -1;
+			}
+			break;
+		} else {
+			worm_pack_t pack;
+			
+			if (worm_pack_open(&pack, fd) == 0) {
+				worm_pack_t* grown = realloc(packs->packs, (packs->count + 1) * sizeof(pack));
+				if (grown == NULL) {
+					worm_pack_close(&pack);
+					retval = -1;
+				} else {
+					packs->packs = grown;
+					packs->packs[packs->count++] = pack;
+				}
+			} else if (	(errno != EINVAL)
+					   && (errno != ESTALE)) {
+				retval = -1;
+			}
+			close(fd);
+		}
+	}
+	if (retval != 0) {
+		int err = errno;
+		worm_packs_close(packs);
+		errno = err;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	looks a name up in a directory's packs; the newest first
+ *
+ * @param	packs	the packs
+ * @param	name	the name to look up
+ * @param	pack	on success the pack its in; may be NULL
+ *
+ * @return	its entry, else NULL if no pack has it
+ */
+const worm_pack_entry_t* worm_packs_lookup(const worm_packs_t* packs, const char* name, const worm_pack_t** pack) {
+	const worm_pack_entry_t* retval = NULL;
+	for (uint32_t n = packs->count; (retval == NULL) && (n > 0); n--) {
+		if ((retval = worm_pack_lookup(&packs->packs[n - 1], name)) != NULL) {
+			if (pack) {
+				*pack = &packs->packs[n - 1];
+			}
+		}
+	}
+	return retval;
+}
+
+
+void worm_packs_close(worm_packs_t* packs) {
+	for (uint32_t n = 0; n < packs->count; n++) {
+		worm_pack_close(&packs->packs[n]);
+	}
+	free(packs->packs);
+	memset(packs, 0, sizeof(*packs));
+}
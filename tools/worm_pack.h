@@ -0,0 +1,186 @@
+//
+//  worm_pack.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_pack_h
+#define tools_worm_pack_h
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * Packs hold the contents of many small WORM files; files named k_worm_pack_prefix
+ * and their number (from 0) within the directory of the files they hold.  As WORM
+ * files never change a pack is an exact copy of them, so a walk of the directory can
+ * read its packs sequentially rather than opening every file.
+ *
+ * A pack is written append only; the data of its members (in name order), their
+ * entries (sorted by name, as strcmp orders them), their names (each NUL terminated)
+ * and lastly a trailer.  Its synced before it's made WORM, with the latest retention
+ * of its members; a pack without a trailer (a crash part way) or without the
+ * attribute is invalid and its members are still read from their files.  As a
+ * member's data is in the same order as its entry, iterating the entries reads the
+ * pack sequentially.
+ *
+ * A directory's packs are numbered contiguously; packing again adds packs holding
+ * the files not already packed.  Lookups search the newest pack first.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_worm_pack_version				1
+#define k_worm_pack_magic				"WORMPAK"
+#define k_worm_pack_prefix				".wormpack."
+#define k_worm_pack_max					1024	// packs per directory
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a member of the pack
+ *
+ * @field	offset		the offset of its data in the pack
+ * @field	size		the size of its data
+ * @field	mtime		its modification time; seconds since the epoch
+ * @field	expires		the time (seconds since the epoch) it was WORM until;
+ *						k_wormxattr_retain_forever if it doesn't expire
+ * @field	mode		its mode
+ * @field	uid			its owner
+ * @field	gid			its group
+ * @field	name		the offset of its name in the names
+ * @field	len			the length of its name
+ */
+typedef struct {
+	uint64_t			offset;
+	uint64_t			size;
+	int64_t				mtime;
+	uint64_t			expires;
+	uint32_t			mode;
+	uint32_t			uid;
+	uint32_t			gid;
+	uint32_t			name;
+	uint16_t			len;
+	uint16_t			reserved[3];
+} worm_pack_entry_t;
+
+/**
+ * @brief	the trailer at the end of a pack
+ *
+ * @field	magic		k_worm_pack_magic
+ * @field	version		k_worm_pack_version
+ * @field	count		the number of entries
+ * @field	entries		the offset of the entries; the data before them
+ * @field	names		the size of the names; NUL padded to a multiple of 8 bytes
+ */
+typedef struct {
+	char				magic[8];
+	uint32_t			version;
+	uint32_t			count;
+	uint64_t			entries;
+	uint64_t			names;
+} worm_pack_trailer_t;
+
+/**
+ * @brief	a pack mapped for reading
+ *
+ * @field	base		the mapping
+ * @field	size		the size of the mapping
+ * @field	count		the number of entries
+ * @field	entries		the entries; sorted by name
+ * @field	names		the names
+ */
+typedef struct {
+	void*						base;
+	size_t						size;
+	uint32_t					count;
+	const worm_pack_entry_t*	entries;
+	const char*					names;
+} worm_pack_t;
+
+/**
+ * @brief	the packs of a directory
+ *
+ * @field	packs		the packs; in number order
+ * @field	count		the number of packs
+ */
+typedef struct {
+	worm_pack_t*		packs;
+	uint32_t			count;
+} worm_packs_t;
+
+/**
+ * @brief	a pack being written
+ *
+ * @field	fd			the pack; open for appending
+ * @field	number		its number
+ * @field	offset		the size of the data written
+ * @field	expires		the latest retention of its members
+ * @field	entries		the entries added
+ * @field	count		the number of entries added
+ * @field	slots		the number of entries allocated
+ * @field	names		the names added
+ * @field	used		the size of the names
+ * @field	space		the size allocated for names
+ * @field	failed		non zero if a write failed; the pack can't be finished
+ */
+typedef struct {
+	int					fd;
+	uint32_t			number;
+	uint64_t			offset;
+	uint64_t			expires;
+	worm_pack_entry_t*	entries;
+	size_t				count;
+	size_t				slots;
+	char*				names;
+	size_t				used;
+	size_t				space;
+	int					failed;
+} worm_pack_writer_t;
+
+extern int worm_pack_create(worm_pack_writer_t* writer, int dirfd);
+extern int worm_pack_add(worm_pack_writer_t* writer, const char* name, int fd, uint64_t expires);
+extern int worm_pack_finish(worm_pack_writer_t* writer);
+extern void worm_pack_abort(worm_pack_writer_t* writer, int dirfd);
+
+extern int worm_pack_open(worm_pack_t* pack, int fd);
+extern const worm_pack_entry_t* worm_pack_lookup(const worm_pack_t* pack, const char* name);
+extern const char* worm_pack_name(const worm_pack_t* pack, const worm_pack_entry_t* entry);
+extern const void* worm_pack_data(const worm_pack_t* pack, const worm_pack_entry_t* entry);
+extern void worm_pack_close(worm_pack_t* pack);
+
+extern int worm_packs_open(worm_packs_t* packs, int dirfd);
+extern const worm_pack_entry_t* worm_packs_lookup(const worm_packs_t* packs, const char* name, const worm_pack_t** pack);
+extern void worm_packs_close(worm_packs_t* packs);
+
+
+#endif
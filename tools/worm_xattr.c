@@ -0,0 +1,296 @@
+//
+//  worm_xattr.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+
+#include "worm_xattr.h"
+
+
+/*
+ * Definitions
+ */
+
+static int fvalue_is(int fd, int (*is)(const char* value, size_t len));
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	reads our attribute
+ *
+ * @param	path		the file to read
+ * @param	expires		on success the time (seconds since the epoch) the file is WORM 
+ *						until; k_wormxattr_retain_forever if it doesn't expire
+ *
+ * @return	0 on success, else -1 and errno is set; ENOATTR/ENODATA if it isn't WORM
+ */
+int worm_xattr_get(const char* path, uint64_t* expires) {
+	int retval = -1;
+	char value[k_wormxattr_value_max];
+#ifdef __APPLE__
+	ssize_t len = getxattr(path, k_worm_xattr_name, value, sizeof(value), 0, XATTR_NOFOLLOW);
+#else
+	ssize_t len = lgetxattr(path, k_worm_xattr_name, value, sizeof(value));
+#endif
+	if (len >= 0) {
+		*expires = wormxattr_value_parse(value, (size_t) len);
+		retval = 0;
+	} else if (errno == ERANGE) {
+		// too large to be a retention value, but its there
+		*expires = k_wormxattr_retain_forever;
+		retval = 0;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	sets our attribute; making the file WORM
+ *
+ * @param	path		the file to set it on
+ * @param	expires		the time (seconds since the epoch) the file is WORM until;
+ *						k_wormxattr_retain_forever if it doesn't expire
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_xattr_set(const char* path, uint64_t expires) {
+	char value[k_wormxattr_value_max];
+	size_t len = wormxattr_value_format(value, sizeof(value), expires);
+#ifdef __APPLE__
+	return setxattr(path, k_worm_xattr_name, value, len, 0, XATTR_NOFOLLOW);
+#else
+	return lsetxattr(path, k_worm_xattr_name, value, len, 0);
+#endif
+}
+
+
+/**
+ * @brief	reads our attribute from an open file
+ *
+ * @param	fd			the file to read
+ * @param	expires		as worm_xattr_get
+ *
+ * @return	as worm_xattr_get
+ */
+int worm_xattr_fget(int fd, uint64_t* expires) {
+	int retval = -1;
+	char value[k_wormxattr_value_max];
+#ifdef __APPLE__
+	ssize_t len = fgetxattr(fd, k_worm_xattr_name, value, sizeof(value), 0, 0);
+#else
+	ssize_t len = fgetxattr(fd, k_worm_xattr_name, value, sizeof(value));
+#endif
+	if (len >= 0) {
+		*expires = wormxattr_value_parse(value, (size_t) len);
+		retval = 0;
+	} else if (errno == ERANGE) {
+		*expires = k_wormxattr_retain_forever;
+		retval = 0;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	sets our attribute on an open file; making it WORM
+ *
+ * @param	fd			the file to set it on
+ * @param	expires		as worm_xattr_set
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_xattr_fset(int fd, uint64_t expires) {
+	char value[k_wormxattr_value_max];
+	size_t len = wormxattr_value_format(value, sizeof(value), expires);
+#ifdef __APPLE__
+	return fsetxattr(fd, k_worm_xattr_name, value, len, 0, 0);
+#else
+	return fsetxattr(fd, k_worm_xattr_name, value, len, 0);
+#endif
+}
+
+
+/**
+ * @brief	checks the value of our attribute on an open file
+ *
+ * @param	fd			the file
+ * @param	is			the check of the value; e.g. wormxattr_value_is_sealed
+ *
+ * @return	1 if it is, 0 if not (including if it isn't WORM), else -1 and errno is set
+ */
+static int fvalue_is(int fd, int (*is)(const char* value, size_t len)) {
+	int retval = -1;
+	char value[k_wormxattr_value_max];
+#ifdef __APPLE__
+	ssize_t len = fgetxattr(fd, k_worm_xattr_name, value, sizeof(value), 0, 0);
+#else
+	ssize_t len = fgetxattr(fd, k_worm_xattr_name, value, sizeof(value));
+#endif
+	if (len >= 0) {
+		retval = is(value, (size_t) len) ? 1: 0;
+	} else if (	(errno == ENOATTR)
+			 || (errno == ERANGE)) {
+		retval = 0;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if an open directory is sealed
+ *
+ * @param	fd			the directory
+ *
+ * @return	as fvalue_is
+ */
+int worm_xattr_fsealed(int fd) {
+	return fvalue_is(fd, wormxattr_value_is_sealed);
+}
+
+
+/**
+ * @brief	checks if an open file is append only; its attribute is WORM but it isn't
+ *			finalized, so its contents can still grow
+ *
+ * @param	fd			the file
+ *
+ * @return	as fvalue_is
+ */
+int worm_xattr_fappend(int fd) {
+	return fvalue_is(fd, wormxattr_value_is_append);
+}
+
+
+/**
+ * @brief	seals an open directory; see wormxattr_policy.h
+ *
+ * @param	fd			the directory
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_xattr_fseal(int fd) {
+#ifdef __APPLE__
+	return fsetxattr(fd, k_worm_xattr_name, k_wormxattr_value_sealed, sizeof(k_wormxattr_value_sealed) - 1, 0, 0);
+#else
+	return fsetxattr(fd, k_worm_xattr_name, k_wormxattr_value_sealed, sizeof(k_wormxattr_value_sealed) - 1, 0);
+#endif
+}
+
+
+/**
+ * @brief	builds a path which names an entry relative to a directory descriptor
+ *			(Linux has no fd relative attribute calls; its /proc links stand in)
+ */
+#ifndef __APPLE__
+static int at_path(char* path, size_t len, int dirfd, const char* name) {
+	int retval = snprintf(path, len, "/proc/self/fd/%d/%s", dirfd, name);
+	if (retval >= (int) len) {
+		errno = ENAMETOOLONG;
+		retval = -1;
+	}
+	return retval;
+}
+#endif
+
+
+/**
+ * @brief	reads our attribute from an entry of an open directory; without following
+ *			a symbolic link or opening the entry
+ *
+ * @param	dirfd		the directory
+ * @param	name		the name of the entry
+ * @param	expires		as worm_xattr_get
+ *
+ * @return	as worm_xattr_get
+ */
+int worm_xattr_getat(int dirfd, const char* name, uint64_t* expires) {
+	int retval = -1;
+#ifdef __APPLE__
+	int fd = openat(dirfd, name, O_RDONLY | O_NONBLOCK | O_SYMLINK | O_CLOEXEC);
+	if (fd != -1) {
+		retval = worm_xattr_fget(fd, expires);
+		close(fd);
+	}
+#else
+	char path[PATH_MAX];
+	if (at_path(path, sizeof(path), dirfd, name) != -1) {
+		retval = worm_xattr_get(path, expires);
+	}
+#endif
+	return retval;
+}
+
+
+/**
+ * @brief	sets our attribute on an entry of an open directory; without following a
+ *			symbolic link or opening the entry
+ *
+ * @param	dirfd		the directory
+ * @param	name		the name of the entry
+ * @param	expires		as worm_xattr_set
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_xattr_setat(int dirfd, const char* name, uint64_t expires) {
+	int retval = -1;
+#ifdef __APPLE__
+	int fd = openat(dirfd, name, O_RDONLY | O_NONBLOCK | O_SYMLINK | O_CLOEXEC);
+	if (fd != -1) {
+		retval = worm_xattr_fset(fd, expires);
+		close(fd);
+	}
+#else
+	char path[PATH_MAX];
+	if (at_path(path, sizeof(path), dirfd, name) != -1) {
+		retval = worm_xattr_set(path, expires);
+	}
+#endif
+	return retval;
+}
+
+
+/**
+ * @brief	removes our attribute; only permitted once any retention has expired
+ *			(or for the super user)
+ *
+ * @param	path		the file to remove it from
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+int worm_xattr_remove(const char* path) {
+#ifdef __APPLE__
+	return removexattr(path, k_worm_xattr_name, XATTR_NOFOLLOW);
+#else
+	return lremovexattr(path, k_worm_xattr_name);
+#endif
+}
@@ -0,0 +1,79 @@
+//
+//  worm_xattr.h
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef tools_worm_xattr_h
+#define tools_worm_xattr_h
+
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct label; // the policy header declares kernel routines which take one
+#include "wormxattr.h"
+
+
+/*
+ * Description
+ *
+ * Reads and writes our attribute from userspace.  Symbolic links are never followed.
+ * On Linux only the user namespace can be set by users, so the name is prefixed.
+ */
+
+
+/*
+ * Defines
+ */
+
+#ifdef __APPLE__
+#define k_worm_xattr_name				k_wormxattr_xattr
+#define k_worm_digest_xattr_name		k_wormxattr_digest_xattr
+#else
+#define k_worm_xattr_name				"user." k_wormxattr_xattr
+#define k_worm_digest_xattr_name		"user." k_wormxattr_digest_xattr
+#endif
+
+#ifndef ENOATTR
+#define ENOATTR							ENODATA	// Linux reports a missing attribute as no data
+#endif
+
+
+/*
+ * Definitions
+ */
+
+extern int worm_xattr_get(const char* path, uint64_t* expires);
+extern int worm_xattr_set(const char* path, uint64_t expires);
+extern int worm_xattr_remove(const char* path);
+extern int worm_xattr_fget(int fd, uint64_t* expires);
+extern int worm_xattr_fset(int fd, uint64_t expires);
+extern int worm_xattr_fsealed(int fd);
+extern int worm_xattr_fseal(int fd);
+extern int worm_xattr_fappend(int fd);
+extern int worm_xattr_getat(int dirfd, const char* name, uint64_t* expires);
+extern int worm_xattr_setat(int dirfd, const char* name, uint64_t expires);
+
+
+#endif
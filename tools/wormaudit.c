@@ -0,0 +1,288 @@
+//
+//  wormaudit.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#ifdef __APPLE__
+#include <sys/mount.h>
+#include <sys/fsgetpath.h>
+#endif
+
+
+/*
+ * Description
+ *
+ * Resolves the vnodes in the kext's audit records to paths.  The kext records a
+ * vnode's file system id, file id, parent file id and name rather than its path (so
+ * denials never walk the name cache); this reads the log (files, or stdin, e.g. from
+ * "log show") and adds a path to each record as it's read.  A file id is resolved
+ * with fsgetpath; if the file has since gone, its parent is resolved and the name
+ * recorded with the denial appended.  Denials on the open path have no file ids (the
+ * kext doesn't fetch them there) and are printed as they are.  Resolutions (including
+ * failures) are cached, as denials cluster on a few files and directories.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormaudit_cache_initial		1024	// power of 2; slots in the cache to start with
+#define k_wormaudit_line_max			4096
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a resolved (or unresolvable) file id
+ *
+ * @field	fsid	the file system id
+ * @field	fileid	the file id; 0 for an empty slot
+ * @field	path	its path; NULL if it couldn't be resolved
+ */
+typedef struct {
+	uint64_t		fsid;
+	uint64_t		fileid;
+	char*			path;
+} audit_entry_t;
+
+/**
+ * @brief	the resolution cache; an open addressed hash table
+ *
+ * @field	slots		the entries
+ * @field	size		the number of slots; a power of 2
+ * @field	count		the number of entries
+ * @field	hits		lookups answered from the cache
+ * @field	misses		lookups which had to resolve
+ */
+typedef struct {
+	audit_entry_t*	slots;
+	size_t			size;
+	size_t			count;
+	uint64_t		hits;
+	uint64_t		misses;
+} audit_cache_t;
+
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-s] [file ...]\n", name);
+	fprintf(stderr, "  -s  print the cache statistics when done\n");
+	fprintf(stderr, "adds the path of the vnode to each wormxattr audit record in the log files (or stdin)\n");
+	exit(2);
+}
+
+
+/**
+ * @brief	resolves a file id to its current path
+ *
+ * @param	fsid	the file system id; val[0] in the low 32 bits
+ * @param	fileid	the file id
+ * @param	path	on success the path
+ * @param	len		the size of path
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int id_path(uint64_t fsid, uint64_t fileid, char* path, size_t len) {
+	int retval = -1;
+#ifdef __APPLE__
+	fsid_t id;
+	id.val[0] = (int32_t) (uint32_t) fsid;
+	id.val[1] = (int32_t) (uint32_t) (fsid >> 32);
+	if (fsgetpath(path, len, &id, fileid) >= 0) {
+		retval = 0;
+	}
+#else
+	// only the kext writes these records
+	errno = ENOTSUP;
+#endif
+	return retval;
+}
+
+
+static size_t cache_slot(const audit_cache_t* cache, uint64_t fsid, uint64_t fileid) {
+	uint64_t hash = (fileid ^ (fsid * 0xff51afd7ed558ccdull)) * 0x9e3779b97f4a7c15ull;
+	return (size_t) (hash >> 32) & (cache->size - 1);
+}
+
+
+/**
+ * @brief	doubles the size of the cache
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int cache_grow(audit_cache_t* cache) {
+	int retval = -1;
+	audit_cache_t grown = *cache;
+
+	grown.size = cache->size ? cache->size * 2: k_wormaudit_cache_initial;
+	if ((grown.slots = calloc(grown.size, sizeof(*grown.slots))) != NULL) {
+		for (size_t i = 0; i < cache->size; i++) {
+			if (cache->slots[i].fileid) {
+				size_t slot = cache_slot(&grown, cache->slots[i].fsid, cache->slots[i].fileid);
+				while (grown.slots[slot].fileid) {
+					slot = (slot + 1) & (grown.size - 1);
+				}
+				grown.slots[slot] = cache->slots[i];
+			}
+		}
+		free(cache->slots);
+		*cache = grown;
+		retval = 0;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	resolves a file id to its path; from the cache if its been resolved before
+ *
+ * @param	cache	the cache
+ * @param	fsid	the file system id
+ * @param	fileid	the file id
+ *
+ * @return	the path (owned by the cache), else NULL if it can't be resolved
+ */
+static const char* cache_path(audit_cache_t* cache, uint64_t fsid, uint64_t fileid) {
+	const char* retval = NULL;
+	char path[PATH_MAX];
+	size_t slot = 0;
+
+	if (	(cache->count + 1) * 2 > cache->size
+		 && cache_grow(cache) != 0) {
+		goto out; // out of memory; just don't resolve
+	}
+	slot = cache_slot(cache, fsid, fileid);
+	while (cache->slots[slot].fileid) {
+		if (	cache->slots[slot].fileid == fileid
+			 && cache->slots[slot].fsid == fsid) {
+			cache->hits++;
+			retval = cache->slots[slot].path;
+			goto out;
+		}
+		slot = (slot + 1) & (cache->size - 1);
+	}
+	cache->misses++;
+	cache->slots[slot].fsid = fsid;
+	cache->slots[slot].fileid = fileid;
+	if (id_path(fsid, fileid, path, sizeof(path)) == 0) {
+		cache->slots[slot].path = strdup(path);
+	}
+	cache->count++;
+	retval = cache->slots[slot].path;
+
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	prints a line of the log; adding the path of the vnode if its an audit record
+ *
+ * @param	cache	the resolution cache
+ * @param	line	the line; including its newline
+ */
+static void audit_line(audit_cache_t* cache, const char* line) {
+	const char* ids = strstr(line, "(fsid = ");
+	const char* name = NULL;
+	const char* end = NULL;
+	unsigned long long fsid = 0, fileid = 0, parent = 0;
+	const char* path = NULL;
+
+	if (	ids == NULL
+		 || sscanf(ids, "(fsid = %llx, fileid = %llu, parent = %llu,", &fsid, &fileid, &parent) != 3
+		 || (name = strstr(ids, ", name = \"")) == NULL
+		 || (end = strstr(name, "\", vnode = ")) == NULL) {
+		fputs(line, stdout); // not one of ours
+		return;
+	}
+	name += strlen(", name = \"");
+
+	if (	fileid != 0
+		 && (path = cache_path(cache, fsid, fileid)) != NULL) {
+		printf("%.*s, path = \"%s\"%s", (int) (end + 1 - line), line, path, end + 1);
+	} else if (	parent != 0
+			 && (path = cache_path(cache, fsid, parent)) != NULL) {
+		// its gone; where it was
+		printf("%.*s, path = \"%s/%.*s\" (gone)%s", (int) (end + 1 - line), line,
+			   strcmp(path, "/") == 0 ? "": path, (int) (end - name), name, end + 1);
+	} else {
+		fputs(line, stdout);
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	bool stats = false;
+	audit_cache_t cache = {0};
+	char line[k_wormaudit_line_max];
+	int ch = 0;
+
+	while ((ch = getopt(argc, argv, "s")) != -1) {
+		switch (ch) {
+			case 's':
+				stats = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	for (int i = optind; (i < argc) || (i == optind); i++) {
+		FILE* f = stdin;
+
+		if (	(i < argc)
+			 && (f = fopen(argv[i], "r")) == NULL) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			retval = 1;
+			continue;
+		}
+		while (fgets(line, sizeof(line), f) != NULL) {
+			audit_line(&cache, line);
+		}
+		if (f != stdin) {
+			fclose(f);
+		}
+	}
+	if (stats) {
+		fprintf(stderr, "resolved %zu ids; %" PRIu64 " cache hits, %" PRIu64 " misses\n", cache.count, cache.hits, cache.misses);
+	}
+	return retval;
+}
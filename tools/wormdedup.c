@@ -0,0 +1,717 @@
+//
+//  wormdedup.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#endif
+
+#include "walk.h"
+#include "worm_digest.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Description
+ *
+ * Deduplicates WORM files; identical files (across every tree given) are made to
+ * share their storage.  Trees are walked by the shared work stealing walker and each
+ * WORM file (regular, finalized and no smaller than -m) is digested by the thread
+ * which finds it; using the digest stored when it was sealed (wormseal -H) if it has
+ * one.  The files are then grouped by device, size and digest and the groups shared
+ * out between the threads.
+ *
+ * Duplicates are deduplicated in place; the file system is asked (FIDEDUPERANGE) to
+ * share their extents with the group's first file.  It compares the contents itself
+ * and only shares what's identical, so nothing a file reads can change and a wrong
+ * digest costs nothing.  Files keep their names, inodes and attributes; nothing is
+ * unlinked, renamed or opened for writing, so the policy's guarantees hold throughout.
+ * Replacing duplicates with hard links would need them unlinked, which the policy
+ * denies.  The file system must support sharing extents (e.g. btrfs or XFS) and, as
+ * the files are opened read only, it must be run by the files' owner or the super user.
+ *
+ * With a content store (-s, a directory on the same file system) each group's
+ * contents are also cloned (FICLONE) into the store, named for their digest and made
+ * WORM, and the group shares the store's extents; so later runs deduplicate new
+ * copies against the store even once the group's other files have expired and gone.
+ *
+ * Extent sharing is Linux only; elsewhere, or with -n, the duplicates and the bytes
+ * they'd save are reported and nothing is changed.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormdedup_threads				8
+#define k_wormdedup_min					4096				// smaller files rarely fill a block
+#define k_wormdedup_chunk				(16 * 1024 * 1024)	// bytes deduplicated per call
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a WORM file found by the walk
+ */
+typedef struct {
+	uint64_t		dev;
+	uint64_t		ino;
+	uint64_t		size;
+	uint8_t			digest[k_worm_digest_len];
+	char*			path;
+} dedup_record_t;
+
+/**
+ * @brief	the records found by a thread; merged once the walks end
+ */
+typedef struct {
+	dedup_record_t*	records;
+	size_t			count;
+	size_t			space;
+} dedup_list_t;
+
+/**
+ * @brief	a group of identical files; count records from first
+ */
+typedef struct {
+	size_t			first;
+	size_t			count;
+} dedup_group_t;
+
+/**
+ * @brief	the state of a deduplication run
+ *
+ * @field	root		the absolute path of the tree being walked
+ * @field	min			the smallest file deduplicated
+ * @field	dryrun		report what would be saved without changing anything
+ * @field	store		the content store; -1 without one
+ * @field	storedev	the device the store is on
+ * @field	lists		the records found by each thread
+ * @field	records		the records of every tree; sorted into groups
+ * @field	groups		the groups of identical files
+ * @field	ngroups		the number of groups
+ * @field	next		the next group to deduplicate
+ * @field	files		WORM files found
+ * @field	digested	bytes digested
+ * @field	duplicates	files which duplicate an earlier one (or the store)
+ * @field	stored		contents added to the store
+ * @field	tmps		temporaries created in the store; numbering each uniquely
+ * @field	shared		files which already shared their first extent with the source
+ * @field	saved		bytes shared (or with dryrun, which would be)
+ * @field	differ		files whose contents differ from their digest's group
+ * @field	failed		files which couldn't be read or deduplicated
+ */
+typedef struct {
+	const char*			root;
+	uint64_t			min;
+	bool				dryrun;
+	int					store;
+	uint64_t			storedev;
+	dedup_list_t		lists[k_walk_threads_max];
+	dedup_record_t*		records;
+	dedup_group_t*		groups;
+	size_t				ngroups;
+	volatile size_t		next;
+	volatile uint64_t	files;
+	volatile uint64_t	digested;
+	volatile uint64_t	duplicates;
+	volatile uint64_t	stored;
+	volatile uint64_t	tmps;
+	volatile uint64_t	shared;
+	volatile uint64_t	saved;
+	volatile uint64_t	differ;
+	volatile uint64_t	failed;
+} dedup_run_t;
+
+static void usage(const char* name);
+static void dedup_failed(dedup_run_t* d, const char* path, int err);
+static void dedup_entry(walk_t* w, unsigned thread, int dirfd, const char* name, const char* path, unsigned char type, uint64_t state);
+static void dedup_error(walk_t* w, unsigned thread, const char* path, int err);
+static int dedup_walk(dedup_run_t* d, const char* root, unsigned threads);
+static int record_compare(const void* a, const void* b);
+static int dedup_group(dedup_run_t* d, size_t records);
+static int dedup_extent(int fd, uint64_t* physical);
+static int dedup_range(dedup_run_t* d, int src, const char* path, uint64_t size);
+static int dedup_store(dedup_run_t* d, const dedup_record_t* record, bool* cloned);
+static void dedup_one(dedup_run_t* d, const dedup_group_t* g);
+static void* dedup_thread(void* arg);
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-t threads] [-m bytes] [-s store] [-n] path ...\n", name);
+	fprintf(stderr, "  -t threads  the number of threads digesting and deduplicating (default %u)\n", k_wormdedup_threads);
+	fprintf(stderr, "  -m bytes    the smallest file deduplicated (default %u)\n", k_wormdedup_min);
+	fprintf(stderr, "  -s store    a content store on the same file system; shared by later runs\n");
+	fprintf(stderr, "  -n          report the duplicates and what they'd save; change nothing\n");
+	exit(2);
+}
+
+
+static void dedup_failed(dedup_run_t* d, const char* path, int err) {
+	fprintf(stderr, "%s%s%s: %s\n", d->root, ((d->root[0] == '\0') || (path[0] == '\0')) ? "": "/", path, strerror(err));
+	(void) __sync_fetch_and_add(&d->failed, 1);
+}
+
+
+/**
+ * @brief	records a WORM file; with its digest
+ */
+static void dedup_entry(walk_t* w, unsigned thread, int dirfd, const char* name, const char* path, unsigned char type, uint64_t state) {
+	dedup_run_t* d = walk_arg(w);
+	dedup_list_t* l = &d->lists[thread];
+	dedup_record_t r = {0};
+	uint64_t expires = 0;
+	uint64_t bytes = 0;
+	struct stat st;
+	int fd = -1;
+	
+	if (type != DT_REG) {
+		return;
+	}
+	if ((fd = openat(dirfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) == -1) {
+		dedup_failed(d, path, errno);
+		return;
+	}
+	if (fstat(fd, &st) != 0) {
+		dedup_failed(d, path, errno);
+	} else if (	((uint64_t) st.st_size < d->min)
+			   || (worm_xattr_fget(fd, &expires) != 0)
+			   || (worm_xattr_fappend(fd) != 0)) {
+		// too small, not WORM or still growing
+	} else if (	(worm_digest_get(fd, r.digest) != 0)
+			   && (worm_digest_fd(fd, r.digest, &bytes) != 0)) {
+		dedup_failed(d, path, errno);
+	} else if (asprintf(&r.path, "%s/%s", d->root, path) == -1) {
+		dedup_failed(d, path, ENOMEM);
+	} else {
+		r.dev = (uint64_t) st.st_dev;
+		r.ino = (uint64_t) st.st_ino;
+		r.size = (uint64_t) st.st_size;
+		if (l->count == l->space) {
+			size_t space = l->space ? l->space * 2: 1024;
+			dedup_record_t* records = realloc(l->records, space * sizeof(*records));
+			if (records == NULL) {
+				free(r.path);
+				dedup_failed(d, path, ENOMEM);
+				goto out;
+			}
+			l->records = records;
+			l->space = space;
+		}
+		l->records[l->count++] = r;
+		(void) __sync_fetch_and_add(&d->files, 1);
+		(void) __sync_fetch_and_add(&d->digested, bytes);
+	}
+out:
+	close(fd);
+}
+
+
+static void dedup_error(walk_t* w, unsigned thread, const char* path, int err) {
+	dedup_failed(walk_arg(w), path, err);
+}
+
+
+/**
+ * @brief	walks a tree; recording its WORM files
+ *
+ * @return	0 on success, else 1
+ */
+static int dedup_walk(dedup_run_t* d, const char* root, unsigned threads) {
+	int retval = 1;
+	walk_callbacks_t callbacks = {
+		.entry = dedup_entry,
+		.error = dedup_error,
+	};
+	walk_t* w = NULL;
+	int err = 0;
+	
+	d->root = root;
+	if ((w = walk_create(root, threads, &callbacks, d)) == NULL) {
+		fprintf(stderr, "%s: %s\n", root, strerror(errno));
+	} else if ((err = walk_run(w)) != 0) {
+		fprintf(stderr, "%s: unable to walk; %s\n", root, strerror(err));
+	} else {
+		retval = 0;
+	}
+	if (w != NULL) {
+		walk_destroy(w);
+	}
+	d->root = "";
+	return retval;
+}
+
+
+/**
+ * @brief	orders records by device, size, digest and inode; so groups of identical
+ *			files are adjacent, as are hard links to the same file
+ */
+static int record_compare(const void* a, const void* b) {
+	const dedup_record_t* ra = a;
+	const dedup_record_t* rb = b;
+	int retval = 0;
+	
+	if (ra->dev != rb->dev) {
+		retval = (ra->dev < rb->dev) ? -1: 1;
+	} else if (ra->size != rb->size) {
+		retval = (ra->size < rb->size) ? -1: 1;
+	} else if ((retval = memcmp(ra->digest, rb->digest, sizeof(ra->digest))) != 0) {
+		// ordered by digest
+	} else if (ra->ino != rb->ino) {
+		retval = (ra->ino < rb->ino) ? -1: 1;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	merges the threads' records and groups them; hard links (a file found by
+ *			more than one path) are only kept once.  Without a store only groups with
+ *			more than one file are kept
+ *
+ * @param	d		the run
+ * @param	records	the number of records
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int dedup_group(dedup_run_t* d, size_t records) {
+	int retval = -1;
+	size_t n = 0;
+	
+	if (	((d->records = calloc(records ? records: 1, sizeof(*d->records))) == NULL)
+		 || ((d->groups = calloc(records ? records: 1, sizeof(*d->groups))) == NULL)) {
+		goto out;
+	}
+	for (unsigned t = 0; t < k_walk_threads_max; t++) {
+		if (d->lists[t].count > 0) {
+			memcpy(&d->records[n], d->lists[t].records, d->lists[t].count * sizeof(*d->records));
+			n += d->lists[t].count;
+		}
+		free(d->lists[t].records);
+		memset(&d->lists[t], 0, sizeof(d->lists[t]));
+	}
+	qsort(d->records, n, sizeof(*d->records), record_compare);
+	for (size_t i = 0; i < n; i++) {
+		dedup_group_t* g = (d->ngroups > 0) ? &d->groups[d->ngroups - 1]: NULL;
+		const dedup_record_t* last = (g != NULL) ? &d->records[g->first + g->count - 1]: NULL;
+		
+		if (	(last != NULL)
+			 && (last->dev == d->records[i].dev)
+			 && (last->size == d->records[i].size)
+			 && (memcmp(last->digest, d->records[i].digest, sizeof(last->digest)) == 0)) {
+			if (last->ino == d->records[i].ino) {
+				// another link to the same file
+				free(d->records[i].path);
+				d->records[i].path = NULL;
+				continue;
+			}
+			if (g->first + g->count != i) {
+				d->records[g->first + g->count] = d->records[i];
+				d->records[i].path = NULL;
+			}
+			g->count++;
+		} else {
+			if (	(g != NULL)
+				 && (g->count == 1)
+				 && (d->store == -1)) {
+				d->ngroups--; // a file without duplicates
+			}
+			d->groups[d->ngroups++] = (dedup_group_t) {i, 1};
+		}
+	}
+	if (	(d->ngroups > 0)
+		 && (d->groups[d->ngroups - 1].count == 1)
+		 && (d->store == -1)) {
+		d->ngroups--;
+	}
+	retval = 0;
+out:
+	return retval;
+}
+
+
+/**
+ * @brief	gets where a file's first extent is on the disk
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int dedup_extent(int fd, uint64_t* physical) {
+	int retval = -1;
+#ifdef __linux__
+	struct {
+		struct fiemap			map;
+		struct fiemap_extent	extent;
+	} args;
+	
+	memset(&args, 0, sizeof(args));
+	args.map.fm_length = FIEMAP_MAX_OFFSET;
+	args.map.fm_flags = FIEMAP_FLAG_SYNC;
+	args.map.fm_extent_count = 1;
+	if (ioctl(fd, FS_IOC_FIEMAP, &args.map) == 0) {
+		if (	(args.map.fm_mapped_extents == 1)
+			 && ((args.extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE)) == 0)) {
+			*physical = args.extent.fe_physical;
+			retval = 0;
+		} else {
+			errno = ENODATA;
+		}
+	}
+#else
+	errno = ENOTSUP;
+#endif
+	return retval;
+}
+
+
+/**
+ * @brief	shares a file's extents with a source whose contents are the same.  A file
+ *			already sharing its first extent with the source (e.g. from an earlier run)
+ *			is left alone
+ *
+ * @param	d		the run
+ * @param	src		the source; open for reading
+ * @param	path	the file
+ * @param	size	the size of both
+ *
+ * @return	0 on success, else -1 and errno is set; EILSEQ if they differ
+ */
+static int dedup_range(dedup_run_t* d, int src, const char* path, uint64_t size) {
+	int retval = -1;
+#ifdef __linux__
+	int fd = open(path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+	struct {
+		struct file_dedupe_range		range;
+		struct file_dedupe_range_info	info;
+	} args;
+	uint64_t offset = 0;
+	uint64_t from = 0, to = 0;
+	
+	if (fd == -1) {
+		goto out;
+	}
+	retval = 0;
+	if (	(dedup_extent(src, &from) == 0)
+		 && (dedup_extent(fd, &to) == 0)
+		 && (from == to)) {
+		(void) __sync_fetch_and_add(&d->shared, 1);
+		offset = size;
+	}
+	while (	(retval == 0)
+		   && (offset < size)) {
+		memset(&args, 0, sizeof(args));
+		args.range.src_offset = offset;
+		args.range.src_length = (size - offset < k_wormdedup_chunk) ? size - offset: k_wormdedup_chunk;
+		args.range.dest_count = 1;
+		args.info.dest_fd = fd;
+		args.info.dest_offset = offset;
+		if (ioctl(src, FIDEDUPERANGE, &args.range) != 0) {
+			retval = -1;
+		} else if (args.info.status == FILE_DEDUPE_RANGE_DIFFERS) {
+			errno = EILSEQ;
+			retval = -1;
+		} else if (args.info.status < 0) {
+			errno = -args.info.status;
+			retval = -1;
+		} else if (args.info.bytes_deduped == 0) {
+			errno = EIO; // no progress
+			retval = -1;
+		} else {
+			offset += args.info.bytes_deduped;
+			(void) __sync_fetch_and_add(&d->saved, args.info.bytes_deduped);
+		}
+	}
+out:
+	if (fd != -1) {
+		int err = errno;
+		close(fd);
+		errno = err;
+	}
+#else
+	errno = ENOTSUP;
+#endif
+	return retval;
+}
+
+
+/**
+ * @brief	opens a group's contents in the store; cloning them in if they aren't yet
+ *
+ * @param	d		the run
+ * @param	record	the group's first file
+ * @param	cloned	on success true if the file was cloned into the store; so its
+ *					already sharing the store's extents
+ *
+ * @return	the store's copy, open for reading; else -1 and errno is set
+ */
+static int dedup_store(dedup_run_t* d, const dedup_record_t* record, bool* cloned) {
+	int retval = -1;
+	char name[3 + k_worm_digest_len * 2 + 1];
+	char tmp[sizeof(name) + 40];
+	struct stat st;
+	
+	*cloned = false;
+	snprintf(name, 3, "%02x", record->digest[0]);
+	(void) mkdirat(d->store, name, 0755);
+	name[2] = '/';
+	for (size_t i = 0; i < k_worm_digest_len; i++) {
+		snprintf(&name[3 + i * 2], 3, "%02x", record->digest[i]);
+	}
+	if ((retval = openat(d->store, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) != -1) {
+		if (	(fstat(retval, &st) != 0)
+			 || ((uint64_t) st.st_size != record->size)) {
+			close(retval);
+			errno = EEXIST; // a digest collision; left unstored
+			retval = -1;
+		}
+	} else if (errno == ENOENT) {
+#ifdef __linux__
+		int src = open(record->path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+		int fd = -1;
+		
+		// cloned under a temporary name unique to this process and call (never reusing
+		// another's, or one left behind), and only made WORM once synced, just before
+		// it's renamed; so the store only ever holds whole, WORM contents (renaming a
+		// WORM file within the store is allowed) and until then a failure can remove it
+		snprintf(tmp, sizeof(tmp), "%s.%d.%" PRIu64 ".tmp", name, (int) getpid(), __sync_fetch_and_add(&d->tmps, 1));
+		if (	(src != -1)
+			 && ((fd = openat(d->store, tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0444)) != -1)
+			 && (ioctl(fd, FICLONE, src) == 0)
+			 && (fsync(fd) == 0)
+			 && (worm_xattr_fset(fd, k_wormxattr_retain_forever) == 0)
+			 && (renameat(d->store, tmp, d->store, name) == 0)) {
+			retval = openat(d->store, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+			(void) __sync_fetch_and_add(&d->stored, 1);
+			*cloned = true;
+		} else if (fd != -1) {
+			int err = errno;
+			(void) unlinkat(d->store, tmp, 0);
+			errno = err;
+		}
+		if (fd != -1) {
+			close(fd);
+		}
+		if (src != -1) {
+			int err = errno;
+			close(src);
+			errno = err;
+		}
+#else
+		errno = ENOTSUP;
+#endif
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	deduplicates a group; against the store, if there is one, else its first file
+ */
+static void dedup_one(dedup_run_t* d, const dedup_group_t* g) {
+	const dedup_record_t* records = &d->records[g->first];
+	bool store = (	(d->store != -1)
+				  && (records[0].dev == d->storedev));
+	size_t first = store ? 0: 1;
+	bool cloned = false;
+	int src = -1;
+	
+	if (d->dryrun) {
+		// the store isn't read, so only the duplicates within the group are counted
+		if (g->count > 1) {
+			(void) __sync_fetch_and_add(&d->duplicates, g->count - 1);
+			(void) __sync_fetch_and_add(&d->saved, (g->count - 1) * records[0].size);
+		}
+		return;
+	}
+	if (store) {
+		if ((src = dedup_store(d, &records[0], &cloned)) == -1) {
+			// deduplicate against the first file instead
+			if (errno != EEXIST) {
+				fprintf(stderr, "%s: unable to store; %s\n", records[0].path, strerror(errno));
+			}
+			first = 1;
+		} else if (cloned) {
+			first = 1;
+		}
+	}
+	if (	(src == -1)
+		 && (g->count > 1)
+		 && ((src = open(records[0].path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) == -1)) {
+		dedup_failed(d, records[0].path, errno);
+		return;
+	}
+	for (size_t i = first; i < g->count; i++) {
+		if (dedup_range(d, src, records[i].path, records[i].size) == 0) {
+			(void) __sync_fetch_and_add(&d->duplicates, 1); // including those already shared
+		} else if (errno == EILSEQ) {
+			printf("%s: contents differ from its digest's\n", records[i].path);
+			(void) __sync_fetch_and_add(&d->differ, 1);
+		} else {
+			dedup_failed(d, records[i].path, errno);
+		}
+	}
+	if (src != -1) {
+		close(src);
+	}
+}
+
+
+static void* dedup_thread(void* arg) {
+	dedup_run_t* d = arg;
+	size_t g = 0;
+	
+	while ((g = __sync_fetch_and_add(&d->next, 1)) < d->ngroups) {
+		dedup_one(d, &d->groups[g]);
+	}
+	return NULL;
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	unsigned threads = k_wormdedup_threads;
+	const char* store = NULL;
+	dedup_run_t d = {0};
+	pthread_t tids[k_walk_threads_max];
+	struct timespec start = {0};
+	struct timespec end = {0};
+	size_t records = 0;
+	int ch = 0;
+	
+	d.min = k_wormdedup_min;
+	d.store = -1;
+	d.root = "";
+	while ((ch = getopt(argc, argv, "t:m:s:n")) != -1) {
+		switch (ch) {
+			case 't':
+				threads = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'm':
+				d.min = strtoull(optarg, NULL, 10);
+				break;
+			case 's':
+				store = optarg;
+				break;
+			case 'n':
+				d.dryrun = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	optind == argc
+		 || threads == 0
+		 || threads > k_walk_threads_max) {
+		usage(argv[0]);
+	}
+#ifndef __linux__
+	if (!d.dryrun) {
+		fprintf(stderr, "extent sharing isn't supported here; reporting only\n");
+		d.dryrun = true;
+	}
+#endif
+	if (store != NULL) {
+		struct stat st;
+		
+		if (	((d.store = open(store, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+			 || (fstat(d.store, &st) != 0)) {
+			fprintf(stderr, "%s: %s\n", store, strerror(errno));
+			return 1;
+		}
+		d.storedev = (uint64_t) st.st_dev;
+	}
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = optind; i < argc; i++) {
+		char path[PATH_MAX] = {0};
+		
+		if (realpath(argv[i], path) == NULL) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			retval = 1;
+		} else if (dedup_walk(&d, path, threads) != 0) {
+			retval = 1;
+		}
+	}
+	for (unsigned t = 0; t < k_walk_threads_max; t++) {
+		records += d.lists[t].count;
+	}
+	if (dedup_group(&d, records) != 0) {
+		fprintf(stderr, "unable to group; %s\n", strerror(errno));
+		return 1;
+	}
+	
+	if (threads > d.ngroups) {
+		threads = d.ngroups ? (unsigned) d.ngroups: 1;
+	}
+	for (unsigned t = 1; t < threads; t++) {
+		if (pthread_create(&tids[t], NULL, dedup_thread, &d) != 0) {
+			threads = t;
+			break;
+		}
+	}
+	dedup_thread(&d);
+	for (unsigned t = 1; t < threads; t++) {
+		pthread_join(tids[t], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	printf("%" PRIu64 " WORM files, %zu groups, %" PRIu64 " duplicates%s (%" PRIu64 " already shared), %" PRIu64 " stored, %.1f MB %s, %" PRIu64 " differ, %" PRIu64 " failed; %.2fs (%.1f MB digested)\n",
+		   d.files, d.ngroups, d.duplicates, d.dryrun ? " found": " deduplicated", d.shared, d.stored,
+		   (double) d.saved / (1024 * 1024), d.dryrun ? "could be saved": "saved", d.differ, d.failed,
+		   (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9, (double) d.digested / (1024 * 1024));
+	if (	(d.differ != 0)
+		 || (d.failed != 0)) {
+		retval = 1;
+	}
+	for (size_t i = 0; i < records; i++) {
+		free(d.records[i].path);
+	}
+	free(d.records);
+	free(d.groups);
+	if (d.store != -1) {
+		close(d.store);
+	}
+	return retval;
+}
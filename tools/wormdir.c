@@ -0,0 +1,144 @@
+//
+//  wormdir.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "worm_dirindex.h"
+
+
+/*
+ * Description
+ *
+ * Reads a sealed directory's index (see worm_dirindex.h); looking names up, or listing
+ * its entries (-l), without reading the directory.  A directory without a valid index
+ * (or which isn't sealed) is an error; its listing could still change.
+ */
+
+
+/*
+ * Definitions
+ */
+
+static char dir_type(uint8_t type);
+static void dir_print(const worm_dirindex_t* index, const worm_dirindex_entry_t* entry);
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static char dir_type(uint8_t type) {
+	char retval = '?';
+	switch (type) {
+		case DT_REG:	retval = 'f'; break;
+		case DT_DIR:	retval = 'd'; break;
+		case DT_LNK:	retval = 'l'; break;
+		case DT_FIFO:	retval = 'p'; break;
+		case DT_SOCK:	retval = 's'; break;
+		case DT_CHR:	retval = 'c'; break;
+		case DT_BLK:	retval = 'b'; break;
+	}
+	return retval;
+}
+
+
+static void dir_print(const worm_dirindex_t* index, const worm_dirindex_entry_t* entry) {
+	printf("%c %10" PRIu64 " %s\n", dir_type(entry->type), entry->ino, worm_dirindex_name(index, entry));
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s -l dir\n", name);
+	fprintf(stderr, "       %s dir name ...\n", name);
+	fprintf(stderr, "  -l             list every entry of the directory\n");
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 1;
+	bool list = false;
+	worm_dirindex_t index = {0};
+	int dirfd = -1;
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "l")) != -1) {
+		switch (ch) {
+			case 'l':
+				list = true;
+				break;
+			default:
+				usage(argv[0]);
+				goto out;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (	(argc < 1)
+		 || (list && argc != 1)
+		 || (!list && argc < 2)) {
+		usage(argv[-optind]);
+		goto out;
+	}
+	
+	if ((dirfd = open(argv[0], O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+		goto out;
+	}
+	if (worm_dirindex_open(&index, dirfd) != 0) {
+		fprintf(stderr, "%s: no index; %s\n", argv[0], (errno == ESTALE) ? "not sealed": strerror(errno));
+		goto out;
+	}
+	retval = 0;
+	if (list) {
+		for (uint32_t i = 0; i < index.count; i++) {
+			dir_print(&index, &index.entries[i]);
+		}
+	} else {
+		for (int i = 1; i < argc; i++) {
+			const worm_dirindex_entry_t* entry = worm_dirindex_lookup(&index, argv[i]);
+			if (entry == NULL) {
+				fprintf(stderr, "%s/%s: %s\n", argv[0], argv[i], strerror(ENOENT));
+				retval = 1;
+			} else {
+				dir_print(&index, entry);
+			}
+		}
+	}
+	
+out:
+	worm_dirindex_close(&index);
+	if (dirfd != -1) {
+		close(dirfd);
+	}
+	return retval;
+}
@@ -0,0 +1,493 @@
+//
+//  wormfand.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/xattr.h>
+
+#include "worm_cache.h"
+
+struct label; // the policy header declares kernel routines which take one
+#include "wormxattr.h"
+
+
+/*
+ * Description
+ *
+ * Enforces the policy on Linux with fanotify permission events; the decisions come 
+ * from the policy core (wormxattr_policy.h) which the kext uses.  Each open of a file
+ * on a watched mount is held by the kernel until a worker thread allows or denies it.
+ *
+ * The WORM state of each inode is cached (see worm_cache.h) so the allow path for an
+ * unchanged file never re-reads the attribute.  As the state is cached 
+ * and the open's access isn't, the state is checked first; only opens of WORM files 
+ * ask whether they write.  fanotify doesn't report the open flags, so they're read
+ * from the opening thread's syscall arguments (/proc/<tid>/syscall); its blocked in
+ * the open until we answer.  Events report the thread (FAN_REPORT_TID) rather than 
+ * its process, whose main thread may be in any other syscall.
+ *
+ * Limitations; fanotify has no permission events for unlink, rename, truncate(2) by
+ * path or attribute changes.  Set the append only flag (chattr +a) on WORM directories
+ * to stop entries being removed from them, and the immutable flag (chattr +i) on 
+ * sealed directories as there are none for create, link or rename into one either.
+ * Use the trusted attribute namespace (-N trusted) so that only root can remove the
+ * attribute.  Opens of WORM files made by io_uring, or by syscalls we don't know, 
+ * are denied as writes (and counted) unless -P is given.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormfand_queue				4096
+#define k_wormfand_threads_max			64
+#define k_wormfand_marks_max			64
+#define k_wormfand_buffer				(64 * 1024)
+
+// older headers; Linux 4.20
+#ifndef FAN_REPORT_TID
+#define FAN_REPORT_TID					0x00000100
+#endif
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a permission event waiting for a worker
+ */
+typedef struct {
+	int			fd;
+	pid_t		tid;
+} work_t;
+
+/**
+ * @brief	statistics; updated atomically
+ */
+typedef struct {
+	volatile uint64_t	events;
+	volatile uint64_t	denied;
+	volatile uint64_t	cache_hits;
+	volatile uint64_t	xattr_reads;
+	volatile uint64_t	intent_reads;
+	volatile uint64_t	intent_unknown;
+} stats_t;
+
+
+static char g_xattr[XATTR_NAME_MAX + 1] = "user." k_wormxattr_xattr;
+static bool g_strict = true;
+static bool g_quiet = false;
+static int g_fan = -1;
+static stats_t g_stats = {0};
+static volatile sig_atomic_t g_stop = 0;
+static volatile sig_atomic_t g_report = 0;
+
+static work_t g_queue[k_wormfand_queue];
+static size_t g_queue_head = 0;
+static size_t g_queue_count = 0;
+static bool g_queue_closed = false;
+static pthread_mutex_t g_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_queue_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_queue_space = PTHREAD_COND_INITIALIZER;
+
+
+/*
+ * Implementation
+ */
+
+__private_extern__ uint64_t wormxattr_policy_now(void) {
+	return (uint64_t) time(NULL);
+}
+
+
+/**
+ * @brief	gets an inodes WORM state; from the cache if its valid, else from its attribute
+ *
+ * @param	fd		the event fd; open on the inode
+ * @param	st		the inodes stat
+ *
+ * @return	the state as a label value
+ */
+static intptr_t worm_state(int fd, const struct stat* st) {
+	intptr_t retval = worm_cache_get(st);
+	
+	if (retval != k_wormxattr_label_unknown) {
+		(void) __sync_fetch_and_add(&g_stats.cache_hits, 1);
+	} else {
+		char value[k_wormxattr_value_max];
+		ssize_t len = fgetxattr(fd, g_xattr, value, sizeof(value));
+		
+		(void) __sync_fetch_and_add(&g_stats.xattr_reads, 1);
+		retval = k_wormxattr_label_mutable; // as the kext; errors are mutable
+		if (len >= 0) {
+			retval = wormxattr_policy_label(value, (size_t) len);
+		} else if (errno == ERANGE) {
+			retval = wormxattr_label_worm(k_wormxattr_retain_forever);
+		}
+		worm_cache_set(st, retval);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	converts open flags into the policy's access
+ */
+static int open_access(uint64_t flags) {
+	int retval = 0;
+	retval |= (flags & O_ACCMODE) != O_RDONLY ? k_wormxattr_access_write: 0;
+	retval |= (flags & O_ACCMODE) == O_RDWR ? k_wormxattr_access_read: 0;
+	retval |= (flags & O_APPEND) ? k_wormxattr_access_append: 0;
+	retval |= (flags & O_TRUNC) ? k_wormxattr_access_truncate: 0;
+	return retval;
+}
+
+
+/**
+ * @brief	finds how a blocked thread is opening a file, from the syscall its in
+ *
+ * @param	tid		the thread
+ * @param	access	on success the k_wormxattr_access_* of the open
+ *
+ * @return	0 on success, else -1 if its unknown
+ */
+static int open_intent(pid_t tid, int* access) {
+	int retval = -1;
+	char path[64];
+	char buf[256] = {0};
+	long nr = -1;
+	unsigned long long args[6] = {0};
+	int fd = -1;
+	ssize_t len = 0;
+	
+	(void) __sync_fetch_and_add(&g_stats.intent_reads, 1);
+	(void) snprintf(path, sizeof(path), "/proc/%d/syscall", (int) tid);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		goto out;
+	}
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (	(len <= 0)
+		 || (sscanf(buf, "%ld %llx %llx %llx %llx %llx %llx", &nr, &args[0], &args[1], &args[2], &args[3], &args[4], &args[5]) != 7)) {
+		goto out;
+	}
+	switch (nr) {
+#ifdef SYS_open
+		case SYS_open:
+			*access = open_access(args[1]);
+			retval = 0;
+			break;
+#endif
+#ifdef SYS_creat
+		case SYS_creat:
+			*access = k_wormxattr_access_write | k_wormxattr_access_truncate;
+			retval = 0;
+			break;
+#endif
+		case SYS_openat:
+		case SYS_open_by_handle_at:
+			*access = open_access(args[2]);
+			retval = 0;
+			break;
+#ifdef SYS_openat2
+		case SYS_openat2: {
+			// the flags are the first member of the struct open_how it points to
+			uint64_t flags = 0;
+			(void) snprintf(path, sizeof(path), "/proc/%d/mem", (int) tid);
+			if ((fd = open(path, O_RDONLY | O_CLOEXEC)) != -1) {
+				if (pread(fd, &flags, sizeof(flags), (off_t) args[2]) == sizeof(flags)) {
+					*access = open_access(flags);
+					retval = 0;
+				}
+				close(fd);
+			}
+			break;
+		}
+#endif
+		case SYS_execve:
+		case SYS_execveat:
+			*access = 0;
+			retval = 0;
+			break;
+	}
+out:
+	if (retval != 0) {
+		(void) __sync_fetch_and_add(&g_stats.intent_unknown, 1);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	decides a permission event
+ *
+ * @param	w		the event
+ *
+ * @return	FAN_ALLOW or FAN_DENY
+ */
+static uint32_t decide(const work_t* w) {
+	uint32_t retval = FAN_ALLOW;
+	struct stat st;
+	int access = 0;
+	intptr_t value = k_wormxattr_label_mutable;
+	
+	if (	(fstat(w->fd, &st) == 0)
+		 && !S_ISDIR(st.st_mode)
+		 && wormxattr_policy_is_worm(value = worm_state(w->fd, &st))) {
+		if (open_intent(w->tid, &access) != 0) {
+			access = g_strict ? k_wormxattr_access_write: 0;
+		}
+		if (wormxattr_policy_guards_open(access, S_ISDIR(st.st_mode)) & wormxattr_policy_active(value)) {
+			retval = FAN_DENY;
+		}
+	}
+	return retval;
+}
+
+
+static void* worker(void* arg) {
+	for (;;) {
+		work_t w;
+		struct fanotify_response response = {0};
+		
+		(void) pthread_mutex_lock(&g_queue_lock);
+		while ((g_queue_count == 0) && !g_queue_closed) {
+			(void) pthread_cond_wait(&g_queue_work, &g_queue_lock);
+		}
+		if (g_queue_count == 0) {
+			(void) pthread_mutex_unlock(&g_queue_lock);
+			break;
+		}
+		w = g_queue[g_queue_head];
+		g_queue_head = (g_queue_head + 1) % k_wormfand_queue;
+		g_queue_count--;
+		(void) pthread_cond_signal(&g_queue_space);
+		(void) pthread_mutex_unlock(&g_queue_lock);
+		
+		response.fd = w.fd;
+		response.response = decide(&w);
+		if (response.response == FAN_DENY) {
+			(void) __sync_fetch_and_add(&g_stats.denied, 1);
+			if (!g_quiet) {
+				char path[64], target[PATH_MAX] = {0};
+				(void) snprintf(path, sizeof(path), "/proc/self/fd/%d", w.fd);
+				if (readlink(path, target, sizeof(target) - 1) < 0) {
+					strcpy(target, "?");
+				}
+				fprintf(stderr, "wormfand: denied write open of WORM file by thread %d; %s\n", (int) w.tid, target);
+			}
+		}
+		if (write(g_fan, &response, sizeof(response)) != sizeof(response)) {
+			fprintf(stderr, "wormfand: unable to respond; %s\n", strerror(errno));
+		}
+		close(w.fd);
+	}
+	return NULL;
+}
+
+
+static void enqueue(int fd, pid_t tid) {
+	(void) pthread_mutex_lock(&g_queue_lock);
+	while (g_queue_count == k_wormfand_queue) {
+		(void) pthread_cond_wait(&g_queue_space, &g_queue_lock);
+	}
+	g_queue[(g_queue_head + g_queue_count) % k_wormfand_queue].fd = fd;
+	g_queue[(g_queue_head + g_queue_count) % k_wormfand_queue].tid = tid;
+	g_queue_count++;
+	(void) pthread_cond_signal(&g_queue_work);
+	(void) pthread_mutex_unlock(&g_queue_lock);
+}
+
+
+static void report(void) {
+	fprintf(stderr, "wormfand: events %" PRIu64 ", denied %" PRIu64 ", cache hits %" PRIu64 
+			", xattr reads %" PRIu64 ", intent reads %" PRIu64 ", intent unknown %" PRIu64 "\n",
+			g_stats.events, g_stats.denied, g_stats.cache_hits, g_stats.xattr_reads,
+			g_stats.intent_reads, g_stats.intent_unknown);
+}
+
+
+static void on_signal(int sig) {
+	if (sig == SIGUSR1) {
+		g_report = 1;
+	} else {
+		g_stop = 1;
+	}
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-t threads] [-N user|trusted] [-F] [-P] [-q] path ...\n", name);
+	fprintf(stderr, "  -t  worker threads (default; one per cpu)\n");
+	fprintf(stderr, "  -N  the attribute namespace (default user)\n");
+	fprintf(stderr, "  -F  watch the whole file system each path is on, not just its mount\n");
+	fprintf(stderr, "  -P  allow opens of WORM files when the open flags can't be found (default; deny)\n");
+	fprintf(stderr, "  -q  don't log denials\n");
+	fprintf(stderr, "SIGUSR1 prints statistics\n");
+	exit(2);
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int markFlags = FAN_MARK_ADD | FAN_MARK_MOUNT;
+	pthread_t tids[k_wormfand_threads_max];
+	struct sigaction sa = {0};
+	sigset_t signals;
+	static char buf[k_wormfand_buffer] __attribute__((aligned(8)));
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "t:N:FSPqh")) != -1) {
+		switch (ch) {
+			case 't':
+				threads = strtol(optarg, NULL, 10);
+				break;
+			case 'N':
+				if (	(strcmp(optarg, "user") != 0)
+					 && (strcmp(optarg, "trusted") != 0)) {
+					usage(argv[0]);
+				}
+				(void) snprintf(g_xattr, sizeof(g_xattr), "%s.%s", optarg, k_wormxattr_xattr);
+				break;
+			case 'F':
+				markFlags = FAN_MARK_ADD | FAN_MARK_FILESYSTEM;
+				break;
+			case 'S':
+				g_strict = true; // the default; still accepted
+				break;
+			case 'P':
+				g_strict = false;
+				break;
+			case 'q':
+				g_quiet = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (threads < 1) {
+		threads = 1;
+	} else if (threads > k_wormfand_threads_max) {
+		threads = k_wormfand_threads_max;
+	}
+	if (optind == argc) {
+		usage(argv[0]);
+	}
+	
+	g_fan = fanotify_init(FAN_CLASS_CONTENT | FAN_CLOEXEC | FAN_UNLIMITED_QUEUE | FAN_REPORT_TID, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+	if (g_fan == -1) {
+		fprintf(stderr, "wormfand: fanotify_init; %s (needs CAP_SYS_ADMIN and Linux 4.20)\n", strerror(errno));
+		return 1;
+	}
+	for (int i = optind; i < argc; i++) {
+		if (fanotify_mark(g_fan, markFlags, FAN_OPEN_PERM, AT_FDCWD, argv[i]) != 0) {
+			fprintf(stderr, "wormfand: %s; %s\n", argv[i], strerror(errno));
+			return 1;
+		}
+	}
+	
+	sa.sa_handler = on_signal; // no SA_RESTART; the read is interrupted
+	(void) sigaction(SIGINT, &sa, NULL);
+	(void) sigaction(SIGTERM, &sa, NULL);
+	(void) sigaction(SIGUSR1, &sa, NULL);
+	
+	// workers block our signals, so they're delivered to (and interrupt) the reader
+	(void) sigemptyset(&signals);
+	(void) sigaddset(&signals, SIGINT);
+	(void) sigaddset(&signals, SIGTERM);
+	(void) sigaddset(&signals, SIGUSR1);
+	(void) pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	for (long t = 0; t < threads; t++) {
+		if (pthread_create(&tids[t], NULL, worker, NULL) != 0) {
+			threads = t;
+			break;
+		}
+	}
+	(void) pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+	printf("wormfand: ready\n");
+	(void) fflush(stdout);
+	
+	while (!g_stop) {
+		ssize_t len = read(g_fan, buf, sizeof(buf));
+		if (g_report) {
+			g_report = 0;
+			report();
+		}
+		if (len < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			fprintf(stderr, "wormfand: read; %s\n", strerror(errno));
+			retval = 1;
+			break;
+		}
+		for (struct fanotify_event_metadata* m = (struct fanotify_event_metadata*) buf; 
+			 FAN_EVENT_OK(m, len); 
+			 m = FAN_EVENT_NEXT(m, len)) {
+			if (m->vers != FANOTIFY_METADATA_VERSION) {
+				fprintf(stderr, "wormfand: unexpected fanotify version %u\n", m->vers);
+				g_stop = 1;
+				break;
+			}
+			if (m->fd < 0) {
+				continue; // queue overflow; there's nothing to answer
+			}
+			(void) __sync_fetch_and_add(&g_stats.events, 1);
+			if (m->mask & FAN_OPEN_PERM) {
+				enqueue(m->fd, m->pid); // the thread id; FAN_REPORT_TID
+			} else {
+				close(m->fd);
+			}
+		}
+	}
+	
+	(void) pthread_mutex_lock(&g_queue_lock);
+	g_queue_closed = true;
+	(void) pthread_cond_broadcast(&g_queue_work);
+	(void) pthread_mutex_unlock(&g_queue_lock);
+	for (long t = 0; t < threads; t++) {
+		(void) pthread_join(tids[t], NULL);
+	}
+	close(g_fan); // any events still held are allowed
+	report();
+	return retval;
+}
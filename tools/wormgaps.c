@@ -0,0 +1,321 @@
+//
+//  wormgaps.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "walk.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Description
+ *
+ * Finds inheritance gaps; entries of WORM directories which don't carry the attribute.
+ * The policy can fail to write it when a file is created in, or renamed into, a WORM
+ * directory and files which predate labelling were never given it.  Each one found is
+ * printed and, with -f, given its directory's attribute (so its retention too).  A 
+ * directory missing the attribute is treated as though it had it, so its entries are
+ * expected to carry it as well; repairing it would make that so.
+ *
+ * The tree is walked by the shared work stealing walker (see walk.h); a directory's
+ * expected attribute is handed down as its walk state so nothing is read twice, and
+ * entries are read relative to their directory without being opened.  A directory 
+ * whose retention has expired no longer passes its attribute on, so isn't checked.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormgaps_threads				8
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the state of a scan
+ *
+ * @field	root		the absolute path of the directory being scanned
+ * @field	fix			true to give gaps the attribute
+ * @field	files		entries visited (not including directories)
+ * @field	gaps		entries found without the attribute
+ * @field	repaired	gaps given the attribute
+ * @field	failed		entries which couldn't be read or repaired
+ */
+typedef struct {
+	const char*			root;
+	bool				fix;
+	volatile uint64_t	files;
+	volatile uint64_t	gaps;
+	volatile uint64_t	repaired;
+	volatile uint64_t	failed;
+} gaps_scan_t;
+
+/**
+ * @brief	a walk run on another thread
+ */
+typedef struct {
+	walk_t*				w;
+	int					err;
+	volatile bool		finished;
+} gaps_walker_t;
+
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+__private_extern__ uint64_t wormxattr_policy_now(void) {
+	return (uint64_t) time(NULL);
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-f] [-t threads] [-x] [-q] dir ...\n", name);
+	fprintf(stderr, "  -f          give each gap its directory's attribute\n");
+	fprintf(stderr, "  -t threads  the number of threads walking (default %u)\n", k_wormgaps_threads);
+	fprintf(stderr, "  -x          list sealed directories from their index rather than reading them\n");
+	fprintf(stderr, "  -q          don't report progress\n");
+	fprintf(stderr, "prints the entries of WORM directories which aren't WORM\n");
+	exit(2);
+}
+
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * @brief	the walk state for a directory's attribute; 0 if its entries needn't be WORM,
+ *			else the expiry they should carry plus 1
+ */
+static uint64_t gaps_state(uint64_t expires) {
+	return wormxattr_policy_is_worm(wormxattr_label_worm(expires)) ? expires + 1: 0;
+}
+
+
+static void gaps_failed(gaps_scan_t* s, const char* path, int err) {
+	fprintf(stderr, "%s%s%s: %s\n", s->root, (path[0] == '\0') ? "": "/", path, strerror(err));
+	(void) __sync_fetch_and_add(&s->failed, 1);
+}
+
+
+/**
+ * @brief	reports a gap, and repairs it if asked to
+ *
+ * @param	set		sets the attribute; returning 0 on success, else -1 and errno is set
+ */
+static void gaps_found(gaps_scan_t* s, const char* path, uint64_t state, int (*set)(int, const char*, uint64_t), int fd, const char* name) {
+	(void) __sync_fetch_and_add(&s->gaps, 1);
+	printf("%s%s%s\n", s->root, (path[0] == '\0') ? "": "/", path);
+	if (s->fix) {
+		if (set(fd, name, state - 1) != 0) {
+			gaps_failed(s, path, errno);
+		} else {
+			(void) __sync_fetch_and_add(&s->repaired, 1);
+		}
+	}
+}
+
+
+static int gaps_fset(int fd, const char* name, uint64_t expires) {
+	return worm_xattr_fset(fd, expires);
+}
+
+
+static void gaps_dir(walk_t* w, unsigned thread, int dirfd, const char* path, uint64_t* state) {
+	gaps_scan_t* s = walk_arg(w);
+	uint64_t expires = 0;
+	
+	if (path[0] == '\0') {
+		// the root inherits from its parent
+		int parent = openat(dirfd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (parent != -1) {
+			if (worm_xattr_fget(parent, &expires) == 0) {
+				*state = gaps_state(expires);
+			}
+			close(parent);
+		}
+	}
+	if (worm_xattr_fget(dirfd, &expires) == 0) {
+		*state = gaps_state(expires);
+	} else if (errno != ENOATTR) {
+		gaps_failed(s, path, errno);
+	} else if (*state != 0) {
+		gaps_found(s, path, *state, gaps_fset, dirfd, NULL);
+	}
+}
+
+
+static void gaps_entry(walk_t* w, unsigned thread, int dirfd, const char* name, const char* path, unsigned char type, uint64_t state) {
+	gaps_scan_t* s = walk_arg(w);
+	uint64_t expires = 0;
+	
+	(void) __sync_fetch_and_add(&s->files, 1);
+	if (state == 0) {
+		return;
+	}
+	if (worm_xattr_getat(dirfd, name, &expires) == 0) {
+		return;
+	} else if (errno != ENOATTR) {
+		gaps_failed(s, path, errno);
+	} else {
+		gaps_found(s, path, state, worm_xattr_setat, dirfd, name);
+	}
+}
+
+
+static void gaps_error(walk_t* w, unsigned thread, const char* path, int err) {
+	gaps_failed(walk_arg(w), path, err);
+}
+
+
+static void* gaps_walker(void* arg) {
+	gaps_walker_t* walker = arg;
+	walker->err = walk_run(walker->w);
+	walker->finished = true;
+	return NULL;
+}
+
+
+/**
+ * @brief	scans a directory and everything below it for gaps
+ *
+ * @return	0 if it was scanned (and any gaps repaired), else 1
+ */
+static int gaps_scan(const char* root, bool fix, unsigned threads, bool indexed, bool quiet) {
+	int retval = 1;
+	gaps_scan_t s = {0};
+	walk_callbacks_t callbacks = {
+		.dir = gaps_dir,
+		.entry = gaps_entry,
+		.error = gaps_error,
+	};
+	gaps_walker_t walker = {0};
+	pthread_t tid;
+	uint64_t start = now_ns();
+	uint64_t last = 0;
+	double secs = 0;
+	
+	s.root = root;
+	s.fix = fix;
+	if ((walker.w = walk_create(root, threads, &callbacks, &s)) == NULL) {
+		fprintf(stderr, "%s: %s\n", root, strerror(errno));
+		goto out;
+	}
+	walk_indexed(walker.w, indexed);
+	// report progress from this thread whilst another runs the walk
+	if ((walker.err = pthread_create(&tid, NULL, gaps_walker, &walker)) == 0) {
+		while (!walker.finished) {
+			struct timespec ts = { .tv_sec = 0, .tv_nsec = 100000000 };
+			uint64_t elapsed = now_ns() - start;
+			(void) nanosleep(&ts, NULL);
+			if (	!quiet
+				 && (elapsed / 1000000000ULL != last)) {
+				last = elapsed / 1000000000ULL;
+				fprintf(stderr, "%s: %" PRIu64 " dirs, %" PRIu64 " files, %" PRIu64 " gaps, %.0f/s\n", 
+						root, walk_dirs(walker.w), s.files, s.gaps, (double) (walk_dirs(walker.w) + s.files) * 1e9 / (double) elapsed);
+			}
+		}
+		(void) pthread_join(tid, NULL);
+	}
+	if (walker.err != 0) {
+		fprintf(stderr, "%s: unable to walk; %s\n", root, strerror(walker.err));
+		goto out;
+	}
+	secs = (double) (now_ns() - start) / 1e9;
+	fprintf(stderr, "%s: %" PRIu64 " dirs, %" PRIu64 " files, %" PRIu64 " gaps, %" PRIu64 " repaired, %" PRIu64 " failed; %.2fs, %.0f entries/s\n",
+			root, walk_dirs(walker.w), s.files, s.gaps, s.repaired, s.failed, secs, (double) (walk_dirs(walker.w) + s.files) / ((secs > 0) ? secs: 1));
+	retval = (s.failed == 0) ? 0: 1;
+out:
+	if (walker.w != NULL) {
+		walk_destroy(walker.w);
+	}
+	return retval;
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	bool fix = false;
+	unsigned threads = k_wormgaps_threads;
+	bool indexed = false;
+	bool quiet = false;
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "ft:xq")) != -1) {
+		switch (ch) {
+			case 'f':
+				fix = true;
+				break;
+			case 't':
+				threads = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'x':
+				indexed = true;
+				break;
+			case 'q':
+				quiet = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	optind == argc
+		 || threads == 0
+		 || threads > k_walk_threads_max) {
+		usage(argv[0]);
+	}
+	
+	for (int i = optind; i < argc; i++) {
+		char path[PATH_MAX] = {0};
+		
+		if (realpath(argv[i], path) == NULL) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			retval = 1;
+		} else if (gaps_scan(path, fix, threads, indexed, quiet) != 0) {
+			retval = 1;
+		}
+	}
+	return retval;
+}
@@ -0,0 +1,475 @@
+//
+//  wormlog.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __APPLE__
+#include <sys/mount.h>
+#include <sys/sysctl.h>
+#endif
+
+#include "worm_log.h"
+
+
+/*
+ * Description
+ *
+ * Keeps and queries the binary audit log.  "record" polls the kext's exported records
+ * (security.mac.wormxattr.audit.records) and appends them to the log; with it running
+ * the kext's system log copy can be turned off (sysctl security.mac.wormxattr.audit.syslog=0).
+ * "query" prints the records matching a filter, as text, CSV or JSON lines, using the
+ * segments' indexes to skip most of the log; "index" rebuilds the indexes.  Recording
+ * is macOS only; a log can be queried anywhere.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormlog_batch					256		// records read per poll
+#define k_wormlog_interval				500		// ms between polls when there's nothing new
+
+
+/*
+ * Definitions
+ */
+
+#define wormlog_hook_name(name)			#name,
+
+static const char* g_hook_names[] = {
+	audit_hooks(wormlog_hook_name)
+};
+
+#define k_wormlog_hook_count			(sizeof(g_hook_names) / sizeof(g_hook_names[0]))
+
+typedef enum {
+	k_wormlog_text,
+	k_wormlog_csv,
+	k_wormlog_json
+} wormlog_format_t;
+
+/**
+ * @brief	the state of a query's output
+ *
+ * @field	format	how to print the records
+ * @field	limit	stop after this many; 0 for all
+ * @field	count	the number printed
+ */
+typedef struct {
+	wormlog_format_t	format;
+	uint64_t			limit;
+	uint64_t			count;
+} wormlog_output_t;
+
+#ifdef __APPLE__
+static volatile sig_atomic_t g_stop = 0;
+#endif
+
+static void usage(const char* name);
+static int print_record(const audit_export_t* r, void* arg);
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s record -d dir [-s MB] [-i ms]\n", name);
+	fprintf(stderr, "       %s query -d dir [-u uid] [-k hook[,hook...]] [-S since] [-U until] [-p path] [-o text|csv|json] [-n limit] [-v]\n", name);
+	fprintf(stderr, "       %s index -d dir\n", name);
+	fprintf(stderr, "  -d dir     the log directory\n");
+	fprintf(stderr, "  -s MB      the size of each segment (default: %d)\n", k_worm_log_segment_size / (1024 * 1024));
+	fprintf(stderr, "  -i ms      how often to poll the kext when there's nothing new (default: %d)\n", k_wormlog_interval);
+	fprintf(stderr, "  -u uid     records of the uid\n");
+	fprintf(stderr, "  -k hooks   records from the hooks, e.g. check_open,check_unlink\n");
+	fprintf(stderr, "  -S since   records at or after; seconds since the epoch, or -seconds ago\n");
+	fprintf(stderr, "  -U until   records at or before; as since\n");
+	fprintf(stderr, "  -p path    records of the file, or of its entries if its a directory\n");
+	fprintf(stderr, "  -o format  text (default), csv or json (one object per line)\n");
+	fprintf(stderr, "  -n limit   stop after limit records\n");
+	fprintf(stderr, "  -v         print the work the query did\n");
+	exit(2);
+}
+
+
+#ifdef __APPLE__
+static void stop_handler(int sig) {
+	(void) sig;
+	g_stop = 1;
+}
+#endif
+
+
+/**
+ * @brief	parses a time; seconds since the epoch, or if negative seconds ago
+ *
+ * @return	the time in ns since the epoch
+ */
+static uint64_t parse_time(const char* arg) {
+	long long secs = strtoll(arg, NULL, 10);
+	
+	if (secs < 0) {
+		secs += (long long) time(NULL);
+	}
+	return (secs > 0) ? (uint64_t) secs * 1000000000ull: 0;
+}
+
+
+/**
+ * @brief	finds the ids the kext records for a file
+ *
+ * @param	path	the file
+ * @param	fsid	on success its file system id; val[0] in the low 32 bits
+ * @param	fileid	on success its file id
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int path_file(const char* path, uint64_t* fsid, uint64_t* fileid) {
+	int retval = -1;
+	struct stat st = {0};
+	
+	if (stat(path, &st) == 0) {
+#ifdef __APPLE__
+		struct statfs sfs = {0};
+		if (statfs(path, &sfs) == 0) {
+			*fsid = (uint64_t) (uint32_t) sfs.f_fsid.val[0] | (uint64_t) (uint32_t) sfs.f_fsid.val[1] << 32;
+			*fileid = (uint64_t) st.st_ino;
+			retval = 0;
+		}
+#else
+		*fsid = (uint64_t) st.st_dev;
+		*fileid = (uint64_t) st.st_ino;
+		retval = 0;
+#endif
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	parses a comma separated list of hook names
+ *
+ * @return	a mask of the hooks (1 << hook), else 0 if one isn't a hook
+ */
+static uint32_t parse_hooks(const char* arg) {
+	uint32_t retval = 0;
+	char* list = strdup(arg);
+	char* save = NULL;
+	
+	for (char* name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+		size_t i = 0;
+		
+		for (i = 0; i < k_wormlog_hook_count; i++) {
+			if (	strcmp(name, g_hook_names[i]) == 0
+				 || (strncmp(g_hook_names[i], "check_", 6) == 0 && strcmp(name, g_hook_names[i] + 6) == 0)) {
+				break;
+			}
+		}
+		if (i == k_wormlog_hook_count) {
+			fprintf(stderr, "%s: not a hook\n", name);
+			retval = 0;
+			break;
+		}
+		retval |= 1u << i;
+	}
+	free(list);
+	return retval;
+}
+
+
+/**
+ * @brief	prints a string as a JSON string
+ */
+static void print_json_string(const char* s) {
+	putchar('"');
+	for (; *s; s++) {
+		unsigned char c = (unsigned char) *s;
+		
+		if (c == '"' || c == '\\') {
+			printf("\\%c", c);
+		} else if (c < 0x20) {
+			printf("\\u%04x", c);
+		} else {
+			putchar(c);
+		}
+	}
+	putchar('"');
+}
+
+
+static int print_record(const audit_export_t* r, void* arg) {
+	wormlog_output_t* output = arg;
+	const char* hook = (r->hook < k_wormlog_hook_count) ? g_hook_names[r->hook]: "unknown";
+	char name[k_audit_export_name_max + 1] = {0};
+	
+	memcpy(name, r->name, k_audit_export_name_max); // its terminated; but be sure
+	switch (output->format) {
+		case k_wormlog_text: {
+			time_t secs = (time_t) (r->time / 1000000000ull);
+			char when[32] = {0};
+			
+			strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&secs));
+			printf("%s.%06u %s uid = %u, gid = %u, error = %d, count = %u, arg = 0x%" PRIx64
+				   " (fsid = %" PRIx64 ", fileid = %" PRIu64 ", parent = %" PRIu64 ", name = \"%s\")\n",
+				   when, (unsigned) (r->time % 1000000000ull / 1000), hook, r->uid, r->gid, r->error,
+				   r->count, r->arg, r->fsid, r->fileid, r->parent, name);
+			break;
+		}
+		case k_wormlog_csv:
+			if (output->count == 0) {
+				printf("seq,time,hook,uid,gid,error,count,arg,fsid,fileid,parent,name\n");
+			}
+			printf("%" PRIu64 ",%" PRIu64 ",%s,%u,%u,%d,%u,%" PRIu64 ",%" PRIx64 ",%" PRIu64 ",%" PRIu64 ",\"",
+				   r->seq, r->time, hook, r->uid, r->gid, r->error, r->count, r->arg, r->fsid, r->fileid, r->parent);
+			for (const char* c = name; *c; c++) {
+				if (*c == '"') {
+					putchar('"');
+				}
+				putchar(*c);
+			}
+			printf("\"\n");
+			break;
+		case k_wormlog_json:
+			printf("{\"seq\": %" PRIu64 ", \"time\": %" PRIu64 ", \"hook\": \"%s\", \"uid\": %u, \"gid\": %u, "
+				   "\"error\": %d, \"count\": %u, \"arg\": %" PRIu64 ", \"fsid\": \"%" PRIx64 "\", \"fileid\": %" PRIu64
+				   ", \"parent\": %" PRIu64 ", \"name\": ",
+				   r->seq, r->time, hook, r->uid, r->gid, r->error, r->count, r->arg, r->fsid, r->fileid, r->parent);
+			print_json_string(name);
+			printf("}\n");
+			break;
+	}
+	output->count++;
+	return output->limit && output->count >= output->limit;
+}
+
+
+/**
+ * @brief	polls the kext for its exported records and appends them to the log; until
+ *			interrupted.  Resumes after the last record in the log
+ *
+ * @return	0 on success, else non zero
+ */
+static int wormlog_record(const char* dir, size_t segmentSize, unsigned interval) {
+	int retval = 1;
+#ifdef __APPLE__
+	worm_log_t log = {0};
+	audit_export_t* batch = NULL;
+	
+	if ((batch = calloc(k_wormlog_batch, sizeof(*batch))) == NULL) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		goto out;
+	}
+	if (worm_log_open(&log, dir, segmentSize) != 0) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		goto out;
+	}
+	signal(SIGINT, stop_handler);
+	signal(SIGTERM, stop_handler);
+	
+	retval = 0;
+	while (g_stop == 0) {
+		audit_export_request_t request = {k_audit_export_version, 0, log.header->session, log.header->next};
+		size_t len = k_wormlog_batch * sizeof(*batch);
+		size_t n = 0;
+		
+		if (sysctlbyname(k_audit_export_sysctl, batch, &len, &request, sizeof(request)) != 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "%s: %s\n", k_audit_export_sysctl, strerror(errno));
+			retval = 1;
+			break;
+		}
+		n = len / sizeof(*batch);
+		if (n > 0) {
+			if (batch[0].session != request.session) {
+				if (request.session != 0) {
+					fprintf(stderr, "the kext was reloaded; records from %" PRIu64 "\n", batch[0].seq);
+				}
+			} else if (batch[0].seq != request.from) {
+				fprintf(stderr, "lost records %" PRIu64 " to %" PRIu64 "; they were overwritten before they were read\n",
+						request.from, batch[0].seq - 1);
+			}
+			if (worm_log_append(&log, batch, n) != 0) {
+				fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+				retval = 1;
+				break;
+			}
+		}
+		if (n < k_wormlog_batch) {
+			usleep(interval * 1000);
+		}
+	}
+	worm_log_sync(&log);
+	worm_log_close(&log);
+	
+out:
+	free(batch);
+#else
+	(void) dir;
+	(void) segmentSize;
+	(void) interval;
+	fprintf(stderr, "record: only the macOS kext exports records\n");
+#endif
+	return retval;
+}
+
+
+/**
+ * @brief	rebuilds the index of every segment
+ *
+ * @return	0 on success, else non zero
+ */
+static int wormlog_index(const char* dir) {
+	int retval = 0;
+	uint64_t* numbers = NULL;
+	size_t count = 0;
+	
+	if (worm_log_segments(dir, &numbers, &count) != 0) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		retval = 1;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (worm_log_index(dir, numbers[i]) != 0) {
+			fprintf(stderr, "%s: segment %" PRIu64 ": %s\n", dir, numbers[i], strerror(errno));
+			retval = 1;
+		}
+	}
+	free(numbers);
+	return retval;
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	const char* command = NULL;
+	const char* dir = NULL;
+	size_t segmentSize = 0;
+	unsigned interval = k_wormlog_interval;
+	worm_log_filter_t filter = {0};
+	wormlog_output_t output = {k_wormlog_text, 0, 0};
+	worm_log_stats_t stats = {0};
+	bool verbose = false;
+	int ch = 0;
+	
+	if (argc < 2) {
+		usage(argv[0]);
+	}
+	command = argv[1];
+	optind = 2;
+	while ((ch = getopt(argc, argv, "d:s:i:u:k:S:U:p:o:n:v")) != -1) {
+		switch (ch) {
+			case 'd':
+				dir = optarg;
+				break;
+			case 's':
+				segmentSize = (size_t) strtoull(optarg, NULL, 10) * 1024 * 1024;
+				break;
+			case 'i':
+				interval = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'u':
+				filter.hasUid = true;
+				filter.uid = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			case 'k':
+				if ((filter.hooks = parse_hooks(optarg)) == 0) {
+					usage(argv[0]);
+				}
+				break;
+			case 'S':
+				filter.since = parse_time(optarg);
+				break;
+			case 'U':
+				filter.until = parse_time(optarg);
+				break;
+			case 'p':
+				if (path_file(optarg, &filter.fsid, &filter.fileid) != 0) {
+					fprintf(stderr, "%s: %s\n", optarg, strerror(errno));
+					exit(1);
+				}
+				filter.hasFile = true;
+				break;
+			case 'o':
+				if (strcmp(optarg, "text") == 0) {
+					output.format = k_wormlog_text;
+				} else if (strcmp(optarg, "csv") == 0) {
+					output.format = k_wormlog_csv;
+				} else if (strcmp(optarg, "json") == 0) {
+					output.format = k_wormlog_json;
+				} else {
+					usage(argv[0]);
+				}
+				break;
+			case 'n':
+				output.limit = strtoull(optarg, NULL, 10);
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	dir == NULL
+		 || optind != argc) {
+		usage(argv[0]);
+	}
+	
+	if (strcmp(command, "record") == 0) {
+		retval = wormlog_record(dir, segmentSize, interval);
+	} else if (strcmp(command, "index") == 0) {
+		retval = wormlog_index(dir);
+	} else if (strcmp(command, "query") == 0) {
+		struct timespec start = {0};
+		struct timespec end = {0};
+		
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (worm_log_query(dir, &filter, print_record, &output, &stats) != 0) {
+			fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+			retval = 1;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		fflush(stdout);
+		if (verbose) {
+			fprintf(stderr, "%" PRIu64 " matches; %" PRIu64 " segments (%" PRIu64 " skipped by their index), %" PRIu64 " records read in %.3fms\n",
+					output.count, stats.segments, stats.skipped, stats.scanned,
+					(double) (end.tv_sec - start.tv_sec) * 1e3 + (double) (end.tv_nsec - start.tv_nsec) / 1e6);
+		}
+	} else {
+		usage(argv[0]);
+	}
+	return retval;
+}
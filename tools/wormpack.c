@@ -0,0 +1,568 @@
+//
+//  wormpack.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "worm_pack.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Description
+ *
+ * Packs the small WORM files of WORM directories into packs (see worm_pack.h), so
+ * backups and scans read a few large files sequentially rather than opening each
+ * one; and lists and reads them.  Only regular files which are WORM (and finalized)
+ * are packed and, as they can't change, a pack is an exact copy of them.  Files
+ * already in one of the directory's packs are skipped, so packing can be repeated as
+ * a directory fills.
+ *
+ * With -d the packed files are removed once their pack is synced, WORM and matches
+ * them.  Nothing can be unlinked from a WORM directory, even by the super user, so 
+ * that's only tried once the directory's own retention has expired; then the policy 
+ * permits it once a file's retention has expired, or for the super user (who can 
+ * remove the file's attribute first, and puts it back if the unlink still fails).
+ * Files which can't be removed are left, and are still readable from their pack.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormpack_member_max			(64 * 1024)			// the largest file packed, by default
+#define k_wormpack_pack_size			(1024 * 1024 * 1024)	// the size packs are filled to
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the totals of packing a directory
+ *
+ * @field	files		files packed
+ * @field	bytes		bytes packed
+ * @field	packs		packs written
+ * @field	removed		files removed once packed
+ */
+typedef struct {
+	uint64_t			files;
+	uint64_t			bytes;
+	uint64_t			packs;
+	uint64_t			removed;
+} wormpack_totals_t;
+
+static int name_compare(const void* a, const void* b);
+static int pack_list(int dirfd, const worm_packs_t* packs, uint64_t max, char*** names, size_t* count);
+static int pack_matches(int dirfd, const worm_pack_t* pack, const worm_pack_entry_t* entry);
+static int pack_remove(const char* dir, int dirfd, uint32_t number, wormpack_totals_t* totals);
+static int pack_dir(const char* dir, uint64_t max, uint64_t size, bool remove);
+static int list_dir(const char* dir);
+static int cat_dir(const char* dir, char* const names[], int count);
+static int write_all(const void* buf, size_t len);
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static int name_compare(const void* a, const void* b) {
+	return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+
+/**
+ * @brief	lists the files of a directory which can be packed, in name order; regular,
+ *			WORM (not append only), no larger than max and not already packed
+ *
+ * @param	dirfd		the directory
+ * @param	packs		its packs
+ * @param	max			the largest file packed
+ * @param	names		on success the names; free'd (each, and the list) by the caller
+ * @param	count		on success the number of names
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int pack_list(int dirfd, const worm_packs_t* packs, uint64_t max, char*** names, size_t* count) {
+	int retval = -1;
+	int fd = dup(dirfd); // closedir closes it
+	DIR* dir = NULL;
+	struct dirent* ent = NULL;
+	char** list = NULL;
+	size_t n = 0, slots = 0;
+	
+	if (	(fd == -1)
+		 || ((dir = fdopendir(fd)) == NULL)) {
+		if (fd != -1) {
+			close(fd);
+		}
+		goto out;
+	}
+	while ((errno = 0, ent = readdir(dir)) != NULL) {
+		struct stat st;
+		uint64_t expires = 0;
+		int file = -1;
+		bool packable = false;
+		
+		if (	(ent->d_name[0] == '.')
+			 && (	(strncmp(ent->d_name, k_worm_pack_prefix, sizeof(k_worm_pack_prefix) - 1) == 0)
+				 || (strcmp(ent->d_name, ".") == 0)
+				 || (strcmp(ent->d_name, "..") == 0))) {
+			continue;
+		}
+		if (	((ent->d_type != DT_REG) && (ent->d_type != DT_UNKNOWN))
+			 || (fstatat(dirfd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+			 || !S_ISREG(st.st_mode)
+			 || ((uint64_t) st.st_size > max)
+			 || (worm_packs_lookup(packs, ent->d_name, NULL) != NULL)) {
+			continue;
+		}
+		if ((file = openat(dirfd, ent->d_name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) != -1) {
+			packable = (	(worm_xattr_fget(file, &expires) == 0)
+						 && (worm_xattr_fappend(file) == 0));
+			close(file);
+		}
+		if (!packable) {
+			continue;
+		}
+		if (n == slots) {
+			char** grown = realloc(list, (slots = slots ? slots * 2: 1024) * sizeof(*list));
+			if (grown == NULL) {
+				goto out;
+			}
+			list = grown;
+		}
+		if ((list[n] = strdup(ent->d_name)) == NULL) {
+			goto out;
+		}
+		n++;
+	}
+	if (errno != 0) {
+		goto out;
+	}
+	qsort(list, n, sizeof(*list), name_compare);
+	*names = list;
+	*count = n;
+	list = NULL;
+	retval = 0;
+out:
+	if (dir != NULL) {
+		int err = errno;
+		closedir(dir);
+		errno = err;
+	}
+	if (list != NULL) {
+		for (size_t i = 0; i < n; i++) {
+			free(list[i]);
+		}
+		free(list);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks a file matches its entry in a pack; read in full
+ *
+ * @return	1 if it does, 0 if not, else -1 and errno is set
+ */
+static int pack_matches(int dirfd, const worm_pack_t* pack, const worm_pack_entry_t* entry) {
+	int retval = -1;
+	const char* data = worm_pack_data(pack, entry);
+	int fd = openat(dirfd, worm_pack_name(pack, entry), O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+	char buf[k_wormpack_member_max];
+	uint64_t offset = 0;
+	
+	if (fd == -1) {
+		goto out;
+	}
+	retval = (data != NULL) ? 1: 0;
+	while (retval == 1) {
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n > 0) {
+			if (	((uint64_t) n > entry->size - offset)
+				 || (memcmp(buf, data + offset, (size_t) n) != 0)) {
+				retval = 0;
+			}
+			offset += (uint64_t) n;
+		} else if (n == 0) {
+			if (offset != entry->size) {
+				retval = 0;
+			}
+			break;
+		} else if (errno != EINTR) {
+			retval = -1;
+		}
+	}
+out:
+	if (fd != -1) {
+		close(fd);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	removes the files a pack holds; once checked against it
+ *
+ * @return	0 if every file was removed, else 1
+ */
+static int pack_remove(const char* dir, int dirfd, uint32_t number, wormpack_totals_t* totals) {
+	int retval = 1;
+	char name[64];
+	char path[PATH_MAX];
+	int fd = -1;
+	worm_pack_t pack = {0};
+	uint64_t expires = 0;
+	bool worm = false;
+	
+	snprintf(name, sizeof(name), "%s%u", k_worm_pack_prefix, number);
+	if (	((fd = openat(dirfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) == -1)
+		 || (worm_pack_open(&pack, fd) != 0)) {
+		fprintf(stderr, "%s/%s: unable to reopen; %s\n", dir, name, strerror(errno));
+		goto out;
+	}
+	retval = 0;
+	for (uint32_t i = 0; i < pack.count; i++) {
+		const char* member = worm_pack_name(&pack, &pack.entries[i]);
+		int match = pack_matches(dirfd, &pack, &pack.entries[i]);
+		
+		if (match != 1) {
+			fprintf(stderr, "%s/%s: %s; not removed\n", dir, member, (match == 0) ? "doesn't match its pack": strerror(errno));
+			retval = 1;
+		} else if (snprintf(path, sizeof(path), "%s/%s", dir, member) >= (int) sizeof(path)) {
+			fprintf(stderr, "%s/%s: %s\n", dir, member, strerror(ENAMETOOLONG));
+			retval = 1;
+		} else if (	!(worm = (worm_xattr_get(path, &expires) == 0))
+				   && (errno != ENOATTR)) {
+			fprintf(stderr, "%s: %s; not removed\n", path, strerror(errno));
+			retval = 1;
+		} else if (	(worm_xattr_remove(path) != 0)
+				   && (errno != ENOATTR)) {
+			fprintf(stderr, "%s: unable to remove; %s\n", path, strerror(errno));
+			retval = 1;
+		} else if (unlinkat(dirfd, member, 0) != 0) {
+			int err = errno;
+			
+			// it mustn't be left in place without its attribute
+			if (	worm
+				 && (worm_xattr_set(path, expires) != 0)) {
+				fprintf(stderr, "%s: unable to restore its attribute; %s\n", path, strerror(errno));
+			}
+			fprintf(stderr, "%s: unable to remove; %s\n", path, strerror(err));
+			retval = 1;
+		} else {
+			totals->removed++;
+		}
+	}
+out:
+	worm_pack_close(&pack);
+	if (fd != -1) {
+		close(fd);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	packs the files of a WORM directory
+ *
+ * @param	dir		the directory
+ * @param	max		the largest file packed
+ * @param	size	the size packs are filled to
+ * @param	remove	remove the files once packed
+ *
+ * @return	0 on success, else 1
+ */
+static int pack_dir(const char* dir, uint64_t max, uint64_t size, bool remove) {
+	int retval = 1;
+	int dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	worm_packs_t packs = {0};
+	worm_pack_writer_t writer = {.fd = -1};
+	wormpack_totals_t totals = {0};
+	char** names = NULL;
+	size_t count = 0;
+	uint64_t expires = 0;
+	
+	if (dirfd == -1) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		goto out;
+	}
+	if (worm_xattr_fget(dirfd, &expires) != 0) {
+		fprintf(stderr, "%s: %s\n", dir, (errno == ENOATTR) ? "not a WORM directory": strerror(errno));
+		goto out;
+	}
+	if (worm_xattr_fsealed(dirfd) == 1) {
+		fprintf(stderr, "%s: sealed; nothing can be created in it\n", dir);
+		goto out;
+	}
+	if (	remove
+		 && (expires > (uint64_t) time(NULL))) {
+		// stripping the files' attributes would leave them mutable, and still there
+		fprintf(stderr, "%s: WORM; nothing can be removed from it until its retention expires\n", dir);
+		remove = false;
+	}
+	if (	(worm_packs_open(&packs, dirfd) != 0)
+		 || (pack_list(dirfd, &packs, max, &names, &count) != 0)) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		goto out;
+	}
+	retval = 0;
+	for (size_t i = 0; (retval == 0) && (i < count); i++) {
+		int fd = openat(dirfd, names[i], O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+		
+		if (	(fd == -1)
+			 || (worm_xattr_fget(fd, &expires) != 0)) {
+			fprintf(stderr, "%s/%s: %s; not packed\n", dir, names[i], strerror(errno));
+		} else if (	(writer.fd == -1)
+				   && (worm_pack_create(&writer, dirfd) != 0)) {
+			fprintf(stderr, "%s: unable to create a pack; %s\n", dir, strerror(errno));
+			retval = 1;
+		} else if (worm_pack_add(&writer, names[i], fd, expires) != 0) {
+			fprintf(stderr, "%s/%s: %s\n", dir, names[i], strerror(errno));
+			if (writer.failed) {
+				worm_pack_abort(&writer, dirfd);
+				retval = 1;
+			}
+		}
+		if (fd != -1) {
+			close(fd);
+		}
+		if (	(writer.fd != -1)
+			 && (	(writer.offset >= size)
+				 || (i + 1 == count))) {
+			uint32_t number = writer.number;
+			uint64_t files = writer.count;
+			uint64_t bytes = writer.offset;
+			
+			if (worm_pack_finish(&writer) != 0) {
+				fprintf(stderr, "%s/%s%u: unable to finish; %s\n", dir, k_worm_pack_prefix, number, strerror(errno));
+				retval = 1;
+			} else {
+				totals.files += files;
+				totals.bytes += bytes;
+				totals.packs++;
+				if (	remove
+					 && (pack_remove(dir, dirfd, number, &totals) != 0)) {
+					retval = 1;
+				}
+			}
+		}
+	}
+	if (writer.fd != -1) {
+		worm_pack_abort(&writer, dirfd);
+	}
+	printf("%s: %" PRIu64 " files (%.1f MB) packed into %" PRIu64 " packs", dir, totals.files, (double) totals.bytes / (1024 * 1024), totals.packs);
+	if (remove) {
+		printf("; %" PRIu64 " removed", totals.removed);
+	}
+	printf("\n");
+out:
+	for (size_t i = 0; i < count; i++) {
+		free(names[i]);
+	}
+	free(names);
+	worm_packs_close(&packs);
+	if (dirfd != -1) {
+		close(dirfd);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	lists the members of a directory's packs
+ *
+ * @return	0 on success, else 1
+ */
+static int list_dir(const char* dir) {
+	int retval = 1;
+	int dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	worm_packs_t packs = {0};
+	
+	if (	(dirfd == -1)
+		 || (worm_packs_open(&packs, dirfd) != 0)) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		goto out;
+	}
+	for (uint32_t p = 0; p < packs.count; p++) {
+		for (uint32_t i = 0; i < packs.packs[p].count; i++) {
+			const worm_pack_entry_t* entry = &packs.packs[p].entries[i];
+			printf("%06o %5u %5u %10" PRIu64 " %s\n", entry->mode & 07777, entry->uid, entry->gid, entry->size, worm_pack_name(&packs.packs[p], entry));
+		}
+	}
+	retval = 0;
+out:
+	worm_packs_close(&packs);
+	if (dirfd != -1) {
+		close(dirfd);
+	}
+	return retval;
+}
+
+
+static int write_all(const void* buf, size_t len) {
+	int retval = 0;
+	while (	(retval == 0)
+		   && (len > 0)) {
+		ssize_t n = write(STDOUT_FILENO, buf, len);
+		if (n > 0) {
+			buf = (const char*) buf + n;
+			len -= (size_t) n;
+		} else if ((n == -1) && (errno == EINTR)) {
+			// again
+		} else {
+			retval = -1;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	writes members of a directory's packs to stdout; each named, or else every
+ *			member in pack order (so the packs are read sequentially)
+ *
+ * @return	0 on success, else 1
+ */
+static int cat_dir(const char* dir, char* const names[], int count) {
+	int retval = 1;
+	int dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	worm_packs_t packs = {0};
+	
+	if (	(dirfd == -1)
+		 || (worm_packs_open(&packs, dirfd) != 0)) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		goto out;
+	}
+	retval = 0;
+	if (count == 0) {
+		for (uint32_t p = 0; (retval == 0) && (p < packs.count); p++) {
+			for (uint32_t i = 0; (retval == 0) && (i < packs.packs[p].count); i++) {
+				const void* data = worm_pack_data(&packs.packs[p], &packs.packs[p].entries[i]);
+				if (	(data == NULL)
+					 || (write_all(data, (size_t) packs.packs[p].entries[i].size) != 0)) {
+					fprintf(stderr, "%s/%s: %s\n", dir, worm_pack_name(&packs.packs[p], &packs.packs[p].entries[i]), (data == NULL) ? "invalid entry": strerror(errno));
+					retval = 1;
+				}
+			}
+		}
+	}
+	for (int i = 0; (retval == 0) && (i < count); i++) {
+		const worm_pack_t* pack = NULL;
+		const worm_pack_entry_t* entry = worm_packs_lookup(&packs, names[i], &pack);
+		const void* data = (entry != NULL) ? worm_pack_data(pack, entry): NULL;
+		
+		if (entry == NULL) {
+			fprintf(stderr, "%s/%s: not packed\n", dir, names[i]);
+			retval = 1;
+		} else if (	(data == NULL)
+				   || (write_all(data, (size_t) entry->size) != 0)) {
+			fprintf(stderr, "%s/%s: %s\n", dir, names[i], (data == NULL) ? "invalid entry": strerror(errno));
+			retval = 1;
+		}
+	}
+out:
+	worm_packs_close(&packs);
+	if (dirfd != -1) {
+		close(dirfd);
+	}
+	return retval;
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s pack [-m KB] [-s MB] [-d] dir ...\n", name);
+	fprintf(stderr, "       %s list dir\n", name);
+	fprintf(stderr, "       %s cat dir [name ...]\n", name);
+	fprintf(stderr, "  -m KB      the largest file packed (default: %d)\n", k_wormpack_member_max / 1024);
+	fprintf(stderr, "  -s MB      the size packs are filled to (default: %d)\n", k_wormpack_pack_size / (1024 * 1024));
+	fprintf(stderr, "  -d         remove files once packed; if the policy permits\n");
+	exit(2);
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	const char* command = NULL;
+	uint64_t max = k_wormpack_member_max;
+	uint64_t size = k_wormpack_pack_size;
+	bool remove = false;
+	int ch = 0;
+	
+	if (argc < 2) {
+		usage(argv[0]);
+	}
+	command = argv[1];
+	optind = 2;
+	while ((ch = getopt(argc, argv, "m:s:d")) != -1) {
+		switch (ch) {
+			case 'm':
+				max = strtoull(optarg, NULL, 10) * 1024;
+				break;
+			case 's':
+				size = strtoull(optarg, NULL, 10) * 1024 * 1024;
+				break;
+			case 'd':
+				remove = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	(optind >= argc)
+		 || (size == 0)) {
+		usage(argv[0]);
+	}
+	
+	if (strcmp(command, "pack") == 0) {
+		for (int i = optind; i < argc; i++) {
+			if (pack_dir(argv[i], max, size, remove) != 0) {
+				retval = 1;
+			}
+		}
+	} else if (	(strcmp(command, "list") == 0)
+			   && (optind + 1 == argc)) {
+		retval = list_dir(argv[optind]);
+	} else if (strcmp(command, "cat") == 0) {
+		retval = cat_dir(argv[optind], &argv[optind + 1], argc - optind - 1);
+	} else {
+		usage(argv[0]);
+	}
+	return retval;
+}
@@ -0,0 +1,754 @@
+//
+//  wormpreload.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/xattr.h>
+
+#include "worm_cache.h"
+
+struct label; // the policy header declares kernel routines which take one
+#include "wormxattr.h"
+
+
+/*
+ * Description
+ *
+ * Enforces the policy within a process, for where the kext (or wormfand) can't be
+ * used; e.g. containerised jobs.  Load it with LD_PRELOAD=libwormpreload.so.  The libc
+ * calls which correspond to the vnode_check_* hooks are wrapped and fail with EPERM 
+ * as the hooks would; files created in or renamed into a WORM directory inherit its
+ * attribute, as they do with vnode_notify_{create,rename}.  Nothing can be created,
+ * linked or renamed into a sealed directory.
+ *
+ * The WORM state of each inode is cached (see worm_cache.h); setting or removing an
+ * attribute through us invalidates it, and changes made elsewhere change the ctime.
+ * Opens which don't write cost nothing more than a flag test.
+ *
+ * This is cooperative; a process which makes syscalls directly (or is statically 
+ * linked) isn't constrained.  WORM_XATTR_NS=trusted reads the trusted namespace.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_preload_real(name)			static __typeof__(name)* real_##name = NULL; \
+										if (real_##name == NULL) { real_##name = (__typeof__(name)*) dlsym(RTLD_NEXT, #name); }
+
+// the open flags which make an open write
+#define k_preload_open_writes			(O_WRONLY | O_RDWR | O_APPEND | O_TRUNC)
+
+
+/*
+ * Definitions
+ */
+
+static char g_xattr[XATTR_NAME_MAX + 1] = "user." k_wormxattr_xattr;
+
+
+/*
+ * Implementation
+ */
+
+__private_extern__ uint64_t wormxattr_policy_now(void) {
+	return (uint64_t) time(NULL);
+}
+
+
+__attribute__((constructor)) static void preload_init(void) {
+	const char* ns = getenv("WORM_XATTR_NS");
+	if ((ns != NULL) && (strcmp(ns, "trusted") == 0)) {
+		(void) snprintf(g_xattr, sizeof(g_xattr), "trusted.%s", k_wormxattr_xattr);
+	}
+}
+
+
+/**
+ * @brief	makes a path relative to a directory fd usable by the path based calls
+ *
+ * @param	dirfd	the directory fd; AT_FDCWD for the current directory
+ * @param	path	the path
+ * @param	buf		a PATH_MAX buffer
+ *
+ * @return	the usable path; path or buf
+ */
+static const char* at_path(int dirfd, const char* path, char* buf) {
+	const char* retval = path;
+	if ((dirfd != AT_FDCWD) && (path[0] != '/')) {
+		(void) snprintf(buf, PATH_MAX, "/proc/self/fd/%d/%s", dirfd, path);
+		retval = buf;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	the directory containing a path
+ *
+ * @param	path	the (usable) path
+ * @param	buf		a PATH_MAX buffer for the result
+ *
+ * @return	buf
+ */
+static const char* parent_path(const char* path, char* buf) {
+	size_t len = strlen(path);
+	while ((len > 1) && (path[len - 1] == '/')) {
+		len--; // "dir/" is dir
+	}
+	while ((len > 0) && (path[len - 1] != '/')) {
+		len--;
+	}
+	if (len == 0) {
+		(void) strcpy(buf, ".");
+	} else {
+		while ((len > 1) && (path[len - 1] == '/')) {
+			len--;
+		}
+		(void) snprintf(buf, PATH_MAX, "%.*s", (int) len, path);
+	}
+	return buf;
+}
+
+
+/**
+ * @brief	reads a files WORM state; from the cache if its unchanged
+ *
+ * @param	path	the (usable) path
+ * @param	follow	non zero to follow a final symbolic link
+ * @param	st		on return the files stat; st_mode is 0 if it doesn't exist
+ *
+ * @return	the state as a label value; mutable if the file doesn't exist
+ */
+static intptr_t worm_state(const char* path, int follow, struct stat* st) {
+	intptr_t retval = k_wormxattr_label_mutable;
+	
+	if ((follow ? stat(path, st): lstat(path, st)) != 0) {
+		st->st_mode = 0; // the real call will fail (or create it)
+	} else if ((retval = worm_cache_get(st)) == k_wormxattr_label_unknown) {
+		char value[k_wormxattr_value_max];
+		ssize_t len = follow ? getxattr(path, g_xattr, value, sizeof(value)): lgetxattr(path, g_xattr, value, sizeof(value));
+		
+		retval = k_wormxattr_label_mutable; // as the kext; errors are mutable
+		if (len >= 0) {
+			retval = wormxattr_policy_label(value, (size_t) len);
+		} else if (errno == ERANGE) {
+			retval = wormxattr_label_worm(k_wormxattr_retain_forever);
+		}
+		worm_cache_set(st, retval);
+	}
+	return retval;
+}
+
+
+static int is_worm(const char* path, int follow) {
+	struct stat st;
+	int err = errno;
+	int retval = wormxattr_policy_is_worm(worm_state(path, follow, &st));
+	errno = err;
+	return retval;
+}
+
+
+/**
+ * @brief	the WORM state of the directory a path is in, if its WORM
+ *
+ * @return	the directories label value if its WORM, else 0
+ */
+static intptr_t worm_parent(const char* path) {
+	char buf[PATH_MAX];
+	struct stat st;
+	int err = errno;
+	intptr_t retval = worm_state(parent_path(path, buf), 1, &st);
+	errno = err;
+	return (wormxattr_policy_active(retval) & k_wormxattr_class_inherited) ? retval: 0;
+}
+
+
+/**
+ * @brief	gives a new file its parent directories WORM state; as vnode_notify_create does
+ *
+ * @param	fd		the file, or -1 to use path
+ * @param	path	the (usable) path
+ * @param	value	the parents label value
+ */
+static void inherit_worm(int fd, const char* path, intptr_t value) {
+	char buf[k_wormxattr_value_max];
+	size_t len = wormxattr_policy_format(buf, sizeof(buf), value);
+	int err = errno;
+	k_preload_real(fsetxattr);
+	k_preload_real(lsetxattr);
+	if (((fd != -1) ? real_fsetxattr(fd, g_xattr, buf, len, 0): real_lsetxattr(path, g_xattr, buf, len, 0)) != 0) {
+		fprintf(stderr, "wormpreload: unable to make %s WORM; %s\n", path, strerror(errno));
+	}
+	errno = err;
+}
+
+
+static int deny(void) {
+	errno = EPERM;
+	return -1;
+}
+
+
+/**
+ * @brief	the policy for new entries in a directory; as vnode_check_create, 
+ *			vnode_check_link and vnode_check_rename_to
+ *
+ * @param	path	the (usable) path of the new entry
+ * @param	rule	the rules mask; k_wormxattr_rule_{create,link,rename_to}
+ *
+ * @return	0 to allow, else -1 with errno set
+ */
+static int check_create(const char* path, unsigned rule) {
+	char buf[PATH_MAX];
+	struct stat st;
+	int err = errno;
+	intptr_t value = worm_state(parent_path(path, buf), 1, &st);
+	errno = err;
+	return (wormxattr_policy_guards(rule, 1, 0) & wormxattr_policy_active(value)) ? deny(): 0;
+}
+
+
+/**
+ * @brief	the policy for opens; as vnode_check_open, and inheritance for creates
+ *
+ * @param	path		the (usable) path
+ * @param	flags		the open flags
+ * @param	inherit		on return the parents label value, if it must be inherited
+ *
+ * @return	0 to allow, else -1 with errno set
+ */
+static int check_open(const char* path, int flags, intptr_t* inherit) {
+	int retval = 0;
+	*inherit = 0;
+	if (flags & k_preload_open_writes) {
+		struct stat st;
+		int access = 0;
+		int err = errno;
+		intptr_t value = worm_state(path, (flags & O_NOFOLLOW) == 0, &st);
+		
+		access |= (flags & (O_WRONLY | O_RDWR)) ? k_wormxattr_access_write: 0;
+		access |= ((flags & O_ACCMODE) == O_RDWR) ? k_wormxattr_access_read: 0;
+		access |= (flags & O_APPEND) ? k_wormxattr_access_append: 0;
+		access |= (flags & O_TRUNC) ? k_wormxattr_access_truncate: 0;
+		errno = err;
+		if (	(st.st_mode != 0)
+			 && ((flags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))) {
+			// it exists so the open fails (EEXIST) without opening it
+		} else if (wormxattr_policy_guards_open(access, S_ISDIR(st.st_mode)) & wormxattr_policy_active(value)) {
+			retval = deny();
+		} else if ((st.st_mode == 0) && (flags & O_CREAT)) {
+			if ((retval = check_create(path, k_wormxattr_rule_create)) == 0) {
+				*inherit = worm_parent(path);
+			}
+		}
+	}
+	return retval;
+}
+
+
+static int open_common(int dirfd, const char* path, int flags, mode_t mode, int (*fn)(int, const char*, int, ...)) {
+	char buf[PATH_MAX];
+	const char* p = at_path(dirfd, path, buf);
+	intptr_t inherit = 0;
+	int retval = check_open(p, flags, &inherit);
+	if (retval == 0) {
+		retval = fn(dirfd, path, flags, mode);
+		if ((retval != -1) && inherit) {
+			inherit_worm(retval, p, inherit);
+		}
+	}
+	return retval;
+}
+
+
+/*
+ * Wrapped calls
+ */
+
+int openat(int dirfd, const char* path, int flags, ...) {
+	k_preload_real(openat);
+	mode_t mode = 0;
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+	return open_common(dirfd, path, flags, mode, real_openat);
+}
+
+
+int openat64(int dirfd, const char* path, int flags, ...) {
+	k_preload_real(openat64);
+	mode_t mode = 0;
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+	return open_common(dirfd, path, flags, mode, real_openat64);
+}
+
+
+int open(const char* path, int flags, ...) {
+	k_preload_real(openat);
+	mode_t mode = 0;
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+	return open_common(AT_FDCWD, path, flags, mode, real_openat);
+}
+
+
+int open64(const char* path, int flags, ...) {
+	k_preload_real(openat64);
+	mode_t mode = 0;
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+	return open_common(AT_FDCWD, path, flags, mode, real_openat64);
+}
+
+
+// the fortified opens (-D_FORTIFY_SOURCE); never O_CREAT
+int __open_2(const char* path, int flags) {
+	return open(path, flags);
+}
+
+
+int __open64_2(const char* path, int flags) {
+	return open64(path, flags);
+}
+
+
+int __openat_2(int dirfd, const char* path, int flags) {
+	return openat(dirfd, path, flags);
+}
+
+
+int __openat64_2(int dirfd, const char* path, int flags) {
+	return openat64(dirfd, path, flags);
+}
+
+
+int creat(const char* path, mode_t mode) {
+	return open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+
+int creat64(const char* path, mode_t mode) {
+	return open64(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+
+/**
+ * @brief	the open flags an fopen mode implies
+ */
+static int fopen_flags(const char* mode) {
+	int retval = (strchr(mode, '+') != NULL) ? O_RDWR: 0;
+	switch (mode[0]) {
+		case 'w': retval |= O_WRONLY | O_CREAT | O_TRUNC; break;
+		case 'a': retval |= O_WRONLY | O_CREAT | O_APPEND; break;
+	}
+	return retval;
+}
+
+
+static FILE* fopen_common(const char* path, const char* mode, FILE* (*fn)(const char*, const char*)) {
+	FILE* retval = NULL;
+	intptr_t inherit = 0;
+	if (check_open(path, fopen_flags(mode), &inherit) == 0) {
+		retval = fn(path, mode);
+		if ((retval != NULL) && inherit) {
+			inherit_worm(fileno(retval), path, inherit);
+		}
+	}
+	return retval;
+}
+
+
+FILE* fopen(const char* path, const char* mode) {
+	k_preload_real(fopen);
+	return fopen_common(path, mode, real_fopen);
+}
+
+
+FILE* fopen64(const char* path, const char* mode) {
+	k_preload_real(fopen64);
+	return fopen_common(path, mode, real_fopen64);
+}
+
+
+int truncate(const char* path, off_t length) {
+	k_preload_real(truncate);
+	struct stat st;
+	int err = errno;
+	intptr_t value = worm_state(path, 1, &st);
+	errno = err;
+	if (wormxattr_policy_guards_truncate(S_ISDIR(st.st_mode)) & wormxattr_policy_active(value)) {
+		return deny();
+	}
+	return real_truncate(path, length);
+}
+
+
+int ftruncate(int fd, off_t length) {
+	k_preload_real(ftruncate);
+	char buf[PATH_MAX];
+	(void) snprintf(buf, sizeof(buf), "/proc/self/fd/%d", fd);
+	if (is_worm(buf, 1)) {
+		return deny();
+	}
+	return real_ftruncate(fd, length);
+}
+
+
+/**
+ * @brief	the policy for unlink; as vnode_check_unlink
+ */
+static int check_unlink(const char* path) {
+	return (worm_parent(path) || is_worm(path, 0)) ? deny(): 0;
+}
+
+
+int unlinkat(int dirfd, const char* path, int flags) {
+	k_preload_real(unlinkat);
+	char buf[PATH_MAX];
+	return (check_unlink(at_path(dirfd, path, buf)) != 0) ? -1: real_unlinkat(dirfd, path, flags);
+}
+
+
+int unlink(const char* path) {
+	k_preload_real(unlink);
+	return (check_unlink(path) != 0) ? -1: real_unlink(path);
+}
+
+
+int rmdir(const char* path) {
+	k_preload_real(rmdir);
+	return (check_unlink(path) != 0) ? -1: real_rmdir(path);
+}
+
+
+int remove(const char* path) {
+	k_preload_real(remove);
+	return (check_unlink(path) != 0) ? -1: real_remove(path);
+}
+
+
+/**
+ * @brief	renames a file; as vnode_check_rename_from and vnode_notify_rename
+ */
+static int rename_common(int olddirfd, const char* oldpath, int newdirfd, const char* newpath, unsigned int flags) {
+	char oldbuf[PATH_MAX], newbuf[PATH_MAX];
+	const char* from = at_path(olddirfd, oldpath, oldbuf);
+	const char* to = at_path(newdirfd, newpath, newbuf);
+	int retval = -1;
+	
+	if (worm_parent(from)) {
+		retval = deny(); // you can't move anything out of a WORM directory
+	} else if (check_create(to, k_wormxattr_rule_rename_to) != 0) {
+		// or into a sealed one
+	} else {
+		intptr_t inherit = worm_parent(to);
+		if (flags) {
+			k_preload_real(renameat2);
+			retval = real_renameat2(olddirfd, oldpath, newdirfd, newpath, flags);
+		} else {
+			k_preload_real(renameat);
+			retval = real_renameat(olddirfd, oldpath, newdirfd, newpath);
+		}
+		if ((retval == 0) && inherit) {
+			inherit_worm(-1, to, inherit);
+		}
+	}
+	return retval;
+}
+
+
+int rename(const char* oldpath, const char* newpath) {
+	return rename_common(AT_FDCWD, oldpath, AT_FDCWD, newpath, 0);
+}
+
+
+int renameat(int olddirfd, const char* oldpath, int newdirfd, const char* newpath) {
+	return rename_common(olddirfd, oldpath, newdirfd, newpath, 0);
+}
+
+
+int renameat2(int olddirfd, const char* oldpath, int newdirfd, const char* newpath, unsigned int flags) {
+	return rename_common(olddirfd, oldpath, newdirfd, newpath, flags);
+}
+
+
+int mkdirat(int dirfd, const char* path, mode_t mode) {
+	k_preload_real(mkdirat);
+	char buf[PATH_MAX];
+	const char* p = at_path(dirfd, path, buf);
+	intptr_t inherit = 0;
+	int retval = check_create(p, k_wormxattr_rule_create);
+	if (retval == 0) {
+		inherit = worm_parent(p);
+		retval = real_mkdirat(dirfd, path, mode);
+	}
+	if ((retval == 0) && inherit) {
+		inherit_worm(-1, p, inherit);
+	}
+	return retval;
+}
+
+
+int mkdir(const char* path, mode_t mode) {
+	return mkdirat(AT_FDCWD, path, mode);
+}
+
+
+// new entries; as vnode_check_link and vnode_check_create
+int linkat(int olddirfd, const char* oldpath, int newdirfd, const char* newpath, int flags) {
+	k_preload_real(linkat);
+	char buf[PATH_MAX];
+	return (check_create(at_path(newdirfd, newpath, buf), k_wormxattr_rule_link) != 0) ? -1: real_linkat(olddirfd, oldpath, newdirfd, newpath, flags);
+}
+
+
+int link(const char* oldpath, const char* newpath) {
+	k_preload_real(link);
+	return (check_create(newpath, k_wormxattr_rule_link) != 0) ? -1: real_link(oldpath, newpath);
+}
+
+
+int symlinkat(const char* target, int newdirfd, const char* linkpath) {
+	k_preload_real(symlinkat);
+	char buf[PATH_MAX];
+	return (check_create(at_path(newdirfd, linkpath, buf), k_wormxattr_rule_create) != 0) ? -1: real_symlinkat(target, newdirfd, linkpath);
+}
+
+
+int symlink(const char* target, const char* linkpath) {
+	k_preload_real(symlink);
+	return (check_create(linkpath, k_wormxattr_rule_create) != 0) ? -1: real_symlink(target, linkpath);
+}
+
+
+// attribute changes; as vnode_check_set{mode,owner,utimes}
+int chmod(const char* path, mode_t mode) {
+	k_preload_real(chmod);
+	return is_worm(path, 1) ? deny(): real_chmod(path, mode);
+}
+
+
+int fchmodat(int dirfd, const char* path, mode_t mode, int flags) {
+	k_preload_real(fchmodat);
+	char buf[PATH_MAX];
+	return is_worm(at_path(dirfd, path, buf), (flags & AT_SYMLINK_NOFOLLOW) == 0) ? deny(): real_fchmodat(dirfd, path, mode, flags);
+}
+
+
+int fchmod(int fd, mode_t mode) {
+	k_preload_real(fchmod);
+	char buf[PATH_MAX];
+	(void) snprintf(buf, sizeof(buf), "/proc/self/fd/%d", fd);
+	return is_worm(buf, 1) ? deny(): real_fchmod(fd, mode);
+}
+
+
+int chown(const char* path, uid_t owner, gid_t group) {
+	k_preload_real(chown);
+	return is_worm(path, 1) ? deny(): real_chown(path, owner, group);
+}
+
+
+int lchown(const char* path, uid_t owner, gid_t group) {
+	k_preload_real(lchown);
+	return is_worm(path, 0) ? deny(): real_lchown(path, owner, group);
+}
+
+
+int fchownat(int dirfd, const char* path, uid_t owner, gid_t group, int flags) {
+	k_preload_real(fchownat);
+	char buf[PATH_MAX];
+	return is_worm(at_path(dirfd, path, buf), (flags & AT_SYMLINK_NOFOLLOW) == 0) ? deny(): real_fchownat(dirfd, path, owner, group, flags);
+}
+
+
+int fchown(int fd, uid_t owner, gid_t group) {
+	k_preload_real(fchown);
+	char buf[PATH_MAX];
+	(void) snprintf(buf, sizeof(buf), "/proc/self/fd/%d", fd);
+	return is_worm(buf, 1) ? deny(): real_fchown(fd, owner, group);
+}
+
+
+int utime(const char* path, const struct utimbuf* times) {
+	k_preload_real(utime);
+	return is_worm(path, 1) ? deny(): real_utime(path, times);
+}
+
+
+int utimes(const char* path, const struct timeval times[2]) {
+	k_preload_real(utimes);
+	return is_worm(path, 1) ? deny(): real_utimes(path, times);
+}
+
+
+int utimensat(int dirfd, const char* path, const struct timespec times[2], int flags) {
+	k_preload_real(utimensat);
+	char buf[PATH_MAX];
+	return is_worm(at_path(dirfd, path, buf), (flags & AT_SYMLINK_NOFOLLOW) == 0) ? deny(): real_utimensat(dirfd, path, times, flags);
+}
+
+
+int futimens(int fd, const struct timespec times[2]) {
+	k_preload_real(futimens);
+	char buf[PATH_MAX];
+	(void) snprintf(buf, sizeof(buf), "/proc/self/fd/%d", fd);
+	return is_worm(buf, 1) ? deny(): real_futimens(fd, times);
+}
+
+
+/**
+ * @brief	forgets a files cached state once its attributes have changed
+ */
+static void xattr_changed(const char* path, int follow) {
+	struct stat st;
+	int err = errno;
+	if ((follow ? stat(path, &st): lstat(path, &st)) == 0) {
+		worm_cache_invalidate(&st);
+	}
+	errno = err;
+}
+
+
+/**
+ * @brief	the policy for setting an attribute; as vnode_check_setextattr, setting the 
+ *			worm attribute of an append only file to a WORM value finalizes it and of a
+ *			WORM directory to sealed seals it
+ *
+ * @return	0 to allow, else -1 with errno set
+ */
+static int check_setxattr(const char* path, int follow, const char* name, const void* value, size_t size) {
+	int retval = 0;
+	struct stat st;
+	int err = errno;
+	intptr_t state = worm_state(path, follow, &st);
+	errno = err;
+	if (	(wormxattr_policy_active(state) == k_wormxattr_class_append)
+		 && (strcmp(name, g_xattr) == 0)
+		 && wormxattr_policy_finalizes(value, size)) {
+		// an append only file is being made WORM; the one change it allows
+	} else if (	(strcmp(name, g_xattr) == 0)
+			 && wormxattr_policy_seals(wormxattr_policy_active(state), S_ISDIR(st.st_mode), value, size)) {
+		// as is a WORM directory being sealed
+	} else if (wormxattr_policy_is_worm(state)) {
+		retval = deny();
+	}
+	return retval;
+}
+
+
+// attributes; as vnode_check_setextattr and vnode_check_deleteextattr
+int setxattr(const char* path, const char* name, const void* value, size_t size, int flags) {
+	k_preload_real(setxattr);
+	int retval = check_setxattr(path, 1, name, value, size) ? -1: real_setxattr(path, name, value, size, flags);
+	if (retval == 0) {
+		xattr_changed(path, 1);
+	}
+	return retval;
+}
+
+
+int lsetxattr(const char* path, const char* name, const void* value, size_t size, int flags) {
+	k_preload_real(lsetxattr);
+	int retval = check_setxattr(path, 0, name, value, size) ? -1: real_lsetxattr(path, name, value, size, flags);
+	if (retval == 0) {
+		xattr_changed(path, 0);
+	}
+	return retval;
+}
+
+
+int fsetxattr(int fd, const char* name, const void* value, size_t size, int flags) {
+	k_preload_real(fsetxattr);
+	char buf[PATH_MAX];
+	(void) snprintf(buf, sizeof(buf), "/proc/self/fd/%d", fd);
+	int retval = check_setxattr(buf, 1, name, value, size) ? -1: real_fsetxattr(fd, name, value, size, flags);
+	if (retval == 0) {
+		xattr_changed(buf, 1);
+	}
+	return retval;
+}
+
+
+int removexattr(const char* path, const char* name) {
+	k_preload_real(removexattr);
+	int retval = ((getuid() != 0) && is_worm(path, 1)) ? deny(): real_removexattr(path, name);
+	if (retval == 0) {
+		xattr_changed(path, 1);
+	}
+	return retval;
+}
+
+
+int lremovexattr(const char* path, const char* name) {
+	k_preload_real(lremovexattr);
+	int retval = ((getuid() != 0) && is_worm(path, 0)) ? deny(): real_lremovexattr(path, name);
+	if (retval == 0) {
+		xattr_changed(path, 0);
+	}
+	return retval;
+}
+
+
+int fremovexattr(int fd, const char* name) {
+	k_preload_real(fremovexattr);
+	char buf[PATH_MAX];
+	(void) snprintf(buf, sizeof(buf), "/proc/self/fd/%d", fd);
+	int retval = ((getuid() != 0) && is_worm(buf, 1)) ? deny(): real_fremovexattr(fd, name);
+	if (retval == 0) {
+		xattr_changed(buf, 1);
+	}
+	return retval;
+}
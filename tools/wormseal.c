@@ -0,0 +1,685 @@
+//
+//  wormseal.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "walk.h"
+#include "worm_digest.h"
+#include "worm_dirindex.h"
+#include "worm_index.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Description
+ *
+ * Seals files WORM; forever or until a retention period expires.  Files with a 
+ * retention period are recorded in the expiry index before they're sealed so that
+ * the sweeper can always find them; a record for a file which failed to seal is 
+ * harmless as the sweeper checks the file before acting.
+ *
+ * With -R directories are sealed with everything below them; walked by a pool of
+ * work stealing threads (see walk.h).  Entries are opened relative to their directory
+ * and sealed through the descriptor; those which already carry the attribute are 
+ * left alone (so they keep their retention) and symbolic links and special files
+ * are skipped.  With a retention period each thread batches its files so that one
+ * index write (and sync) covers many of them; the batch is indexed then sealed.
+ *
+ * With -H each file's contents digest is stored (see worm_digest.h) before its sealed,
+ * so later tampering below the file system (raw writes, offline edits, restores of 
+ * altered backups) can be found with wormverify.
+ *
+ * A checkpoint (-c) records each directory whose subtree has been sealed; running
+ * again with the same checkpoint skips them.  Once anything fails nothing more is
+ * recorded so a resumed run always revisits the failures.
+ *
+ * With -S directories are sealed (see wormxattr_policy.h); nothing more can be created
+ * in, linked or renamed into them, so their listing is final and is indexed (see 
+ * worm_dirindex.h) for readers which look names up or list them.  With -R the tree
+ * is sealed WORM first.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormseal_threads				8
+#define k_wormseal_batch_max			32		// descriptors held open per thread
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the files a thread has indexed but not yet sealed
+ */
+typedef struct {
+	int				fds[k_wormseal_batch_max];
+	char*			paths[k_wormseal_batch_max];
+	size_t			count;
+} seal_batch_t;
+
+/**
+ * @brief	the state of a recursive seal
+ *
+ * @field	root		the absolute path of the directory being sealed
+ * @field	expires		the retention; k_wormxattr_retain_forever if none
+ * @field	index		the expiry index; NULL without a retention period
+ * @field	digest		true to store each file's digest before sealing it
+ * @field	checkpoint	the checkpoint file; -1 if none
+ * @field	done		the absolute paths the checkpoint says are complete; a hash set
+ * @field	slots		the size of done; a power of 2
+ * @field	files		entries visited (not including directories)
+ * @field	sealed		files and directories sealed
+ * @field	already		files and directories which already carried the attribute
+ * @field	skipped		symbolic links and special files
+ * @field	failed		files and directories which couldn't be read or sealed
+ * @field	batches		a batch per thread
+ */
+typedef struct {
+	const char*			root;
+	uint64_t			expires;
+	const char*			index;
+	bool				digest;
+	int					checkpoint;
+	char**				done;
+	size_t				slots;
+	volatile uint64_t	files;
+	volatile uint64_t	sealed;
+	volatile uint64_t	already;
+	volatile uint64_t	skipped;
+	volatile uint64_t	failed;
+	seal_batch_t		batches[k_walk_threads_max];
+} seal_tree_t;
+
+/**
+ * @brief	a walk run on another thread
+ */
+typedef struct {
+	walk_t*				w;
+	int					err;
+	volatile bool		finished;
+} seal_walker_t;
+
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-r seconds | -u epoch] [-i index] [-H] [-R [-t threads] [-c checkpoint] [-q]] path ...\n", name);
+	fprintf(stderr, "       %s -S [-H] [-R [-t threads] [-c checkpoint] [-q]] dir ...\n", name);
+	fprintf(stderr, "  -r seconds     retain for this long from now\n");
+	fprintf(stderr, "  -u epoch       retain until this time (seconds since the epoch)\n");
+	fprintf(stderr, "  -i index       the expiry index directory (required with -r/-u)\n");
+	fprintf(stderr, "  -H             store each file's contents digest, for wormverify\n");
+	fprintf(stderr, "  -R             seal directories and everything below them\n");
+	fprintf(stderr, "  -S             seal directories' entries and index them; forever\n");
+	fprintf(stderr, "  -t threads     the number of threads walking (default %u)\n", k_wormseal_threads);
+	fprintf(stderr, "  -c checkpoint  record finished directories; rerun with it to resume\n");
+	fprintf(stderr, "  -q             don't report progress\n");
+	fprintf(stderr, "without -r or -u files are sealed WORM forever\n");
+	exit(2);
+}
+
+
+/**
+ * @brief	stores a file's digest; directories have none
+ *
+ * @return	0 on success (or if its a directory), else -1 and errno is set
+ */
+static int seal_digest(const char* path) {
+	int retval = -1;
+	int fd = open(path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+	uint8_t digest[k_worm_digest_len];
+	struct stat st;
+	
+	if (fd != -1) {
+		if (fstat(fd, &st) != 0) {
+			// errno is set
+		} else if (!S_ISREG(st.st_mode)) {
+			retval = 0;
+		} else if (worm_digest_fd(fd, digest, NULL) == 0) {
+			retval = worm_digest_set(fd, digest);
+		}
+		close(fd);
+	}
+	return retval;
+}
+
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+static size_t done_hash(seal_tree_t* t, const char* path) {
+	uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+	for (; *path; path++) {
+		h = (h ^ (unsigned char) *path) * 0x100000001b3ULL;
+	}
+	return (size_t) h & (t->slots - 1);
+}
+
+
+/**
+ * @brief	loads the checkpoint; a set of the absolute paths of completed directories
+ *
+ * @return	0 on success (including if it doesn't exist yet), else -1 and errno is set
+ */
+static int done_load(seal_tree_t* t, const char* checkpoint) {
+	int retval = -1;
+	FILE* f = fopen(checkpoint, "r");
+	char** lines = NULL;
+	size_t count = 0;
+	size_t space = 0;
+	char* line = NULL;
+	size_t len = 0;
+	ssize_t n = 0;
+	
+	if (f == NULL) {
+		if (errno != ENOENT) {
+			goto out;
+		}
+	} else {
+		while ((n = getline(&line, &len, f)) > 0) {
+			if (line[n - 1] != '\n') {
+				break; // torn by a crash
+			}
+			line[n - 1] = '\0';
+			if (count == space) {
+				char** grown = realloc(lines, (space = space ? space * 2: 256) * sizeof(*lines));
+				if (grown == NULL) {
+					goto out;
+				}
+				lines = grown;
+			}
+			if ((lines[count] = strdup(line)) == NULL) {
+				goto out;
+			}
+			count++;
+		}
+	}
+	// open addressing, at most half full
+	for (t->slots = 1024; t->slots < count * 2; t->slots *= 2);
+	if ((t->done = calloc(t->slots, sizeof(*t->done))) == NULL) {
+		goto out;
+	}
+	for (size_t i = 0; i < count; i++) {
+		size_t slot = done_hash(t, lines[i]);
+		while (	(t->done[slot] != NULL)
+			   && (strcmp(t->done[slot], lines[i]) != 0)) {
+			slot = (slot + 1) & (t->slots - 1);
+		}
+		if (t->done[slot] == NULL) {
+			t->done[slot] = lines[i];
+			lines[i] = NULL;
+		}
+	}
+	retval = 0;
+out:
+	for (size_t i = 0; i < count; i++) {
+		free(lines[i]);
+	}
+	free(lines);
+	free(line);
+	if (f != NULL) {
+		fclose(f);
+	}
+	return retval;
+}
+
+
+static bool done_contains(seal_tree_t* t, const char* path) {
+	bool retval = false;
+	for (size_t slot = done_hash(t, path); t->done[slot] != NULL; slot = (slot + 1) & (t->slots - 1)) {
+		if (strcmp(t->done[slot], path) == 0) {
+			retval = true;
+			break;
+		}
+	}
+	return retval;
+}
+
+
+static char* tree_path(seal_tree_t* t, const char* path) {
+	char* retval = NULL;
+	if (asprintf(&retval, "%s%s%s", t->root, (path[0] == '\0') ? "": "/", path) == -1) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	return retval;
+}
+
+
+static void tree_failed(seal_tree_t* t, const char* path, int err) {
+	char* full = tree_path(t, path);
+	fprintf(stderr, "%s: %s\n", full, strerror(err));
+	free(full);
+	(void) __sync_fetch_and_add(&t->failed, 1);
+}
+
+
+/**
+ * @brief	indexes then seals the files in a batch
+ */
+static void batch_flush(seal_tree_t* t, seal_batch_t* b) {
+	int err = 0;
+	
+	if (b->count == 0) {
+		return;
+	}
+	if (worm_index_append_paths(t->index, t->expires, (const char* const*) b->paths, b->count) != 0) {
+		err = errno;
+	}
+	for (size_t i = 0; i < b->count; i++) {
+		if (err != 0) {
+			fprintf(stderr, "%s: unable to index; %s\n", b->paths[i], strerror(err));
+			(void) __sync_fetch_and_add(&t->failed, 1);
+		} else if (worm_xattr_fset(b->fds[i], t->expires) != 0) {
+			fprintf(stderr, "%s: %s\n", b->paths[i], strerror(errno));
+			(void) __sync_fetch_and_add(&t->failed, 1);
+		} else {
+			(void) __sync_fetch_and_add(&t->sealed, 1);
+		}
+		close(b->fds[i]);
+		free(b->paths[i]);
+	}
+	b->count = 0;
+}
+
+
+/**
+ * @brief	seals an open file or directory unless it already carries the attribute;
+ *			takes the descriptor (closing it now, or once its batch is flushed)
+ */
+static void seal_fd(seal_tree_t* t, unsigned thread, int fd, const char* path, bool file) {
+	uint64_t expires = 0;
+	uint8_t digest[k_worm_digest_len];
+	
+	if (worm_xattr_fget(fd, &expires) == 0) {
+		(void) __sync_fetch_and_add(&t->already, 1);
+		close(fd);
+	} else if (errno != ENOATTR) {
+		tree_failed(t, path, errno);
+		close(fd);
+	} else if (	t->digest
+			   && file
+			   && (	(worm_digest_fd(fd, digest, NULL) != 0)
+					|| (worm_digest_set(fd, digest) != 0))) {
+		tree_failed(t, path, errno);
+		close(fd);
+	} else if (t->index == NULL) {
+		if (worm_xattr_fset(fd, t->expires) != 0) {
+			tree_failed(t, path, errno);
+		} else {
+			(void) __sync_fetch_and_add(&t->sealed, 1);
+		}
+		close(fd);
+	} else {
+		seal_batch_t* b = &t->batches[thread];
+		b->fds[b->count] = fd;
+		b->paths[b->count] = tree_path(t, path);
+		if (++b->count == k_wormseal_batch_max) {
+			batch_flush(t, b);
+		}
+	}
+}
+
+
+static void tree_dir(walk_t* w, unsigned thread, int dirfd, const char* path, uint64_t* state) {
+	seal_tree_t* t = walk_arg(w);
+	int fd = fcntl(dirfd, F_DUPFD_CLOEXEC, 0); // the walker closes its own
+	
+	if (fd == -1) {
+		tree_failed(t, path, errno);
+	} else {
+		seal_fd(t, thread, fd, path, false);
+	}
+}
+
+
+static void tree_entry(walk_t* w, unsigned thread, int dirfd, const char* name, const char* path, unsigned char type, uint64_t state) {
+	seal_tree_t* t = walk_arg(w);
+	int fd = -1;
+	
+	(void) __sync_fetch_and_add(&t->files, 1);
+	if (type != DT_REG) {
+		(void) __sync_fetch_and_add(&t->skipped, 1);
+	} else if ((fd = openat(dirfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) == -1) {
+		tree_failed(t, path, errno);
+	} else {
+		seal_fd(t, thread, fd, path, true);
+	}
+}
+
+
+static void tree_after(walk_t* w, unsigned thread, const char* path) {
+	seal_tree_t* t = walk_arg(w);
+	// flushed before the directory can complete, so the checkpoint never runs ahead
+	if (t->index != NULL) {
+		batch_flush(t, &t->batches[thread]);
+	}
+}
+
+
+static void tree_done(walk_t* w, unsigned thread, const char* path) {
+	seal_tree_t* t = walk_arg(w);
+	char* full = NULL;
+	char* line = NULL;
+	
+	if (	(t->checkpoint == -1)
+		 || (t->failed != 0)) {
+		return;
+	}
+	full = tree_path(t, path);
+	if (	(strchr(full, '\n') == NULL)
+		 && (asprintf(&line, "%s\n", full) != -1)) {
+		// O_APPEND; each line is written whole
+		(void) write(t->checkpoint, line, strlen(line));
+		free(line);
+	}
+	free(full);
+}
+
+
+static bool tree_skip(walk_t* w, const char* path) {
+	seal_tree_t* t = walk_arg(w);
+	bool retval = false;
+	
+	if (t->done != NULL) {
+		char* full = tree_path(t, path);
+		retval = done_contains(t, full);
+		free(full);
+	}
+	return retval;
+}
+
+
+static void tree_error(walk_t* w, unsigned thread, const char* path, int err) {
+	tree_failed(walk_arg(w), path, err);
+}
+
+
+/**
+ * @brief	seals a directory, so its entries are fixed, and writes its index.  The index
+ *			is created first as nothing can be created in the directory once its sealed
+ *
+ * @return	0 on success, else 1
+ */
+static int seal_dir(const char* path) {
+	int retval = 1;
+	int dirfd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	int fd = -1;
+	worm_dirindex_t index;
+	uint64_t expires = 0;
+	uint32_t count = 0;
+	int sealed = 0;
+	
+	if (dirfd == -1) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+	} else if (worm_dirindex_open(&index, dirfd) == 0) {
+		printf("%s: already sealed; %u entries indexed\n", path, index.count);
+		worm_dirindex_close(&index);
+		retval = 0;
+	} else if ((fd = openat(dirfd, k_worm_dirindex_name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0444)) == -1) {
+		fprintf(stderr, "%s: unable to create its index; %s\n", path, strerror(errno));
+	} else if (	((sealed = worm_xattr_fsealed(dirfd)) == -1)
+			   || (	(sealed == 0)
+					&& (worm_xattr_fseal(dirfd) != 0))) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+	} else if (worm_dirindex_write(dirfd, fd, &count) != 0) {
+		fprintf(stderr, "%s: unable to index; %s\n", path, strerror(errno));
+	} else if (	(worm_xattr_fget(fd, &expires) != 0)
+			   && (worm_xattr_fset(fd, k_wormxattr_retain_forever) != 0)) {
+		// in a WORM directory its inherited the attribute already
+		fprintf(stderr, "%s/%s: %s\n", path, k_worm_dirindex_name, strerror(errno));
+	} else {
+		printf("%s: sealed; %u entries indexed\n", path, count);
+		retval = 0;
+	}
+	if (fd != -1) {
+		close(fd);
+	}
+	if (dirfd != -1) {
+		close(dirfd);
+	}
+	return retval;
+}
+
+
+static void* seal_walker(void* arg) {
+	seal_walker_t* walker = arg;
+	walker->err = walk_run(walker->w);
+	walker->finished = true;
+	return NULL;
+}
+
+
+/**
+ * @brief	seals a directory and everything below it
+ *
+ * @return	0 if everything was sealed, else 1
+ */
+static int seal_tree(const char* root, uint64_t expires, const char* index, bool digest, unsigned threads, const char* checkpoint, bool quiet) {
+	int retval = 1;
+	seal_tree_t t = {0};
+	walk_callbacks_t callbacks = {
+		.dir = tree_dir,
+		.entry = tree_entry,
+		.after = tree_after,
+		.done = tree_done,
+		.skip = tree_skip,
+		.error = tree_error,
+	};
+	walk_t* w = NULL;
+	uint64_t start = now_ns();
+	double secs = 0;
+	int err = 0;
+	
+	t.root = root;
+	t.expires = expires;
+	t.index = (expires != k_wormxattr_retain_forever) ? index: NULL;
+	t.digest = digest;
+	t.checkpoint = -1;
+	if (checkpoint != NULL) {
+		if (	(done_load(&t, checkpoint) != 0)
+			 || ((t.checkpoint = open(checkpoint, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)) == -1)) {
+			fprintf(stderr, "%s: %s\n", checkpoint, strerror(errno));
+			goto out;
+		}
+		if (done_contains(&t, root)) {
+			printf("%s: already sealed\n", root);
+			retval = 0;
+			goto out;
+		}
+	}
+	if ((w = walk_create(root, threads, &callbacks, &t)) == NULL) {
+		fprintf(stderr, "%s: %s\n", root, strerror(errno));
+		goto out;
+	}
+	if (quiet) {
+		err = walk_run(w);
+	} else {
+		// report progress from this thread whilst another runs the walk
+		seal_walker_t walker = { .w = w };
+		pthread_t tid;
+		if ((err = pthread_create(&tid, NULL, seal_walker, &walker)) == 0) {
+			uint64_t last = 0;
+			while (!walker.finished) {
+				struct timespec ts = { .tv_sec = 0, .tv_nsec = 100000000 };
+				uint64_t elapsed = now_ns() - start;
+				(void) nanosleep(&ts, NULL);
+				if (elapsed / 1000000000ULL != last) {
+					last = elapsed / 1000000000ULL;
+					fprintf(stderr, "%s: %" PRIu64 " dirs, %" PRIu64 " files, %" PRIu64 " sealed, %.0f/s\n", 
+							root, walk_dirs(w), t.files, t.sealed, (double) (walk_dirs(w) + t.files) * 1e9 / (double) elapsed);
+				}
+			}
+			(void) pthread_join(tid, NULL);
+			err = walker.err;
+		}
+	}
+	if (err != 0) {
+		fprintf(stderr, "%s: unable to walk; %s\n", root, strerror(err));
+		goto out;
+	}
+	secs = (double) (now_ns() - start) / 1e9;
+	printf("%s: %" PRIu64 " dirs, %" PRIu64 " files, %" PRIu64 " sealed, %" PRIu64 " already sealed, %" PRIu64 " skipped, %" PRIu64 " failed; %.2fs, %.0f entries/s\n",
+		   root, walk_dirs(w), t.files, t.sealed, t.already, t.skipped, t.failed, secs, (double) (walk_dirs(w) + t.files) / ((secs > 0) ? secs: 1));
+	retval = (t.failed == 0) ? 0: 1;
+out:
+	if (w != NULL) {
+		walk_destroy(w);
+	}
+	if (t.checkpoint != -1) {
+		close(t.checkpoint);
+	}
+	if (t.done != NULL) {
+		for (size_t i = 0; i < t.slots; i++) {
+			free(t.done[i]);
+		}
+		free(t.done);
+	}
+	return retval;
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	uint64_t expires = k_wormxattr_retain_forever;
+	const char* index = NULL;
+	bool recursive = false;
+	unsigned threads = k_wormseal_threads;
+	const char* checkpoint = NULL;
+	bool quiet = false;
+	bool digest = false;
+	bool dirs = false;
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "r:u:i:HRSt:c:q")) != -1) {
+		switch (ch) {
+			case 'r':
+				expires = (uint64_t) time(NULL) + strtoull(optarg, NULL, 10);
+				break;
+			case 'u':
+				expires = strtoull(optarg, NULL, 10);
+				break;
+			case 'i':
+				index = optarg;
+				break;
+			case 'H':
+				digest = true;
+				break;
+			case 'R':
+				recursive = true;
+				break;
+			case 'S':
+				dirs = true;
+				break;
+			case 't':
+				threads = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'c':
+				checkpoint = optarg;
+				break;
+			case 'q':
+				quiet = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	optind == argc
+		 || (expires != k_wormxattr_retain_forever && index == NULL)
+		 || (expires != k_wormxattr_retain_forever && dirs)
+		 || threads == 0
+		 || threads > k_walk_threads_max) {
+		usage(argv[0]);
+	}
+	
+	for (int i = optind; i < argc; i++) {
+		char path[PATH_MAX] = {0};
+		struct stat st = {0};
+		
+		if (realpath(argv[i], path) == NULL) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			retval = 1;
+			continue;
+		}
+		if (	recursive
+			 && lstat(path, &st) == 0
+			 && S_ISDIR(st.st_mode)) {
+			if (seal_tree(path, expires, index, digest, threads, checkpoint, quiet) != 0) {
+				retval = 1;
+			} else if (	dirs
+					   && seal_dir(path) != 0) {
+				retval = 1;
+			}
+			continue;
+		}
+		if (dirs) {
+			if (seal_dir(path) != 0) {
+				retval = 1;
+			}
+			continue;
+		}
+		if (	digest
+			 && seal_digest(path) != 0) {
+			fprintf(stderr, "%s: unable to digest; %s\n", path, strerror(errno));
+			retval = 1;
+			continue;
+		}
+		if (	expires != k_wormxattr_retain_forever
+			 && worm_index_append(index, expires, path) != 0) {
+			fprintf(stderr, "%s: unable to index; %s\n", path, strerror(errno));
+			retval = 1;
+			continue;
+		}
+		if (worm_xattr_set(path, expires) != 0) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			retval = 1;
+		}
+	}
+	return retval;
+}
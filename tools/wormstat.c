@@ -0,0 +1,267 @@
+//
+//  wormstat.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+#include "wormxattr_stats.h"
+
+
+/*
+ * Description
+ *
+ * Reports the policy's per hook counters (security.mac.wormxattr.stats); the calls,
+ * denials and attribute reads per second of each hook over an interval, and the
+ * latency percentiles of the timed hooks.  Without an interval it reports the totals
+ * since the counters were last reset.  macOS only; the counters live in the kext.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormstat_snapshot				"security.mac.wormxattr.stats.snapshot"
+#define k_wormstat_reset				"security.mac.wormxattr.stats.reset"
+
+
+/*
+ * Definitions
+ */
+
+#define wormstat_hook_name(name)		#name,
+
+static const char* g_hook_names[] = {
+	wormxattr_stats_hooks(wormstat_hook_name)
+};
+
+#define wormstat_timed_hook(name)		k_wormxattr_stats_##name,
+
+static const wormxattr_stats_hook_t g_timed_hooks[] = {
+	wormxattr_stats_timed_hooks(wormstat_timed_hook)
+};
+
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-i seconds] [-c count] [-a] | -R\n", name);
+	fprintf(stderr, "  -i seconds  report the rates over each interval (default: totals since reset)\n");
+	fprintf(stderr, "  -c count    the number of intervals to report (default: until interrupted)\n");
+	fprintf(stderr, "  -a          include hooks which weren't called\n");
+	fprintf(stderr, "  -R          reset the counters\n");
+	exit(2);
+}
+
+
+/**
+ * @brief	reads the counters; checking they're the layout we were built with
+ *
+ * @param	stats	on success the counters
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int stats_read(wormxattr_stats_t* stats) {
+	int retval = -1;
+	size_t len = sizeof(*stats);
+	
+	if (sysctlbyname(k_wormstat_snapshot, stats, &len, NULL, 0) == 0) {
+		if (	len != sizeof(*stats)
+			 || stats->version != k_wormxattr_stats_version
+			 || stats->hooks != k_wormxattr_stats_hook_count
+			 || stats->timed != k_wormxattr_stats_timed_count
+			 || stats->buckets != k_wormxattr_stats_buckets) {
+			errno = EPROTO; // a kext built from a different version
+		} else {
+			retval = 0;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	finds the bucket holding a percentile of a latency histogram
+ *
+ * @param	histogram	the histogram
+ * @param	total		the sum of its buckets
+ * @param	pct			the percentile
+ *
+ * @return	the upper bound of the bucket in ns
+ */
+static uint64_t stats_percentile(const uint64_t* histogram, uint64_t total, unsigned pct) {
+	uint64_t want = (total * pct + 99) / 100;
+	uint64_t seen = 0;
+	int bucket = 0;
+	
+	for (bucket = 0; bucket < k_wormxattr_stats_buckets - 1; bucket++) {
+		seen += histogram[bucket];
+		if (seen >= want) {
+			break;
+		}
+	}
+	return (uint64_t) 2 << bucket;
+}
+
+
+/**
+ * @brief	prints the difference between two readings as rates
+ *
+ * @param	now		the later reading
+ * @param	then	the earlier reading; zeroed for the totals since reset
+ * @param	all		include hooks which weren't called
+ */
+static void stats_print(const wormxattr_stats_t* now, const wormxattr_stats_t* then, bool all) {
+	double secs = (double) (now->elapsed - then->elapsed) / 1e9;
+	
+	if (secs <= 0) {
+		secs = 1;
+	}
+	printf("%-32s %12s %12s %12s\n", "hook", "calls/s", "denies/s", "lookups/s");
+	for (int i = 0; i < k_wormxattr_stats_hook_count; i++) {
+		uint64_t calls = now->calls[i] - then->calls[i];
+		
+		if (	calls == 0
+			 && all == false) {
+			continue;
+		}
+		printf("%-32s %12.1f %12.1f %12.1f\n",
+			   g_hook_names[i],
+			   (double) calls / secs,
+			   (double) (now->denies[i] - then->denies[i]) / secs,
+			   (double) (now->lookups[i] - then->lookups[i]) / secs);
+	}
+	printf("\n%-32s %12s %12s\n", "labels", "resolves/s", "avoided/s");
+	printf("%-32s %12.1f %12.1f\n", "",
+		   (double) (now->resolves - then->resolves) / secs,
+		   (double) (now->avoided - then->avoided) / secs);
+	
+	printf("\n%-32s %12s %12s %12s %12s\n", "latency (sampled)", "p50 ns", "p90 ns", "p99 ns", "max ns");
+	for (int i = 0; i < k_wormxattr_stats_timed_count; i++) {
+		uint64_t histogram[k_wormxattr_stats_buckets] = {0};
+		uint64_t total = 0;
+		int max = 0;
+		
+		for (int b = 0; b < k_wormxattr_stats_buckets; b++) {
+			histogram[b] = now->latency[i][b] - then->latency[i][b];
+			total += histogram[b];
+			if (histogram[b]) {
+				max = b;
+			}
+		}
+		if (total == 0) {
+			if (all) {
+				printf("%-32s %12s %12s %12s %12s\n", g_hook_names[g_timed_hooks[i]], "-", "-", "-", "-");
+			}
+			continue;
+		}
+		printf("%-32s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n",
+			   g_hook_names[g_timed_hooks[i]],
+			   stats_percentile(histogram, total, 50),
+			   stats_percentile(histogram, total, 90),
+			   stats_percentile(histogram, total, 99),
+			   (uint64_t) 2 << max);
+	}
+	fflush(stdout);
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	unsigned interval = 0;
+	long count = -1;
+	bool all = false;
+	bool reset = false;
+	wormxattr_stats_t now = {0};
+	wormxattr_stats_t then = {0};
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "i:c:aR")) != -1) {
+		switch (ch) {
+			case 'i':
+				interval = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'c':
+				count = strtol(optarg, NULL, 10);
+				break;
+			case 'a':
+				all = true;
+				break;
+			case 'R':
+				reset = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	optind != argc
+		 || (reset && (interval || count != -1))) {
+		usage(argv[0]);
+	}
+	
+	if (reset) {
+		int value = 1;
+		
+		if (sysctlbyname(k_wormstat_reset, NULL, NULL, &value, sizeof(value)) != 0) {
+			fprintf(stderr, "%s: %s\n", k_wormstat_reset, strerror(errno));
+			retval = 1;
+		}
+	} else if (stats_read(&now) != 0) {
+		fprintf(stderr, "%s: %s\n", k_wormstat_snapshot, strerror(errno));
+		retval = 1;
+	} else if (interval == 0) {
+		printf("since reset %.1fs ago\n", (double) now.elapsed / 1e9);
+		stats_print(&now, &then, all);
+	} else {
+		for (long i = 0; (count < 0) || (i < count); i++) {
+			then = now;
+			sleep(interval);
+			if (stats_read(&now) != 0) {
+				fprintf(stderr, "%s: %s\n", k_wormstat_snapshot, strerror(errno));
+				retval = 1;
+				break;
+			}
+			if (now.elapsed < then.elapsed) {
+				then = (wormxattr_stats_t) {0}; // reset during the interval
+			}
+			if (i > 0) {
+				printf("\n");
+			}
+			stats_print(&now, &then, all);
+		}
+	}
+	return retval;
+}
@@ -0,0 +1,318 @@
+//
+//  wormsweep.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "worm_index.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Description
+ *
+ * Sweeps the expiry index; releasing (or deleting) the files whose retention period
+ * has expired.  Only the buckets which are due are read.  Their expired records are 
+ * shared between a pool of threads which take the next record with an atomic 
+ * increment; so slow file systems are worked on in parallel.
+ *
+ * A file is only acted on if its attribute still carries the expiry it was indexed
+ * with; it may since have been resealed with a longer retention (and reindexed).
+ * Records which fail are kept and retried on the next sweep.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormsweep_threads				4
+#define k_wormsweep_threads_max			64
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the outcome of a single record
+ */
+typedef enum {
+	k_sweep_keep = 0,	// failed, or not yet expired; retried next time
+	k_sweep_done,		// released or deleted
+	k_sweep_stale,		// the file has gone or no longer carries this expiry
+} sweep_result_t;
+
+/**
+ * @brief	the work shared by the sweeper threads
+ *
+ * @field	records		the expired records from every due bucket
+ * @field	results		the outcome of each record
+ * @field	count		the number of records
+ * @field	next		the next record to process
+ * @field	now			the time the sweep started
+ * @field	delete		delete expired files rather than release them
+ * @field	dryrun		print what would be done
+ */
+typedef struct {
+	worm_index_record_t*	records;
+	sweep_result_t*			results;
+	size_t					count;
+	volatile size_t			next;
+	uint64_t				now;
+	bool					delete;
+	bool					dryrun;
+} sweep_t;
+
+static sweep_result_t sweep_record(sweep_t* s, const worm_index_record_t* rec);
+static void* sweep_thread(void* arg);
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static sweep_result_t sweep_record(sweep_t* s, const worm_index_record_t* rec) {
+	sweep_result_t retval = k_sweep_keep;
+	uint64_t expires = 0;
+	struct stat st = {0};
+	
+	if (worm_xattr_get(rec->path, &expires) != 0) {
+		if (	errno == ENOENT
+			 || errno == ENOTDIR
+			 || (errno == ENOATTR && !s->delete)) {
+			retval = k_sweep_stale; // the file has gone, or was already released
+		} else if (errno != ENOATTR) {
+			fprintf(stderr, "%s: %s\n", rec->path, strerror(errno));
+		}
+		if (retval != k_sweep_keep || errno != ENOATTR) {
+			goto out;
+		}
+		expires = rec->expires; // released early; still delete it
+	}
+	if (expires != rec->expires) {
+		retval = k_sweep_stale; // resealed; its new record will sweep it
+		goto out;
+	}
+	if (expires > s->now) {
+		goto out;
+	}
+	
+	if (s->dryrun) {
+		printf("%s %s\n", s->delete ? "delete": "release", rec->path);
+		retval = k_sweep_done;
+	} else if (s->delete) {
+		if (	lstat(rec->path, &st) == 0
+			 && (S_ISDIR(st.st_mode) ? rmdir(rec->path): unlink(rec->path)) == 0) {
+			retval = k_sweep_done;
+		} else {
+			fprintf(stderr, "%s: unable to delete; %s\n", rec->path, strerror(errno));
+		}
+	} else if (worm_xattr_remove(rec->path) == 0) {
+		retval = k_sweep_done;
+	} else {
+		fprintf(stderr, "%s: unable to release; %s\n", rec->path, strerror(errno));
+	}
+
+out:
+	return retval;
+}
+
+
+static void* sweep_thread(void* arg) {
+	sweep_t* s = (sweep_t*) arg;
+	size_t i = 0;
+	
+	while ((i = __sync_fetch_and_add(&s->next, 1)) < s->count) {
+		s->results[i] = sweep_record(s, &s->records[i]);
+	}
+	return NULL;
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s -i index [-t threads] [-d] [-n]\n", name);
+	fprintf(stderr, "  -i index    the expiry index directory\n");
+	fprintf(stderr, "  -t threads  the number of files worked on at once (default %u)\n", k_wormsweep_threads);
+	fprintf(stderr, "  -d          delete expired files, rather than releasing them\n");
+	fprintf(stderr, "  -n          print what would be done; change nothing\n");
+	exit(2);
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	const char* index = NULL;
+	unsigned threads = k_wormsweep_threads;
+	sweep_t s = {0};
+	char** names = NULL;
+	size_t nbuckets = 0;
+	worm_index_bucket_t* buckets = NULL;
+	pthread_t tids[k_wormsweep_threads_max];
+	size_t released = 0;
+	size_t stale = 0;
+	int ch = 0;
+	
+	while ((ch = getopt(argc, argv, "i:t:dn")) != -1) {
+		switch (ch) {
+			case 'i':
+				index = optarg;
+				break;
+			case 't':
+				threads = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'd':
+				s.delete = true;
+				break;
+			case 'n':
+				s.dryrun = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	index == NULL
+		 || threads == 0
+		 || threads > k_wormsweep_threads_max) {
+		usage(argv[0]);
+	}
+	
+	s.now = (uint64_t) time(NULL);
+	if (worm_index_due(index, s.now, &names, &nbuckets) != 0) {
+		fprintf(stderr, "%s: %s\n", index, strerror(errno));
+		return 1;
+	}
+	if (	nbuckets == 0
+		 || (buckets = calloc(nbuckets, sizeof(*buckets))) == NULL) {
+		goto out;
+	}
+	
+	// load every due bucket and gather their expired records into one list
+	for (size_t b = 0; b < nbuckets; b++) {
+		buckets[b].fd = -1;
+		if (worm_index_load(names[b], &buckets[b]) != 0) {
+			if (errno != ENOENT) {
+				fprintf(stderr, "%s: %s\n", names[b], strerror(errno));
+				retval = 1;
+			}
+			continue;
+		}
+		for (size_t r = 0; r < buckets[b].count; r++) {
+			if (buckets[b].records[r].expires <= s.now) {
+				s.count++;
+			}
+		}
+	}
+	if (	(s.records = calloc(s.count + 1, sizeof(*s.records))) == NULL
+		 || (s.results = calloc(s.count + 1, sizeof(*s.results))) == NULL) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		retval = 1;
+		goto out;
+	}
+	s.count = 0;
+	for (size_t b = 0; b < nbuckets; b++) {
+		for (size_t r = 0; r < buckets[b].count; r++) {
+			if (buckets[b].records[r].expires <= s.now) {
+				s.records[s.count++] = buckets[b].records[r];
+			}
+		}
+	}
+	
+	if (threads > s.count) {
+		threads = s.count ? (unsigned) s.count: 1;
+	}
+	for (unsigned t = 1; t < threads; t++) {
+		if (pthread_create(&tids[t], NULL, sweep_thread, &s) != 0) {
+			threads = t;
+			break;
+		}
+	}
+	sweep_thread(&s);
+	for (unsigned t = 1; t < threads; t++) {
+		pthread_join(tids[t], NULL);
+	}
+	
+	// rewrite each bucket without the records which are finished with
+	if (!s.dryrun) {
+		size_t i = 0;
+		
+		for (size_t b = 0; b < nbuckets; b++) {
+			size_t keep = 0;
+			
+			if (buckets[b].fd == -1) {
+				continue;
+			}
+			for (size_t r = 0; r < buckets[b].count; r++) {
+				if (buckets[b].records[r].expires <= s.now) {
+					if (s.results[i++] != k_sweep_keep) {
+						continue;
+					}
+				}
+				buckets[b].records[keep++] = buckets[b].records[r];
+			}
+			if (keep != buckets[b].count) {
+				if (worm_index_rewrite(&buckets[b], buckets[b].records, keep) != 0) {
+					fprintf(stderr, "%s: unable to rewrite; %s\n", buckets[b].path, strerror(errno));
+					retval = 1;
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < s.count; i++) {
+		if (s.results[i] == k_sweep_done) {
+			released++;
+		} else if (s.results[i] == k_sweep_stale) {
+			stale++;
+		} else if (s.results[i] == k_sweep_keep) {
+			retval = 1;
+		}
+	}
+	printf("%zu expired, %zu %s, %zu stale, %zu failed\n", s.count, released,
+		   s.delete ? "deleted": "released", stale, s.count - released - stale);
+
+out:
+	if (buckets != NULL) {
+		for (size_t b = 0; b < nbuckets; b++) {
+			worm_index_close(&buckets[b]);
+		}
+		free(buckets);
+	}
+	for (size_t b = 0; b < nbuckets; b++) {
+		free(names[b]);
+	}
+	free(names);
+	free(s.records);
+	free(s.results);
+	return retval;
+}
@@ -0,0 +1,520 @@
+//
+//  wormverify.c
+//  tools
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "walk.h"
+#include "worm_cache.h"
+#include "worm_digest.h"
+#include "worm_xattr.h"
+
+
+/*
+ * Description
+ *
+ * Verifies files against the contents digest stored when they were sealed (wormseal 
+ * -H); finding tampering below the file system.  Trees are walked by the shared work
+ * stealing walker and each file is mapped and digested by the thread which finds it,
+ * so several files are read at once and the disks, not the digest, set the pace.
+ *
+ * Verification is incremental.  The state file (-s) records when each file (by 
+ * device and inode) was last verified, and its change time then; files verified 
+ * within the window (-w) whose change time is the same are skipped.  Files which fail
+ * aren't recorded so they're checked every time.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormverify_threads			8
+#define k_wormverify_window				(7 * 86400)
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	when a file was last verified
+ */
+typedef struct {
+	uint64_t		dev;
+	uint64_t		ino;
+	int64_t			ctime_sec;
+	int64_t			ctime_nsec;
+	uint64_t		verified;	// seconds since the epoch; 0 for an empty slot
+} verify_record_t;
+
+/**
+ * @brief	the records made by a thread; merged into the state once the walk ends
+ */
+typedef struct {
+	verify_record_t*	records;
+	size_t				count;
+	size_t				space;
+} verify_list_t;
+
+/**
+ * @brief	the state of a verification run
+ *
+ * @field	root		the absolute path of the directory being verified
+ * @field	now			when the run started
+ * @field	window		how recently a file must have been verified to be skipped
+ * @field	indexed		list sealed directories from their index; see walk_indexed
+ * @field	state		the records loaded from the state file; a hash set
+ * @field	slots		the size of state; a power of 2
+ * @field	lists		the records made by each thread
+ * @field	files		regular files visited
+ * @field	bytes		bytes digested
+ * @field	verified	files whose digest matched
+ * @field	recent		files skipped as they were verified recently
+ * @field	undigested	files without a digest
+ * @field	mismatched	files whose digest didn't match (or was invalid)
+ * @field	failed		files which couldn't be read
+ */
+typedef struct {
+	const char*			root;
+	uint64_t			now;
+	uint64_t			window;
+	bool				indexed;
+	verify_record_t*	state;
+	size_t				slots;
+	verify_list_t		lists[k_walk_threads_max];
+	volatile uint64_t	files;
+	volatile uint64_t	bytes;
+	volatile uint64_t	verified;
+	volatile uint64_t	recent;
+	volatile uint64_t	undigested;
+	volatile uint64_t	mismatched;
+	volatile uint64_t	failed;
+} verify_run_t;
+
+/**
+ * @brief	a walk run on another thread
+ */
+typedef struct {
+	walk_t*				w;
+	int					err;
+	volatile bool		finished;
+} verify_walker_t;
+
+static void usage(const char* name);
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-t threads] [-s state] [-w seconds] [-x] [-q] path ...\n", name);
+	fprintf(stderr, "  -t threads  the number of threads verifying (default %u)\n", k_wormverify_threads);
+	fprintf(stderr, "  -s state    records when files were verified; skipping recent ones\n");
+	fprintf(stderr, "  -w seconds  how recently counts as recent (default %u)\n", k_wormverify_window);
+	fprintf(stderr, "  -x          list sealed directories from their index rather than reading them\n");
+	fprintf(stderr, "  -q          don't report progress\n");
+	fprintf(stderr, "prints the files whose contents don't match the digest stored when sealed\n");
+	exit(2);
+}
+
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+static size_t state_slot(verify_run_t* v, uint64_t dev, uint64_t ino) {
+	size_t retval = (size_t) ((ino * 0x9e3779b97f4a7c15ULL) ^ dev) & (v->slots - 1);
+	while (	(v->state[retval].verified != 0)
+		   && ((v->state[retval].dev != dev) || (v->state[retval].ino != ino))) {
+		retval = (retval + 1) & (v->slots - 1);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	sizes the state for a number of records, at most half full; rehashing any held
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int state_reserve(verify_run_t* v, size_t count) {
+	int retval = 0;
+	size_t slots = 1024;
+	
+	while (slots < count * 2) {
+		slots *= 2;
+	}
+	if (slots > v->slots) {
+		verify_record_t* old = v->state;
+		size_t oldslots = v->slots;
+		
+		if ((v->state = calloc(slots, sizeof(*v->state))) == NULL) {
+			v->state = old;
+			retval = -1;
+		} else {
+			v->slots = slots;
+			for (size_t i = 0; i < oldslots; i++) {
+				if (old[i].verified != 0) {
+					v->state[state_slot(v, old[i].dev, old[i].ino)] = old[i];
+				}
+			}
+			free(old);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	loads the state file; a line per file of "dev ino ctime_sec ctime_nsec verified"
+ *
+ * @return	0 on success (including if it doesn't exist yet), else -1 and errno is set
+ */
+static int state_load(verify_run_t* v, const char* path) {
+	int retval = -1;
+	FILE* f = fopen(path, "r");
+	verify_record_t r;
+	size_t count = 0;
+	
+	if (state_reserve(v, 0) != 0) {
+		goto out;
+	}
+	if (f == NULL) {
+		retval = (errno == ENOENT) ? 0: -1;
+		goto out;
+	}
+	while (fscanf(f, "%" SCNu64 " %" SCNu64 " %" SCNd64 " %" SCNd64 " %" SCNu64 "\n", 
+				  &r.dev, &r.ino, &r.ctime_sec, &r.ctime_nsec, &r.verified) == 5) {
+		if (	(r.verified != 0)
+			 && (state_reserve(v, ++count) != 0)) {
+			goto out;
+		}
+		v->state[state_slot(v, r.dev, r.ino)] = r;
+	}
+	retval = 0;
+out:
+	if (f != NULL) {
+		fclose(f);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	merges the records made during the run into the state and writes it out
+ *
+ * @return	0 on success, else -1 and errno is set
+ */
+static int state_save(verify_run_t* v, const char* path) {
+	int retval = -1;
+	char tmp[PATH_MAX];
+	FILE* f = NULL;
+	size_t count = 0;
+	
+	for (size_t i = 0; i < v->slots; i++) {
+		count += (v->state[i].verified != 0);
+	}
+	for (unsigned t = 0; t < k_walk_threads_max; t++) {
+		for (size_t i = 0; i < v->lists[t].count; i++) {
+			verify_record_t* r = &v->lists[t].records[i];
+			if (state_reserve(v, ++count) != 0) {
+				goto out;
+			}
+			v->state[state_slot(v, r->dev, r->ino)] = *r;
+		}
+	}
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((f = fopen(tmp, "w")) == NULL) {
+		goto out;
+	}
+	for (size_t i = 0; i < v->slots; i++) {
+		verify_record_t* r = &v->state[i];
+		if (r->verified != 0) {
+			fprintf(f, "%" PRIu64 " %" PRIu64 " %" PRId64 " %" PRId64 " %" PRIu64 "\n", 
+					r->dev, r->ino, r->ctime_sec, r->ctime_nsec, r->verified);
+		}
+	}
+	if (	(fflush(f) == 0)
+		 && (fsync(fileno(f)) == 0)
+		 && (fclose(f) == 0)) {
+		f = NULL;
+		retval = rename(tmp, path);
+	}
+out:
+	if (f != NULL) {
+		fclose(f);
+		(void) unlink(tmp);
+	}
+	return retval;
+}
+
+
+static void verify_failed(verify_run_t* v, const char* path, int err) {
+	fprintf(stderr, "%s%s%s: %s\n", v->root, (path[0] == '\0') ? "": "/", path, strerror(err));
+	(void) __sync_fetch_and_add(&v->failed, 1);
+}
+
+
+/**
+ * @brief	verifies an open file; skipping it if it was verified recently
+ */
+static void verify_fd(verify_run_t* v, unsigned thread, int fd, const char* path) {
+	struct stat st;
+	uint8_t stored[k_worm_digest_len];
+	uint8_t digest[k_worm_digest_len];
+	uint64_t bytes = 0;
+	
+	(void) __sync_fetch_and_add(&v->files, 1);
+	if (fstat(fd, &st) != 0) {
+		verify_failed(v, path, errno);
+		return;
+	}
+	if (v->state != NULL) {
+		verify_record_t* r = &v->state[state_slot(v, (uint64_t) st.st_dev, (uint64_t) st.st_ino)];
+		if (	(r->verified != 0)
+			 && (r->verified + v->window > v->now)
+			 && (r->ctime_sec == (int64_t) st.st_ctim.tv_sec)
+			 && (r->ctime_nsec == (int64_t) st.st_ctim.tv_nsec)) {
+			(void) __sync_fetch_and_add(&v->recent, 1);
+			return;
+		}
+	}
+	if (worm_digest_get(fd, stored) != 0) {
+		if (errno == ENOATTR) {
+			(void) __sync_fetch_and_add(&v->undigested, 1);
+		} else if (errno == EINVAL) {
+			printf("%s%s%s: invalid digest\n", v->root, (path[0] == '\0') ? "": "/", path);
+			(void) __sync_fetch_and_add(&v->mismatched, 1);
+		} else {
+			verify_failed(v, path, errno);
+		}
+		return;
+	}
+	if (worm_digest_fd(fd, digest, &bytes) != 0) {
+		verify_failed(v, path, errno);
+		return;
+	}
+	(void) __sync_fetch_and_add(&v->bytes, bytes);
+	if (memcmp(stored, digest, sizeof(digest)) != 0) {
+		printf("%s%s%s: digest mismatch\n", v->root, (path[0] == '\0') ? "": "/", path);
+		(void) __sync_fetch_and_add(&v->mismatched, 1);
+	} else {
+		verify_list_t* l = &v->lists[thread];
+		(void) __sync_fetch_and_add(&v->verified, 1);
+		if (l->count == l->space) {
+			size_t space = l->space ? l->space * 2: 1024;
+			verify_record_t* records = realloc(l->records, space * sizeof(*records));
+			if (records == NULL) {
+				return; // its verified again next time
+			}
+			l->records = records;
+			l->space = space;
+		}
+		l->records[l->count++] = (verify_record_t) {
+			.dev = (uint64_t) st.st_dev,
+			.ino = (uint64_t) st.st_ino,
+			.ctime_sec = (int64_t) st.st_ctim.tv_sec,
+			.ctime_nsec = (int64_t) st.st_ctim.tv_nsec,
+			.verified = v->now,
+		};
+	}
+}
+
+
+static void verify_entry(walk_t* w, unsigned thread, int dirfd, const char* name, const char* path, unsigned char type, uint64_t state) {
+	verify_run_t* v = walk_arg(w);
+	int fd = -1;
+	
+	if (type != DT_REG) {
+		return;
+	}
+	if ((fd = openat(dirfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)) == -1) {
+		verify_failed(v, path, errno);
+	} else {
+		verify_fd(v, thread, fd, path);
+		close(fd);
+	}
+}
+
+
+static void verify_error(walk_t* w, unsigned thread, const char* path, int err) {
+	verify_failed(walk_arg(w), path, err);
+}
+
+
+static void* verify_walker(void* arg) {
+	verify_walker_t* walker = arg;
+	walker->err = walk_run(walker->w);
+	walker->finished = true;
+	return NULL;
+}
+
+
+/**
+ * @brief	verifies a file, or a directory and everything below it
+ *
+ * @return	0 if everything matched, else 1
+ */
+static int verify_path(verify_run_t* v, const char* root, unsigned threads, bool quiet) {
+	int retval = 1;
+	walk_callbacks_t callbacks = {
+		.entry = verify_entry,
+		.error = verify_error,
+	};
+	verify_walker_t walker = {0};
+	pthread_t tid;
+	uint64_t start = now_ns();
+	uint64_t last = 0;
+	double secs = 0;
+	struct stat st;
+	
+	v->root = root;
+	v->files = v->bytes = v->verified = v->recent = v->undigested = v->mismatched = v->failed = 0;
+	if (	(lstat(root, &st) == 0)
+		 && !S_ISDIR(st.st_mode)) {
+		int fd = open(root, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+		v->root = "";
+		if (fd == -1) {
+			verify_failed(v, root, errno);
+		} else {
+			verify_fd(v, 0, fd, root);
+			close(fd);
+		}
+		v->root = root;
+		goto report;
+	}
+	if ((walker.w = walk_create(root, threads, &callbacks, v)) == NULL) {
+		fprintf(stderr, "%s: %s\n", root, strerror(errno));
+		goto out;
+	}
+	walk_indexed(walker.w, v->indexed);
+	// report progress from this thread whilst another runs the walk
+	if ((walker.err = pthread_create(&tid, NULL, verify_walker, &walker)) == 0) {
+		while (!walker.finished) {
+			struct timespec ts = { .tv_sec = 0, .tv_nsec = 100000000 };
+			uint64_t elapsed = now_ns() - start;
+			(void) nanosleep(&ts, NULL);
+			if (	!quiet
+				 && (elapsed / 1000000000ULL != last)) {
+				last = elapsed / 1000000000ULL;
+				fprintf(stderr, "%s: %" PRIu64 " files, %" PRIu64 " verified, %.1f MB/s\n", 
+						root, v->files, v->verified, (double) v->bytes * 1e3 / (double) elapsed);
+			}
+		}
+		(void) pthread_join(tid, NULL);
+	}
+	if (walker.err != 0) {
+		fprintf(stderr, "%s: unable to walk; %s\n", root, strerror(walker.err));
+		goto out;
+	}
+report:
+	secs = (double) (now_ns() - start) / 1e9;
+	fprintf(stderr, "%s: %" PRIu64 " files, %" PRIu64 " verified, %" PRIu64 " recently verified, %" PRIu64 " without a digest, %" PRIu64 " mismatched, %" PRIu64 " failed; %.2fs, %.1f MB/s (%s)\n",
+			root, v->files, v->verified, v->recent, v->undigested, v->mismatched, v->failed, secs, 
+			(double) v->bytes / 1e6 / ((secs > 0) ? secs: 1), worm_digest_impl());
+	retval = ((v->mismatched == 0) && (v->failed == 0)) ? 0: 1;
+out:
+	if (walker.w != NULL) {
+		walk_destroy(walker.w);
+	}
+	return retval;
+}
+
+
+int main(int argc, char* argv[]) {
+	int retval = 0;
+	unsigned threads = k_wormverify_threads;
+	const char* state = NULL;
+	bool quiet = false;
+	verify_run_t v = {0};
+	int ch = 0;
+	
+	v.window = k_wormverify_window;
+	while ((ch = getopt(argc, argv, "t:s:w:xq")) != -1) {
+		switch (ch) {
+			case 't':
+				threads = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				state = optarg;
+				break;
+			case 'w':
+				v.window = strtoull(optarg, NULL, 10);
+				break;
+			case 'x':
+				v.indexed = true;
+				break;
+			case 'q':
+				quiet = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (	optind == argc
+		 || threads == 0
+		 || threads > k_walk_threads_max) {
+		usage(argv[0]);
+	}
+	
+	v.now = (uint64_t) time(NULL);
+	if (	(state != NULL)
+		 && (state_load(&v, state) != 0)) {
+		fprintf(stderr, "%s: %s\n", state, strerror(errno));
+		return 1;
+	}
+	for (int i = optind; i < argc; i++) {
+		char path[PATH_MAX] = {0};
+		
+		if (realpath(argv[i], path) == NULL) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			retval = 1;
+		} else if (verify_path(&v, path, threads, quiet) != 0) {
+			retval = 1;
+		}
+	}
+	if (	(state != NULL)
+		 && (state_save(&v, state) != 0)) {
+		fprintf(stderr, "%s: %s\n", state, strerror(errno));
+		retval = 1;
+	}
+	return retval;
+}
@@ -26,18 +26,314 @@
 #include <sys/systm.h>
 #include <mach/mach_types.h>
 #include <stdarg.h>
+#include <sys/proc.h>
+#include <sys/random.h>
+#include <sys/sysctl.h>
+#include <sys/mount.h>
+#include <sys/vnode.h>
+#include <kern/clock.h>
+#include <kern/locks.h>
+#include <kern/thread.h>
+#include <libkern/OSAtomic.h>
 
+#include "wormxattr.h"
 #include "audit.h"
+#include "dbg.h"
+
+
+/*
+ * Description
+ *
+ * Denials are recorded as fixed size binary records into a set of rings; the ring
+ * is chosen by the cpu the caller is running on so callers rarely contend.  Each 
+ * ring is a bounded lock-free queue (multi producer, as threads can be preempted 
+ * and migrated, single consumer) so recording a denial is a compare and swap plus 
+ * a few stores.  A kernel thread periodically drains the rings and formats the 
+ * records into the system log; if a ring is full the record is counted as dropped
+ * (security.mac.wormxattr.audit_dropped) rather than blocking the caller.
+ *
+ * Before a record reaches a ring it is coalesced; repeated denials with the same
+ * hook, uid, gid and vnode within a window are counted rather than recorded.  Once 
+ * a hook's budget of records for the window is used, further repeats are summarized 
+ * by a single record (with a repeat count) when the window ends.  The window and 
+ * budget are tunable per hook; security.mac.wormxattr.audit.<hook>.{window_ms,budget}
+ * with a budget of 0 disabling coalescing for that hook.
+ *
+ * Records name the vnode by file system id, file id, parent file id and name; never
+ * a path, as building one walks the name cache up to the root on the syscall path.
+ * The file ids are only fetched for records which are going to be logged (not for 
+ * those coalesced away), and never on the open path (write opens and creates); that
+ * is a vnode_getattr, which can block in the file system, on every denied open.  Those
+ * records have the file system id and the name from the lookup or the name cache, and
+ * file ids of 0.  Paths are resolved from them in userspace when the log is read 
+ * (tools/wormaudit).
+ *
+ * The drainer also copies each record into an export ring for a userspace consumer 
+ * (tools/wormlog); security.mac.wormxattr.audit.records (see audit_export.h).  With 
+ * a consumer running the system log copy can be turned off; audit.syslog=0.
+ */
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a slot in an audit ring
+ *
+ * @field	seq			the slots sequence number; position + 1 once published, 
+ *						position + k_audit_ring_size once drained
+ * @field	record		the record
+ */
+typedef struct __audit_slot_t {
+	volatile UInt64		seq;
+	audit_record_t		record;
+} audit_slot_t;
+
+/**
+ * @brief	a ring of audit records; head and tail are kept on separate cache lines
+ *
+ * @field	head		the next position producers will reserve
+ * @field	dropped		the number of records dropped as the ring was full
+ * @field	tail		the next position the drainer will read
+ * @field	slots		the records
+ */
+typedef struct __audit_ring_t {
+	volatile UInt64		head __attribute__((aligned(64)));
+	volatile SInt64		dropped;
+	volatile UInt64		tail __attribute__((aligned(64)));
+	audit_slot_t		slots[k_audit_ring_size] __attribute__((aligned(64)));
+} audit_ring_t;
+
+/**
+ * @brief	tracks repeats of a denial within a coalescing window
+ *
+ * @field	lock		0 if unlocked; entries are only ever try-locked
+ * @field	start		mach_absolute_time the window started; 0 if the entry is unused
+ * @field	emitted		records emitted in this window
+ * @field	suppressed	records coalesced in this window
+ * @field	record		the most recent record; its key is hook, uid, gid and vnode
+ */
+typedef struct __audit_coalesce_t {
+	volatile UInt32		lock;
+	uint64_t			start;
+	uint32_t			emitted;
+	uint32_t			suppressed;
+	audit_record_t		record;
+} audit_coalesce_t;
+
+/**
+ * @brief	the per hook coalescing tunables
+ *
+ * @field	window		the coalescing window, in ms
+ * @field	budget		records emitted per window before repeats are coalesced; 0 disables
+ */
+typedef struct __audit_limit_t {
+	int		window;
+	int		budget;
+} audit_limit_t;
+
+/**
+ * @brief	the audit state
+ *
+ * @field	rings		the per cpu rings
+ * @field	coalesce	the coalescing table; indexed by a hash of the records key
+ * @field	limits		the coalescing tunables; indexed by audit_hook_t
+ * @field	salt		random value mixed into vnode identifiers; so we don't leak kernel addresses
+ * @field	reported	the number of dropped records we've already logged
+ * @field	syslog		non zero if records are formatted into the system log
+ * @field	session		random value identifying this load of the kext to the consumer
+ * @field	exported	the seq of the next exported record
+ * @field	exportLock	protects the export ring
+ * @field	exports		the most recently exported records; seq n is at n & (k_audit_export_size - 1)
+ * @field	lockGroup	the lock group for lock
+ * @field	lock		protects running, and is used to sleep the drainer
+ * @field	running		non zero whilst the drainer should run
+ * @field	thread		the drainer; THREAD_NULL once it has exited
+ */
+typedef struct __audit_t {
+	audit_ring_t		rings[k_audit_rings];
+	audit_coalesce_t	coalesce[k_audit_coalesce_entries];
+	audit_limit_t		limits[k_audit_hook_count];
+	uint64_t			salt;
+	uint64_t			reported;
+	int					syslog;
+	uint64_t			session;
+	uint64_t			exported;
+	lck_mtx_t*			exportLock;
+	audit_export_t		exports[k_audit_export_size];
+	lck_grp_t*			lockGroup;
+	lck_mtx_t*			lock;
+	int					running;
+	thread_t			thread;
+} audit_t;
+
+
+// static (global) instance
+static audit_t g_audit;
+
+// exported by the kernel, but not declared in the kernel framework headers
+extern int cpu_number(void);
+
+static inline int audit_hook_opens(audit_hook_t hook);
+static void audit_identify(audit_record_t* record, struct vnode* vp, struct componentname* cnp);
+static int audit_coalesce(audit_record_t* record, struct vnode* vp, struct componentname* cnp);
+static void audit_coalesce_expire(uint64_t now);
+static void audit_push(const audit_record_t* record);
+static void audit_drain(void);
+static void audit_drain_thread(void* param, wait_result_t wr);
+static void audit_format(const audit_record_t* record);
+static void audit_export(const audit_record_t* record, uint64_t wall, uint64_t now);
+static int audit_sysctl_dropped SYSCTL_HANDLER_ARGS;
+static int audit_sysctl_records SYSCTL_HANDLER_ARGS;
+
+/**
+ * @brief	the message logged for each hook; indexed by audit_hook_t
+ */
+static const char* g_audit_messages[k_audit_hook_count] = {
+	[k_audit_hook_check_deleteextattr]	= "prevents deletion of attributes by non su",
+	[k_audit_hook_check_exchangedata]	= "on vnode prevents exchanging data",
+	[k_audit_hook_check_open]			= "on vnode prevents opening with write access",
+	[k_audit_hook_check_rename_from]	= "on vnode prevents renaming",
+	[k_audit_hook_check_setattrlist]	= "on vnode prevents setting attributes",
+	[k_audit_hook_check_setextattr]		= "on vnode prevents setting extended attributes",
+	[k_audit_hook_check_setflags]		= "on vnode prevents setting flags",
+	[k_audit_hook_check_setmode]		= "on vnode prevents setmode",
+	[k_audit_hook_check_setowner]		= "on vnode prevents changing ownership",
+	[k_audit_hook_check_setutimes]		= "on vnode prevents setting utimes",
+	[k_audit_hook_check_truncate]		= "on vnode prevents truncate",
+	[k_audit_hook_check_unlink]			= "on vnode prevents unlink",
+	[k_audit_hook_notify_create]		= "could not be inherited",
+	[k_audit_hook_notify_rename]		= "could not be inherited",
+	[k_audit_hook_check_create]			= "on directory prevents creating entries",
+	[k_audit_hook_check_link]			= "on directory prevents linking",
+	[k_audit_hook_check_rename_to]		= "on directory prevents renaming into it",
+};
+
+SYSCTL_DECL(_security_mac_wormxattr);
+SYSCTL_PROC(_security_mac_wormxattr, OID_AUTO, audit_dropped, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_LOCKED, 
+			0, 0, audit_sysctl_dropped, "Q", "Audit records dropped as the rings were full");
+SYSCTL_NODE(_security_mac_wormxattr, OID_AUTO, audit, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "Audit coalescing limits");
+SYSCTL_INT(_security_mac_wormxattr_audit, OID_AUTO, syslog, CTLFLAG_RW | CTLFLAG_LOCKED, 
+		   &g_audit.syslog, 0, "Format records into the system log");
+SYSCTL_PROC(_security_mac_wormxattr_audit, OID_AUTO, records, CTLTYPE_OPAQUE | CTLFLAG_RW | CTLFLAG_LOCKED, 
+			0, 0, audit_sysctl_records, "S,audit_export", "Write an audit_export_request_t, read the records");
+
+// security.mac.wormxattr.audit.<hook>.{window_ms,budget}
+#define audit_limit_sysctl(name) \
+	SYSCTL_NODE(_security_mac_wormxattr_audit, OID_AUTO, name, CTLFLAG_RW | CTLFLAG_LOCKED, 0, #name " coalescing limits"); \
+	SYSCTL_INT(_security_mac_wormxattr_audit_##name, OID_AUTO, window_ms, CTLFLAG_RW | CTLFLAG_LOCKED, \
+			   &g_audit.limits[k_audit_hook_##name].window, 0, "Coalescing window (ms)"); \
+	SYSCTL_INT(_security_mac_wormxattr_audit_##name, OID_AUTO, budget, CTLFLAG_RW | CTLFLAG_LOCKED, \
+			   &g_audit.limits[k_audit_hook_##name].budget, 0, "Records per window before coalescing; 0 disables")
+
+#define audit_limit_sysctls(name)	audit_limit_sysctl(name);
+audit_hooks(audit_limit_sysctls)
+
+#define audit_limit_oids(name) \
+	&sysctl__security_mac_wormxattr_audit_##name, \
+	&sysctl__security_mac_wormxattr_audit_##name##_window_ms, \
+	&sysctl__security_mac_wormxattr_audit_##name##_budget,
+
+/**
+ * @brief	our sysctl's; registered in order, unregistered in reverse
+ */
+static struct sysctl_oid* g_audit_sysctls[] = {
+	&sysctl__security_mac_wormxattr_audit_dropped,
+	&sysctl__security_mac_wormxattr_audit,
+	&sysctl__security_mac_wormxattr_audit_syslog,
+	&sysctl__security_mac_wormxattr_audit_records,
+	audit_hooks(audit_limit_oids)
+};
 
 
 /*
  * Implementation
  */
 
+/**
+ * @brief	initializes the audit rings and starts the drainer
+ *
+ * @return	KERN_SUCCESS on success, else a valid kern_return_t error
+ */
+__private_extern__ kern_return_t audit_start(void) {
+	kern_return_t retval = KERN_FAILURE;
+
+	(void) memset(&g_audit, 0x00, sizeof(g_audit));
+	for (int i = 0; i < k_audit_rings; i++) {
+		for (int j = 0; j < k_audit_ring_size; j++) {
+			g_audit.rings[i].slots[j].seq = j;
+		}
+	}
+	read_random(&g_audit.salt, sizeof(g_audit.salt));
+	read_random(&g_audit.session, sizeof(g_audit.session));
+	g_audit.session |= 1; // never 0; thats the consumers "none"
+	g_audit.syslog = 1;
+	for (int i = 0; i < k_audit_hook_count; i++) {
+		g_audit.limits[i].window = k_audit_default_window_ms;
+		g_audit.limits[i].budget = k_audit_default_budget;
+	}
+
+	g_audit.lockGroup = lck_grp_alloc_init("wormxattr_audit", LCK_GRP_ATTR_NULL);
+	if (g_audit.lockGroup) {
+		g_audit.lock = lck_mtx_alloc_init(g_audit.lockGroup, LCK_ATTR_NULL);
+		g_audit.exportLock = lck_mtx_alloc_init(g_audit.lockGroup, LCK_ATTR_NULL);
+		if (	g_audit.lock
+			 && g_audit.exportLock) {
+			g_audit.running = 1;
+			retval = kernel_thread_start(audit_drain_thread, NULL, &g_audit.thread);
+			if (retval == KERN_SUCCESS) {
+				thread_deallocate(g_audit.thread); // we don't need the reference
+				for (int i = 0; i < (int) (sizeof(g_audit_sysctls)/sizeof(g_audit_sysctls[0])); i++) {
+					sysctl_register_oid(g_audit_sysctls[i]);
+				}
+			} else {
+				dbg_error("Unable to start audit drainer: %d\n", retval);
+				g_audit.thread = THREAD_NULL;
+				lck_mtx_free(g_audit.exportLock, g_audit.lockGroup);
+				lck_mtx_free(g_audit.lock, g_audit.lockGroup);
+				lck_grp_free(g_audit.lockGroup);
+			}
+		} else {
+			if (g_audit.exportLock) {
+				lck_mtx_free(g_audit.exportLock, g_audit.lockGroup);
+			}
+			if (g_audit.lock) {
+				lck_mtx_free(g_audit.lock, g_audit.lockGroup);
+			}
+			lck_grp_free(g_audit.lockGroup);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	stops the drainer; any records still in the rings are logged first
+ */
+__private_extern__ void audit_stop(void) {
+	for (int i = (int) (sizeof(g_audit_sysctls)/sizeof(g_audit_sysctls[0])) - 1; i >= 0; i--) {
+		sysctl_unregister_oid(g_audit_sysctls[i]);
+	}
+
+	lck_mtx_lock(g_audit.lock);
+	g_audit.running = 0;
+	wakeup(&g_audit.running);
+	while (g_audit.thread != THREAD_NULL) {
+		(void) msleep(&g_audit.thread, g_audit.lock, PZERO, "wormxattr_audit_stop", NULL);
+	}
+	lck_mtx_unlock(g_audit.lock);
+
+	lck_mtx_free(g_audit.exportLock, g_audit.lockGroup);
+	lck_mtx_free(g_audit.lock, g_audit.lockGroup);
+	lck_grp_free(g_audit.lockGroup);
+}
+
+
 /**
  * @brief	log an audit message to the system audit log
+ *			Note: this is synchronous; use audit_deny for anything on a syscall path
  *
- * @param	cred		the user credentials used to attempt the operation
  * @param	str			the printf style format string for the output message
  */
 __private_extern__ void audit_log(const char* str, ...) {
@@ -47,3 +343,387 @@ __private_extern__ void audit_log(const char* str, ...) {
 	(void) vprintf(str, args);
 	va_end(args);
 }
+
+
+/**
+ * @brief	records a denial; repeats are coalesced, the rest go into the calling cpu's ring.  Never blocks
+ *
+ * @param	hook		the hook generating the record
+ * @param	uid			the callers uid
+ * @param	gid			the callers gid
+ * @param	vp			the vnode the request was made against; may be NULL
+ * @param	cnp			the lookup which found vp; may be NULL
+ * @param	error		the errno returned to the caller
+ * @param	arg			hook specific argument
+ */
+__private_extern__ void audit_record(audit_hook_t hook, uid_t uid, gid_t gid, struct vnode* vp, struct componentname* cnp, int error, uint64_t arg) {
+	audit_record_t record;
+	record.timestamp = mach_absolute_time();
+	record.vnode = ((uint64_t) (uintptr_t) vp) ^ g_audit.salt;
+	record.arg = arg;
+	record.hook = hook;
+	record.uid = uid;
+	record.gid = gid;
+	record.error = error;
+	record.count = 1;
+	if (audit_coalesce(&record, vp, cnp) == 0) {
+		audit_push(&record);
+	}
+}
+
+
+/**
+ * @brief	checks if a hook is on the open path; its records aren't given file ids
+ *
+ * @param	hook		the hook
+ *
+ * @return	non zero if it is
+ */
+static inline int audit_hook_opens(audit_hook_t hook) {
+	return	(hook == k_audit_hook_check_open)
+		 || (hook == k_audit_hook_check_create)
+		 || (hook == k_audit_hook_notify_create);
+}
+
+
+/**
+ * @brief	fills in a records vnode identity; file system id, file id, parent file id and name.
+ *			The file ids are left 0 for hooks on the open path
+ *
+ * @param	record		the record to fill in; its hook must be set
+ * @param	vp			the vnode; may be NULL
+ * @param	cnp			the lookup which found vp; may be NULL, in which case the name
+ *						is taken from the name cache
+ */
+static void audit_identify(audit_record_t* record, struct vnode* vp, struct componentname* cnp) {
+	record->fsid = 0;
+	record->fileid = 0;
+	record->parent = 0;
+	record->name[0] = '\0';
+	if (vp) {
+		struct vfsstatfs* sfs = vfs_statfs(vnode_mount(vp));
+		
+		record->fsid = (uint32_t) sfs->f_fsid.val[0] | ((uint64_t) (uint32_t) sfs->f_fsid.val[1] << 32);
+		if (audit_hook_opens(record->hook) == 0) {
+			struct vnode_attr va;
+			VATTR_INIT(&va);
+			VATTR_WANTED(&va, va_fileid);
+			VATTR_WANTED(&va, va_parentid);
+			if (vnode_getattr(vp, &va, vfs_context_current()) == 0) {
+				record->fileid = VATTR_IS_SUPPORTED(&va, va_fileid) ? va.va_fileid: 0;
+				record->parent = VATTR_IS_SUPPORTED(&va, va_parentid) ? va.va_parentid: 0;
+			}
+		}
+		if (	cnp
+			 && cnp->cn_nameptr) {
+			// the name isn't terminated; its within the whole path being looked up
+			size_t len = (cnp->cn_namelen < (int) sizeof(record->name)) ? (size_t) cnp->cn_namelen: sizeof(record->name) - 1;
+			(void) memcpy(record->name, cnp->cn_nameptr, len);
+			record->name[len] = '\0';
+		} else {
+			const char* name = vnode_getname(vp);
+			if (name) {
+				(void) strlcpy(record->name, name, sizeof(record->name));
+				vnode_putname(name);
+			}
+		}
+	}
+}
+
+
+/**
+ * @brief	coalesces repeated denials; if a window with suppressed repeats is being replaced
+ *			a summary record for it is pushed.  Records which aren't coalesced are identified
+ *
+ * @param	record		the record to coalesce
+ * @param	vp			the vnode the record is for; may be NULL
+ * @param	cnp			the lookup which found vp; may be NULL
+ *
+ * @return	0 if the record should be pushed, non zero if it has been coalesced
+ */
+static int audit_coalesce(audit_record_t* record, struct vnode* vp, struct componentname* cnp) {
+	int retval = 0; // push
+	int identified = 0;
+	audit_limit_t* limit = &g_audit.limits[record->hook];
+	if (limit->budget > 0) {
+		uint64_t hash = (record->vnode ^ ((uint64_t) record->uid << 32) ^ ((uint64_t) record->gid << 16) ^ record->hook) * 0x9e3779b97f4a7c15ull;
+		audit_coalesce_t* entry = &g_audit.coalesce[(hash >> 32) & (k_audit_coalesce_entries - 1)];
+		// try lock; if someone else has the entry we just don't coalesce this record
+		if (OSCompareAndSwap(0, 1, &entry->lock)) {
+			uint64_t window = 0;
+			nanoseconds_to_absolutetime((uint64_t) limit->window * 1000 * 1000, &window);
+			if (	(entry->start != 0)
+				 && ((record->timestamp - entry->start) < window)
+				 && (entry->record.vnode == record->vnode)
+				 && (entry->record.hook == record->hook)
+				 && (entry->record.uid == record->uid)
+				 && (entry->record.gid == record->gid)) {
+				// a repeat within the window
+				if (entry->emitted < (uint32_t) limit->budget) {
+					entry->emitted++;
+				} else {
+					entry->suppressed++;
+					entry->record.timestamp = record->timestamp;
+					entry->record.arg = record->arg;
+					entry->record.error = record->error;
+					retval = 1; // coalesced
+				}
+			} else {
+				// new key, or the window has ended; summarize the old window and start a new one
+				if (entry->suppressed) {
+					entry->record.count = entry->suppressed;
+					audit_push(&entry->record);
+				}
+				audit_identify(record, vp, cnp); // the entry's copy is used for the summary
+				identified = 1;
+				entry->start = record->timestamp;
+				entry->emitted = 1;
+				entry->suppressed = 0;
+				entry->record = *record;
+			}
+			OSMemoryBarrier(); // entry must be updated before it's unlocked
+			entry->lock = 0;
+		}
+	}
+	if (	(retval == 0)
+		 && (identified == 0)) {
+		audit_identify(record, vp, cnp);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	pushes summary records for windows which have ended with suppressed repeats
+ *
+ * @param	now			the current mach_absolute_time
+ */
+static void audit_coalesce_expire(uint64_t now) {
+	for (int i = 0; i < k_audit_coalesce_entries; i++) {
+		audit_coalesce_t* entry = &g_audit.coalesce[i];
+		if (	entry->suppressed
+			 && OSCompareAndSwap(0, 1, &entry->lock)) {
+			uint64_t window = 0;
+			nanoseconds_to_absolutetime((uint64_t) g_audit.limits[entry->record.hook].window * 1000 * 1000, &window);
+			if (	entry->suppressed
+				 && ((now - entry->start) >= window)) {
+				entry->record.count = entry->suppressed;
+				audit_push(&entry->record);
+				entry->start = 0;
+				entry->emitted = 0;
+				entry->suppressed = 0;
+			}
+			OSMemoryBarrier(); // entry must be updated before it's unlocked
+			entry->lock = 0;
+		}
+	}
+}
+
+
+/**
+ * @brief	pushes a record into the calling cpu's ring; never blocks
+ *
+ * @param	record		the record to push
+ */
+static void audit_push(const audit_record_t* record) {
+	audit_ring_t* ring = &g_audit.rings[cpu_number() & (k_audit_rings - 1)];
+	UInt64 pos = ring->head;
+	for (;;) {
+		audit_slot_t* slot = &ring->slots[pos & (k_audit_ring_size - 1)];
+		SInt64 diff = (SInt64) (slot->seq - pos);
+		if (diff == 0) {
+			// slot is free; try and reserve it
+			if (OSCompareAndSwap64(pos, pos + 1, &ring->head)) {
+				slot->record = *record;
+				OSMemoryBarrier(); // record must be visible before it's published
+				slot->seq = pos + 1;
+				break;
+			}
+			pos = ring->head;
+		} else if (diff < 0) {
+			// ring is full; the drainer hasn't caught up
+			(void) OSIncrementAtomic64(&ring->dropped);
+			break;
+		} else {
+			// another thread reserved it first; try again
+			pos = ring->head;
+		}
+	}
+}
+
+
+/**
+ * @brief	gets the number of records which have been dropped
+ *
+ * @return	the number of records dropped, across all rings, since audit_start
+ */
+__private_extern__ uint64_t audit_dropped(void) {
+	uint64_t retval = 0;
+	for (int i = 0; i < k_audit_rings; i++) {
+		retval += g_audit.rings[i].dropped;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	summarizes ended coalescing windows, then empties all rings exporting the 
+ *			records and formatting them into the system log
+ */
+static void audit_drain(void) {
+	clock_sec_t secs = 0;
+	clock_usec_t microsecs = 0;
+	uint64_t now = mach_absolute_time();
+	
+	clock_get_calendar_microtime(&secs, &microsecs);
+	audit_coalesce_expire(now);
+	for (int i = 0; i < k_audit_rings; i++) {
+		audit_ring_t* ring = &g_audit.rings[i];
+		for (;;) {
+			audit_slot_t* slot = &ring->slots[ring->tail & (k_audit_ring_size - 1)];
+			if (slot->seq != (ring->tail + 1)) {
+				break; // ring is empty (or the next record isn't published yet)
+			}
+			OSMemoryBarrier();
+			audit_record_t record = slot->record;
+			OSMemoryBarrier(); // copy must complete before the slot is released
+			slot->seq = ring->tail + k_audit_ring_size;
+			ring->tail++;
+
+			audit_export(&record, (uint64_t) secs * 1000000000ull + (uint64_t) microsecs * 1000ull, now);
+			if (g_audit.syslog) {
+				audit_format(&record);
+			}
+		}
+	}
+
+	uint64_t dropped = audit_dropped();
+	if (dropped != g_audit.reported) {
+		audit_log("%llu audit records dropped\n", (unsigned long long) (dropped - g_audit.reported));
+		g_audit.reported = dropped;
+	}
+}
+
+
+/**
+ * @brief	the drainer; empties the rings every k_audit_drain_interval_ms until stopped
+ */
+static void audit_drain_thread(void* param, wait_result_t wr) {
+	struct timespec ts = {0, k_audit_drain_interval_ms * 1000 * 1000};
+	lck_mtx_lock(g_audit.lock);
+	while (g_audit.running) {
+		lck_mtx_unlock(g_audit.lock);
+		audit_drain();
+		lck_mtx_lock(g_audit.lock);
+		if (g_audit.running) {
+			(void) msleep(&g_audit.running, g_audit.lock, PZERO, "wormxattr_audit", &ts);
+		}
+	}
+	audit_drain(); // anything recorded whilst we were stopping
+
+	g_audit.thread = THREAD_NULL;
+	wakeup(&g_audit.thread);
+	lck_mtx_unlock(g_audit.lock);
+	(void) thread_terminate(current_thread());
+}
+
+
+/**
+ * @brief	formats a record into the system log
+ *
+ * @param	record		the record to format
+ */
+static void audit_format(const audit_record_t* record) {
+	uint64_t ns = 0;
+	const char* message = "unknown";
+	if (record->hook < k_audit_hook_count) {
+		message = g_audit_messages[record->hook];
+	}
+	absolutetime_to_nanoseconds(record->timestamp, &ns);
+	audit_log("User:Group[%d:%d]; Extended attribute, %s, %s (fsid = %llx, fileid = %llu, parent = %llu, name = \"%s\", "
+			  "vnode = %llx, arg = %llx, error = %d, count = %u, time = %llu)\n", 
+			  record->uid, record->gid, k_wormxattr_xattr, message, 
+			  (unsigned long long) record->fsid, (unsigned long long) record->fileid, (unsigned long long) record->parent, record->name,
+			  (unsigned long long) record->vnode, (unsigned long long) record->arg, record->error, record->count, (unsigned long long) ns);
+}
+
+
+/**
+ * @brief	copies a record into the export ring; overwriting the oldest
+ *
+ * @param	record		the record to export
+ * @param	wall		the calendar time, ns since the epoch, at now
+ * @param	now			mach_absolute_time when wall was read
+ */
+static void audit_export(const audit_record_t* record, uint64_t wall, uint64_t now) {
+	uint64_t ago = 0;
+	audit_export_t* slot = NULL;
+	
+	if (record->timestamp < now) {
+		absolutetime_to_nanoseconds(now - record->timestamp, &ago);
+	}
+	lck_mtx_lock(g_audit.exportLock);
+	slot = &g_audit.exports[g_audit.exported & (k_audit_export_size - 1)];
+	slot->seq = g_audit.exported++;
+	slot->session = g_audit.session;
+	slot->time = wall - ago;
+	slot->fsid = record->fsid;
+	slot->fileid = record->fileid;
+	slot->parent = record->parent;
+	slot->vnode = record->vnode;
+	slot->arg = record->arg;
+	slot->hook = record->hook;
+	slot->uid = record->uid;
+	slot->gid = record->gid;
+	slot->error = record->error;
+	slot->count = record->count;
+	slot->reserved = 0;
+	(void) memcpy(slot->name, record->name, sizeof(slot->name));
+	lck_mtx_unlock(g_audit.exportLock);
+}
+
+
+/**
+ * @brief	security.mac.wormxattr.audit.records; the caller writes an 
+ *			audit_export_request_t and reads back the exported records from the one it
+ *			asked for (as many as fit).  As it must be written its root only
+ */
+static int audit_sysctl_records SYSCTL_HANDLER_ARGS {
+	int retval = 0;
+	audit_export_request_t request = {0};
+	
+	if (req->newptr == 0) {
+		retval = EPERM;
+	} else if ((retval = SYSCTL_IN(req, &request, sizeof(request))) != 0) {
+		// bad request
+	} else if (request.version != k_audit_export_version) {
+		retval = EINVAL;
+	} else {
+		lck_mtx_lock(g_audit.exportLock);
+		uint64_t oldest = (g_audit.exported > k_audit_export_size) ? g_audit.exported - k_audit_export_size: 0;
+		uint64_t from = request.from;
+		if (	(request.session != g_audit.session)
+			 || (from > g_audit.exported)) {
+			from = oldest; // a new consumer, or the kext was reloaded
+		} else if (from < oldest) {
+			from = oldest; // they've been overwritten
+		}
+		for (uint64_t seq = from; seq < g_audit.exported; seq++) {
+			if (	(req->oldptr != 0)
+				 && (req->oldidx + sizeof(audit_export_t) > req->oldlen)) {
+				break; // as many as fit
+			}
+			if ((retval = SYSCTL_OUT(req, &g_audit.exports[seq & (k_audit_export_size - 1)], sizeof(audit_export_t))) != 0) {
+				break;
+			}
+		}
+		lck_mtx_unlock(g_audit.exportLock);
+	}
+	return retval;
+}
+
+
+static int audit_sysctl_dropped SYSCTL_HANDLER_ARGS {
+	uint64_t dropped = audit_dropped();
+	return SYSCTL_OUT(req, &dropped, sizeof(dropped));
+}
@@ -30,21 +30,101 @@
 #include <sys/kauth.h>
 #include <sys/syslog.h>
 
+#include "audit_export.h"
+
+
+/*
+ * Defines
+ */
+
+#define k_audit_rings					16		// power of 2; rings are selected by cpu number
+#define k_audit_ring_size				512		// power of 2; records per ring
+#define k_audit_drain_interval_ms		100		// how often the drainer empties the rings
+#define k_audit_coalesce_entries		1024	// power of 2; repeated denials tracked for coalescing
+#define k_audit_default_window_ms		1000	// default coalescing window per hook
+#define k_audit_default_budget			1		// default records emitted per window before coalescing
+#define k_audit_name_max				k_audit_export_name_max	// bytes of a vnodes name kept in a record; including the nul
+#define k_audit_export_size				4096	// power of 2; records kept for userspace (audit_export.h)
+
 
 /*
  * Definitions
  */
 
+#define audit_hook_enum(name)		k_audit_hook_##name,
+
+/**
+ * @brief	identifies the hook which generated an audit record
+ */
+typedef enum {
+	audit_hooks(audit_hook_enum)
+	k_audit_hook_count
+} audit_hook_t;
+
+/**
+ * @brief	a fixed size binary audit record; formatted (off the syscall path) by the drainer.
+ *			The vnode is identified by its file system and file ids (plus its parent and
+ *			name, for when it has since been deleted) rather than its path; paths are 
+ *			resolved from them in userspace, when the log is read (tools/wormaudit)
+ *
+ * @field	timestamp		mach_absolute_time when the record was generated
+ * @field	vnode			an opaque, per boot, identifier for the vnode involved
+ * @field	arg				hook specific argument e.g. the open mode
+ * @field	fsid			the file system id of the vnodes mount; val[0] in the low 32 bits
+ * @field	fileid			the vnodes file id (inode number); 0 if unknown
+ * @field	parent			the file id of its parent directory; 0 if unknown
+ * @field	hook			the audit_hook_t which generated the record
+ * @field	uid				the callers uid
+ * @field	gid				the callers gid
+ * @field	error			the errno returned to the caller
+ * @field	count			the number of denials this record represents; > 1 when repeats were coalesced
+ * @field	name			the vnodes name (truncated); from the lookup which found it where the
+ *							hook has one
+ */
+typedef struct __audit_record_t {
+	uint64_t	timestamp;
+	uint64_t	vnode;
+	uint64_t	arg;
+	uint64_t	fsid;
+	uint64_t	fileid;
+	uint64_t	parent;
+	uint32_t	hook;
+	uint32_t	uid;
+	uint32_t	gid;
+	int32_t		error;
+	uint32_t	count;
+	char		name[k_audit_name_max];
+} audit_record_t;
+
+struct vnode; // pre define
+struct componentname;
+
+__private_extern__ kern_return_t audit_start(void);
+__private_extern__ void audit_stop(void);
 __private_extern__ void audit_log(const char* str, ...);
+__private_extern__ void audit_record(audit_hook_t hook, uid_t uid, gid_t gid, struct vnode* vp, struct componentname* cnp, int error, uint64_t arg);
+__private_extern__ uint64_t audit_dropped(void);
 
 
 /**
- * @brief	audits a request that has been denied; prints out the calling users uid/gid and the error.
+ * @brief	audits a request that has been denied; records the calling users uid/gid, the vnode and the error.
  *
  * @param	cred		a kauth_cred_t - the callers credentials; this macro will evaluate cred multiple times
- * @param	str			the printf style format string for the output message
+ * @param	hook		the audit_hook_t making the denial
+ * @param	vp			the vnode the request was made against
+ * @param	error		the errno returned to the caller
+ * @param	arg			hook specific argument, formatted by the drainer
+ */
+#define audit_deny(cred, hook, vp, error, arg)		audit_record(hook, kauth_cred_getuid(cred), kauth_cred_getgid(cred), vp, NULL, error, (uint64_t) (arg))
+
+
+/**
+ * @brief	as audit_deny; for hooks which have the lookup which found the vnode, so its 
+ *			name is taken from that rather than the name cache
+ *
+ * @param	cnp			the struct componentname* naming vp in its directory
  */
-#define audit_deny(cred, str, ...)			audit_log("User:Group[%d:%d]; " str, kauth_cred_getuid(cred), kauth_cred_getgid(cred), ##__VA_ARGS__)
+#define audit_deny_cnp(cred, hook, vp, cnp, error, arg)	audit_record(hook, kauth_cred_getuid(cred), kauth_cred_getgid(cred), vp, cnp, error, (uint64_t) (arg))
 
 
 #endif
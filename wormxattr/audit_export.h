@@ -0,0 +1,136 @@
+//
+//  audit_export.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_audit_export_h
+#define wormxattr_audit_export_h
+
+
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * The binary audit records exported to userspace; security.mac.wormxattr.audit.records.
+ * The drainer keeps the most recent records in an export ring, numbered consecutively
+ * from the kext being loaded, and a consumer (tools/wormlog) polls for those after the
+ * last it saw.  Records are fixed width and the consumer stores them as they are; so
+ * this header is shared with it.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_audit_export_version			1
+#define k_audit_export_name_max			64		// as k_audit_name_max
+#define k_audit_export_sysctl			"security.mac.wormxattr.audit.records"
+
+/**
+ * @brief	the hooks which generate audit records; expands hook(name) for each.  Their 
+ *			order is the audit_hook_t numbering; only ever append
+ */
+#define audit_hooks(hook) \
+	hook(check_deleteextattr) \
+	hook(check_exchangedata) \
+	hook(check_open) \
+	hook(check_rename_from) \
+	hook(check_setattrlist) \
+	hook(check_setextattr) \
+	hook(check_setflags) \
+	hook(check_setmode) \
+	hook(check_setowner) \
+	hook(check_setutimes) \
+	hook(check_truncate) \
+	hook(check_unlink) \
+	hook(notify_create) \
+	hook(notify_rename) \
+	hook(check_create) \
+	hook(check_link) \
+	hook(check_rename_to)
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	an exported audit record
+ *
+ * @field	seq			the records number; consecutive from the kext being loaded
+ * @field	session		a random value chosen when the kext was loaded; seq restarts when it changes
+ * @field	time		when the denial was made; ns since the epoch
+ * @field	fsid		the file system id of the vnode; val[0] in the low 32 bits
+ * @field	fileid		the vnodes file id; 0 if unknown
+ * @field	parent		the file id of its parent directory; 0 if unknown
+ * @field	vnode		an opaque, per boot, identifier for the vnode
+ * @field	arg			hook specific argument e.g. the open mode
+ * @field	hook		the audit_hook_t which denied
+ * @field	uid			the callers uid
+ * @field	gid			the callers gid
+ * @field	error		the errno returned to the caller
+ * @field	count		the number of denials this record represents; > 1 when repeats were coalesced
+ * @field	reserved	0
+ * @field	name		the vnodes name (truncated); nul terminated
+ */
+typedef struct __audit_export_t {
+	uint64_t	seq;
+	uint64_t	session;
+	uint64_t	time;
+	uint64_t	fsid;
+	uint64_t	fileid;
+	uint64_t	parent;
+	uint64_t	vnode;
+	uint64_t	arg;
+	uint32_t	hook;
+	uint32_t	uid;
+	uint32_t	gid;
+	int32_t		error;
+	uint32_t	count;
+	uint32_t	reserved;
+	char		name[k_audit_export_name_max];
+} audit_export_t;
+
+/**
+ * @brief	a request for records; written to the sysctl, the records are read back.
+ *			Records from before the ring's oldest are gone; the consumer sees the gap 
+ *			in seq.  If session doesn't match the kext's, records are read from its
+ *			oldest
+ *
+ * @field	version		k_audit_export_version
+ * @field	reserved	0
+ * @field	session		the session of the last record the consumer has; 0 if none
+ * @field	from		the seq of the first record wanted
+ */
+typedef struct __audit_export_request_t {
+	uint32_t	version;
+	uint32_t	reserved;
+	uint64_t	session;
+	uint64_t	from;
+} audit_export_request_t;
+
+
+#endif
@@ -33,6 +33,10 @@
 #include "audit.h"
 #include "dbg.h"
 
+#include "wormxattr_class.h"
+#include "wormxattr_mount.h"
+#include "wormxattr_persist.h"
+#include "wormxattr_stats.h"
 #include "wormxattr_vnode.h"
 
 // header includes, structure predefines to make mac_policy warning free
@@ -100,6 +104,10 @@ typedef struct __wormxattr_t {
 // static (global) instance
 static wormxattr_t g_wormxattr_policy = {0};
 
+// sysctl node for our tunables and statistics; security.mac.wormxattr
+SYSCTL_DECL(_security_mac);
+SYSCTL_NODE(_security_mac, OID_AUTO, wormxattr, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "wormxattr policy");
+
 static void initialize_policy(wormxattr_t* self);
 
 static mpo_policy_init_t policy_init;
@@ -121,13 +129,45 @@ kern_return_t com_mountainstorm_kext_wormxattr_start(kmod_info_t* ki, void* data
 	kern_return_t retval = KERN_FAILURE;
 	
 	initialize_policy(&g_wormxattr_policy);
-	retval = (kern_return_t) mac_policy_register(&g_wormxattr_policy.conf, 
-												 &g_wormxattr_policy.handle, 
-												 data);
-	if (retval != KERN_SUCCESS) {
-		audit_log("Failed to register mac policy: %d\n", retval);
+	sysctl_register_oid(&sysctl__security_mac_wormxattr);
+	if ((retval = wormxattr_stats_start()) != KERN_SUCCESS) {
+		audit_log("Failed to start stats: %d\n", retval);
+	} else if ((retval = audit_start()) != KERN_SUCCESS) {
+		audit_log("Failed to start audit: %d\n", retval);
+	} else if ((retval = wormxattr_class_start()) != KERN_SUCCESS) {
+		audit_log("Failed to start class names: %d\n", retval);
+		audit_stop();
 	} else {
-		dbg_info("Label slot assigned: %d\n", g_wormxattr_policy.label_slot);
+		retval = wormxattr_mount_start();
+		if (retval != KERN_SUCCESS) {
+			audit_log("Failed to start mount tracking: %d\n", retval);
+		} else {
+			retval = wormxattr_persist_start();
+			if (retval != KERN_SUCCESS) {
+				audit_log("Failed to start persist worker: %d\n", retval);
+			} else {
+				retval = (kern_return_t) mac_policy_register(&g_wormxattr_policy.conf, 
+															 &g_wormxattr_policy.handle, 
+															 data);
+				if (retval != KERN_SUCCESS) {
+					audit_log("Failed to register mac policy: %d\n", retval);
+					wormxattr_persist_stop();
+				} else {
+					dbg_info("Label slot assigned: %d\n", g_wormxattr_policy.label_slot);
+				}
+			}
+			if (retval != KERN_SUCCESS) {
+				wormxattr_mount_stop();
+			}
+		}
+		if (retval != KERN_SUCCESS) {
+			wormxattr_class_stop();
+			audit_stop();
+		}
+	}
+	if (retval != KERN_SUCCESS) {
+		wormxattr_stats_stop();
+		sysctl_unregister_oid(&sysctl__security_mac_wormxattr);
 	}
 	return retval;
 }
@@ -149,6 +189,14 @@ kern_return_t com_mountainstorm_kext_wormxattr_stop(kmod_info_t* ki, void* data)
 	retval = mac_policy_unregister(g_wormxattr_policy.handle);
 	if (retval != KERN_SUCCESS) {
 		dbg_error("Failed to unregister mac policy: %d\n", retval);
+	} else {
+		// no more hooks can fire; flush queued attributes, then the audit rings
+		wormxattr_persist_stop();
+		wormxattr_mount_stop();
+		wormxattr_class_stop();
+		audit_stop();
+		wormxattr_stats_stop();
+		sysctl_unregister_oid(&sysctl__security_mac_wormxattr);
 	}
 #endif
 	return retval;
@@ -159,11 +207,11 @@ kern_return_t com_mountainstorm_kext_wormxattr_stop(kmod_info_t* ki, void* data)
  * @brief	sets the WORM state in a label
  *
  * @param	label	the label to set the state in
- * @param	state	the state to set; 0 mutable, anything else WORM
+ * @param	value	the value to set; a k_wormxattr_label_* state, or wormxattr_label_worm()
  */
-__private_extern__ inline void wormxattr_set_label(struct label* label, int state) {
+__private_extern__ inline void wormxattr_set_label(struct label* label, intptr_t value) {
 	if (label) {
-		mac_label_set(label, g_wormxattr_policy.label_slot, (intptr_t) state);	
+		mac_label_set(label, g_wormxattr_policy.label_slot, value);	
 	}
 }
 
@@ -173,12 +221,42 @@ __private_extern__ inline void wormxattr_set_label(struct label* label, int stat
  *
  * @param	label	the label to get the state from
  *
- * @return	the value of the WORM state; 0 mutable, anything else WORM
+ * @return	the labels value; see wormxattr_label_state/wormxattr_label_expires.
+ *			k_wormxattr_label_unknown if label is NULL
+ */
+__private_extern__ inline intptr_t wormxattr_get_label(struct label* label) {
+	intptr_t retval = k_wormxattr_label_unknown;
+	if (label) {
+		retval = mac_label_get(label, g_wormxattr_policy.label_slot);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	sets the policy's pointer in a label; used for mount labels
+ *
+ * @param	label	the label to set the pointer in
+ * @param	ptr		the pointer to set
+ */
+__private_extern__ inline void wormxattr_set_label_ptr(struct label* label, void* ptr) {
+	if (label) {
+		mac_label_set(label, g_wormxattr_policy.label_slot, (intptr_t) ptr);
+	}
+}
+
+
+/**
+ * @brief	gets the policy's pointer from a label; used for mount labels
+ *
+ * @param	label	the label to get the pointer from
+ *
+ * @return	the pointer; NULL if the label is NULL or no pointer has been set
  */
-__private_extern__ inline int wormxattr_get_label(struct label* label) {
-	int retval = 0;
+__private_extern__ inline void* wormxattr_get_label_ptr(struct label* label) {
+	void* retval = NULL;
 	if (label) {
-		retval = (int) mac_label_get(label, g_wormxattr_policy.label_slot);
+		retval = (void*) mac_label_get(label, g_wormxattr_policy.label_slot);
 	}
 	return retval;
 }
@@ -214,6 +292,7 @@ static void initialize_policy(wormxattr_t* self) {
 
 	// init policy hooks
 	self->ops.mpo_policy_init = policy_init;
+	wormxattr_mount_initialize(&self->ops);
 	wormxattr_vnode_initialize(&self->ops);
 }
 
@@ -225,11 +304,8 @@ static void policy_init(struct mac_policy_conf *mpc) {
 	 * doesn't support access from kernel mode (strangely) e.g. CTLFLAG_KERN.  As such we can't
 	 * and will instead do it through  /etc/sysctl.conf.  This means that SOME vnodes 
 	 * will exist from before this was enabled (sysctl.conf is processed relativly late in the 
-	 * boot process.  As such we handle NULL labels by just ignoring it and returning "grant" 
-	 * for those operations.
-	 *
-	 * Note: this means that you cant make directories/files WORM whose vnodes are
-	 * created before sysctl.conf is processed.
+	 * boot process.  As such vnodes with NULL labels have their extended attribute read
+	 * each time a check needs it (see resolve_label), as there is nowhere to cache it.
 	 */
 }
 
@@ -27,19 +27,26 @@
 #define wormxattr_h
 
 
+#include "wormxattr_policy.h"
+
+
 /*
  * Defines
  */
 
 #define k_wormxattr_xattr		"com.mountainstorm.Worm"
+#define k_wormxattr_free_xattr	"com.mountainstorm.WormFree"	// on a mount's root; the mount has no WORM vnodes
+#define k_wormxattr_digest_xattr	"com.mountainstorm.WormDigest"	// the contents digest; set by the tools when sealing
 
 
 /*
  * Definitions
  */
 
-__private_extern__ void wormxattr_set_label(struct label* label, int state);
-__private_extern__ int wormxattr_get_label(struct label* label);
+__private_extern__ void wormxattr_set_label(struct label* label, intptr_t value);
+__private_extern__ intptr_t wormxattr_get_label(struct label* label);
+__private_extern__ void wormxattr_set_label_ptr(struct label* label, void* ptr);
+__private_extern__ void* wormxattr_get_label_ptr(struct label* label);
 
 
 #endif
@@ -0,0 +1,399 @@
+//
+//  wormxattr_class.c
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <sys/systm.h>
+#include <mach/mach_types.h>
+#include <sys/malloc.h>
+#include <sys/sysctl.h>
+#include <kern/locks.h>
+#include <libkern/OSAtomic.h>
+
+#include "wormxattr.h"
+#include "wormxattr_class.h"
+#include "dbg.h"
+
+
+/*
+ * Description
+ *
+ * The attributes which mark a vnode as being in a class of WORM.  k_wormxattr_xattr 
+ * always marks the worm class (and is what children inherit); the class_names sysctl 
+ * adds more names, as a list of name=class entries e.g. 
+ * "com.acme.LegalHold=hold,com.acme.Tenant1=worm,com.acme.Scratch=scratch", so that 
+ * several independently managed attributes (a tenant each, say) can share a class.  
+ * Labels record the classes, not the names; so a change only applies to vnodes whose 
+ * labels are resolved after it (i.e. set it in sysctl.conf).
+ *
+ * vnode_label_update_extattr is called for every attribute changed on every file, and 
+ * nearly all of them aren't ours.  The watched names (and k_wormxattr_free_xattr) are 
+ * held in a perfect hash; a table with a slot per name, found by searching for a seed
+ * which hashes them without collisions when the names are set.  Matching a name is a 
+ * hash of its length and its first and last 8 bytes, a length compare and at most one 
+ * memcmp; so names of the same length must differ in their first or last 8 bytes.
+ *
+ * Hooks read the table without a lock, or writing anything shared; matching is on the
+ * path of every attribute change.  As a hook may still be reading a table the sysctl
+ * has replaced, replaced tables are retired and only freed when the policy stops.  
+ * There are at most k_wormxattr_class_retired_max; the names are meant to be set once 
+ * (in sysctl.conf), setting the same names again replaces nothing, and once that many
+ * have been replaced further changes are refused (EBUSY) until the kext is reloaded.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_class_slots			(1 << k_wormxattr_class_slot_bits)
+#define k_wormxattr_class_seed			0x9e3779b97f4a7c15ull	// the first seed tried; odd
+#define k_wormxattr_class_seed_tries	4096
+#define k_wormxattr_class_retired_max	16			// tables replaced before changes are refused
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the parsed form of the class_names sysctl
+ *
+ * @field	seed		the hash seed; hashes the watched names to distinct slots
+ * @field	slots		the perfect hash of names (and the WORM free marker); len is 0 if empty
+ * @field	count		the number of valid entries in names
+ * @field	names		the watched names; k_wormxattr_xattr first
+ * @field	text		the names as set
+ * @field	keys		a copy of text which the names point into
+ */
+typedef struct __wormxattr_class_table_t {
+	uint64_t				seed;
+	wormxattr_class_name_t	slots[k_wormxattr_class_slots];
+	uint32_t				count;
+	wormxattr_class_name_t	names[k_wormxattr_class_names_max];
+	char					text[k_wormxattr_class_names_len];
+	char					keys[k_wormxattr_class_names_len];
+} wormxattr_class_table_t;
+
+/**
+ * @brief	the class name state
+ *
+ * @field	lockGroup	the lock group for lock
+ * @field	lock		serializes changes to table
+ * @field	table		the current table
+ * @field	retired		the tables replaced; hooks may still be reading them
+ * @field	retiredCount	the number of valid entries in retired
+ */
+typedef struct __wormxattr_classes_t {
+	lck_grp_t*							lockGroup;
+	lck_mtx_t*							lock;
+	wormxattr_class_table_t* volatile	table;
+	wormxattr_class_table_t*			retired[k_wormxattr_class_retired_max];
+	uint32_t							retiredCount;
+} wormxattr_classes_t;
+
+
+// static (global) instance
+static wormxattr_classes_t g_wormxattr_classes;
+
+static inline uint32_t class_hash(const char* name, size_t len, uint64_t seed);
+static int class_table_add(wormxattr_class_table_t* table, const char* name, unsigned classes);
+static int class_table_parse(wormxattr_class_table_t* table);
+static int class_table_hash(wormxattr_class_table_t* table);
+static int class_sysctl_names SYSCTL_HANDLER_ARGS;
+
+SYSCTL_DECL(_security_mac_wormxattr);
+SYSCTL_PROC(_security_mac_wormxattr, OID_AUTO, class_names, CTLTYPE_STRING | CTLFLAG_RW | CTLFLAG_LOCKED,
+			0, 0, class_sysctl_names, "A", "Extra WORM attribute names; name=worm|hold|scratch");
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	initializes the class names; just k_wormxattr_xattr until the sysctl is set
+ *
+ * @return	KERN_SUCCESS on success, else a valid kern_return_t error
+ */
+__private_extern__ kern_return_t wormxattr_class_start(void) {
+	kern_return_t retval = KERN_FAILURE;
+	
+	(void) memset(&g_wormxattr_classes, 0x00, sizeof(g_wormxattr_classes));
+	g_wormxattr_classes.lockGroup = lck_grp_alloc_init("wormxattr_class", LCK_GRP_ATTR_NULL);
+	if (g_wormxattr_classes.lockGroup) {
+		wormxattr_class_table_t* table = _MALLOC(sizeof(*table), M_TEMP, M_WAITOK | M_ZERO);
+		g_wormxattr_classes.lock = lck_mtx_alloc_init(g_wormxattr_classes.lockGroup, LCK_ATTR_NULL);
+		if (	g_wormxattr_classes.lock
+			 && table
+			 && (class_table_parse(table) == 0)) {
+			g_wormxattr_classes.table = table;
+			sysctl_register_oid(&sysctl__security_mac_wormxattr_class_names);
+			retval = KERN_SUCCESS;
+		} else {
+			if (table) {
+				_FREE(table, M_TEMP);
+			}
+			if (g_wormxattr_classes.lock) {
+				lck_mtx_free(g_wormxattr_classes.lock, g_wormxattr_classes.lockGroup);
+			}
+			lck_grp_free(g_wormxattr_classes.lockGroup);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	releases the class names; the policy must be unregistered
+ */
+__private_extern__ void wormxattr_class_stop(void) {
+	sysctl_unregister_oid(&sysctl__security_mac_wormxattr_class_names);
+	for (uint32_t i = 0; i < g_wormxattr_classes.retiredCount; i++) {
+		_FREE(g_wormxattr_classes.retired[i], M_TEMP);
+	}
+	_FREE(g_wormxattr_classes.table, M_TEMP);
+	lck_mtx_free(g_wormxattr_classes.lock, g_wormxattr_classes.lockGroup);
+	lck_grp_free(g_wormxattr_classes.lockGroup);
+}
+
+
+/**
+ * @brief	checks if an attribute name is one we watch
+ *
+ * @param	name	the attribute name
+ *
+ * @return	the k_wormxattr_class_* the name marks, k_wormxattr_class_free_marker for 
+ *			k_wormxattr_free_xattr, else 0 if it isn't ours
+ */
+__private_extern__ unsigned wormxattr_class_match(const char* name) {
+	wormxattr_class_table_t* table = g_wormxattr_classes.table;
+	size_t len = strlen(name);
+	wormxattr_class_name_t* slot = &table->slots[class_hash(name, len, table->seed)];
+	return (	(slot->len == len)
+			 && (memcmp(slot->name, name, len) == 0)) ? slot->classes: 0;
+}
+
+
+/**
+ * @brief	gets the watched names; to resolve a vnodes classes from
+ *
+ * @param	names	on return the names; valid until the policy stops
+ *
+ * @return	the number of names; at least 1 (k_wormxattr_xattr is first)
+ */
+__private_extern__ uint32_t wormxattr_class_watched(const wormxattr_class_name_t** names) {
+	wormxattr_class_table_t* table = g_wormxattr_classes.table;
+	*names = table->names;
+	return table->count;
+}
+
+
+/**
+ * @brief	hashes a name to its slot; from its length and its first and last 8 bytes,
+ *			so the cost doesn't depend on the length
+ *
+ * @param	name	the name
+ * @param	len		its length
+ * @param	seed	the tables seed
+ *
+ * @return	the slot
+ */
+static inline uint32_t class_hash(const char* name, size_t len, uint64_t seed) {
+	uint64_t first = 0;
+	uint64_t last = 0;
+	
+	if (len >= sizeof(first)) {
+		(void) memcpy(&first, name, sizeof(first));
+		(void) memcpy(&last, name + len - sizeof(last), sizeof(last));
+	} else {
+		(void) memcpy(&first, name, len);
+	}
+	return (uint32_t) ((((first ^ len) * seed) ^ last) * seed >> (64 - k_wormxattr_class_slot_bits));
+}
+
+
+/**
+ * @brief	adds a watched name to a table
+ *
+ * @param	table	the table
+ * @param	name	the name; must outlive the table
+ * @param	classes	the k_wormxattr_class_* it marks
+ *
+ * @return	0 on success, else EINVAL if its a duplicate, or there are too many
+ */
+static int class_table_add(wormxattr_class_table_t* table, const char* name, unsigned classes) {
+	int retval = 0;
+	size_t len = strlen(name);
+	
+	for (uint32_t i = 0; i < table->count; i++) {
+		if (strcmp(table->names[i].name, name) == 0) {
+			// the same name twice is fine; in two classes isn't
+			retval = (table->names[i].classes == classes) ? EEXIST: EINVAL;
+			break;
+		}
+	}
+	if (retval == EEXIST) {
+		retval = 0;
+	} else if (	(retval == 0)
+			   && (	(table->count == k_wormxattr_class_names_max)
+				   || (len == 0)
+				   || (strcmp(name, k_wormxattr_free_xattr) == 0))) {
+		retval = EINVAL;
+	} else if (retval == 0) {
+		table->names[table->count].name = name;
+		table->names[table->count].len = (uint32_t) len;
+		table->names[table->count].classes = classes;
+		table->count++;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	parses table->text into table->names and hashes them
+ *
+ * @param	table	the table to parse; text must be set
+ *
+ * @return	0 on success, else EINVAL if the text isn't valid
+ */
+static int class_table_parse(wormxattr_class_table_t* table) {
+	int retval = 0;
+	char* it = table->keys;
+	
+	(void) strlcpy(table->keys, table->text, sizeof(table->keys));
+	table->count = 0;
+	retval = class_table_add(table, k_wormxattr_xattr, k_wormxattr_class_worm);
+	while (retval == 0) {
+		// entries are separated by commas and/or whitespace
+		while ((*it == ',') || (*it == ' ') || (*it == '\t') || (*it == '\n')) {
+			it++;
+		}
+		if (*it == '\0') {
+			break; // done
+		}
+		
+		char* name = it;
+		while ((*it != '\0') && (*it != '=') && (*it != ',') && (*it != ' ')) {
+			it++;
+		}
+		if ((*it != '=') || (it == name)) {
+			retval = EINVAL;
+			break;
+		}
+		*it++ = '\0';
+		
+		char* kind = it;
+		while ((*it != '\0') && (*it != ',') && (*it != ' ') && (*it != '\t') && (*it != '\n')) {
+			it++;
+		}
+		if (*it != '\0') {
+			*it++ = '\0';
+		}
+		
+		unsigned classes = 0;
+#define wormxattr_class_parse(cname, bit)	classes = (strcmp(kind, #cname) == 0) ? (bit): classes;
+		wormxattr_policy_classes(wormxattr_class_parse)
+#undef wormxattr_class_parse
+		if (classes == 0) {
+			retval = EINVAL;
+			break;
+		}
+		retval = class_table_add(table, name, classes);
+	}
+	if (retval == 0) {
+		retval = class_table_hash(table);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	builds the perfect hash of a tables names and the WORM free marker
+ *
+ * @param	table	the table; names must be set
+ *
+ * @return	0 on success, else EINVAL if no seed could be found (e.g. two names only 
+ *			differ in their middle)
+ */
+static int class_table_hash(wormxattr_class_table_t* table) {
+	int retval = EINVAL;
+	uint64_t seed = k_wormxattr_class_seed;
+	wormxattr_class_name_t marker = {k_wormxattr_free_xattr, sizeof(k_wormxattr_free_xattr) - 1, k_wormxattr_class_free_marker};
+	
+	for (int try = 0; (try < k_wormxattr_class_seed_tries) && (retval != 0); try++) {
+		retval = 0;
+		(void) memset(table->slots, 0x00, sizeof(table->slots));
+		for (uint32_t i = 0; (i <= table->count) && (retval == 0); i++) {
+			wormxattr_class_name_t* name = (i < table->count) ? &table->names[i]: &marker;
+			wormxattr_class_name_t* slot = &table->slots[class_hash(name->name, name->len, seed)];
+			if (slot->len) {
+				retval = EINVAL; // collision
+			} else {
+				*slot = *name;
+			}
+		}
+		table->seed = seed;
+		seed = (seed * 6364136223846793005ull + 1442695040888963407ull) | 1; // next odd seed
+	}
+	dbg_info("hashed %u class names; seed 0x%llx, %s\n", table->count, table->seed, retval ? "failed": "ok");
+	return retval;
+}
+
+
+/**
+ * @brief	sysctl handler for class_names; a valid new value replaces the table
+ */
+static int class_sysctl_names SYSCTL_HANDLER_ARGS {
+	int retval = ENOMEM;
+	wormxattr_class_table_t* table = _MALLOC(sizeof(*table), M_TEMP, M_WAITOK | M_ZERO);
+	if (table) {
+		lck_mtx_lock(g_wormxattr_classes.lock);
+		(void) strlcpy(table->text, g_wormxattr_classes.table->text, sizeof(table->text));
+		lck_mtx_unlock(g_wormxattr_classes.lock);
+		
+		retval = sysctl_handle_string(oidp, table->text, sizeof(table->text), req);
+		if (	(retval == 0)
+			 && req->newptr) {
+			retval = class_table_parse(table);
+			if (retval == 0) {
+				lck_mtx_lock(g_wormxattr_classes.lock);
+				if (strcmp(table->text, g_wormxattr_classes.table->text) == 0) {
+					// the same names; nothing to replace
+				} else if (g_wormxattr_classes.retiredCount == k_wormxattr_class_retired_max) {
+					retval = EBUSY; // no room to keep the table it would replace
+				} else {
+					g_wormxattr_classes.retired[g_wormxattr_classes.retiredCount++] = g_wormxattr_classes.table;
+					OSMemoryBarrier(); // the table is complete before its published
+					g_wormxattr_classes.table = table;
+					table = NULL; // its published
+				}
+				lck_mtx_unlock(g_wormxattr_classes.lock);
+			}
+		}
+		if (table) {
+			_FREE(table, M_TEMP);
+		}
+	}
+	return retval;
+}
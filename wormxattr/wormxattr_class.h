@@ -0,0 +1,66 @@
+//
+//  wormxattr_class.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_class_h
+#define wormxattr_class_h
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_class_names_len		512		// max length of the class_names sysctl
+#define k_wormxattr_class_names_max		8		// max watched names; including k_wormxattr_xattr
+#define k_wormxattr_class_slot_bits		4		// the hash table has 1 << bits slots
+#define k_wormxattr_class_free_marker	0x20	// wormxattr_class_match for k_wormxattr_free_xattr
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a watched attribute name
+ *
+ * @field	name		the attribute name
+ * @field	len			its length
+ * @field	classes		the k_wormxattr_class_* it marks a vnode as being in, or
+ *						k_wormxattr_class_free_marker
+ */
+typedef struct {
+	const char*			name;
+	uint32_t			len;
+	uint32_t			classes;
+} wormxattr_class_name_t;
+
+
+__private_extern__ kern_return_t wormxattr_class_start(void);
+__private_extern__ void wormxattr_class_stop(void);
+
+__private_extern__ unsigned wormxattr_class_match(const char* name);
+__private_extern__ uint32_t wormxattr_class_watched(const wormxattr_class_name_t** names);
+
+
+#endif
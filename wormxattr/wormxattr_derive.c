@@ -0,0 +1,172 @@
+//
+//  wormxattr_derive.c
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <sys/systm.h>
+#include <mach/mach_types.h>
+#include <libkern/OSAtomic.h>
+
+#include "wormxattr.h"
+#include "wormxattr_derive.h"
+
+
+// header includes, structure predefines to make mac_policy warning free
+struct socket;
+struct sockopt;
+#include <sys/mount.h>
+#include <sys/msg.h>
+#include <sys/socket.h>
+#include <sys/vnode.h>
+#include <security/mac_policy.h>
+
+
+/*
+ * Description
+ *
+ * On derive mounts (see wormxattr_mount_mode_t) a vnode without an attribute of its own
+ * takes the state its nearest ancestor with one would give a new child; so moving a tree
+ * into a WORM directory is a rename, not an attribute write per file.  Deriving a state
+ * walks up the vnode's ancestors; this caches the derived state of each directory walked
+ * so later derivations stop at the first cached ancestor.
+ *
+ * Entries are keyed by vnode and vid, so a recycled vnode never matches, and carry the 
+ * generation they were derived in.  Anything which changes what a directory's 
+ * descendants derive (a directory being renamed or its attributes changed) moves the 
+ * generation on; every entry, and every derived label, is stale from then on.  Its a 
+ * direct mapped table; each slot has a sequence which is odd whilst its written, so 
+ * lookups never lock and a torn entry is a miss.  The cache needs no setup; its static.
+ */
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a cached directory state
+ *
+ * @field	sequence	bumped before and after the entry is written; odd whilst it is
+ * @field	generation	the generation the state was derived in
+ * @field	vid			the vid of vp when it was derived
+ * @field	vp			the directory; not referenced.  NULL for an empty slot
+ * @field	value		the directory's label value, as derived
+ */
+typedef struct __wormxattr_derive_entry_t {
+	volatile UInt32		sequence;
+	uint32_t			generation;
+	uint32_t			vid;
+	struct vnode*		vp;
+	intptr_t			value;
+} wormxattr_derive_entry_t;
+
+
+// static (global) instance
+static wormxattr_derive_entry_t g_wormxattr_derive[k_wormxattr_derive_slots];
+static volatile SInt32 g_wormxattr_derive_generation = 1;
+
+static inline wormxattr_derive_entry_t* derive_slot(struct vnode* dvp);
+
+
+/*
+ * Implementation
+ */
+
+static inline wormxattr_derive_entry_t* derive_slot(struct vnode* dvp) {
+	uint64_t hash = ((uint64_t) (uintptr_t) dvp >> 4) * 0x9e3779b97f4a7c15ull;
+	return &g_wormxattr_derive[(hash >> 32) & (k_wormxattr_derive_slots - 1)];
+}
+
+
+/**
+ * @brief	gets the current generation; derive with it, and cache the results under it
+ *
+ * @return	the generation
+ */
+__private_extern__ uint32_t wormxattr_derive_generation(void) {
+	return (uint32_t) g_wormxattr_derive_generation;
+}
+
+
+/**
+ * @brief	makes every cached state, and every derived label, stale; called when what
+ *			some directory's descendants derive has changed
+ */
+__private_extern__ void wormxattr_derive_invalidate(void) {
+	(void) OSIncrementAtomic(&g_wormxattr_derive_generation);
+}
+
+
+/**
+ * @brief	looks up a directory's derived state
+ *
+ * @param	dvp			the directory
+ * @param	generation	the current generation; from wormxattr_derive_generation
+ * @param	value		on success its label value
+ *
+ * @return	non zero if it was cached in generation
+ */
+__private_extern__ int wormxattr_derive_lookup(struct vnode* dvp, uint32_t generation, intptr_t* value) {
+	int retval = 0;
+	wormxattr_derive_entry_t* entry = derive_slot(dvp);
+	UInt32 sequence = entry->sequence;
+	
+	OSMemoryBarrier();
+	if (	((sequence & 1) == 0)
+		 && (entry->vp == dvp)
+		 && (entry->generation == generation)
+		 && (entry->vid == vnode_vid(dvp))) {
+		intptr_t cached = entry->value;
+		OSMemoryBarrier();
+		if (entry->sequence == sequence) {
+			*value = cached;
+			retval = 1;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	caches a directory's derived state; replacing whatever was in its slot.  If 
+ *			another thread is writing the slot its left to them
+ *
+ * @param	dvp			the directory
+ * @param	generation	the generation it was derived in
+ * @param	value		its label value
+ */
+__private_extern__ void wormxattr_derive_insert(struct vnode* dvp, uint32_t generation, intptr_t value) {
+	wormxattr_derive_entry_t* entry = derive_slot(dvp);
+	UInt32 sequence = entry->sequence;
+	
+	if (	((sequence & 1) == 0)
+		 && OSCompareAndSwap(sequence, sequence + 1, &entry->sequence)) {
+		OSMemoryBarrier();
+		entry->vp = dvp;
+		entry->vid = vnode_vid(dvp);
+		entry->generation = generation;
+		entry->value = value;
+		OSMemoryBarrier();
+		entry->sequence = sequence + 2;
+	}
+}
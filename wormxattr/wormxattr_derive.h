@@ -0,0 +1,50 @@
+//
+//  wormxattr_derive.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_derive_h
+#define wormxattr_derive_h
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_derive_slots		2048	// power of 2; directories whose state is cached
+#define k_wormxattr_derive_depth		32		// ancestors held at once whilst deriving
+
+
+/*
+ * Definitions
+ */
+
+struct vnode; // pre define
+
+__private_extern__ uint32_t wormxattr_derive_generation(void);
+__private_extern__ void wormxattr_derive_invalidate(void);
+__private_extern__ int wormxattr_derive_lookup(struct vnode* dvp, uint32_t generation, intptr_t* value);
+__private_extern__ void wormxattr_derive_insert(struct vnode* dvp, uint32_t generation, intptr_t value);
+
+
+#endif
@@ -0,0 +1,718 @@
+//
+//  wormxattr_mount.c
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <sys/systm.h>
+#include <mach/mach_types.h>
+#include <sys/malloc.h>
+#include <sys/sysctl.h>
+#include <kern/locks.h>
+#include <libkern/OSAtomic.h>
+
+#include "wormxattr.h"
+#include "wormxattr_derive.h"
+#include "wormxattr_mount.h"
+#include "wormxattr_persist.h"
+#include "wormxattr_stats.h"
+#include "dbg.h"
+#include "audit.h"
+
+
+// header includes, structure predefines to make mac_policy warning free
+struct socket;
+struct sockopt;
+#include <sys/mount.h>
+#include <sys/msg.h>
+#include <sys/socket.h>
+#include <sys/vnode.h>
+#include <security/mac_policy.h>
+
+
+/*
+ * Description
+ *
+ * Every vnode instantiated for an existing file costs an extended attribute lookup
+ * to find out if it's WORM.  Most mounts contain no WORM vnodes at all, so we keep
+ * a per mount summary which lets vnode_label_associate_extattr skip the lookup when
+ * the answer is definitely mutable.
+ *
+ * A mount is WORM free if the root directory has the k_wormxattr_free_xattr attribute;
+ * set by the super user once a tree is known to contain no WORM vnodes.  The marker
+ * is read when the root vnode is associated; until then the mount is assumed to
+ * contain WORM vnodes.  Before our attribute is set on any vnode of a WORM free mount
+ * the marker is removed, and the summary updated, so it is never stale on disk.
+ *
+ * Each mount also has a mode (see wormxattr_mount_mode_t) taken from the mount_modes
+ * sysctl; a list of key=mode rules e.g. "devfs=ignore,nfs=ignore,/Volumes/Scratch=ignore".
+ * A key starting with '/' matches the path a file system is mounted on, otherwise its
+ * file system type; path rules take precedence.  Mounts without a rule are enforced.
+ * Mounts are evaluated when they are associated, and again whenever the rules change, as
+ * sysctl.conf is only applied once the boot volumes are already mounted.  Vnodes on an
+ * ignored mount never have their attribute read or inherited; however a vnode labeled
+ * before its mount became ignored keeps its label until it's recycled.  Vnodes on a
+ * derive mount take their state from their nearest ancestor with an attribute (see 
+ * wormxattr_derive.c).
+ *
+ * Hooks which aren't passed the mount label find the mode of a vnode's mount from the
+ * slots; an open addressed table, hashed on the mount, of the mount and its mode in a
+ * single word (a mount is aligned, so the mode fits in its low bits).  They're only
+ * changed with the lock held, and read without it; a reader holds a reference to the
+ * mount it looks for, so a slot holding it is current.  Mounts which don't fit (more
+ * than k_wormxattr_mount_slots) are found by walking the list, with the lock held.
+ */
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the per mount summary; hung off the mount label
+ *
+ * @field	next		the next mount in g_wormxattr_mounts.mounts
+ * @field	mp			the mount; NULL until the label is associated
+ * @field	free		non zero if the mount is known to have no WORM vnodes
+ * @field	mode		how the policy treats vnodes on the mount; a wormxattr_mount_mode_t
+ * @field	root		the mount's root vnode, as last associated; not referenced
+ * @field	rootVid		the vid of root when it was associated
+ * @field	slotted		non zero if the mount is in g_wormxattr_mounts.slots
+ */
+typedef struct __wormxattr_mount_t {
+	struct __wormxattr_mount_t*	next;
+	struct mount*				mp;
+	volatile UInt32				free;
+	volatile UInt32				mode;
+	struct vnode*				root;
+	uint32_t					rootVid;
+	uint32_t					slotted;
+} wormxattr_mount_t;
+
+/**
+ * @brief	a single mount_modes rule
+ *
+ * @field	key			a mount path if it begins with '/' else a file system type name
+ * @field	mode		the mode mounts matching key are given
+ */
+typedef struct __wormxattr_mount_rule_t {
+	const char*				key;
+	wormxattr_mount_mode_t	mode;
+} wormxattr_mount_rule_t;
+
+/**
+ * @brief	the parsed form of the mount_modes sysctl
+ *
+ * @field	text		the rules as set
+ * @field	keys		a copy of text which the rule keys point into
+ * @field	count		the number of valid entries in rules
+ * @field	rules		the rules
+ */
+typedef struct __wormxattr_mount_table_t {
+	char					text[k_wormxattr_mount_modes_len];
+	char					keys[k_wormxattr_mount_modes_len];
+	uint32_t				count;
+	wormxattr_mount_rule_t	rules[k_wormxattr_mount_rules];
+} wormxattr_mount_table_t;
+
+/**
+ * @brief	the mount tracking state
+ *
+ * @field	lockGroup	the lock group for lock
+ * @field	lock		protects mounts, table and changes to a mount's free marker
+ * @field	mounts		all mounts with associated labels
+ * @field	table		the current mount_modes rules
+ * @field	derives		non zero if any of the rules is a derive rule
+ * @field	ignores		non zero if any of the rules is an ignore rule
+ * @field	overflow	the number of mounts which aren't in slots
+ * @field	slots		mounts and their modes; (uintptr_t) mp | mode, see mount_slot
+ */
+typedef struct __wormxattr_mounts_t {
+	lck_grp_t*			lockGroup;
+	lck_mtx_t*			lock;
+	wormxattr_mount_t*	mounts;
+	wormxattr_mount_table_t* table;
+	volatile UInt32		derives;
+	volatile UInt32		ignores;
+	uint32_t			overflow;
+	volatile uintptr_t	slots[k_wormxattr_mount_slots];
+} wormxattr_mounts_t;
+
+// a slot which held a mount; lookups probe past it
+#define k_mount_slot_removed		((uintptr_t) 0x4)
+#define k_mount_slot_mode_mask		((uintptr_t) 0x3)
+
+
+// static (global) instance
+static wormxattr_mounts_t g_wormxattr_mounts;
+
+// mac mount hooks
+static mpo_mount_check_umount_t				mount_check_umount;
+static mpo_mount_label_associate_t			mount_label_associate;
+static mpo_mount_label_destroy_t			mount_label_destroy;
+static mpo_mount_label_init_t				mount_label_init;
+
+static inline int mount_table_separator(char c);
+static int mount_table_parse(wormxattr_mount_table_t* table);
+static wormxattr_mount_mode_t mount_table_mode(wormxattr_mount_table_t* table, struct mount* mp);
+static int mount_table_uses(wormxattr_mount_table_t* table, wormxattr_mount_mode_t mode);
+static inline uint32_t mount_slot(struct mount* mp);
+static int mount_slot_set(struct mount* mp, wormxattr_mount_mode_t mode);
+static void mount_slot_remove(struct mount* mp);
+static int mount_sysctl_modes SYSCTL_HANDLER_ARGS;
+
+SYSCTL_DECL(_security_mac_wormxattr);
+SYSCTL_PROC(_security_mac_wormxattr, OID_AUTO, mount_modes, CTLTYPE_STRING | CTLFLAG_RW | CTLFLAG_LOCKED,
+			0, 0, mount_sysctl_modes, "A", "Per mount modes; key=enforce|ignore|noinherit|derive, key is a mount path or fs type");
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	initializes the mount callbacks hooked by this policy.
+ *			Note: this ONLY sets fields which begin with mpo_mount
+ *
+ * @param	ops		the policy ops to set our hooks into.
+ */
+__private_extern__ void wormxattr_mount_initialize(struct mac_policy_ops* ops) {
+	if (ops) {
+		ops->mpo_mount_check_umount				= mount_check_umount;
+		ops->mpo_mount_label_associate			= mount_label_associate;
+		ops->mpo_mount_label_destroy			= mount_label_destroy;
+		ops->mpo_mount_label_init				= mount_label_init;
+	} else {
+		panic("Invalid parameter - ops == NULL\n");
+	}
+}
+
+
+/**
+ * @brief	initializes the mount tracking state
+ *
+ * @return	KERN_SUCCESS on success, else a valid kern_return_t error
+ */
+__private_extern__ kern_return_t wormxattr_mount_start(void) {
+	kern_return_t retval = KERN_FAILURE;
+	
+	(void) memset(&g_wormxattr_mounts, 0x00, sizeof(g_wormxattr_mounts));
+	g_wormxattr_mounts.lockGroup = lck_grp_alloc_init("wormxattr_mount", LCK_GRP_ATTR_NULL);
+	if (g_wormxattr_mounts.lockGroup) {
+		g_wormxattr_mounts.lock = lck_mtx_alloc_init(g_wormxattr_mounts.lockGroup, LCK_ATTR_NULL);
+		g_wormxattr_mounts.table = _MALLOC(sizeof(*g_wormxattr_mounts.table), M_TEMP, M_WAITOK | M_ZERO);
+		if (	g_wormxattr_mounts.lock
+			 && g_wormxattr_mounts.table) {
+			(void) strlcpy(g_wormxattr_mounts.table->text, k_wormxattr_mount_default_modes, sizeof(g_wormxattr_mounts.table->text));
+			(void) mount_table_parse(g_wormxattr_mounts.table);
+			g_wormxattr_mounts.derives = mount_table_uses(g_wormxattr_mounts.table, k_wormxattr_mount_derive);
+			g_wormxattr_mounts.ignores = mount_table_uses(g_wormxattr_mounts.table, k_wormxattr_mount_ignore);
+			
+			sysctl_register_oid(&sysctl__security_mac_wormxattr_mount_modes);
+			retval = KERN_SUCCESS;
+		} else {
+			if (g_wormxattr_mounts.table) {
+				_FREE(g_wormxattr_mounts.table, M_TEMP);
+			}
+			if (g_wormxattr_mounts.lock) {
+				lck_mtx_free(g_wormxattr_mounts.lock, g_wormxattr_mounts.lockGroup);
+			}
+			lck_grp_free(g_wormxattr_mounts.lockGroup);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	releases the mount tracking state; the policy must be unregistered
+ */
+__private_extern__ void wormxattr_mount_stop(void) {
+	sysctl_unregister_oid(&sysctl__security_mac_wormxattr_mount_modes);
+	_FREE(g_wormxattr_mounts.table, M_TEMP);
+	lck_mtx_free(g_wormxattr_mounts.lock, g_wormxattr_mounts.lockGroup);
+	lck_grp_free(g_wormxattr_mounts.lockGroup);
+}
+
+
+/**
+ * @brief	gets the mode of a mount
+ *
+ * @param	mntlabel	the label of the mount; may be NULL
+ *
+ * @return	the mounts mode; k_wormxattr_mount_enforce if it isn't known
+ */
+__private_extern__ wormxattr_mount_mode_t wormxattr_mount_mode(struct label* mntlabel) {
+	wormxattr_mount_mode_t retval = k_wormxattr_mount_enforce;
+	wormxattr_mount_t* mount = wormxattr_get_label_ptr(mntlabel);
+	if (mount) {
+		retval = mount->mode;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets the mode of a mount, for hooks which aren't passed its label; from the 
+ *			slots, without the lock.  Only if there are more mounts than slots, and it 
+ *			isn't in them, is the mount list walked
+ *
+ * @param	mp		the mount; the caller holds a reference to it (e.g. a vnode on it)
+ *
+ * @return	the mounts mode; k_wormxattr_mount_enforce if it isn't known
+ */
+__private_extern__ wormxattr_mount_mode_t wormxattr_mount_mode_of(struct mount* mp) {
+	wormxattr_mount_mode_t retval = k_wormxattr_mount_enforce;
+	uint32_t slot = mount_slot(mp);
+	int found = 0;
+	
+	for (uint32_t i = 0; i < k_wormxattr_mount_slots; i++) {
+		uintptr_t value = g_wormxattr_mounts.slots[(slot + i) & (k_wormxattr_mount_slots - 1)];
+		if (value == 0) {
+			break; // never used; mp isn't further on
+		} else if ((value & ~k_mount_slot_mode_mask) == (uintptr_t) mp) {
+			retval = (wormxattr_mount_mode_t) (value & k_mount_slot_mode_mask);
+			found = 1;
+			break;
+		}
+	}
+	if (	(found == 0)
+		 && g_wormxattr_mounts.overflow) {
+		lck_mtx_lock(g_wormxattr_mounts.lock);
+		for (wormxattr_mount_t* mount = g_wormxattr_mounts.mounts; mount; mount = mount->next) {
+			if (mount->mp == mp) {
+				retval = mount->mode;
+				break;
+			}
+		}
+		lck_mtx_unlock(g_wormxattr_mounts.lock);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if any mount can be a derive mount; if not, hooks which aren't passed 
+ *			the mount label needn't find the mode of a vnode's mount to resolve it
+ *
+ * @return	non zero if there are derive rules
+ */
+__private_extern__ int wormxattr_mount_derives(void) {
+	return g_wormxattr_mounts.derives != 0;
+}
+
+
+/**
+ * @brief	checks if any mount can be ignored; if so, hooks which aren't passed the mount
+ *			label must find the mode of a vnode's mount before reading its attributes
+ *
+ * @return	non zero if there are ignore rules
+ */
+__private_extern__ int wormxattr_mount_ignores(void) {
+	return g_wormxattr_mounts.ignores != 0;
+}
+
+
+/**
+ * @brief	checks if the WORM attribute needs to be read for a vnode on this mount
+ *
+ * @param	mntlabel	the label of the mount the vnode is on; may be NULL
+ *
+ * @return	0 if the mount is known to be WORM free or is ignored, non zero if the 
+ *			attribute must be read (when the label is resolved)
+ */
+__private_extern__ int wormxattr_mount_lookup(struct label* mntlabel) {
+	int retval = 1; // look it up
+	wormxattr_mount_t* mount = wormxattr_get_label_ptr(mntlabel);
+	if (	mount 
+		&& (mount->free || (mount->mode == k_wormxattr_mount_ignore))) {
+		wormxattr_stats_avoided();
+		retval = 0;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	records the mount's root vnode and (re)reads its WORM free marker
+ *
+ * @param	mntlabel	the label of the mount; may be NULL
+ * @param	vp			the root vnode of the mount
+ */
+__private_extern__ void wormxattr_mount_root(struct label* mntlabel, struct vnode* vp) {
+	wormxattr_mount_t* mount = wormxattr_get_label_ptr(mntlabel);
+	if (	mount
+		&& (mount->mode != k_wormxattr_mount_ignore)) {
+		char marker = 0;
+		size_t attrlen = 0;
+		int ret = mac_vnop_getxattr(vp, k_wormxattr_free_xattr, &marker, sizeof(marker), &attrlen);
+		
+		lck_mtx_lock(g_wormxattr_mounts.lock);
+		mount->root = vp;
+		mount->rootVid = vnode_vid(vp);
+		mount->free = ((ret == KERN_SUCCESS) || (ret == ERANGE)) ? 1: 0;
+		lck_mtx_unlock(g_wormxattr_mounts.lock);
+		dbg_info("mount %s is %s\n", vfs_statfs(vnode_mount(vp))->f_mntonname, mount->free ? "WORM free": "WORM");
+	}
+}
+
+
+/**
+ * @brief	called before our attribute is set on a vnode; if the mount was WORM free
+ *			its marker is removed so that it is never stale
+ *
+ * @param	mp		the mount the attribute is being set on
+ *
+ * @return	0 if the attribute may be set, else an errno
+ */
+__private_extern__ int wormxattr_mount_worm_added(struct mount* mp) {
+	int retval = 0;
+	wormxattr_mount_t* found = NULL;
+	struct vnode* root = NULLVP;
+	uint32_t rootVid = 0;
+	
+	// only find the mount under the lock; the VFS calls below can block, and label
+	// the root vnode, which takes the lock again (wormxattr_mount_root)
+	lck_mtx_lock(g_wormxattr_mounts.lock);
+	for (wormxattr_mount_t* mount = g_wormxattr_mounts.mounts; mount; mount = mount->next) {
+		if ((mount->mp == mp) && mount->free) {
+			found = mount;
+			root = mount->root;
+			rootVid = mount->rootVid;
+			break;
+		}
+	}
+	lck_mtx_unlock(g_wormxattr_mounts.lock);
+	
+	if (found) {
+		/*
+		 * we don't hold a reference on the root vnode (it would prevent unmount)
+		 * so it may have been recycled; in which case look it up again
+		 */
+		if (	(root == NULLVP)
+			 || (vnode_getwithvid(root, rootVid) != 0)) {
+			if (vnode_lookup(vfs_statfs(mp)->f_mntonname, 0, &root, vfs_context_current()) != 0) {
+				root = NULLVP;
+			}
+		}
+		
+		retval = ENOENT;
+		if (root) {
+			retval = mac_vnop_removexattr(root, k_wormxattr_free_xattr);
+			if (retval == ENOATTR) {
+				retval = 0; // someone already removed it
+			}
+			(void) vnode_put(root);
+		}
+		if (retval == 0) {
+			// the mount may have gone whilst unlocked; only clear it if its still there
+			lck_mtx_lock(g_wormxattr_mounts.lock);
+			for (wormxattr_mount_t* mount = g_wormxattr_mounts.mounts; mount; mount = mount->next) {
+				if (	(mount == found)
+					 && (mount->mp == mp)) {
+					mount->free = 0;
+					break;
+				}
+			}
+			lck_mtx_unlock(g_wormxattr_mounts.lock);
+		} else {
+			audit_log("Unable to remove %s from %s; %d\n", k_wormxattr_free_xattr, vfs_statfs(mp)->f_mntonname, retval);
+		}
+	}
+	return retval;
+}
+
+
+// mac hooks - see mac_policy for documentation
+static int mount_check_umount(kauth_cred_t cred,
+							  struct mount *mp,
+							  struct label *mlabel) {
+	// queued attribute writes hold vnode references, and must reach the disk first
+	wormxattr_persist_flush();
+	return 0; // grant access
+}
+
+
+static void mount_label_init(struct label *label) {
+	wormxattr_mount_t* mount = _MALLOC(sizeof(*mount), M_TEMP, M_WAITOK | M_ZERO);
+	wormxattr_set_label_ptr(label, mount); // if the allocation failed we'll always lookup
+}
+
+
+static void mount_label_associate(kauth_cred_t cred,
+								  struct mount *mp,
+								  struct label *mntlabel) {
+	wormxattr_mount_t* mount = wormxattr_get_label_ptr(mntlabel);
+	if (mount) {
+		lck_mtx_lock(g_wormxattr_mounts.lock);
+		mount->mp = mp;
+		mount->mode = mount_table_mode(g_wormxattr_mounts.table, mp);
+		if ((mount->slotted = mount_slot_set(mp, mount->mode)) == 0) {
+			g_wormxattr_mounts.overflow++;
+		}
+		mount->next = g_wormxattr_mounts.mounts;
+		g_wormxattr_mounts.mounts = mount;
+		lck_mtx_unlock(g_wormxattr_mounts.lock);
+	}
+}
+
+
+static void mount_label_destroy(struct label *label) {
+	wormxattr_mount_t* mount = wormxattr_get_label_ptr(label);
+	if (mount) {
+		lck_mtx_lock(g_wormxattr_mounts.lock);
+		for (wormxattr_mount_t** it = &g_wormxattr_mounts.mounts; *it; it = &(*it)->next) {
+			if (*it == mount) {
+				*it = mount->next;
+				if (mount->slotted) {
+					mount_slot_remove(mount->mp);
+				} else {
+					g_wormxattr_mounts.overflow--;
+				}
+				break;
+			}
+		}
+		lck_mtx_unlock(g_wormxattr_mounts.lock);
+		wormxattr_set_label_ptr(label, NULL);
+		_FREE(mount, M_TEMP);
+	}
+}
+
+
+/**
+ * @brief	checks if a character separates rules; a comma or any whitespace
+ */
+static inline int mount_table_separator(char c) {
+	return (c == ',') || (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+
+/**
+ * @brief	parses table->text into table->rules
+ *
+ * @param	table	the table to parse; text must be set
+ *
+ * @return	0 on success, else EINVAL if the text isn't valid
+ */
+static int mount_table_parse(wormxattr_mount_table_t* table) {
+	int retval = 0;
+	char* it = table->keys;
+	
+	(void) strlcpy(table->keys, table->text, sizeof(table->keys));
+	table->count = 0;
+	while (retval == 0) {
+		// rules are separated by commas and/or whitespace
+		while (mount_table_separator(*it)) {
+			it++;
+		}
+		if (*it == '\0') {
+			break; // done
+		}
+		
+		char* key = it;
+		while ((*it != '\0') && (*it != '=') && !mount_table_separator(*it)) {
+			it++;
+		}
+		if ((*it != '=') || (it == key) || (table->count == k_wormxattr_mount_rules)) {
+			retval = EINVAL;
+			break;
+		}
+		*it++ = '\0';
+		
+		char* mode = it;
+		while ((*it != '\0') && !mount_table_separator(*it)) {
+			it++;
+		}
+		if (*it != '\0') {
+			*it++ = '\0';
+		}
+		
+		wormxattr_mount_rule_t* rule = &table->rules[table->count];
+		rule->key = key;
+		if (strcmp(mode, "enforce") == 0) {
+			rule->mode = k_wormxattr_mount_enforce;
+		} else if (strcmp(mode, "ignore") == 0) {
+			rule->mode = k_wormxattr_mount_ignore;
+		} else if (strcmp(mode, "noinherit") == 0) {
+			rule->mode = k_wormxattr_mount_noinherit;
+		} else if (strcmp(mode, "derive") == 0) {
+			rule->mode = k_wormxattr_mount_derive;
+		} else {
+			retval = EINVAL;
+			break;
+		}
+		table->count++;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	finds the mode for a mount; a path rule beats a file system type rule
+ *
+ * @param	table	the rules
+ * @param	mp		the mount
+ *
+ * @return	the mode for mp; k_wormxattr_mount_enforce if no rule matches
+ */
+static wormxattr_mount_mode_t mount_table_mode(wormxattr_mount_table_t* table, struct mount* mp) {
+	wormxattr_mount_mode_t retval = k_wormxattr_mount_enforce;
+	struct vfsstatfs* stat = vfs_statfs(mp);
+	for (uint32_t i = 0; i < table->count; i++) {
+		wormxattr_mount_rule_t* rule = &table->rules[i];
+		if (rule->key[0] == '/') {
+			if (strcmp(rule->key, stat->f_mntonname) == 0) {
+				retval = rule->mode;
+				break; // path rules win
+			}
+		} else if (strcmp(rule->key, stat->f_fstypename) == 0) {
+			retval = rule->mode; // keep looking for a path rule
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if any of the rules gives a mode
+ *
+ * @param	table	the rules
+ * @param	mode	the mode
+ *
+ * @return	non zero if one does
+ */
+static int mount_table_uses(wormxattr_mount_table_t* table, wormxattr_mount_mode_t mode) {
+	int retval = 0;
+	for (uint32_t i = 0; i < table->count; i++) {
+		if (table->rules[i].mode == mode) {
+			retval = 1;
+			break;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	sysctl handler for mount_modes; a valid new value is applied to every mount
+ */
+static int mount_sysctl_modes SYSCTL_HANDLER_ARGS {
+	int retval = ENOMEM;
+	wormxattr_mount_table_t* table = _MALLOC(sizeof(*table), M_TEMP, M_WAITOK | M_ZERO);
+	if (table) {
+		lck_mtx_lock(g_wormxattr_mounts.lock);
+		(void) strlcpy(table->text, g_wormxattr_mounts.table->text, sizeof(table->text));
+		lck_mtx_unlock(g_wormxattr_mounts.lock);
+		
+		retval = sysctl_handle_string(oidp, table->text, sizeof(table->text), req);
+		if (	(retval == 0) 
+			 && req->newptr) {
+			retval = mount_table_parse(table);
+			if (retval == 0) {
+				wormxattr_mount_table_t* old = NULL;
+				
+				lck_mtx_lock(g_wormxattr_mounts.lock);
+				old = g_wormxattr_mounts.table;
+				g_wormxattr_mounts.table = table;
+				g_wormxattr_mounts.derives = mount_table_uses(table, k_wormxattr_mount_derive);
+				g_wormxattr_mounts.ignores = mount_table_uses(table, k_wormxattr_mount_ignore);
+				for (wormxattr_mount_t* mount = g_wormxattr_mounts.mounts; mount; mount = mount->next) {
+					mount->mode = mount_table_mode(table, mount->mp);
+					if (mount->slotted) {
+						(void) mount_slot_set(mount->mp, mount->mode);
+					}
+				}
+				lck_mtx_unlock(g_wormxattr_mounts.lock);
+				wormxattr_derive_invalidate(); // labels derived on a mount which no longer derives
+				table = old; // free the old table
+			}
+		}
+		_FREE(table, M_TEMP);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	the slot a mount is first looked for in
+ */
+static inline uint32_t mount_slot(struct mount* mp) {
+	uint64_t hash = (uint64_t) (uintptr_t) mp * 0x9e3779b97f4a7c15ULL;
+	return (uint32_t) (hash >> 32) & (k_wormxattr_mount_slots - 1);
+}
+
+
+/**
+ * @brief	records the mode of a mount in the slots; the lock must be held
+ *
+ * @param	mp		the mount
+ * @param	mode	its mode
+ *
+ * @return	non zero if its in the slots, else 0 if every slot is in use
+ */
+static int mount_slot_set(struct mount* mp, wormxattr_mount_mode_t mode) {
+	int retval = 0;
+	uint32_t slot = mount_slot(mp);
+	int use = -1;
+	
+	for (int i = 0; i < k_wormxattr_mount_slots; i++) {
+		int index = (int) ((slot + i) & (k_wormxattr_mount_slots - 1));
+		uintptr_t value = g_wormxattr_mounts.slots[index];
+		if ((value & ~k_mount_slot_mode_mask) == (uintptr_t) mp) {
+			use = index; // already there; update it
+			break;
+		} else if (value == 0) {
+			if (use == -1) {
+				use = index;
+			}
+			break;
+		} else if (	(value == k_mount_slot_removed)
+				   && (use == -1)) {
+			use = index;
+		}
+	}
+	if (use != -1) {
+		g_wormxattr_mounts.slots[use] = (uintptr_t) mp | (uintptr_t) mode;
+		retval = 1;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	removes a mount from the slots; the lock must be held
+ *
+ * @param	mp		the mount
+ */
+static void mount_slot_remove(struct mount* mp) {
+	uint32_t slot = mount_slot(mp);
+	for (int i = 0; i < k_wormxattr_mount_slots; i++) {
+		int index = (int) ((slot + i) & (k_wormxattr_mount_slots - 1));
+		uintptr_t value = g_wormxattr_mounts.slots[index];
+		if (value == 0) {
+			break;
+		} else if ((value & ~k_mount_slot_mode_mask) == (uintptr_t) mp) {
+			g_wormxattr_mounts.slots[index] = k_mount_slot_removed;
+			break;
+		}
+	}
+}
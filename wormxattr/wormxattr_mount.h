@@ -0,0 +1,73 @@
+//
+//  wormxattr_mount.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_mount_h
+#define wormxattr_mount_h
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_mount_modes_len		512				// max length of the mount_modes sysctl
+#define k_wormxattr_mount_rules			32				// max rules in the mount_modes sysctl
+#define k_wormxattr_mount_default_modes	"devfs=ignore"	// mount_modes until sysctl.conf sets it
+#define k_wormxattr_mount_slots			256				// power of 2; mounts whose mode is found without the lock
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	how the policy treats vnodes on a mount
+ */
+typedef enum {
+	k_wormxattr_mount_enforce = 0,		// WORM attributes are honoured and inherited
+	k_wormxattr_mount_ignore,			// never evaluated; no attribute reads, everything is mutable
+	k_wormxattr_mount_noinherit,		// WORM attributes are honoured but not inherited by new children
+	k_wormxattr_mount_derive,			// WORM attributes are honoured; descendants derive them, nothing is written
+} wormxattr_mount_mode_t;
+
+
+struct label; // pre define
+struct mac_policy_ops;
+struct mount;
+struct vnode;
+
+__private_extern__ void wormxattr_mount_initialize(struct mac_policy_ops* ops);
+__private_extern__ kern_return_t wormxattr_mount_start(void);
+__private_extern__ void wormxattr_mount_stop(void);
+
+__private_extern__ wormxattr_mount_mode_t wormxattr_mount_mode(struct label* mntlabel);
+__private_extern__ wormxattr_mount_mode_t wormxattr_mount_mode_of(struct mount* mp);
+__private_extern__ int wormxattr_mount_derives(void);
+__private_extern__ int wormxattr_mount_ignores(void);
+__private_extern__ int wormxattr_mount_lookup(struct label* mntlabel);
+__private_extern__ void wormxattr_mount_root(struct label* mntlabel, struct vnode* vp);
+__private_extern__ int wormxattr_mount_worm_added(struct mount* mp);
+
+
+#endif
@@ -0,0 +1,412 @@
+//
+//  wormxattr_persist.c
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <sys/systm.h>
+#include <mach/mach_types.h>
+#include <sys/proc.h>
+#include <sys/sysctl.h>
+#include <kern/clock.h>
+#include <kern/locks.h>
+#include <kern/thread.h>
+#include <libkern/OSAtomic.h>
+
+#include "wormxattr.h"
+#include "wormxattr_persist.h"
+#include "dbg.h"
+#include "audit.h"
+
+
+// header includes, structure predefines to make mac_policy warning free
+struct socket;
+struct sockopt;
+#include <sys/mount.h>
+#include <sys/msg.h>
+#include <sys/socket.h>
+#include <sys/vnode.h>
+#include <security/mac_policy.h>
+
+
+/*
+ * Description
+ *
+ * When a vnode is created in (or moved into) a WORM directory it inherits our
+ * attribute; by default the attribute is written synchronously in the create path.
+ * With security.mac.wormxattr.persist.deferred set the label is set straight away, 
+ * so the vnode is enforced as WORM immediately, and the attribute write is queued.
+ * A worker thread writes the queued attributes in batches; whenever a batch is 
+ * waiting or every k_wormxattr_persist_interval_ms.
+ *
+ * Each queued vnode holds a usecount (vnode_ref) until its attribute is written. The
+ * queue is bounded; when it's full the caller falls back to a synchronous write.  
+ * The queue is flushed before any unmount (mpo_mount_check_umount) and when the 
+ * policy stops.  There is no hook for sync(2); the interval bounds how long an 
+ * attribute can be outstanding.  Until then the attribute isn't visible to getxattr.
+ */
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	an attribute waiting to be written
+ *
+ * @field	vp			the vnode; referenced with vnode_ref
+ * @field	label		the vnodes label; valid whilst we hold the reference
+ * @field	queued		when it was queued (mach_absolute_time)
+ * @field	uid			the uid of the creator; for auditing failures
+ * @field	gid			the gid of the creator; for auditing failures
+ * @field	hook		the hook which queued it; for auditing failures
+ */
+typedef struct __wormxattr_persist_entry_t {
+	struct vnode*	vp;
+	struct label*	label;
+	uint64_t		queued;
+	uint32_t		uid;
+	uint32_t		gid;
+	audit_hook_t	hook;
+} wormxattr_persist_entry_t;
+
+/**
+ * @brief	the persist state
+ *
+ * @field	queue		the attributes waiting to be written
+ * @field	head		the next queue position to write into
+ * @field	tail		the next queue position to flush
+ * @field	batch		entries taken from the queue by the flusher currently writing
+ * @field	lockGroup	the lock group for lock and flushLock
+ * @field	lock		protects queue, head, tail, running and is used to sleep the worker
+ * @field	flushLock	serializes flushers; held whilst a batch is written
+ * @field	running		non zero whilst the worker should run
+ * @field	thread		the worker; THREAD_NULL once it has exited
+ * @field	deferred	non zero to defer inherited attribute writes
+ * @field	depth		the number of queued entries
+ * @field	maxDepth	the largest depth seen
+ * @field	queued		the number of attributes queued
+ * @field	flushed		the number of queued attributes written
+ * @field	fallbacks	the number of attributes written synchronously as the queue was full
+ * @field	failed		the number of queued attributes which couldn't be written
+ * @field	batchLast	how long the last batch took to write (ns)
+ * @field	batchMax	the longest a batch took to write (ns)
+ * @field	ageMax		the longest an attribute waited to be written (ns)
+ */
+typedef struct __wormxattr_persist_t {
+	wormxattr_persist_entry_t	queue[k_wormxattr_persist_queue];
+	uint32_t					head;
+	uint32_t					tail;
+	wormxattr_persist_entry_t	batch[k_wormxattr_persist_batch];
+	lck_grp_t*					lockGroup;
+	lck_mtx_t*					lock;
+	lck_mtx_t*					flushLock;
+	int							running;
+	thread_t					thread;
+	int							deferred;
+	int							depth;
+	int							maxDepth;
+	volatile SInt64				queued;
+	volatile SInt64				flushed;
+	volatile SInt64				fallbacks;
+	volatile SInt64				failed;
+	uint64_t					batchLast;
+	uint64_t					batchMax;
+	uint64_t					ageMax;
+} wormxattr_persist_t;
+
+
+// static (global) instance
+static wormxattr_persist_t g_persist;
+
+static int persist_flush_batch(void);
+static void persist_thread(void* param, wait_result_t wr);
+
+SYSCTL_DECL(_security_mac_wormxattr);
+SYSCTL_NODE(_security_mac_wormxattr, OID_AUTO, persist, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "Inherited attribute persistence");
+SYSCTL_INT(_security_mac_wormxattr_persist, OID_AUTO, deferred, CTLFLAG_RW | CTLFLAG_LOCKED,
+		   &g_persist.deferred, 0, "Defer and batch inherited attribute writes");
+SYSCTL_INT(_security_mac_wormxattr_persist, OID_AUTO, depth, CTLFLAG_RD | CTLFLAG_LOCKED,
+		   &g_persist.depth, 0, "Attributes waiting to be written");
+SYSCTL_INT(_security_mac_wormxattr_persist, OID_AUTO, max_depth, CTLFLAG_RD | CTLFLAG_LOCKED,
+		   &g_persist.maxDepth, 0, "Most attributes ever waiting to be written");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, queued, CTLFLAG_RD | CTLFLAG_LOCKED,
+			(void*) &g_persist.queued, "Attributes queued");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, flushed, CTLFLAG_RD | CTLFLAG_LOCKED,
+			(void*) &g_persist.flushed, "Queued attributes written");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, sync_fallbacks, CTLFLAG_RD | CTLFLAG_LOCKED,
+			(void*) &g_persist.fallbacks, "Attributes written synchronously as the queue was full");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, failed, CTLFLAG_RD | CTLFLAG_LOCKED,
+			(void*) &g_persist.failed, "Queued attributes which couldn't be written");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, batch_last_ns, CTLFLAG_RD | CTLFLAG_LOCKED,
+			&g_persist.batchLast, "Time taken to write the last batch (ns)");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, batch_max_ns, CTLFLAG_RD | CTLFLAG_LOCKED,
+			&g_persist.batchMax, "Longest time taken to write a batch (ns)");
+SYSCTL_QUAD(_security_mac_wormxattr_persist, OID_AUTO, age_max_ns, CTLFLAG_RD | CTLFLAG_LOCKED,
+			&g_persist.ageMax, "Longest an attribute waited to be written (ns)");
+
+static struct sysctl_oid* g_persist_sysctls[] = {
+	&sysctl__security_mac_wormxattr_persist,
+	&sysctl__security_mac_wormxattr_persist_deferred,
+	&sysctl__security_mac_wormxattr_persist_depth,
+	&sysctl__security_mac_wormxattr_persist_max_depth,
+	&sysctl__security_mac_wormxattr_persist_queued,
+	&sysctl__security_mac_wormxattr_persist_flushed,
+	&sysctl__security_mac_wormxattr_persist_sync_fallbacks,
+	&sysctl__security_mac_wormxattr_persist_failed,
+	&sysctl__security_mac_wormxattr_persist_batch_last_ns,
+	&sysctl__security_mac_wormxattr_persist_batch_max_ns,
+	&sysctl__security_mac_wormxattr_persist_age_max_ns
+};
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	initializes the queue and starts the worker
+ *
+ * @return	KERN_SUCCESS on success, else a valid kern_return_t error
+ */
+__private_extern__ kern_return_t wormxattr_persist_start(void) {
+	kern_return_t retval = KERN_FAILURE;
+
+	(void) memset(&g_persist, 0x00, sizeof(g_persist));
+	g_persist.lockGroup = lck_grp_alloc_init("wormxattr_persist", LCK_GRP_ATTR_NULL);
+	if (g_persist.lockGroup) {
+		g_persist.lock = lck_mtx_alloc_init(g_persist.lockGroup, LCK_ATTR_NULL);
+		g_persist.flushLock = lck_mtx_alloc_init(g_persist.lockGroup, LCK_ATTR_NULL);
+		if (	g_persist.lock
+			 && g_persist.flushLock) {
+			g_persist.running = 1;
+			retval = kernel_thread_start(persist_thread, NULL, &g_persist.thread);
+			if (retval == KERN_SUCCESS) {
+				thread_deallocate(g_persist.thread); // we don't need the reference
+				for (int i = 0; i < (int) (sizeof(g_persist_sysctls)/sizeof(g_persist_sysctls[0])); i++) {
+					sysctl_register_oid(g_persist_sysctls[i]);
+				}
+			} else {
+				dbg_error("Unable to start persist worker: %d\n", retval);
+				g_persist.thread = THREAD_NULL;
+			}
+		}
+		if (retval != KERN_SUCCESS) {
+			if (g_persist.flushLock) {
+				lck_mtx_free(g_persist.flushLock, g_persist.lockGroup);
+			}
+			if (g_persist.lock) {
+				lck_mtx_free(g_persist.lock, g_persist.lockGroup);
+			}
+			lck_grp_free(g_persist.lockGroup);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	stops the worker; anything still queued is written first.  The policy must 
+ *			be unregistered so nothing more can be queued
+ */
+__private_extern__ void wormxattr_persist_stop(void) {
+	for (int i = (int) (sizeof(g_persist_sysctls)/sizeof(g_persist_sysctls[0])) - 1; i >= 0; i--) {
+		sysctl_unregister_oid(g_persist_sysctls[i]);
+	}
+
+	lck_mtx_lock(g_persist.lock);
+	g_persist.running = 0;
+	wakeup(&g_persist.running);
+	while (g_persist.thread != THREAD_NULL) {
+		(void) msleep(&g_persist.thread, g_persist.lock, PZERO, "wormxattr_persist_stop", NULL);
+	}
+	lck_mtx_unlock(g_persist.lock);
+
+	lck_mtx_free(g_persist.flushLock, g_persist.lockGroup);
+	lck_mtx_free(g_persist.lock, g_persist.lockGroup);
+	lck_grp_free(g_persist.lockGroup);
+}
+
+
+/**
+ * @brief	queues the inherited attribute write for a vnode, if deferral is enabled and
+ *			there is room; the label is set before it's queued
+ *
+ * @param	cred	the credential of the creator
+ * @param	vp		the vnode inheriting the attribute; must have an iocount
+ * @param	label	the vnodes label
+ * @param	value	the label value to set; the attribute is written from the label
+ * @param	hook	the hook inheriting the attribute; used to audit failures
+ *
+ * @return	non zero if it was queued, else 0 and the caller must write it synchronously
+ */
+__private_extern__ int wormxattr_persist_defer(kauth_cred_t cred, struct vnode* vp, struct label* label, intptr_t value, audit_hook_t hook) {
+	int retval = 0;
+	// only files and directories; anything else (e.g. fifo's) may not support attributes
+	if (	g_persist.deferred
+		 && label
+		 && ((vnode_vtype(vp) == VREG) || (vnode_vtype(vp) == VDIR))
+		 && (vnode_ref(vp) == 0)) {
+		int wake = 0;
+
+		// enforce now; the worker only writes attributes for labels still WORM
+		wormxattr_set_label(label, value);
+
+		lck_mtx_lock(g_persist.lock);
+		if ((g_persist.head - g_persist.tail) < k_wormxattr_persist_queue) {
+			wormxattr_persist_entry_t* entry = &g_persist.queue[g_persist.head & (k_wormxattr_persist_queue - 1)];
+			entry->vp = vp;
+			entry->label = label;
+			entry->queued = mach_absolute_time();
+			entry->uid = kauth_cred_getuid(cred);
+			entry->gid = kauth_cred_getgid(cred);
+			entry->hook = hook;
+			g_persist.head++;
+
+			g_persist.depth = (int) (g_persist.head - g_persist.tail);
+			if (g_persist.depth > g_persist.maxDepth) {
+				g_persist.maxDepth = g_persist.depth;
+			}
+			wake = (g_persist.depth == k_wormxattr_persist_batch);
+			retval = 1;
+		}
+		lck_mtx_unlock(g_persist.lock);
+
+		if (retval) {
+			(void) OSIncrementAtomic64(&g_persist.queued);
+			if (wake) {
+				wakeup(&g_persist.running);
+			}
+		} else {
+			// queue is full; the caller writes it and sets the label to reflect the result
+			(void) OSIncrementAtomic64(&g_persist.fallbacks);
+			vnode_rele(vp);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	writes every queued attribute; returns once they're all written
+ */
+__private_extern__ void wormxattr_persist_flush(void) {
+	while (persist_flush_batch()) {
+		// keep going until its empty
+	}
+}
+
+
+/**
+ * @brief	takes up to k_wormxattr_persist_batch entries off the queue and writes them
+ *
+ * @return	the number of entries written
+ */
+static int persist_flush_batch(void) {
+	int retval = 0;
+
+	lck_mtx_lock(g_persist.flushLock);
+	lck_mtx_lock(g_persist.lock);
+	while (	(g_persist.tail != g_persist.head)
+		   && (retval < k_wormxattr_persist_batch)) {
+		g_persist.batch[retval++] = g_persist.queue[g_persist.tail & (k_wormxattr_persist_queue - 1)];
+		g_persist.tail++;
+	}
+	g_persist.depth = (int) (g_persist.head - g_persist.tail);
+	lck_mtx_unlock(g_persist.lock);
+
+	if (retval) {
+		uint64_t start = mach_absolute_time();
+		uint64_t now = 0, ns = 0;
+		for (int i = 0; i < retval; i++) {
+			wormxattr_persist_entry_t* entry = &g_persist.batch[i];
+			int err = ENOENT;
+			if (vnode_getwithref(entry->vp) == 0) {
+				intptr_t value = wormxattr_get_label(entry->label);
+				if (	(wormxattr_label_state(value) == k_wormxattr_label_worm)
+					 && (wormxattr_label_classes(value) & k_wormxattr_class_inherited)) {
+					char buf[k_wormxattr_value_max];
+					size_t len = wormxattr_policy_format(buf, sizeof(buf), value);
+					err = mac_vnop_setxattr(entry->vp, k_wormxattr_xattr, buf, len);
+				} else {
+					err = 0; // the attribute was removed before we got to write it
+				}
+				if (err != 0) {
+					/*
+					 * the vnode is enforced as WORM until it's recycled, but the attribute
+					 * didn't make it to disk; the best we can do is log it (whilst we hold
+					 * an iocount, so it can be identified)
+					 */
+					audit_record(entry->hook, entry->uid, entry->gid, entry->vp, NULL, err, 0);
+				}
+				(void) vnode_put(entry->vp);
+			} else {
+				audit_record(entry->hook, entry->uid, entry->gid, NULL, NULL, err, 0); // its being reclaimed
+			}
+			if (err == 0) {
+				(void) OSIncrementAtomic64(&g_persist.flushed);
+			} else {
+				(void) OSIncrementAtomic64(&g_persist.failed);
+			}
+			vnode_rele(entry->vp);
+		}
+
+		now = mach_absolute_time();
+		absolutetime_to_nanoseconds(now - g_persist.batch[0].queued, &ns);
+		if (ns > g_persist.ageMax) {
+			g_persist.ageMax = ns; // the first entry waited longest
+		}
+		absolutetime_to_nanoseconds(now - start, &g_persist.batchLast);
+		if (g_persist.batchLast > g_persist.batchMax) {
+			g_persist.batchMax = g_persist.batchLast;
+		}
+	}
+	lck_mtx_unlock(g_persist.flushLock);
+	return retval;
+}
+
+
+/**
+ * @brief	the worker; flushes a batch whenever one is waiting, or every 
+ *			k_wormxattr_persist_interval_ms, until stopped
+ */
+static void persist_thread(void* param, wait_result_t wr) {
+	struct timespec ts = {0, k_wormxattr_persist_interval_ms * 1000 * 1000};
+	lck_mtx_lock(g_persist.lock);
+	while (g_persist.running) {
+		lck_mtx_unlock(g_persist.lock);
+		wormxattr_persist_flush();
+		lck_mtx_lock(g_persist.lock);
+		if (	g_persist.running
+			 && (g_persist.head == g_persist.tail)) {
+			(void) msleep(&g_persist.running, g_persist.lock, PZERO, "wormxattr_persist", &ts);
+		}
+	}
+	lck_mtx_unlock(g_persist.lock);
+	wormxattr_persist_flush(); // anything queued whilst we were stopping
+
+	lck_mtx_lock(g_persist.lock);
+	g_persist.thread = THREAD_NULL;
+	wakeup(&g_persist.thread);
+	lck_mtx_unlock(g_persist.lock);
+	(void) thread_terminate(current_thread());
+}
@@ -0,0 +1,57 @@
+//
+//  wormxattr_persist.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_persist_h
+#define wormxattr_persist_h
+
+
+#include "audit.h"
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_persist_queue			4096	// power of 2; inherited attributes waiting to be written
+#define k_wormxattr_persist_batch			256		// the worker is woken once this many are waiting
+#define k_wormxattr_persist_interval_ms		50		// else it flushes whatever is waiting this often
+
+
+/*
+ * Definitions
+ */
+
+struct label; // pre define
+struct mount;
+struct vnode;
+
+__private_extern__ kern_return_t wormxattr_persist_start(void);
+__private_extern__ void wormxattr_persist_stop(void);
+
+__private_extern__ int wormxattr_persist_defer(kauth_cred_t cred, struct vnode* vp, struct label* label, intptr_t value, audit_hook_t hook);
+__private_extern__ void wormxattr_persist_flush(void);
+
+
+#endif
@@ -0,0 +1,545 @@
+//
+//  wormxattr_policy.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_policy_h
+#define wormxattr_policy_h
+
+
+#include "wormxattr_value.h"
+
+
+/*
+ * Description
+ *
+ * The policy's decisions, free of any kernel interfaces; shared by the kext and the
+ * Linux daemon (tools/wormfand) so both enforce the same WORM semantics.
+ *
+ * A WORM vnode can't be opened for write (including append and truncate) or truncated
+ * unless its a directory, and its attributes can't be changed.  Nothing can be unlinked 
+ * from or renamed out of a WORM directory, and a WORM file can't be unlinked.  Files 
+ * created in, or moved into, a WORM directory inherit its state and retention.  A 
+ * vnode with a retention period is only WORM until it expires.
+ *
+ * The state is held as a label value.  Callers decide whether a check depends on the
+ * state (the guards) before fetching it; the state is the expensive part.
+ *
+ * A vnode can be in more than one class of WORM, each marked by its own attribute(s);
+ * worm (retention, inherited by new children), hold (a legal hold; never expires, so it 
+ * outlasts any retention, and isn't inherited) and scratch (the contents are immutable
+ * but the file can still be renamed, unlinked and have its attributes changed).  The 
+ * label records which classes apply.
+ *
+ * A worm attribute with the value "append" makes a vnode append only rather than WORM;
+ * tracked as a class of its own.  Its denied what WORM is except opens for write and 
+ * append (and not truncate, or read); so a log can be written to for as long as its 
+ * writer likes, with no per write check.  Setting the attribute to a WORM value (forever,
+ * or a retention which hasn't expired) finalizes it, which is the one change allowed.
+ *
+ * A worm attribute with the value "sealed" makes a directory WORM forever and seals it;
+ * tracked as a class of its own, alongside worm.  A WORM directory still accepts new 
+ * children (which inherit its state); a sealed one doesn't, so nothing can be created
+ * in, linked into or renamed into it and its listing is final.  Sealing a WORM directory
+ * is the one change its allowed; tools/wormseal then writes a sorted index of its 
+ * entries beside them (see tools/worm_dirindex.h).
+ *
+ * Which checks deny is declared once, in the rule table below; a row per operation 
+ * (and object it inspects) naming, for each class, the kinds of vnode its denied for, 
+ * whether the super user is exempt and whether denials are audited.  Each row compiles 
+ * to a constant mask with the classes denied in each case (directory or not, super user
+ * or not) so a check is a label load and an AND; adding a hooked operation is adding
+ * a row.
+ */
+
+
+/*
+ * Defines
+ */
+
+// vnode label states; labels start unknown and are resolved from the attribute on first use
+#define k_wormxattr_label_unknown	0
+#define k_wormxattr_label_mutable	1
+#define k_wormxattr_label_worm		2
+#define k_wormxattr_label_derived	3	// mutable with no attribute of its own; on derive mounts
+
+// the classes of WORM; a bit each
+#define k_wormxattr_class_worm			0x1		// retention; inherited by new children
+#define k_wormxattr_class_hold			0x2		// legal hold; never expires
+#define k_wormxattr_class_scratch		0x4		// immutable contents
+#define k_wormxattr_class_append		0x8		// append only; a worm attribute valued "append"
+#define k_wormxattr_class_sealed		0x10	// no new entries; a worm attribute valued "sealed"
+#define k_wormxattr_class_mask			0x1f
+
+#define k_wormxattr_class_inherited		(k_wormxattr_class_worm | k_wormxattr_class_append)
+
+// the class table; class(name, bit) for each class, as named in the class_names sysctl
+#define wormxattr_policy_classes(class) \
+	class(worm,		k_wormxattr_class_worm) \
+	class(hold,		k_wormxattr_class_hold) \
+	class(scratch,	k_wormxattr_class_scratch)
+
+/*
+ * a vnode label holds the state in its low bits, the classes which apply above them and,
+ * for vnodes in the worm class with a retention period, the time (seconds since the epoch)
+ * it expires above them; 0 if it never does
+ */
+#define k_wormxattr_label_state_mask		0x3
+#define k_wormxattr_label_classes_shift		2
+#define k_wormxattr_label_expires_shift		7
+
+#define wormxattr_label_state(value)		((int) ((value) & k_wormxattr_label_state_mask))
+#define wormxattr_label_classes(value)		((unsigned) ((value) >> k_wormxattr_label_classes_shift) & k_wormxattr_class_mask)
+#define wormxattr_label_expires(value)		((uint64_t) (value) >> k_wormxattr_label_expires_shift)
+#define wormxattr_label_value(classes, expires) \
+	((intptr_t) (((expires) >= k_wormxattr_retain_forever ? 0: ((expires) ? (expires): 1)) << k_wormxattr_label_expires_shift) \
+	 | ((intptr_t) (classes) << k_wormxattr_label_classes_shift) | k_wormxattr_label_worm)
+#define wormxattr_label_worm(expires)		wormxattr_label_value(k_wormxattr_class_worm, expires)
+#define k_wormxattr_label_append			wormxattr_label_value(k_wormxattr_class_append, k_wormxattr_retain_forever)
+#define k_wormxattr_label_sealed			wormxattr_label_value(k_wormxattr_class_worm | k_wormxattr_class_sealed, k_wormxattr_retain_forever)
+
+/*
+ * a derived label is mutable as of a generation of the ancestors it was derived from,
+ * held above the state; once the generation moves on its derived again
+ */
+#define wormxattr_label_derived(generation)	(((intptr_t) (generation) << k_wormxattr_label_classes_shift) | k_wormxattr_label_derived)
+#define wormxattr_label_generation(value)	((uint32_t) ((uint64_t) (value) >> k_wormxattr_label_classes_shift))
+
+// rule flags; the cases a class denies.  Vnodes not in the class are never denied by it
+#define k_wormxattr_rule_file			0x1		// anything which isn't a directory
+#define k_wormxattr_rule_dir			0x2		// directories
+#define k_wormxattr_rule_root_exempt	0x4		// the super user is allowed
+#define k_wormxattr_rule_audit			0x8		// denials are audited
+
+#define k_wormxattr_rule_any			(k_wormxattr_rule_file | k_wormxattr_rule_dir)
+
+/*
+ * the rule table; rule(name, worm, hold, scratch, append, sealed) for each check, with the
+ * flags for each class.  Checks which inspect two vnodes (e.g. unlink; the file and its 
+ * directory) have a row for each, as do opens which only append.  A hold denies what WORM
+ * does, scratch only protects the contents and append only allows appending.  Sealed is
+ * always alongside worm, so only denies what worm doesn't; new entries in the directory
+ * (create, link and rename_to).
+ */
+#define wormxattr_policy_rules(rule) \
+	rule(access_write,	k_wormxattr_rule_file, \
+						k_wormxattr_rule_file, \
+						k_wormxattr_rule_file, \
+						0, \
+						0) \
+	rule(create,		0,													/* the directory */ \
+						0, \
+						0, \
+						0, \
+						k_wormxattr_rule_dir | k_wormxattr_rule_audit) \
+	rule(deleteextattr,	k_wormxattr_rule_any | k_wormxattr_rule_root_exempt | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_root_exempt | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_root_exempt | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_root_exempt | k_wormxattr_rule_audit, \
+						0) \
+	rule(exchangedata,	k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(link,			0,													/* the directory */ \
+						0, \
+						0, \
+						0, \
+						k_wormxattr_rule_dir | k_wormxattr_rule_audit) \
+	rule(open_append,	k_wormxattr_rule_file | k_wormxattr_rule_audit,		/* write only and append */ \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						0, \
+						0) \
+	rule(open_write,	k_wormxattr_rule_file | k_wormxattr_rule_audit,		/* any other write */ \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						0) \
+	rule(rename_from,	k_wormxattr_rule_any | k_wormxattr_rule_audit,		/* the source directory */ \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(rename_to,		0,													/* the destination directory */ \
+						0, \
+						0, \
+						0, \
+						k_wormxattr_rule_dir | k_wormxattr_rule_audit) \
+	rule(setattrlist,	k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(setextattr,	k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(setflags,		k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(setmode,		k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(setowner,		k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(setutimes,		k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(truncate,		k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_file | k_wormxattr_rule_audit, \
+						0) \
+	rule(unlink,		k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0) \
+	rule(unlink_from,	k_wormxattr_rule_any | k_wormxattr_rule_audit,		/* the directory */ \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0, \
+						k_wormxattr_rule_any | k_wormxattr_rule_audit, \
+						0)
+
+// a case; the shift of its classes in a rules mask
+#define k_wormxattr_rule_case_bits				5
+#define k_wormxattr_rule_case_mask				((1u << k_wormxattr_rule_case_bits) - 1)
+#define wormxattr_rule_case(isdir, root)	(((((isdir) != 0) << 1) | ((root) != 0)) * k_wormxattr_rule_case_bits)
+
+// the cases of a rules mask for files (either caller), and for callers other than the super user
+#define k_wormxattr_rule_files \
+	((k_wormxattr_rule_case_mask << wormxattr_rule_case(0, 0)) | (k_wormxattr_rule_case_mask << wormxattr_rule_case(0, 1)))
+#define k_wormxattr_rule_users \
+	((k_wormxattr_rule_case_mask << wormxattr_rule_case(0, 0)) | (k_wormxattr_rule_case_mask << wormxattr_rule_case(1, 0)))
+
+// compiles a rows flags into its mask; bit 20 is set if its denials are audited
+#define k_wormxattr_rule_audited				0x100000
+#define wormxattr_rule_denied(flags, isdir, root) \
+	(	((flags) & ((isdir) ? k_wormxattr_rule_dir: k_wormxattr_rule_file)) \
+	 && (!(root) || !((flags) & k_wormxattr_rule_root_exempt)))
+#define wormxattr_rule_classes(worm, hold, scratch, append, sealed, isdir, root) \
+	(	(wormxattr_rule_denied(worm, isdir, root) ? k_wormxattr_class_worm: 0) \
+	 |	(wormxattr_rule_denied(hold, isdir, root) ? k_wormxattr_class_hold: 0) \
+	 |	(wormxattr_rule_denied(scratch, isdir, root) ? k_wormxattr_class_scratch: 0) \
+	 |	(wormxattr_rule_denied(append, isdir, root) ? k_wormxattr_class_append: 0) \
+	 |	(wormxattr_rule_denied(sealed, isdir, root) ? k_wormxattr_class_sealed: 0))
+#define wormxattr_rule_mask(worm, hold, scratch, append, sealed) \
+	(	(wormxattr_rule_classes(worm, hold, scratch, append, sealed, 0, 0) << wormxattr_rule_case(0, 0)) \
+	 |	(wormxattr_rule_classes(worm, hold, scratch, append, sealed, 0, 1) << wormxattr_rule_case(0, 1)) \
+	 |	(wormxattr_rule_classes(worm, hold, scratch, append, sealed, 1, 0) << wormxattr_rule_case(1, 0)) \
+	 |	(wormxattr_rule_classes(worm, hold, scratch, append, sealed, 1, 1) << wormxattr_rule_case(1, 1)) \
+	 |	((((worm) | (hold) | (scratch) | (append) | (sealed)) & k_wormxattr_rule_audit) ? k_wormxattr_rule_audited: 0))
+
+// how a file is being opened
+#define k_wormxattr_access_write		0x1
+#define k_wormxattr_access_append		0x2
+#define k_wormxattr_access_truncate		0x4
+#define k_wormxattr_access_read			0x8		// as well as writing; O_RDWR
+
+
+/*
+ * Definitions
+ */
+
+#define wormxattr_policy_rule_enum(name, worm, hold, scratch, append, sealed) \
+	k_wormxattr_rule_##name = wormxattr_rule_mask(worm, hold, scratch, append, sealed),
+
+/**
+ * @brief	each rules mask; k_wormxattr_rule_<name>
+ */
+enum {
+	wormxattr_policy_rules(wormxattr_policy_rule_enum)
+};
+
+/**
+ * @brief	the current time; supplied by the user of the policy core
+ *
+ * @return	the calendar time in seconds since the epoch
+ */
+__private_extern__ uint64_t wormxattr_policy_now(void);
+
+
+/**
+ * @brief	gets the classes of WORM in force for a label value; the worm class is dropped
+ *			once its retention has expired.  Only retention values read the clock
+ *
+ * @param	value	the label value
+ *
+ * @return	the k_wormxattr_class_* bits in force; 0 if mutable
+ */
+static inline unsigned wormxattr_policy_active(intptr_t value) {
+	unsigned retval = 0;
+	if (wormxattr_label_state(value) == k_wormxattr_label_worm) {
+		uint64_t expires = wormxattr_label_expires(value);
+		retval = wormxattr_label_classes(value);
+		if (	(retval & k_wormxattr_class_worm)
+			 && (expires != 0)
+			 && (expires <= wormxattr_policy_now())) {
+			retval &= ~k_wormxattr_class_worm; // retention has expired
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if a label value is WORM; i.e. any class of WORM is in force
+ *
+ * @param	value	the label value
+ *
+ * @return	0 if mutable; non zero for WORM
+ */
+static inline int wormxattr_policy_is_worm(intptr_t value) {
+	return wormxattr_policy_active(value) != 0;
+}
+
+
+/**
+ * @brief	gets the label value a new child of a vnode inherits; the worm class with its
+ *			retention, else append only.  Other classes aren't inherited
+ *
+ * @param	dvalue	the parents label value
+ *
+ * @return	the childs label value; k_wormxattr_label_mutable if it inherits nothing
+ */
+static inline intptr_t wormxattr_policy_inherit(intptr_t dvalue) {
+	intptr_t retval = k_wormxattr_label_mutable;
+	unsigned active = wormxattr_policy_active(dvalue);
+	if (active & k_wormxattr_class_worm) {
+		uint64_t expires = wormxattr_label_expires(dvalue);
+		uint64_t until = expires ? expires: k_wormxattr_retain_forever;
+		retval = wormxattr_label_worm(until);
+	} else if (active & k_wormxattr_class_append) {
+		retval = k_wormxattr_label_append;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if a rule depends on whether the vnode is a directory; constant for
+ *			a constant rule, so callers only ask when it does
+ *
+ * @param	rule	the rules mask
+ *
+ * @return	non zero if it does
+ */
+static inline int wormxattr_policy_uses_dir(unsigned rule) {
+	// the directory cases are the file cases, shifted
+	return ((rule >> wormxattr_rule_case(1, 0)) & k_wormxattr_rule_files) != (rule & k_wormxattr_rule_files);
+}
+
+
+/**
+ * @brief	checks if a rule depends on whether the caller is the super user; as above
+ *
+ * @param	rule	the rules mask
+ *
+ * @return	non zero if it does
+ */
+static inline int wormxattr_policy_uses_root(unsigned rule) {
+	// the super user cases are the others, shifted
+	return ((rule >> wormxattr_rule_case(0, 1)) & k_wormxattr_rule_users) != (rule & k_wormxattr_rule_users);
+}
+
+
+/**
+ * @brief	gets the classes a rule denies in a case; if none the check doesn't depend
+ *			on the vnodes state
+ *
+ * @param	rule	the rules mask
+ * @param	isdir	non zero if the vnode is a directory
+ * @param	root	non zero if the caller is the super user
+ *
+ * @return	the k_wormxattr_class_* bits the check is denied for
+ */
+static inline unsigned wormxattr_policy_guards(unsigned rule, int isdir, int root) {
+	return (rule >> wormxattr_rule_case(isdir, root)) & k_wormxattr_class_mask;
+}
+
+
+/**
+ * @brief	gets the rule for an open; opens which only append are allowed for append 
+ *			only vnodes
+ *
+ * @param	access	k_wormxattr_access_* the open requests; non zero
+ *
+ * @return	the rules mask; k_wormxattr_rule_open_append or k_wormxattr_rule_open_write
+ */
+static inline unsigned wormxattr_policy_open_rule(int access) {
+	return (access == (k_wormxattr_access_write | k_wormxattr_access_append)) ? k_wormxattr_rule_open_append: k_wormxattr_rule_open_write;
+}
+
+
+/**
+ * @brief	checks if an open depends on the vnodes state; its a write to a file
+ *
+ * @param	access	k_wormxattr_access_* the open requests
+ * @param	isdir	non zero if the vnode is a directory
+ *
+ * @return	the k_wormxattr_class_* bits the open is denied for
+ */
+static inline unsigned wormxattr_policy_guards_open(int access, int isdir) {
+	return (access != 0) ? wormxattr_policy_guards(wormxattr_policy_open_rule(access), isdir, 0): 0;
+}
+
+
+/**
+ * @brief	checks if a truncate depends on the vnodes state; its a file
+ *
+ * @param	isdir	non zero if the vnode is a directory
+ *
+ * @return	the k_wormxattr_class_* bits the truncate is denied for
+ */
+static inline unsigned wormxattr_policy_guards_truncate(int isdir) {
+	return wormxattr_policy_guards(k_wormxattr_rule_truncate, isdir, 0);
+}
+
+
+/**
+ * @brief	gets the label value of a vnode from the value of its worm attribute
+ *
+ * @param	value	the value; need not be NUL terminated
+ * @param	len		the length of value
+ *
+ * @return	the label value; wormxattr_label_worm(expires), k_wormxattr_label_append or
+ *			k_wormxattr_label_sealed
+ */
+static inline intptr_t wormxattr_policy_label(const char* value, size_t len) {
+	intptr_t retval = wormxattr_label_worm(wormxattr_value_parse(value, len));
+	if (wormxattr_value_is_append(value, len)) {
+		retval = k_wormxattr_label_append;
+	} else if (wormxattr_value_is_sealed(value, len)) {
+		retval = k_wormxattr_label_sealed;
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if a value for a worm attribute finalizes an append only vnode; i.e. 
+ *			makes it WORM forever, or until a time which hasn't passed
+ *
+ * @param	value	the value; need not be NUL terminated
+ * @param	len		the length of value; > k_wormxattr_value_max if it was too long to read
+ *
+ * @return	non zero if it does
+ */
+static inline int wormxattr_policy_finalizes(const char* value, size_t len) {
+	int retval = 1; // too long to be anything but forever
+	if (len <= k_wormxattr_value_max) {
+		uint64_t expires = wormxattr_value_parse(value, len);
+		retval =	!wormxattr_value_is_append(value, len)
+				 && (	(expires >= k_wormxattr_retain_forever)
+					 || (expires > wormxattr_policy_now()));
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if a value for a worm attribute seals a WORM directory; the one change
+ *			a directory in (only) the worm class allows
+ *
+ * @param	active	the k_wormxattr_class_* bits in force for the vnode
+ * @param	isdir	non zero if the vnode is a directory
+ * @param	value	the value; need not be NUL terminated
+ * @param	len		the length of value
+ *
+ * @return	non zero if it does
+ */
+static inline int wormxattr_policy_seals(unsigned active, int isdir, const char* value, size_t len) {
+	return	isdir
+		 && (active == k_wormxattr_class_worm)
+		 && wormxattr_value_is_sealed(value, len);
+}
+
+
+/**
+ * @brief	checks if a vnodes new label value, read back after its worm attribute was set,
+ *			is weaker than the label it replaces; a class the attribute carries no longer in
+ *			force, or a shorter retention.  Append only being finalized to WORM is the one
+ *			class which may go.  A deleted attribute (the super user may) is never weaker
+ *
+ * @param	previous	the label value before the attribute was set
+ * @param	value		the label value after
+ *
+ * @return	non zero if it is
+ */
+static inline int wormxattr_policy_weakens(intptr_t previous, intptr_t value) {
+	int retval = 0;
+	unsigned was = wormxattr_policy_active(previous) & (k_wormxattr_class_inherited | k_wormxattr_class_sealed);
+	unsigned now = wormxattr_policy_active(value);
+	if (	was
+		 && (wormxattr_label_classes(value) & k_wormxattr_class_inherited)) {
+		unsigned lost = was & ~now;
+		if (now & k_wormxattr_class_worm) {
+			lost &= ~k_wormxattr_class_append; // finalized
+		}
+		uint64_t before = wormxattr_label_expires(previous);
+		uint64_t after = wormxattr_label_expires(value);
+		retval =	lost
+				 || (	(was & now & k_wormxattr_class_worm)
+					 && ((after ? after: k_wormxattr_retain_forever) < (before ? before: k_wormxattr_retain_forever)));
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	formats the worm attribute of a label value; as a vnode inherits it from its
+ *			directory, or to put back the value a label was read from
+ *
+ * @param	buf		the buffer to format into; at least k_wormxattr_value_max bytes
+ * @param	len		the length of buf
+ * @param	value	the label value; with a k_wormxattr_class_inherited class
+ *
+ * @return	the length of the value (not NUL terminated), 0 if buf is too small
+ */
+static inline size_t wormxattr_policy_format(char* buf, size_t len, intptr_t value) {
+	size_t retval = 0;
+	if (wormxattr_label_classes(value) & k_wormxattr_class_sealed) {
+		retval = wormxattr_value_format_sealed(buf, len);
+	} else if (wormxattr_label_classes(value) & k_wormxattr_class_worm) {
+		uint64_t expires = wormxattr_label_expires(value);
+		retval = wormxattr_value_format(buf, len, expires ? expires: k_wormxattr_retain_forever);
+	} else {
+		retval = wormxattr_value_format_append(buf, len);
+	}
+	return retval;
+}
+
+
+#endif
@@ -0,0 +1,446 @@
+//
+//  wormxattr_stats.c
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <sys/systm.h>
+#include <mach/mach_types.h>
+#include <sys/malloc.h>
+#include <sys/sysctl.h>
+#include <kern/clock.h>
+#include <libkern/OSAtomic.h>
+
+#include "wormxattr_stats.h"
+
+
+/*
+ * Description
+ *
+ * Each hook counts its call (and whether it denied) as it returns; into the counters
+ * of the cpu its running on.  There's a set for every cpu the kernel can run 
+ * (ml_get_max_cpus, allocated at start) so no two cpus share one, or a cache line.  The
+ * updates aren't atomic (a locked add costs more than the hooks they count); a caller
+ * preempted mid update can lose a count made by another thread on that cpu, which is
+ * rare and fine for statistics.  Attribute reads are counted against the hook which 
+ * made them, as are the label resolutions which made them and the associations which
+ * avoided them.  Reading the clock costs more than the counting, so only one in every 
+ * k_wormxattr_stats_sample calls of a timed hook is timed; the histograms hold a 
+ * sample with the same distribution.
+ *
+ * Resetting doesn't touch the counters; it records their current sums as a baseline
+ * which is subtracted whenever they're read.  A read racing with a reset may see a 
+ * mix of the two.
+ */
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a cpu's counters; on their own cache lines
+ */
+typedef struct __wormxattr_stats_cpu_t {
+	volatile SInt64		calls[k_wormxattr_stats_hook_count] __attribute__((aligned(64)));
+	volatile SInt64		denies[k_wormxattr_stats_hook_count];
+	volatile SInt64		lookups[k_wormxattr_stats_hook_count];
+	volatile SInt64		resolves;
+	volatile SInt64		avoided;
+	volatile SInt64		latency[k_wormxattr_stats_timed_count][k_wormxattr_stats_buckets];
+} __attribute__((aligned(64))) wormxattr_stats_cpu_t;
+
+/**
+ * @brief	the stats state
+ *
+ * @field	cpus		the per cpu counters; one for each cpu number, cache line aligned
+ * @field	count		the number of cpus
+ * @field	memory		the allocation cpus is within
+ * @field	baseline	the sums when the counters were last reset
+ * @field	resetAt		mach_absolute_time of the last reset
+ */
+typedef struct __wormxattr_stats_state_t {
+	wormxattr_stats_cpu_t*	cpus;
+	unsigned int			count;
+	void*					memory;
+	wormxattr_stats_t		baseline;
+	uint64_t				resetAt;
+} wormxattr_stats_state_t;
+
+
+// static (global) instance
+static wormxattr_stats_state_t g_stats;
+
+// exported by the kernel, but not declared in the kernel framework headers
+extern int cpu_number(void);
+extern unsigned int ml_get_max_cpus(void);
+
+static int stats_sysctl_snapshot SYSCTL_HANDLER_ARGS;
+static int stats_sysctl_reset SYSCTL_HANDLER_ARGS;
+static int stats_sysctl_counter SYSCTL_HANDLER_ARGS;
+static int stats_sysctl_latency SYSCTL_HANDLER_ARGS;
+static int stats_sysctl_total SYSCTL_HANDLER_ARGS;
+
+/**
+ * @brief	the histogram of each hook, plus 1; 0 if the hook isn't timed
+ */
+#define stats_timed_slot(name)		[k_wormxattr_stats_##name] = k_wormxattr_stats_timed_##name + 1,
+static const uint8_t g_stats_timed[k_wormxattr_stats_hook_count] = {
+	wormxattr_stats_timed_hooks(stats_timed_slot)
+};
+
+// which counter a per hook sysctl reads; arg2 is (kind << 8) | hook
+#define k_stats_kind_calls			0
+#define k_stats_kind_denies			1
+#define k_stats_kind_lookups		2
+
+// which total a sysctl reads; arg2
+#define k_stats_total_resolves		0
+#define k_stats_total_avoided		1
+
+SYSCTL_DECL(_security_mac_wormxattr);
+SYSCTL_NODE(_security_mac_wormxattr, OID_AUTO, stats, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "Per hook statistics");
+SYSCTL_PROC(_security_mac_wormxattr_stats, OID_AUTO, snapshot, CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_LOCKED,
+			0, 0, stats_sysctl_snapshot, "S,wormxattr_stats", "Every counter; a wormxattr_stats_t");
+SYSCTL_PROC(_security_mac_wormxattr_stats, OID_AUTO, reset, CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED,
+			0, 0, stats_sysctl_reset, "I", "Write 1 to reset the counters");
+SYSCTL_PROC(_security_mac_wormxattr, OID_AUTO, xattr_lookups, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_LOCKED,
+			0, k_stats_total_resolves, stats_sysctl_total, "Q", "WORM attribute reads made to resolve vnode labels");
+SYSCTL_PROC(_security_mac_wormxattr, OID_AUTO, xattr_lookups_avoided, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_LOCKED,
+			0, k_stats_total_avoided, stats_sysctl_total, "Q", "Vnode associations which skipped reading the WORM attribute");
+
+// security.mac.wormxattr.stats.<hook>.{calls,denies,lookups}
+#define stats_hook_sysctl(name) \
+	SYSCTL_NODE(_security_mac_wormxattr_stats, OID_AUTO, name, CTLFLAG_RW | CTLFLAG_LOCKED, 0, #name " statistics"); \
+	SYSCTL_PROC(_security_mac_wormxattr_stats_##name, OID_AUTO, calls, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_LOCKED, \
+				0, (k_stats_kind_calls << 8) | k_wormxattr_stats_##name, stats_sysctl_counter, "Q", "Calls"); \
+	SYSCTL_PROC(_security_mac_wormxattr_stats_##name, OID_AUTO, denies, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_LOCKED, \
+				0, (k_stats_kind_denies << 8) | k_wormxattr_stats_##name, stats_sysctl_counter, "Q", "Calls denied, or failed"); \
+	SYSCTL_PROC(_security_mac_wormxattr_stats_##name, OID_AUTO, lookups, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_LOCKED, \
+				0, (k_stats_kind_lookups << 8) | k_wormxattr_stats_##name, stats_sysctl_counter, "Q", "WORM attribute reads");
+
+// security.mac.wormxattr.stats.<hook>.latency
+#define stats_timed_sysctl(name) \
+	SYSCTL_PROC(_security_mac_wormxattr_stats_##name, OID_AUTO, latency, CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_LOCKED, \
+				0, k_wormxattr_stats_timed_##name, stats_sysctl_latency, "Q", "Calls per log2 ns bucket");
+
+wormxattr_stats_hooks(stats_hook_sysctl)
+wormxattr_stats_timed_hooks(stats_timed_sysctl)
+
+#define stats_hook_oids(name) \
+	&sysctl__security_mac_wormxattr_stats_##name, \
+	&sysctl__security_mac_wormxattr_stats_##name##_calls, \
+	&sysctl__security_mac_wormxattr_stats_##name##_denies, \
+	&sysctl__security_mac_wormxattr_stats_##name##_lookups,
+#define stats_timed_oids(name) \
+	&sysctl__security_mac_wormxattr_stats_##name##_latency,
+
+/**
+ * @brief	our sysctl's; registered in order, unregistered in reverse
+ */
+static struct sysctl_oid* g_stats_sysctls[] = {
+	&sysctl__security_mac_wormxattr_stats,
+	&sysctl__security_mac_wormxattr_stats_snapshot,
+	&sysctl__security_mac_wormxattr_stats_reset,
+	&sysctl__security_mac_wormxattr_xattr_lookups,
+	&sysctl__security_mac_wormxattr_xattr_lookups_avoided,
+	wormxattr_stats_hooks(stats_hook_oids)
+	wormxattr_stats_timed_hooks(stats_timed_oids)
+};
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	allocates (zeroed) counters for every cpu and registers the sysctls
+ *
+ * @return	KERN_SUCCESS on success, else KERN_FAILURE
+ */
+__private_extern__ int wormxattr_stats_start(void) {
+	kern_return_t retval = KERN_FAILURE;
+	unsigned int count = ml_get_max_cpus();
+	
+	(void) memset(&g_stats, 0x00, sizeof(g_stats));
+	g_stats.resetAt = mach_absolute_time();
+	if (count == 0) {
+		count = 1;
+	}
+	g_stats.memory = _MALLOC(count * sizeof(wormxattr_stats_cpu_t) + 63, M_TEMP, M_WAITOK | M_ZERO);
+	if (g_stats.memory) {
+		g_stats.cpus = (wormxattr_stats_cpu_t*) (((uintptr_t) g_stats.memory + 63) & ~(uintptr_t) 63);
+		g_stats.count = count;
+		for (int i = 0; i < (int) (sizeof(g_stats_sysctls)/sizeof(g_stats_sysctls[0])); i++) {
+			sysctl_register_oid(g_stats_sysctls[i]);
+		}
+		retval = KERN_SUCCESS;
+	}
+	return retval;
+}
+
+
+__private_extern__ void wormxattr_stats_stop(void) {
+	if (g_stats.memory) {
+		for (int i = (int) (sizeof(g_stats_sysctls)/sizeof(g_stats_sysctls[0])) - 1; i >= 0; i--) {
+			sysctl_unregister_oid(g_stats_sysctls[i]);
+		}
+		_FREE(g_stats.memory, M_TEMP);
+		g_stats.memory = NULL;
+		g_stats.cpus = NULL;
+		g_stats.count = 0;
+	}
+}
+
+
+/**
+ * @brief	the counters of the cpu we're running on; cpu numbers are always below 
+ *			ml_get_max_cpus, so no other cpu uses them
+ */
+static inline wormxattr_stats_cpu_t* stats_cpu(void) {
+	return &g_stats.cpus[cpu_number()];
+}
+
+
+/**
+ * @brief	counts a call of a hook
+ *
+ * @param	hook	the hook
+ * @param	error	the hooks result; non zero if it denied (or failed)
+ */
+__private_extern__ void wormxattr_stats_count(wormxattr_stats_hook_t hook, int error) {
+	wormxattr_stats_cpu_t* cpu = stats_cpu();
+	cpu->calls[hook]++;
+	if (error) {
+		cpu->denies[hook]++;
+	}
+}
+
+
+/**
+ * @brief	reads the clock as a timed hook is called; if this call is to be sampled
+ *
+ * @param	hook	the hook
+ *
+ * @return	mach_absolute_time, else 0 if the call isn't sampled
+ */
+__private_extern__ uint64_t wormxattr_stats_clock(wormxattr_stats_hook_t hook) {
+	wormxattr_stats_cpu_t* cpu = stats_cpu();
+	uint64_t retval = 0;
+	
+	if ((cpu->calls[hook] & (k_wormxattr_stats_sample - 1)) == 0) {
+		retval = mach_absolute_time();
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	counts a call of a timed hook; recording its latency if it was sampled
+ *
+ * @param	hook	the hook
+ * @param	start	wormxattr_stats_clock when the hook was called
+ * @param	error	the hooks result; non zero if it denied (or failed)
+ */
+__private_extern__ void wormxattr_stats_latency(wormxattr_stats_hook_t hook, uint64_t start, int error) {
+	wormxattr_stats_cpu_t* cpu = stats_cpu();
+	uint64_t ns = 0;
+	int bucket = 0;
+	
+	cpu->calls[hook]++;
+	if (error) {
+		cpu->denies[hook]++;
+	}
+	if (	start != 0
+		 && g_stats_timed[hook]) {
+		absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+		if (ns > 0) {
+			bucket = 63 - __builtin_clzll(ns);
+			if (bucket >= k_wormxattr_stats_buckets) {
+				bucket = k_wormxattr_stats_buckets - 1;
+			}
+		}
+		cpu->latency[g_stats_timed[hook] - 1][bucket]++;
+	}
+}
+
+
+/**
+ * @brief	counts a WORM attribute read made by a hook
+ */
+__private_extern__ void wormxattr_stats_lookup(wormxattr_stats_hook_t hook) {
+	wormxattr_stats_cpu_t* cpu = stats_cpu();
+	cpu->lookups[hook]++;
+}
+
+
+/**
+ * @brief	counts a vnode label resolved by reading its WORM attributes
+ */
+__private_extern__ void wormxattr_stats_resolve(void) {
+	wormxattr_stats_cpu_t* cpu = stats_cpu();
+	cpu->resolves++;
+}
+
+
+/**
+ * @brief	counts a vnode association which didn't need to read the WORM attributes
+ */
+__private_extern__ void wormxattr_stats_avoided(void) {
+	wormxattr_stats_cpu_t* cpu = stats_cpu();
+	cpu->avoided++;
+}
+
+
+/**
+ * @brief	sums the counters of every cpu
+ */
+static void stats_sum(wormxattr_stats_t* stats) {
+	(void) memset(stats, 0x00, sizeof(*stats));
+	stats->version = k_wormxattr_stats_version;
+	stats->hooks = k_wormxattr_stats_hook_count;
+	stats->timed = k_wormxattr_stats_timed_count;
+	stats->buckets = k_wormxattr_stats_buckets;
+	for (unsigned int c = 0; c < g_stats.count; c++) {
+		wormxattr_stats_cpu_t* cpu = &g_stats.cpus[c];
+		for (int h = 0; h < k_wormxattr_stats_hook_count; h++) {
+			stats->calls[h] += (uint64_t) cpu->calls[h];
+			stats->denies[h] += (uint64_t) cpu->denies[h];
+			stats->lookups[h] += (uint64_t) cpu->lookups[h];
+		}
+		stats->resolves += (uint64_t) cpu->resolves;
+		stats->avoided += (uint64_t) cpu->avoided;
+		for (int t = 0; t < k_wormxattr_stats_timed_count; t++) {
+			for (int b = 0; b < k_wormxattr_stats_buckets; b++) {
+				stats->latency[t][b] += (uint64_t) cpu->latency[t][b];
+			}
+		}
+	}
+}
+
+
+/**
+ * @brief	reads the counters; since they were last reset
+ *
+ * @param	stats	filled in with the counters
+ */
+__private_extern__ void wormxattr_stats_snapshot(wormxattr_stats_t* stats) {
+	stats_sum(stats);
+	absolutetime_to_nanoseconds(mach_absolute_time() - g_stats.resetAt, &stats->elapsed);
+	for (int h = 0; h < k_wormxattr_stats_hook_count; h++) {
+		stats->calls[h] -= g_stats.baseline.calls[h];
+		stats->denies[h] -= g_stats.baseline.denies[h];
+		stats->lookups[h] -= g_stats.baseline.lookups[h];
+	}
+	stats->resolves -= g_stats.baseline.resolves;
+	stats->avoided -= g_stats.baseline.avoided;
+	for (int t = 0; t < k_wormxattr_stats_timed_count; t++) {
+		for (int b = 0; b < k_wormxattr_stats_buckets; b++) {
+			stats->latency[t][b] -= g_stats.baseline.latency[t][b];
+		}
+	}
+}
+
+
+/**
+ * @brief	resets the counters; subsequent reads count from now
+ */
+__private_extern__ void wormxattr_stats_reset(void) {
+	stats_sum(&g_stats.baseline);
+	g_stats.resetAt = mach_absolute_time();
+}
+
+
+/**
+ * @brief	sysctl handler for snapshot
+ */
+static int stats_sysctl_snapshot SYSCTL_HANDLER_ARGS {
+	wormxattr_stats_t stats;
+	wormxattr_stats_snapshot(&stats);
+	return SYSCTL_OUT(req, &stats, sizeof(stats));
+}
+
+
+/**
+ * @brief	sysctl handler for reset; reads as 0, writing non zero resets
+ */
+static int stats_sysctl_reset SYSCTL_HANDLER_ARGS {
+	int value = 0;
+	int retval = sysctl_handle_int(oidp, &value, 0, req);
+	if (	(retval == 0)
+		 && req->newptr
+		 && value) {
+		wormxattr_stats_reset();
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	sysctl handler for a hook's counters; arg2 selects the counter
+ */
+static int stats_sysctl_counter SYSCTL_HANDLER_ARGS {
+	wormxattr_stats_t stats;
+	uint64_t value = 0;
+	int hook = arg2 & 0xff;
+	
+	wormxattr_stats_snapshot(&stats);
+	switch (arg2 >> 8) {
+		case k_stats_kind_calls:
+			value = stats.calls[hook];
+			break;
+		case k_stats_kind_denies:
+			value = stats.denies[hook];
+			break;
+		default:
+			value = stats.lookups[hook];
+			break;
+	}
+	return SYSCTL_OUT(req, &value, sizeof(value));
+}
+
+
+/**
+ * @brief	sysctl handler for a timed hook's latency histogram; arg2 selects the hook
+ */
+static int stats_sysctl_latency SYSCTL_HANDLER_ARGS {
+	wormxattr_stats_t stats;
+	wormxattr_stats_snapshot(&stats);
+	return SYSCTL_OUT(req, stats.latency[arg2], sizeof(stats.latency[arg2]));
+}
+
+
+/**
+ * @brief	sysctl handler for a total not kept per hook; arg2 selects the total
+ */
+static int stats_sysctl_total SYSCTL_HANDLER_ARGS {
+	wormxattr_stats_t stats;
+	uint64_t value = 0;
+	
+	wormxattr_stats_snapshot(&stats);
+	if (arg2 == k_stats_total_resolves) {
+		value = stats.resolves;
+	} else {
+		value = stats.avoided;
+	}
+	return SYSCTL_OUT(req, &value, sizeof(value));
+}
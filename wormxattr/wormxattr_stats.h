@@ -0,0 +1,151 @@
+//
+//  wormxattr_stats.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_stats_h
+#define wormxattr_stats_h
+
+
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * Per hook counters of calls, denials (or for the notify hooks, failures to inherit)
+ * and WORM attribute reads, and latency histograms for the hooks on the vnode creation
+ * paths.  They're kept per cpu and summed when read; security.mac.wormxattr.stats.
+ * This header is shared with the userspace reader (tools/wormstat).
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_stats_version		3
+#define k_wormxattr_stats_buckets		32		// bucket n counts calls taking [2^n, 2^(n+1)) ns; 0 also < 1ns
+#define k_wormxattr_stats_sample		16		// power of 2; one in this many calls of a timed hook is timed
+
+/**
+ * @brief	every hook the policy registers; expands hook(name) for each
+ */
+#define wormxattr_stats_hooks(hook) \
+	hook(check_access) \
+	hook(check_create) \
+	hook(check_deleteextattr) \
+	hook(check_exchangedata) \
+	hook(check_link) \
+	hook(check_open) \
+	hook(check_rename_from) \
+	hook(check_rename_to) \
+	hook(check_setattrlist) \
+	hook(check_setextattr) \
+	hook(check_setflags) \
+	hook(check_setmode) \
+	hook(check_setowner) \
+	hook(check_setutimes) \
+	hook(check_truncate) \
+	hook(check_unlink) \
+	hook(label_associate_extattr) \
+	hook(label_copy) \
+	hook(label_destroy) \
+	hook(label_recycle) \
+	hook(label_update_extattr) \
+	hook(notify_create) \
+	hook(notify_rename)
+
+/**
+ * @brief	the hooks whose latency is recorded; expands hook(name) for each
+ */
+#define wormxattr_stats_timed_hooks(hook) \
+	hook(label_associate_extattr) \
+	hook(notify_create)
+
+
+/*
+ * Definitions
+ */
+
+#define wormxattr_stats_hook_enum(name)		k_wormxattr_stats_##name,
+#define wormxattr_stats_timed_enum(name)	k_wormxattr_stats_timed_##name,
+
+typedef enum {
+	wormxattr_stats_hooks(wormxattr_stats_hook_enum)
+	k_wormxattr_stats_hook_count
+} wormxattr_stats_hook_t;
+
+typedef enum {
+	wormxattr_stats_timed_hooks(wormxattr_stats_timed_enum)
+	k_wormxattr_stats_timed_count
+} wormxattr_stats_timed_t;
+
+/**
+ * @brief	the counters summed over every cpu; security.mac.wormxattr.stats.snapshot
+ *
+ * @field	version		k_wormxattr_stats_version
+ * @field	hooks		k_wormxattr_stats_hook_count
+ * @field	timed		k_wormxattr_stats_timed_count
+ * @field	buckets		k_wormxattr_stats_buckets
+ * @field	elapsed		ns since the counters were (re)set
+ * @field	calls		calls of each hook
+ * @field	denies		calls of each hook which were denied (or failed)
+ * @field	lookups		WORM attribute reads made by each hook
+ * @field	resolves	vnode labels resolved by reading the WORM attributes
+ * @field	avoided		vnode associations which skipped reading them; the mount was WORM free or ignored
+ * @field	latency		the latency histogram of each timed hook; of a sample of its calls
+ */
+typedef struct __wormxattr_stats_t {
+	uint32_t	version;
+	uint32_t	hooks;
+	uint32_t	timed;
+	uint32_t	buckets;
+	uint64_t	elapsed;
+	uint64_t	calls[k_wormxattr_stats_hook_count];
+	uint64_t	denies[k_wormxattr_stats_hook_count];
+	uint64_t	lookups[k_wormxattr_stats_hook_count];
+	uint64_t	resolves;
+	uint64_t	avoided;
+	uint64_t	latency[k_wormxattr_stats_timed_count][k_wormxattr_stats_buckets];
+} wormxattr_stats_t;
+
+// a keyword for Apple's compilers; the reader is also built elsewhere
+#if !defined(__APPLE__) && !defined(__private_extern__)
+#define __private_extern__				extern __attribute__((visibility("hidden")))
+#endif
+
+__private_extern__ int wormxattr_stats_start(void);			// a kern_return_t; the reader has no mach headers
+__private_extern__ void wormxattr_stats_stop(void);
+
+__private_extern__ void wormxattr_stats_count(wormxattr_stats_hook_t hook, int error);
+__private_extern__ uint64_t wormxattr_stats_clock(wormxattr_stats_hook_t hook);
+__private_extern__ void wormxattr_stats_latency(wormxattr_stats_hook_t hook, uint64_t start, int error);
+__private_extern__ void wormxattr_stats_lookup(wormxattr_stats_hook_t hook);
+__private_extern__ void wormxattr_stats_resolve(void);
+__private_extern__ void wormxattr_stats_avoided(void);
+__private_extern__ void wormxattr_stats_snapshot(wormxattr_stats_t* stats);
+__private_extern__ void wormxattr_stats_reset(void);
+
+
+#endif
@@ -0,0 +1,197 @@
+//
+//  wormxattr_value.c
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "wormxattr_value.h"
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	parses the value of our attribute
+ *
+ * @param	value	the attribute value; need not be NUL terminated
+ * @param	len		the length of value
+ *
+ * @return	the time (seconds since the epoch) the vnode is WORM until; 
+ *			k_wormxattr_retain_forever if it doesn't expire
+ */
+__private_extern__ uint64_t wormxattr_value_parse(const char* value, size_t len) {
+	uint64_t retval = k_wormxattr_retain_forever;
+	size_t prefix = sizeof(k_wormxattr_value_retain) - 1;
+	size_t i = 0;
+	
+	// match the prefix
+	while ((i < prefix) && (i < len) && (value[i] == k_wormxattr_value_retain[i])) {
+		i++;
+	}
+	if ((i == prefix) && (i < len)) {
+		uint64_t expires = 0;
+		while ((i < len) && (value[i] >= '0') && (value[i] <= '9')) {
+			expires = (expires * 10) + (uint64_t) (value[i] - '0');
+			if (expires >= k_wormxattr_retain_forever) {
+				break; // overflow; its forever
+			}
+			i++;
+		}
+		// must be all digits, optionally NUL or newline terminated (as written by xattr -w)
+		if (	(expires < k_wormxattr_retain_forever)
+			 && (	(i == len)
+				 || (value[i] == '\0')
+				 || (value[i] == '\n'))) {
+			retval = expires;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	formats the value of our attribute
+ *
+ * @param	buf		the buffer to format into; at least k_wormxattr_value_max bytes
+ * @param	len		the length of buf
+ * @param	expires	the time (seconds since the epoch) the vnode is WORM until;
+ *					k_wormxattr_retain_forever if it doesn't expire
+ *
+ * @return	the length of the value (not NUL terminated), 0 if buf is too small
+ */
+__private_extern__ size_t wormxattr_value_format(char* buf, size_t len, uint64_t expires) {
+	size_t retval = 0;
+	if (len >= k_wormxattr_value_max) {
+		if (expires >= k_wormxattr_retain_forever) {
+			buf[retval++] = 1; // the traditional single byte
+		} else {
+			char digits[20];
+			size_t count = 0;
+			for (const char* it = k_wormxattr_value_retain; *it; it++) {
+				buf[retval++] = *it;
+			}
+			do {
+				digits[count++] = (char) ('0' + (expires % 10));
+				expires /= 10;
+			} while (expires);
+			while (count) {
+				buf[retval++] = digits[--count];
+			}
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if a value of our attribute is a keyword
+ *
+ * @param	value	the attribute value; need not be NUL terminated
+ * @param	len		the length of value
+ * @param	keyword	the keyword; NUL terminated
+ *
+ * @return	non zero if its keyword; optionally NUL or newline terminated
+ */
+static int value_is_keyword(const char* value, size_t len, const char* keyword) {
+	size_t i = 0;
+	
+	while ((i < len) && keyword[i] && (value[i] == keyword[i])) {
+		i++;
+	}
+	return	(keyword[i] == '\0')
+		 && (	(i == len)
+			 || (	(i + 1 == len)
+				 && ((value[i] == '\0') || (value[i] == '\n'))));
+}
+
+
+/**
+ * @brief	checks if a value of our attribute marks the vnode append only
+ *
+ * @param	value	the attribute value; need not be NUL terminated
+ * @param	len		the length of value
+ *
+ * @return	non zero if its k_wormxattr_value_append; optionally NUL or newline terminated
+ */
+__private_extern__ int wormxattr_value_is_append(const char* value, size_t len) {
+	return value_is_keyword(value, len, k_wormxattr_value_append);
+}
+
+
+/**
+ * @brief	checks if a value of our attribute seals a directory
+ *
+ * @param	value	the attribute value; need not be NUL terminated
+ * @param	len		the length of value
+ *
+ * @return	non zero if its k_wormxattr_value_sealed; optionally NUL or newline terminated
+ */
+__private_extern__ int wormxattr_value_is_sealed(const char* value, size_t len) {
+	return value_is_keyword(value, len, k_wormxattr_value_sealed);
+}
+
+
+/**
+ * @brief	formats a keyword value of our attribute
+ *
+ * @param	buf		the buffer to format into; at least k_wormxattr_value_max bytes
+ * @param	len		the length of buf
+ * @param	keyword	the keyword; NUL terminated
+ *
+ * @return	the length of the value (not NUL terminated), 0 if buf is too small
+ */
+static size_t value_format_keyword(char* buf, size_t len, const char* keyword) {
+	size_t retval = 0;
+	if (len >= k_wormxattr_value_max) {
+		for (const char* it = keyword; *it; it++) {
+			buf[retval++] = *it;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	formats the append only value of our attribute
+ *
+ * @param	buf		the buffer to format into; at least k_wormxattr_value_max bytes
+ * @param	len		the length of buf
+ *
+ * @return	the length of the value (not NUL terminated), 0 if buf is too small
+ */
+__private_extern__ size_t wormxattr_value_format_append(char* buf, size_t len) {
+	return value_format_keyword(buf, len, k_wormxattr_value_append);
+}
+
+
+/**
+ * @brief	formats the sealed value of our attribute
+ *
+ * @param	buf		the buffer to format into; at least k_wormxattr_value_max bytes
+ * @param	len		the length of buf
+ *
+ * @return	the length of the value (not NUL terminated), 0 if buf is too small
+ */
+__private_extern__ size_t wormxattr_value_format_sealed(char* buf, size_t len) {
+	return value_format_keyword(buf, len, k_wormxattr_value_sealed);
+}
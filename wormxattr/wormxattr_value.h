@@ -0,0 +1,75 @@
+//
+//  wormxattr_value.h
+//  wormxattr
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_value_h
+#define wormxattr_value_h
+
+
+/*
+ * Description
+ *
+ * The value of our attribute; shared by the policy and the userspace tools.
+ *
+ * Any value marks a vnode WORM.  A value of the form "retain=<seconds since the epoch>"
+ * marks it WORM until that time, after which it is mutable again; anything else 
+ * (traditionally a single byte) marks it WORM forever.  The value "append" marks it 
+ * append only and the value "sealed" marks a directory WORM forever with its entries
+ * fixed; see wormxattr_policy.h.
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+// a keyword for Apple's compilers; the tools are also built elsewhere
+#if !defined(__APPLE__) && !defined(__private_extern__)
+#define __private_extern__				extern __attribute__((visibility("hidden")))
+#endif
+
+
+/*
+ * Defines
+ */
+
+#define k_wormxattr_value_max			32						// the longest value we read
+#define k_wormxattr_value_retain		"retain="
+#define k_wormxattr_value_append		"append"
+#define k_wormxattr_value_sealed		"sealed"
+#define k_wormxattr_retain_forever		0x00ffffffffffffffull	// fits in a label beside the state and classes
+
+
+/*
+ * Definitions
+ */
+
+__private_extern__ uint64_t wormxattr_value_parse(const char* value, size_t len);
+__private_extern__ size_t wormxattr_value_format(char* buf, size_t len, uint64_t expires);
+__private_extern__ int wormxattr_value_is_append(const char* value, size_t len);
+__private_extern__ size_t wormxattr_value_format_append(char* buf, size_t len);
+__private_extern__ int wormxattr_value_is_sealed(const char* value, size_t len);
+__private_extern__ size_t wormxattr_value_format_sealed(char* buf, size_t len);
+
+
+#endif
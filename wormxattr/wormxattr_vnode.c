@@ -27,9 +27,17 @@
 #include <mach/mach_types.h>
 #include <sys/unistd.h>
 #include <sys/fcntl.h>
+#include <sys/uio.h>
+#include <kern/clock.h>
+#include <libkern/OSAtomic.h>
 
 #include "wormxattr.h"
 #include "wormxattr_vnode.h"
+#include "wormxattr_class.h"
+#include "wormxattr_derive.h"
+#include "wormxattr_mount.h"
+#include "wormxattr_persist.h"
+#include "wormxattr_stats.h"
 #include "dbg.h"
 #include "audit.h"
 
@@ -48,14 +56,34 @@ struct sockopt;
  * Definitions
  */
 
-static inline int get_worm_xattr(struct vnode* vp);
+static inline intptr_t get_worm_xattr(struct vnode* vp, wormxattr_stats_hook_t hook);
+static inline intptr_t get_label_value(struct vnode* vp, struct label* label, wormxattr_stats_hook_t hook);
+static inline unsigned get_classes(struct vnode* vp, struct label* label, wormxattr_stats_hook_t hook);
+static intptr_t resolve_label(struct vnode* vp, struct label* label, wormxattr_stats_hook_t hook);
+static intptr_t derive_worm_xattr(struct vnode* vp, intptr_t previous, wormxattr_stats_hook_t hook);
+static intptr_t derive_parent(struct vnode* vp, uint32_t generation, wormxattr_stats_hook_t hook);
+static inline intptr_t derive_label(intptr_t dvalue, uint32_t generation);
+static inline int rule_denies(kauth_cred_t cred, struct vnode* vp, struct label* label, unsigned rule, wormxattr_stats_hook_t hook);
+static inline int check_rule(kauth_cred_t cred, struct vnode* vp, struct label* label, unsigned rule, 
+							 wormxattr_stats_hook_t hook, audit_hook_t audit, uint64_t arg);
+static int inherit_worm(kauth_cred_t cred, struct vnode* vp, struct label* label, intptr_t dvalue, audit_hook_t hook);
+static int finalizes(struct vnode* vp, struct label* label, struct uio* uio);
+
+/*
+ * bumped whenever update_extattr sets a label; resolve_label uses it to detect that it
+ * raced with an update, and so may have overwritten a newer state with a stale one
+ */
+static volatile SInt32 g_wormxattr_label_generation = 0;
 
 // mac vnode hooks
 static mpo_vnode_check_access_t				vnode_check_access;
+static mpo_vnode_check_create_t				vnode_check_create;
 static mpo_vnode_check_deleteextattr_t		vnode_check_deleteextattr;
 static mpo_vnode_check_exchangedata_t		vnode_check_exchangedata;
+static mpo_vnode_check_link_t				vnode_check_link;
 static mpo_vnode_check_open_t				vnode_check_open;
 static mpo_vnode_check_rename_from_t		vnode_check_rename_from;
+static mpo_vnode_check_rename_to_t			vnode_check_rename_to;
 static mpo_vnode_check_select_t				vnode_check_select;
 static mpo_vnode_check_setattrlist_t		vnode_check_setattrlist;
 static mpo_vnode_check_setextattr_t			vnode_check_setextattr;
@@ -87,11 +115,14 @@ static mpo_vnode_notify_rename_t			vnode_notify_rename;
 __private_extern__ void wormxattr_vnode_initialize(struct mac_policy_ops* ops) {
 	if (ops) {
 		ops->mpo_vnode_check_access				= vnode_check_access;
+		ops->mpo_vnode_check_create				= vnode_check_create;
 		ops->mpo_vnode_check_deleteextattr		= vnode_check_deleteextattr;
 		ops->mpo_vnode_check_exchangedata		= vnode_check_exchangedata;
 		// we're not hooking ioctl as we'd get into a world of vnode specific hurt
+		ops->mpo_vnode_check_link				= vnode_check_link;
 		ops->mpo_vnode_check_open				= vnode_check_open;
 		ops->mpo_vnode_check_rename_from		= vnode_check_rename_from;
+		ops->mpo_vnode_check_rename_to			= vnode_check_rename_to;
 		ops->mpo_vnode_check_setattrlist		= vnode_check_setattrlist;
 		ops->mpo_vnode_check_setextattr			= vnode_check_setextattr;
 		ops->mpo_vnode_check_setflags			= vnode_check_setflags;
@@ -124,25 +155,407 @@ __private_extern__ void wormxattr_vnode_initialize(struct mac_policy_ops* ops) {
 
 
 /**
- * @brief	checks if the vnode has our extended attribute set
- *			Note: if an error occurs and we are unable to retrieve the xattr
- *			this call will return zero (mutable).  This is due to this functions 
+ * @brief	checks which of the watched extended attributes (see wormxattr_class.c) the 
+ *			vnode has, and parses the retention of those in the worm class; the latest 
+ *			retention wins.  Note: if an error occurs and we are unable to retrieve an 
+ *			xattr this call will treat it as absent.  This is due to this functions 
  *			intended usage; in which an error is not a viable return
  *				
  * @param	vnode		the vnode to evaluate
+ * @param	hook		the hook reading it; for the statistics
+ *
+ * @return	the label value; k_wormxattr_label_mutable or wormxattr_label_value(classes, expires)
+ */
+static inline intptr_t get_worm_xattr(struct vnode* vp, wormxattr_stats_hook_t hook) {
+	intptr_t retval = k_wormxattr_label_mutable;
+	const wormxattr_class_name_t* names = NULL;
+	uint32_t count = wormxattr_class_watched(&names);
+	unsigned classes = 0;
+	uint64_t expires = 0;
+	
+	wormxattr_stats_resolve();
+	for (uint32_t i = 0; i < count; i++) {
+		char value[k_wormxattr_value_max] = {0};
+		size_t attrlen = 0;
+		wormxattr_stats_lookup(hook);
+		int ret = mac_vnop_getxattr(vp, names[i].name, value, sizeof(value), &attrlen);
+		if (	(ret == KERN_SUCCESS)
+			 || (ret == ERANGE)) {
+			// we dont care that the attribute is to large ... its there (and can't be a retention)
+			uint64_t until = (ret == KERN_SUCCESS) ? wormxattr_value_parse(value, attrlen): k_wormxattr_retain_forever;
+			if (	(names[i].classes & k_wormxattr_class_worm)
+				 && (ret == KERN_SUCCESS)
+				 && wormxattr_value_is_append(value, attrlen)) {
+				classes |= k_wormxattr_class_append; // append only, until finalized
+			} else {
+				if (	(names[i].classes & k_wormxattr_class_worm)
+					 && (until > expires)) {
+					expires = until;
+				}
+				classes |= names[i].classes;
+				if (	(names[i].classes & k_wormxattr_class_worm)
+					 && (ret == KERN_SUCCESS)
+					 && wormxattr_value_is_sealed(value, attrlen)) {
+					classes |= k_wormxattr_class_sealed; // forever, with no new entries
+				}
+			}
+		}
+	}
+	if (classes) {
+		retval = wormxattr_label_value(classes, expires);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets a vnodes label value; resolving (and caching) it from the extended 
+ *			attribute if this is the first time its been needed, or if its derived
+ *			state is stale
+ *
+ * @param	vp		the vnode to evaluate
+ * @param	label	the vnodes label; may be NULL
+ * @param	hook	the hook evaluating it; for the statistics
+ *
+ * @return	the label value; never k_wormxattr_label_unknown
+ */
+static inline intptr_t get_label_value(struct vnode* vp, struct label* label, wormxattr_stats_hook_t hook) {
+	intptr_t retval = wormxattr_get_label(label);
+	int state = wormxattr_label_state(retval);
+	if (	(state == k_wormxattr_label_unknown)
+		 || (	(state == k_wormxattr_label_derived)
+			 && (wormxattr_label_generation(retval) != wormxattr_derive_generation()))) {
+		retval = resolve_label(vp, label, hook);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	the calendar time; for the policy core to judge retention by
+ *
+ * @return	seconds since the epoch
+ */
+__private_extern__ uint64_t wormxattr_policy_now(void) {
+	clock_sec_t secs = 0;
+	clock_usec_t microsecs = 0;
+	clock_get_calendar_microtime(&secs, &microsecs);
+	return (uint64_t) secs;
+}
+
+
+/**
+ * @brief	gets the classes of WORM in force for a vnode
+ *
+ * @param	vp		the vnode to evaluate
+ * @param	label	the vnodes label; may be NULL
+ * @param	hook	the hook evaluating it; for the statistics
+ *
+ * @return	the k_wormxattr_class_* bits in force; 0 if mutable
+ */
+static inline unsigned get_classes(struct vnode* vp, struct label* label, wormxattr_stats_hook_t hook) {
+	return wormxattr_policy_active(get_label_value(vp, label, hook));
+}
+
+
+/**
+ * @brief	resolves the WORM state of a vnode from its extended attributes and 
+ *			caches it in the label.
+ *
+ *			Vnodes created before labeling was enabled (see policy_init) have a NULL 
+ *			label; they are resolved every time, as there is nowhere to cache the state.
+ *			Vnodes on ignored mounts can reach here unknown (e.g. new ones, or those of a
+ *			single label file system); they're mutable without reading anything
+ *
+ * @param	vp		the vnode to evaluate
+ * @param	label	the vnodes label; may be NULL
+ * @param	hook	the hook evaluating it; for the statistics
+ *
+ * @return	the label value; k_wormxattr_label_mutable or wormxattr_label_value(classes, expires)
+ */
+static intptr_t resolve_label(struct vnode* vp, struct label* label, wormxattr_stats_hook_t hook) {
+	intptr_t retval = k_wormxattr_label_mutable;
+	wormxattr_mount_mode_t mode = k_wormxattr_mount_enforce;
+	if (	(label == NULL)
+		 || wormxattr_mount_derives()
+		 || wormxattr_mount_ignores()) {
+		mode = wormxattr_mount_mode_of(vnode_mount(vp)); // lock free; but only if it matters
+	}
+	if (mode == k_wormxattr_mount_ignore) {
+		// never evaluated; cached, so its only asked once
+		if (label) {
+			wormxattr_set_label(label, retval);
+		}
+	} else if (label == NULL) {
+		if (mode == k_wormxattr_mount_derive) {
+			retval = derive_worm_xattr(vp, k_wormxattr_label_unknown, hook);
+		} else {
+			retval = get_worm_xattr(vp, hook);
+		}
+	} else {
+		/*
+		 * update_extattr may change the attribute (and set the label) between us 
+		 * reading the attribute and caching the result; in which case we might have 
+		 * overwritten its state with our stale one.  It bumps the generation before 
+		 * setting the label so if the generation is unchanged after we've cached the
+		 * state, any update will set the label after us; else we go round again
+		 */
+		SInt32 generation = 0;
+		do {
+			generation = g_wormxattr_label_generation;
+			OSMemoryBarrier();
+			if (mode == k_wormxattr_mount_derive) {
+				retval = derive_worm_xattr(vp, wormxattr_get_label(label), hook);
+			} else {
+				retval = get_worm_xattr(vp, hook);
+			}
+			wormxattr_set_label(label, retval);
+			OSMemoryBarrier();
+		} while (generation != g_wormxattr_label_generation);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	makes a vnode WORM as its parent is; writing the parents retention (if any)
+ *			into its attribute, or queueing it to be written.  Only the worm class (or 
+ *			append only) is inherited
  *
- * @return	0 if mutable; non zero for WORM
+ * @param	cred	the credential of the caller
+ * @param	vp		the vnode inheriting the attribute
+ * @param	label	the vnodes label
+ * @param	dvalue	the parents label value
+ * @param	hook	the hook inheriting the attribute; used to audit failures
+ *
+ * @return	0 on success, else the error from writing the attribute
+ */
+static int inherit_worm(kauth_cred_t cred, struct vnode* vp, struct label* label, intptr_t dvalue, audit_hook_t hook) {
+	int retval = 0;
+	intptr_t value = wormxattr_policy_inherit(dvalue); // the parents retention; no hold or scratch
+	if (wormxattr_persist_defer(cred, vp, label, value, hook)) {
+		// label is set; the attribute will be written by the persist worker
+	} else {
+		char buf[k_wormxattr_value_max];
+		size_t len = wormxattr_policy_format(buf, sizeof(buf), value);
+		retval = mac_vnop_setxattr(vp, k_wormxattr_xattr, buf, len);
+		if (retval == KERN_SUCCESS) {
+			// success - set WORM in label
+			wormxattr_set_label(label, value);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets the label value of a vnode on a derive mount; from its own attributes, 
+ *			else as its nearest ancestor with one would give a new child.  Classes which
+ *			aren't inherited (a hold or scratch) are merged with what it derives
+ *
+ * @param	vp			the vnode to evaluate
+ * @param	previous	its label value; if derived its known to have no attributes of 
+ *						its own, so they aren't read again
+ * @param	hook		the hook evaluating it; for the statistics
+ *
+ * @return	the label value; wormxattr_label_value(classes, expires) or wormxattr_label_derived
  */
-static inline int get_worm_xattr(struct vnode* vp) {
-	int retval = 0; // mutable
+static intptr_t derive_worm_xattr(struct vnode* vp, intptr_t previous, wormxattr_stats_hook_t hook) {
+	uint32_t generation = wormxattr_derive_generation(); // before anything is read
+	intptr_t retval = previous;
+	if (wormxattr_label_state(previous) != k_wormxattr_label_derived) {
+		retval = get_worm_xattr(vp, hook);
+	}
+	if (wormxattr_label_state(retval) != k_wormxattr_label_worm) {
+		retval = derive_label(derive_parent(vp, generation, hook), generation);
+	} else if ((wormxattr_label_classes(retval) & k_wormxattr_class_inherited) == 0) {
+		// its own classes say nothing about retention; its ancestors still might
+		intptr_t derived = derive_label(derive_parent(vp, generation, hook), generation);
+		if (wormxattr_label_state(derived) == k_wormxattr_label_worm) {
+			uint64_t expires = wormxattr_label_expires(derived);
+			uint64_t until = expires ? expires: k_wormxattr_retain_forever;
+			retval = wormxattr_label_value(wormxattr_label_classes(retval) | wormxattr_label_classes(derived), until);
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	derives the label value of a vnodes parent directory; its own if it has an 
+ *			attribute with a class its children inherit, else what it derives from its 
+ *			parent and so on up to the root.  A hold or scratch isn't inherited, so doesn't
+ *			stop the walk.  The walk stops at the first directory cached in generation;
+ *			every directory walked is cached.  If a parent (short of the root) can't be
+ *			found, what it would give can't be known; its taken as WORM, and not cached
+ *
+ * @param	vp			the vnode whose parent to derive
+ * @param	generation	the generation to derive in
+ * @param	hook		the hook evaluating it; for the statistics
+ *
+ * @return	the parents label value; k_wormxattr_label_mutable if it (or vp) is the root
+ */
+static intptr_t derive_parent(struct vnode* vp, uint32_t generation, wormxattr_stats_hook_t hook) {
+	intptr_t retval = k_wormxattr_label_mutable;
+	struct vnode* dirs[k_wormxattr_derive_depth];
+	int count = 0;
+	int known = 0;
+	int lost = 0;
+	struct vnode* dvp = NULLVP;
 	
-	char state = 0;
-	size_t attrlen = 0;
-	int ret = mac_vnop_getxattr(vp, k_wormxattr_xattr, &state, sizeof(state), &attrlen);
-	if (	(ret == KERN_SUCCESS) 
-		 || (ret == ERANGE)) {
-		// we dont care that the attribute is to large ... its there
-		retval = 1; // immutable
+	if (	!vnode_isvroot(vp)
+		 && ((dvp = vnode_getparent(vp)) == NULLVP)) {
+		lost = 1;
+	}
+	// walk up until a directory whose state is known; cached or with an attribute
+	while (	(dvp != NULLVP)
+		   && (known == 0)) {
+		intptr_t own = k_wormxattr_label_mutable;
+		if (wormxattr_derive_lookup(dvp, generation, &retval)) {
+			known = 1;
+		} else if (	(wormxattr_label_state(own = get_worm_xattr(dvp, hook)) == k_wormxattr_label_worm)
+				   && (wormxattr_label_classes(own) & k_wormxattr_class_inherited)) {
+			retval = own; // the nearest ancestor with an attribute its children inherit
+			known = 1;
+		} else if (count == k_wormxattr_derive_depth) {
+			// deeper than we hold at once; derive the rest on their own
+			retval = wormxattr_policy_inherit(derive_parent(dvp, generation, hook));
+			known = 1;
+		} else {
+			dirs[count++] = dvp;
+			if (vnode_isvroot(dvp)) {
+				dvp = NULLVP;
+			} else if ((dvp = vnode_getparent(dvp)) == NULLVP) {
+				lost = 1;
+			}
+		}
+		if (known) {
+			wormxattr_derive_insert(dvp, generation, retval);
+			(void) vnode_put(dvp);
+		}
+	}
+	if (lost) {
+		retval = wormxattr_label_worm(k_wormxattr_retain_forever); // fail closed
+	}
+	// the directories walked have no attribute its children inherit; each derives from its parent
+	while (count > 0) {
+		dvp = dirs[--count];
+		retval = wormxattr_policy_inherit(retval);
+		if (lost == 0) {
+			wormxattr_derive_insert(dvp, generation, retval);
+		}
+		(void) vnode_put(dvp);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	gets the label value a vnode without attributes of its own derives from its
+ *			parent
+ *
+ * @param	dvalue		the parents label value
+ * @param	generation	the generation dvalue was derived in
+ *
+ * @return	the label value; wormxattr_label_derived(generation) if its mutable
+ */
+static inline intptr_t derive_label(intptr_t dvalue, uint32_t generation) {
+	intptr_t retval = wormxattr_policy_inherit(dvalue);
+	if (wormxattr_label_state(retval) != k_wormxattr_label_worm) {
+		retval = wormxattr_label_derived(generation);
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	checks if a setextattr of a worm attribute finalizes an append only vnode, or
+ *			seals a WORM directory; the value is copied in once, from a copy of the uio, as
+ *			the file system reads the original.  It reads it again from user memory, so
+ *			what it stores may not be what was checked; update_extattr keeps the label
+ *			if it's weaker
+ *
+ * @param	vp		the vnode the attribute is being set on
+ * @param	label	the vnodes label; may be NULL
+ * @param	uio		the value being set; may be NULL
+ *
+ * @return	non zero if the vnode is append only and the value makes it WORM, or its a 
+ *			WORM directory and the value seals it
+ */
+static int finalizes(struct vnode* vp, struct label* label, struct uio* uio) {
+	int retval = 0;
+	unsigned active = 0;
+	if (	uio
+		 && (	((active = get_classes(vp, label, k_wormxattr_stats_check_setextattr)) == k_wormxattr_class_append)
+			 || (	(active == k_wormxattr_class_worm)
+				 && vnode_isdir(vp)))) {
+		char value[k_wormxattr_value_max];
+		user_ssize_t len = uio_resid(uio);
+		if (len > k_wormxattr_value_max) {
+			retval = (active == k_wormxattr_class_append); // too long to be a retention, append or sealed; its forever
+		} else if (len >= 0) {
+			uio_t copy = uio_duplicate(uio);
+			if (copy) {
+				if (	(uiomove(value, (int) len, copy) != 0)
+					 || (uio_resid(copy) != 0)) {
+					// unreadable; not a change we allow
+				} else if (active == k_wormxattr_class_append) {
+					retval = wormxattr_policy_finalizes(value, (size_t) len);
+				} else {
+					retval = wormxattr_policy_seals(active, 1, value, (size_t) len);
+				}
+				uio_free(copy);
+			}
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	evaluates a rule (see wormxattr_policy_rules) against a vnode.  Whether its a
+ *			directory and whether the caller is the super user are only asked if the rule 
+ *			depends on them (which is known at compile time) and the label is only 
+ *			resolved if the case is one the rule denies for any class of WORM
+ *
+ * @param	cred	the credential of the caller
+ * @param	vp		the vnode to evaluate
+ * @param	label	the vnodes label; may be NULL
+ * @param	rule	the rules mask; k_wormxattr_rule_<name>
+ * @param	hook	the hook evaluating it; for the statistics
+ *
+ * @return	non zero if the rule denies
+ */
+static inline int rule_denies(kauth_cred_t cred, struct vnode* vp, struct label* label, unsigned rule, wormxattr_stats_hook_t hook) {
+	int isdir = wormxattr_policy_uses_dir(rule) ? vnode_isdir(vp): 0;
+	int root = wormxattr_policy_uses_root(rule) ? (kauth_cred_getuid(cred) == 0): 0;
+	unsigned classes = wormxattr_policy_guards(rule, isdir, root);
+	return	classes
+		 && (classes & get_classes(vp, label, hook));
+}
+
+
+/**
+ * @brief	evaluates a rule against a vnode; auditing a denial if the rule says to
+ *
+ * @param	cred	the credential of the caller
+ * @param	vp		the vnode to evaluate
+ * @param	label	the vnodes label; may be NULL
+ * @param	rule	the rules mask; k_wormxattr_rule_<name>
+ * @param	hook	the hook evaluating it; for the statistics
+ * @param	audit	the hook evaluating it; for the audit record
+ * @param	arg		the hook specific argument recorded with a denial
+ *
+ * @return	0 to grant access, else EPERM
+ */
+static inline int check_rule(kauth_cred_t cred, struct vnode* vp, struct label* label, unsigned rule, 
+							 wormxattr_stats_hook_t hook, audit_hook_t audit, uint64_t arg) {
+	int retval = 0; // grant access
+	if (rule_denies(cred, vp, label, rule, hook)) {
+		if (rule & k_wormxattr_rule_audited) {
+			audit_deny(cred, audit, vp, EPERM, arg);
+		}
+		retval = EPERM; // permision denied
 	}
 	return retval;
 }
@@ -154,19 +567,32 @@ static int vnode_check_access(kauth_cred_t cred,
 							  struct label *label,
 							  int acc_mode) {
 	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		if (vnode_isdir(vp) == 0) {
-			/*
-			 * Note: contary to the documentation for mpo_vnode_check_access_t
-			 * acc_mode does not contain the access(2) flags.  It is instead being
-			 * converted into V{READ,WRITE,EXEC} modes.
-			 */
-			if (acc_mode & VWRITE) {
-				// we dont need to audit people testing what access they have
-				retval = EPERM; // permision denied
-			}
-		}
+	/*
+	 * Note: contary to the documentation for mpo_vnode_check_access_t
+	 * acc_mode does not contain the access(2) flags.  It is instead being
+	 * converted into V{READ,WRITE,EXEC} modes.
+	 *
+	 * the label is only resolved if the answer depends on it
+	 */
+	if (	(acc_mode & VWRITE)
+		 && rule_denies(cred, vp, label, k_wormxattr_rule_access_write, k_wormxattr_stats_check_access)) {
+		// we dont need to audit people testing what access they have
+		retval = EPERM; // permision denied
 	}
+	wormxattr_stats_count(k_wormxattr_stats_check_access, retval);
+	return retval;
+}
+
+
+static int vnode_check_create(kauth_cred_t cred,
+							  struct vnode *dvp,
+							  struct label *dlabel,
+							  struct componentname *cnp,
+							  struct vnode_attr *vap) {
+	// nothing can be created in a sealed directory; its listing is final
+	int retval = check_rule(cred, dvp, dlabel, k_wormxattr_rule_create,
+							k_wormxattr_stats_check_create, k_audit_hook_check_create, 0);
+	wormxattr_stats_count(k_wormxattr_stats_check_create, retval);
 	return retval;
 }
 
@@ -175,14 +601,10 @@ static int vnode_check_deleteextattr(kauth_cred_t cred,
 									 struct vnode *vp,
 									 struct label *vlabel,
 									 const char *name) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(vlabel)) {
-		if (kauth_cred_getuid(cred) != 0) {
-			// normal users can't remove anything if it's immutable
-			audit_deny(cred, "Extended attribute, %s, prevents deletion of attributes by non su\n", k_wormxattr_xattr);
-			retval = EPERM;
-		}
-	}
+	// normal users can't remove anything if it's immutable
+	int retval = check_rule(cred, vp, vlabel, k_wormxattr_rule_deleteextattr, 
+							k_wormxattr_stats_check_deleteextattr, k_audit_hook_check_deleteextattr, 0);
+	wormxattr_stats_count(k_wormxattr_stats_check_deleteextattr, retval);
 	return retval;
 }
 
@@ -192,13 +614,40 @@ static int vnode_check_exchangedata(kauth_cred_t cred,
 									struct label *vl1,
 									struct vnode *v2,
 									struct label *vl2) {
-	int retval = 0; // grant access
-	if (	wormxattr_get_label(vl1) 
-		 || wormxattr_get_label(vl2)) {
-		// you can't swap anything into one of our files
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents exchanging data\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied		
+	// you can't swap anything into one of our files
+	int retval = check_rule(cred, v1, vl1, k_wormxattr_rule_exchangedata,
+							k_wormxattr_stats_check_exchangedata, k_audit_hook_check_exchangedata, 0);
+	if (retval == 0) {
+		retval = check_rule(cred, v2, vl2, k_wormxattr_rule_exchangedata,
+							k_wormxattr_stats_check_exchangedata, k_audit_hook_check_exchangedata, 0);
 	}
+	wormxattr_stats_count(k_wormxattr_stats_check_exchangedata, retval);
+	return retval;
+}
+
+
+static int vnode_check_link(kauth_cred_t cred,
+							struct vnode *dvp,
+							struct label *dlabel,
+							struct vnode *vp,
+							struct label *label,
+							struct componentname *cnp) {
+	// nor can anything be linked into one
+	int retval = check_rule(cred, dvp, dlabel, k_wormxattr_rule_link,
+							k_wormxattr_stats_check_link, k_audit_hook_check_link, 0);
+	if (	(retval == 0)
+		 && wormxattr_mount_derives()
+		 && (wormxattr_mount_mode_of(vnode_mount(vp)) == k_wormxattr_mount_derive)
+		 && (wormxattr_policy_active(get_label_value(vp, label, k_wormxattr_stats_check_link)) & k_wormxattr_class_inherited)) {
+		/*
+		 * on a derive mount a WORM vnode's state may come from its path; linked into a 
+		 * mutable directory it would derive mutable through the link, as renaming it out
+		 * of its WORM directory would
+		 */
+		audit_deny_cnp(cred, k_audit_hook_check_link, vp, cnp, EPERM, 0);
+		retval = EPERM; // permision denied
+	}
+	wormxattr_stats_count(k_wormxattr_stats_check_link, retval);
 	return retval;
 }
 
@@ -208,25 +657,18 @@ static int vnode_check_open(kauth_cred_t cred,
 							struct label *label,
 							int acc_mode) {
 	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-#ifdef DEBUG
-		char buf[MAXPATHLEN] = {0};
-		int len = MAXPATHLEN;
-		(void) vn_getpath(vp, buf, &len);
-		
-		dbg_info("Opening WORM file - %s; checking mode - %x\n", buf, acc_mode);
-#endif
-		// deny if its not a directory and any of the write flags are set
-		if (vnode_isdir(vp) == 0) {
-			if (	(OFLAGS(acc_mode) & O_WRONLY)
-				 || (OFLAGS(acc_mode) & O_RDWR)
-				 || (acc_mode & O_APPEND)
-				 || (acc_mode & O_TRUNC)) {
-				audit_deny(cred, "Extended attribute, %s, on vnode prevents opening with write access (mode = %x)\n", k_wormxattr_xattr, acc_mode);
-				retval = EPERM; // permision denied
-			}
-		}
+	// deny if its not a directory and any of the write flags are set; read only opens never resolve the label
+	int access = 0;
+	access |= (OFLAGS(acc_mode) & (O_WRONLY | O_RDWR)) ? k_wormxattr_access_write: 0;
+	access |= ((OFLAGS(acc_mode) & O_ACCMODE) == O_RDWR) ? k_wormxattr_access_read: 0;
+	access |= (acc_mode & O_APPEND) ? k_wormxattr_access_append: 0;
+	access |= (acc_mode & O_TRUNC) ? k_wormxattr_access_truncate: 0;
+	if (	access
+		 && rule_denies(cred, vp, label, wormxattr_policy_open_rule(access), k_wormxattr_stats_check_open)) {
+		audit_deny(cred, k_audit_hook_check_open, vp, EPERM, acc_mode);
+		retval = EPERM; // permision denied
 	}
+	wormxattr_stats_count(k_wormxattr_stats_check_open, retval);
 	return retval;
 }
 
@@ -239,11 +681,29 @@ static int vnode_check_rename_from(kauth_cred_t cred,
 								   struct componentname *cnp) {
 	int retval = 0; // grant access
 	// you can't move any files from a WORM directory; it would change the dir contents
-	if (wormxattr_get_label(dlabel)) {
+	if (rule_denies(cred, dvp, dlabel, k_wormxattr_rule_rename_from, k_wormxattr_stats_check_rename_from)) {
 		// vnode is immutable - you cant change it, and that includes its name!
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents renaming\n", k_wormxattr_xattr);
+		if (k_wormxattr_rule_rename_from & k_wormxattr_rule_audited) {
+			audit_deny_cnp(cred, k_audit_hook_check_rename_from, vp, cnp, EPERM, 0);
+		}
 		retval = EPERM; // permision denied		
 	}
+	wormxattr_stats_count(k_wormxattr_stats_check_rename_from, retval);
+	return retval;
+}
+
+
+static int vnode_check_rename_to(kauth_cred_t cred,
+								 struct vnode *dvp,
+								 struct label *dlabel,
+								 struct vnode *vp,		/* NULLOK */
+								 struct label *label,
+								 int samedir,
+								 struct componentname *cnp) {
+	// or moved into one; renames within it are denied by rename_from
+	int retval = check_rule(cred, dvp, dlabel, k_wormxattr_rule_rename_to,
+							k_wormxattr_stats_check_rename_to, k_audit_hook_check_rename_to, 0);
+	wormxattr_stats_count(k_wormxattr_stats_check_rename_to, retval);
 	return retval;
 }
 
@@ -252,11 +712,9 @@ static int vnode_check_setattrlist(kauth_cred_t cred,
 								   struct vnode *vp,
 								   struct label *vlabel,
 								   struct attrlist *alist) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(vlabel)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents setting attributes\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied
-	}
+	int retval = check_rule(cred, vp, vlabel, k_wormxattr_rule_setattrlist,
+							k_wormxattr_stats_check_setattrlist, k_audit_hook_check_setattrlist, 0);
+	wormxattr_stats_count(k_wormxattr_stats_check_setattrlist, retval);
 	return retval;
 }
 
@@ -267,9 +725,28 @@ static int vnode_check_setextattr(kauth_cred_t cred,
 								  const char *name,
 								  struct uio *uio) {
 	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents setting extended attributes\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied
+	unsigned match = wormxattr_class_match(name);
+	if (	(match & k_wormxattr_class_worm)
+		 && finalizes(vp, label, uio)) {
+		// an append only vnode is being made WORM, or a WORM directory sealed; the one change each allows
+	} else {
+		retval = check_rule(cred, vp, label, k_wormxattr_rule_setextattr,
+							k_wormxattr_stats_check_setextattr, k_audit_hook_check_setextattr, 0);
+	}
+	if (retval != 0) {
+		// the vnode is WORM
+	} else if (match == k_wormxattr_class_free_marker) {
+		// only the super user may declare a mount WORM free
+		if (kauth_cred_getuid(cred) != 0) {
+			audit_deny(cred, k_audit_hook_check_setextattr, vp, EPERM, 0);
+			retval = EPERM; // permision denied
+		}
+	} else if (match) {
+		// the mount can no longer be WORM free; make sure the marker is gone first
+		retval = wormxattr_mount_worm_added(vnode_mount(vp));
+		if (retval != 0) {
+			audit_deny(cred, k_audit_hook_check_setextattr, vp, retval, 0);
+		}
 	}
 	/* 
 	 * we could have decided to recursivly set this attribute on all child elements 
@@ -283,6 +760,7 @@ static int vnode_check_setextattr(kauth_cred_t cred,
 	 * Note: this does mean that not ALL files in the directory will behave WORM; only those
 	 * tagged as such - which is consitent with our world view
 	 */
+	wormxattr_stats_count(k_wormxattr_stats_check_setextattr, retval);
 	return retval;
 }
 
@@ -291,11 +769,9 @@ static int vnode_check_setflags(kauth_cred_t cred,
 								struct vnode *vp,
 								struct label *label,
 								u_long flags) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents setting flags\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied
-	}
+	int retval = check_rule(cred, vp, label, k_wormxattr_rule_setflags,
+							k_wormxattr_stats_check_setflags, k_audit_hook_check_setflags, flags);
+	wormxattr_stats_count(k_wormxattr_stats_check_setflags, retval);
 	return retval;
 }
 
@@ -304,11 +780,9 @@ static int vnode_check_setmode(kauth_cred_t cred,
 							   struct vnode *vp,
 							   struct label *label,
 							   mode_t mode) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents setmode\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied
-	}
+	int retval = check_rule(cred, vp, label, k_wormxattr_rule_setmode,
+							k_wormxattr_stats_check_setmode, k_audit_hook_check_setmode, mode);
+	wormxattr_stats_count(k_wormxattr_stats_check_setmode, retval);
 	return retval;
 }
 
@@ -318,11 +792,9 @@ static int vnode_check_setowner(kauth_cred_t cred,
 								struct label *label,
 								uid_t uid,
 								gid_t gid) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents changing ownership\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied
-	}
+	int retval = check_rule(cred, vp, label, k_wormxattr_rule_setowner,
+							k_wormxattr_stats_check_setowner, k_audit_hook_check_setowner, ((uint64_t) uid << 32) | gid);
+	wormxattr_stats_count(k_wormxattr_stats_check_setowner, retval);
 	return retval;
 }
 
@@ -332,11 +804,9 @@ static int vnode_check_setutimes(kauth_cred_t cred,
 								 struct label *label,
 								 struct timespec atime,
 								 struct timespec mtime) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents setting utimes\n", k_wormxattr_xattr);
-		retval = EPERM; // permision denied
-	}
+	int retval = check_rule(cred, vp, label, k_wormxattr_rule_setutimes,
+							k_wormxattr_stats_check_setutimes, k_audit_hook_check_setutimes, 0);
+	wormxattr_stats_count(k_wormxattr_stats_check_setutimes, retval);
 	return retval;
 }
 
@@ -345,13 +815,9 @@ static int vnode_check_truncate(kauth_cred_t active_cred,
 								kauth_cred_t file_cred,	/* NULLOK */
 								struct vnode *vp,
 								struct label *label) {
-	int retval = 0; // grant access
-	if (wormxattr_get_label(label)) {
-		if (vnode_isdir(vp) == 0) {
-			audit_deny(active_cred, "Extended attribute, %s, on vnode prevents truncate\n", k_wormxattr_xattr);
-			retval = EPERM; // permision denied
-		}
-	}
+	int retval = check_rule(active_cred, vp, label, k_wormxattr_rule_truncate,
+							k_wormxattr_stats_check_truncate, k_audit_hook_check_truncate, 0);
+	wormxattr_stats_count(k_wormxattr_stats_check_truncate, retval);
 	return retval;
 }
 
@@ -360,20 +826,23 @@ static int vnode_label_associate_extattr(struct mount *mp,
 										 struct label *mntlabel,
 										 struct vnode *vp,
 										 struct label *vlabel) {
+	uint64_t start = wormxattr_stats_clock(k_wormxattr_stats_label_associate_extattr);
 	/*
-	 * this is called when a vnode is created for an existing file
-	 * load check for an extended attribute and if its present set our label
+	 * this is called when a vnode is created for an existing file.  We don't read 
+	 * the attribute here; the label is left unknown and resolved the first time a 
+	 * check needs it, so vnodes which are only ever read never pay for the lookup
+	 *
+	 * if the mount is WORM free (or ignored) we know its mutable without looking
 	 */
-	if (get_worm_xattr(vp)) {
-#ifdef DEBUG
-		char buf[MAXPATHLEN] = {0};
-		int len = MAXPATHLEN;
-		(void) vn_getpath(vp, buf, &len);
-		
-		dbg_info("vnode created for existing file; setting label to reflect - %s\n", buf);
-#endif
-		wormxattr_set_label(vlabel, 1);
+	if (vnode_isvroot(vp)) {
+		wormxattr_mount_root(mntlabel, vp);
 	}
+	if (wormxattr_mount_lookup(mntlabel)) {
+		wormxattr_set_label(vlabel, k_wormxattr_label_unknown);
+	} else {
+		wormxattr_set_label(vlabel, k_wormxattr_label_mutable);
+	}
+	wormxattr_stats_latency(k_wormxattr_stats_label_associate_extattr, start, 0);
 	return 0; // grant access
 }
 
@@ -381,17 +850,20 @@ static int vnode_label_associate_extattr(struct mount *mp,
 static void vnode_label_copy(struct label *src,
 							 struct label *dest) {
 	wormxattr_set_label(dest, wormxattr_get_label(src));	
+	wormxattr_stats_count(k_wormxattr_stats_label_copy, 0);
 }
 
 
 static void vnode_label_destroy(struct label *label) {
-	wormxattr_set_label(label, 0); // cleanup just to be a nice citizen
+	wormxattr_set_label(label, k_wormxattr_label_unknown); // cleanup just to be a nice citizen
+	wormxattr_stats_count(k_wormxattr_stats_label_destroy, 0);
 }
 
 
 static void vnode_label_recycle(struct label *label) {
 	// cleanup WORM state that new user of the label gets it properly initialized
-	wormxattr_set_label(label, 0); 
+	wormxattr_set_label(label, k_wormxattr_label_unknown); 
+	wormxattr_stats_count(k_wormxattr_stats_label_recycle, 0);
 }
 
 
@@ -403,11 +875,14 @@ static int vnode_check_unlink(kauth_cred_t cred,
 							  struct componentname *cnp) {
 	int retval = 0; // grant access
 	// file must be mutable (as we're destorying its contents, and dir must be mutable as we're changing its contents
-	if (	wormxattr_get_label(dlabel)
-		 || wormxattr_get_label(label)) {
-		audit_deny(cred, "Extended attribute, %s, on vnode prevents unlink\n", k_wormxattr_xattr);
+	if (	rule_denies(cred, dvp, dlabel, k_wormxattr_rule_unlink_from, k_wormxattr_stats_check_unlink)
+		 || rule_denies(cred, vp, label, k_wormxattr_rule_unlink, k_wormxattr_stats_check_unlink)) {
+		if ((k_wormxattr_rule_unlink | k_wormxattr_rule_unlink_from) & k_wormxattr_rule_audited) {
+			audit_deny_cnp(cred, k_audit_hook_check_unlink, vp, cnp, EPERM, 0);
+		}
 		retval = EPERM; // permision denied
 	}
+	wormxattr_stats_count(k_wormxattr_stats_check_unlink, retval);
 	return retval;
 }
 
@@ -417,10 +892,46 @@ static int vnode_label_update_extattr(struct mount *mp,
 									  struct vnode *vp,
 									  struct label *vlabel,
 									  const char *name) {
-	if (strcmp(name, k_wormxattr_xattr) == 0) {
-		// our attribute was chaned (set/delete) - change label to reflect attribute state
-		wormxattr_set_label(vlabel, get_worm_xattr(vp));
+	unsigned match = wormxattr_class_match(name);
+	if (match == 0) {
+		// not one of ours; nearly every call
+	} else if (wormxattr_mount_mode(mntlabel) == k_wormxattr_mount_ignore) {
+		// vnodes on ignored mounts are never labeled
+	} else if (match != k_wormxattr_class_free_marker) {
+		// one of our attributes was chaned (set/delete) - change label to reflect attribute state
+		intptr_t previous = wormxattr_get_label(vlabel);
+		intptr_t value = k_wormxattr_label_mutable;
+		if (wormxattr_mount_mode(mntlabel) == k_wormxattr_mount_derive) {
+			if (vnode_isdir(vp)) {
+				wormxattr_derive_invalidate(); // what its descendants derive has changed
+			}
+			value = derive_worm_xattr(vp, k_wormxattr_label_unknown, k_wormxattr_stats_label_update_extattr);
+		} else {
+			value = get_worm_xattr(vp, k_wormxattr_stats_label_update_extattr);
+		}
+		if (wormxattr_policy_weakens(previous, value)) {
+			/*
+			 * only finalizing (or sealing) gets a worm attribute set on a WORM vnode, and
+			 * check_setextattr checked the value it copied in; the file system stored what
+			 * was in user memory after.  Keep the label, and put back the value it was from
+			 */
+			char buf[k_wormxattr_value_max];
+			size_t len = wormxattr_policy_format(buf, sizeof(buf), previous);
+			int err = mac_vnop_setxattr(vp, name, buf, len);
+			audit_log("%s changed to a weaker value than was checked; kept (restore %d)\n", name, err);
+			value = previous;
+		}
+		if (wormxattr_label_state(value) == k_wormxattr_label_worm) {
+			// backstop; in case it was set without vnode_check_setextattr being called
+			(void) wormxattr_mount_worm_added(mp);
+		}
+		(void) OSIncrementAtomic(&g_wormxattr_label_generation); // see resolve_label
+		wormxattr_set_label(vlabel, value);
+	} else if (vnode_isvroot(vp)) {
+		// the mounts WORM free marker was changed - update the mounts summary
+		wormxattr_mount_root(mntlabel, vp);
 	}
+	wormxattr_stats_count(k_wormxattr_stats_label_update_extattr, 0);
 	return 0; // success - according to the docs 
 }
 
@@ -434,25 +945,32 @@ static int vnode_notify_create(kauth_cred_t cred,
 							   struct label *vlabel,
 							   struct componentname *cnp) {
 	int retval = 0; // grant access
+	uint64_t start = wormxattr_stats_clock(k_wormxattr_stats_notify_create);
 	/*
 	 * this is called when a vnode is created for a file which has just been created
 	 * if our parent has our attribute we'll inherit it to the new child )and its label)
+	 * unless the mount has inheritance disabled.  On derive mounts only the label is set
 	 */
-	if (wormxattr_get_label(dlabel)) {
-		char state = 1;
-
+	intptr_t dvalue = k_wormxattr_label_mutable;
+	wormxattr_mount_mode_t mode = wormxattr_mount_mode(mntlabel);
+	if (mode == k_wormxattr_mount_derive) {
+		uint32_t generation = wormxattr_derive_generation();
+		dvalue = get_label_value(dvp, dlabel, k_wormxattr_stats_notify_create);
+		wormxattr_set_label(vlabel, derive_label(dvalue, generation));
+	} else if (mode == k_wormxattr_mount_ignore) {
+		wormxattr_set_label(vlabel, k_wormxattr_label_mutable); // so its never resolved
+	} else if (	(mode == k_wormxattr_mount_enforce)
+			 && (wormxattr_policy_active(dvalue = get_label_value(dvp, dlabel, k_wormxattr_stats_notify_create)) & k_wormxattr_class_inherited)) {
 		// parent directory is WORM so inherit permission to newly created vnode
 		dbg_info("parent directory vnode is labeled as WORM; setting label to reflect - %s\n", cnp->cn_nameptr);
 		
-		retval = mac_vnop_setxattr(vp, k_wormxattr_xattr, &state, sizeof(state));
-		if (retval == KERN_SUCCESS) {
-			// success - set WORM in label
-			wormxattr_set_label(vlabel, 1); 
-		} else {
+		retval = inherit_worm(cred, vp, vlabel, dvalue, k_audit_hook_notify_create);
+		if (retval != KERN_SUCCESS) {
 			// oops, error - retval will be the error from setxattr
-			audit_deny(cred, "Extended attribute, %s, could not be inherited\n", k_wormxattr_xattr);
+			audit_deny_cnp(cred, k_audit_hook_notify_create, vp, cnp, retval, 0);
 		}
 	}
+	wormxattr_stats_latency(k_wormxattr_stats_notify_create, start, retval);
 	return retval;	
 }
 
@@ -463,16 +981,34 @@ static void vnode_notify_rename(kauth_cred_t cred,
 								struct vnode *dvp,
 								struct label *dlabel,
 								struct componentname *cnp) {
-	if (wormxattr_get_label(dlabel)) {
-		char state = 1;
-		
+	int err = KERN_SUCCESS;
+	intptr_t dvalue = get_label_value(dvp, dlabel, k_wormxattr_stats_notify_rename); // nothing read on ignored mounts
+	unsigned inherited = wormxattr_policy_active(dvalue) & k_wormxattr_class_inherited;
+	wormxattr_mount_mode_t mode = k_wormxattr_mount_enforce;
+	if (	inherited
+		 || wormxattr_mount_derives()) {
+		mode = wormxattr_mount_mode_of(vnode_mount(dvp)); // only if it matters
+	}
+	if (mode == k_wormxattr_mount_derive) {
+		/*
+		 * nothing is written; a directory's descendants derive their state from its
+		 * new ancestors, and a vnode whose state was derived derives it again here
+		 */
+		if (vnode_isdir(vp)) {
+			wormxattr_derive_invalidate();
+		}
+		if (wormxattr_label_state(wormxattr_get_label(label)) == k_wormxattr_label_derived) {
+			uint32_t generation = wormxattr_derive_generation();
+			dvalue = get_label_value(dvp, dlabel, k_wormxattr_stats_notify_rename);
+			wormxattr_set_label(label, derive_label(dvalue, generation));
+		}
+	} else if (	inherited
+			 && (mode == k_wormxattr_mount_enforce)) {
 		// parent directory is WORM so inherit permission to newly created vnode
 		dbg_info("parent directory vnode is labeled as WORM; setting label to reflect - %s\n", cnp->cn_nameptr);
 		
-		if (mac_vnop_setxattr(vp, k_wormxattr_xattr, &state, sizeof(state)) == KERN_SUCCESS) {
-			// success - set WORM in label
-			wormxattr_set_label(label, 1); 
-		} else {
+		err = inherit_worm(cred, vp, label, dvalue, k_audit_hook_notify_rename);
+		if (err != KERN_SUCCESS) {
 			/*
 			 * oops, error - we can't set attribute.  Unfortunatly we can't tell it not to rename (its done)
 			 * worse still we can't do this in the rename_to hook as vp can be NULL.  As such the best we can
@@ -483,8 +1019,9 @@ static void vnode_notify_rename(kauth_cred_t cred,
 			 *
 			 * The only time I've seen this is for items which CAN'T have xattrs applied i.e. fifo's
 			 */
-			audit_deny(cred, "Extended attribute, %s, could not be inherited\n", k_wormxattr_xattr);
+			audit_deny_cnp(cred, k_audit_hook_notify_rename, vp, cnp, err, 0);
 		}
 	}
-
+	wormxattr_stats_count(k_wormxattr_stats_notify_rename, err);
+	
 }
@@ -0,0 +1,583 @@
+//
+//  bench.c
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/fcntl.h>
+
+#include "host_kern.h"
+#include "wormxattr.h"
+#include "wormxattr_mount.h"
+
+
+/*
+ * Description
+ *
+ * Per hook latency microbenchmark.  Every hook the policy registers is called
+ * in a tight loop against a WORM labeled and a mutable labeled target, and the
+ * ns per call and aggregate throughput are reported.  The label association
+ * and notify hooks run against a pool of vnodes which are recycled each call
+ * (vnode churn); labels are resolved lazily, so the cost of reading the extended
+ * attribute shows up in the first check made after association.
+ * Each target is on its own mount; with -F the mutable mount is marked WORM free.
+ *
+ * With -R the hooks aren't benchmarked; instead a tree of files is moved into a WORM
+ * directory on an enforced mount, where each of its vnodes then has the attribute 
+ * written (as "xattr -wr" would), and on a derive mount, where nothing is written.
+ * The time to make the tree WORM, and the first check of each file after, is reported.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_bench_iterations				1000000
+#define k_bench_pool					4096
+#define k_bench_uid						501
+#define k_bench_gid						20
+#define k_bench_tree_fanout				1000	// files per directory in the -R tree
+#define k_bench_derive_fs				"derivefs"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the vnodes a benchmark thread operates on; one set is WORM, one mutable
+ */
+typedef struct __bench_target_t {
+	struct mount*	mp;
+	struct vnode*	root;
+	struct vnode*	dir;
+	struct vnode*	file;
+	struct vnode**	pool;			// files in dir; recycled on each churn call
+} bench_target_t;
+
+/**
+ * @brief	the tree moved by the -R benchmark
+ */
+typedef struct __bench_tree_t {
+	struct mount*	mp;
+	struct vnode*	root;
+	struct vnode*	worm;			// the WORM directory its moved into
+	struct vnode*	tree;			// the top of the tree
+	struct vnode**	vnodes;			// the directories and files below tree
+	int				count;
+} bench_tree_t;
+
+/**
+ * @brief	per thread state
+ */
+typedef struct __bench_thread_t {
+	pthread_t			thread;
+	bench_target_t		target[2];	// indexed by k_bench_mutable/k_bench_worm
+	uint64_t			elapsed;
+	int					sink;		// keeps return values live
+} bench_thread_t;
+
+enum {
+	k_bench_mutable = 0,
+	k_bench_worm
+};
+
+typedef int (*bench_fn_t)(bench_thread_t* t, bench_target_t* target, uint64_t i);
+
+/**
+ * @brief	a benchmark case; one per hook (or hook mode)
+ */
+typedef struct __bench_case_t {
+	const char*		name;
+	bench_fn_t		fn;
+} bench_case_t;
+
+
+static struct mac_policy_ops* g_ops = NULL;
+static struct ucred g_cred = {k_bench_uid, k_bench_gid};
+static struct timespec g_time = {0};
+static struct componentname g_cn = {0};
+
+static uint64_t g_iterations = k_bench_iterations;
+static int g_threads = 1;
+static int g_pool = k_bench_pool;
+static int g_free = 0;
+static int g_deferred = 0;
+
+static pthread_barrier_t g_barrier;
+static bench_fn_t g_fn = NULL;
+static int g_which = 0;
+
+
+/*
+ * Benchmark cases
+ */
+
+static int bench_check_access_read(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_access(&g_cred, target->file, &target->file->v_label, VREAD);
+}
+
+
+static int bench_check_access_write(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_access(&g_cred, target->file, &target->file->v_label, VWRITE);
+}
+
+
+static int bench_check_create(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_create(&g_cred, target->dir, &target->dir->v_label, &g_cn, NULL);
+}
+
+
+static int bench_check_deleteextattr(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_deleteextattr(&g_cred, target->file, &target->file->v_label, k_wormxattr_xattr);
+}
+
+
+static int bench_check_exchangedata(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	bench_target_t* mutable = &t->target[k_bench_mutable];
+	return g_ops->mpo_vnode_check_exchangedata(&g_cred, mutable->file, &mutable->file->v_label, target->file, &target->file->v_label);
+}
+
+
+static int bench_check_open_read(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_open(&g_cred, target->file, &target->file->v_label, FFLAGS(O_RDONLY));
+}
+
+
+static int bench_check_open_write(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_open(&g_cred, target->file, &target->file->v_label, FFLAGS(O_WRONLY));
+}
+
+
+static int bench_check_rename_from(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_rename_from(&g_cred, target->dir, &target->dir->v_label, target->file, &target->file->v_label, &g_cn);
+}
+
+
+static int bench_check_setattrlist(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_setattrlist(&g_cred, target->file, &target->file->v_label, NULL);
+}
+
+
+static int bench_check_setextattr(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_setextattr(&g_cred, target->file, &target->file->v_label, "com.mountainstorm.Test", NULL);
+}
+
+
+static int bench_check_setflags(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_setflags(&g_cred, target->file, &target->file->v_label, 0);
+}
+
+
+static int bench_check_setmode(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_setmode(&g_cred, target->file, &target->file->v_label, 0644);
+}
+
+
+static int bench_check_setowner(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_setowner(&g_cred, target->file, &target->file->v_label, k_bench_uid, k_bench_gid);
+}
+
+
+static int bench_check_setutimes(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_setutimes(&g_cred, target->file, &target->file->v_label, g_time, g_time);
+}
+
+
+static int bench_check_truncate(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_truncate(&g_cred, NULL, target->file, &target->file->v_label);
+}
+
+
+static int bench_check_unlink(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	return g_ops->mpo_vnode_check_unlink(&g_cred, target->dir, &target->dir->v_label, target->file, &target->file->v_label, &g_cn);
+}
+
+
+static int bench_label_associate_extattr(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	struct vnode* vp = target->pool[i % g_pool];
+	host_vnode_recycle(vp);
+	return g_ops->mpo_vnode_label_associate_extattr(target->mp, &target->mp->mnt_label, vp, &vp->v_label);
+}
+
+
+static int bench_label_associate_open(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	struct vnode* vp = target->pool[i % g_pool];
+	host_vnode_recycle(vp);
+	(void) g_ops->mpo_vnode_label_associate_extattr(target->mp, &target->mp->mnt_label, vp, &vp->v_label);
+	return g_ops->mpo_vnode_check_open(&g_cred, vp, &vp->v_label, FFLAGS(O_WRONLY));
+}
+
+
+static int bench_label_copy(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	struct vnode* vp = target->pool[i % g_pool];
+	g_ops->mpo_vnode_label_copy(&target->file->v_label, &vp->v_label);
+	return 0;
+}
+
+
+static int bench_label_update_extattr(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	// WORM target updates our attribute (re-read), mutable target an unrelated one (ignored)
+	const char* name = (target == &t->target[k_bench_worm]) ? k_wormxattr_xattr: "com.mountainstorm.Test";
+	return g_ops->mpo_vnode_label_update_extattr(target->mp, &target->mp->mnt_label, target->file, &target->file->v_label, name);
+}
+
+
+static int bench_notify_create(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	struct vnode* vp = target->pool[i % g_pool];
+	host_vnode_recycle(vp);
+	return g_ops->mpo_vnode_notify_create(&g_cred, target->mp, &target->mp->mnt_label, target->dir, &target->dir->v_label, vp, &vp->v_label, &g_cn);
+}
+
+
+static int bench_notify_rename(bench_thread_t* t, bench_target_t* target, uint64_t i) {
+	struct vnode* vp = target->pool[i % g_pool];
+	g_ops->mpo_vnode_notify_rename(&g_cred, vp, &vp->v_label, target->dir, &target->dir->v_label, &g_cn);
+	return 0;
+}
+
+
+static bench_case_t g_cases[] = {
+	{"vnode_check_access(VREAD)",			bench_check_access_read},
+	{"vnode_check_access(VWRITE)",			bench_check_access_write},
+	{"vnode_check_create",					bench_check_create},
+	{"vnode_check_deleteextattr",			bench_check_deleteextattr},
+	{"vnode_check_exchangedata",			bench_check_exchangedata},
+	{"vnode_check_open(O_RDONLY)",			bench_check_open_read},
+	{"vnode_check_open(O_WRONLY)",			bench_check_open_write},
+	{"vnode_check_rename_from",				bench_check_rename_from},
+	{"vnode_check_setattrlist",				bench_check_setattrlist},
+	{"vnode_check_setextattr",				bench_check_setextattr},
+	{"vnode_check_setflags",				bench_check_setflags},
+	{"vnode_check_setmode",					bench_check_setmode},
+	{"vnode_check_setowner",				bench_check_setowner},
+	{"vnode_check_setutimes",				bench_check_setutimes},
+	{"vnode_check_truncate",				bench_check_truncate},
+	{"vnode_check_unlink",					bench_check_unlink},
+	{"vnode_label_associate_extattr",		bench_label_associate_extattr},
+	{"vnode_associate+open(O_WRONLY)",		bench_label_associate_open},
+	{"vnode_label_copy",					bench_label_copy},
+	{"vnode_label_update_extattr",			bench_label_update_extattr},
+	{"vnode_notify_create",					bench_notify_create},
+	{"vnode_notify_rename",					bench_notify_rename},
+	{NULL, NULL}
+};
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	creates one target; a mount, a directory, a file within it and a pool of files for churn
+ *
+ * @param	t		the thread the target belongs to
+ * @param	target	the target to initialize
+ * @param	worm	non zero if the target vnodes should be WORM
+ */
+static void bench_target_init(bench_thread_t* t, bench_target_t* target, int worm) {
+	char state = 1;
+	target->mp = host_mount_create("hfs", worm ? "/Volumes/worm": "/Volumes/mutable");
+	target->root = host_vnode_create(target->mp, NULL, "", VDIR);
+	if (g_free && (worm == 0)) {
+		(void) host_xattr_set(target->root, k_wormxattr_free_xattr, &state, sizeof(state));
+	}
+	host_vnode_associate(target->root);
+	target->dir = host_vnode_create(target->mp, target->root, worm ? "wormDir": "mutableDir", VDIR);
+	target->file = host_vnode_create(target->mp, target->dir, worm ? "wormFile": "mutableFile", VREG);
+	target->pool = calloc(g_pool, sizeof(target->pool[0]));
+	if (target->pool == NULL) {
+		host_panic("Out of memory\n");
+	}
+	for (int i = 0; i < g_pool; i++) {
+		char name[32];
+		(void) snprintf(name, sizeof(name), "file%d", i);
+		target->pool[i] = host_vnode_create(target->mp, target->dir, name, VREG);
+		if (worm) {
+			(void) host_xattr_set(target->pool[i], k_wormxattr_xattr, &state, sizeof(state));
+		}
+		host_vnode_associate(target->pool[i]);
+	}
+	if (worm) {
+		(void) host_xattr_set(target->dir, k_wormxattr_xattr, &state, sizeof(state));
+		(void) host_xattr_set(target->file, k_wormxattr_xattr, &state, sizeof(state));
+	}
+	host_vnode_associate(target->dir);
+	host_vnode_associate(target->file);
+}
+
+
+/**
+ * @brief	makes a tree of files, each directory holding k_bench_tree_fanout, and a WORM
+ *			directory to move it into.  Every file is checked once, so their labels are 
+ *			resolved (as the tree is in use) before its moved
+ *
+ * @param	tree	the tree to initialize
+ * @param	fstype	the file system type of its mount; which decides the mount's mode
+ * @param	files	the number of files
+ */
+static void bench_tree_init(bench_tree_t* tree, const char* fstype, int files) {
+	char state = 1;
+	struct vnode* dir = NULL;
+	
+	tree->mp = host_mount_create(fstype, "/Volumes/tree");
+	tree->root = host_vnode_create(tree->mp, NULL, "", VDIR);
+	host_vnode_associate(tree->root);
+	tree->worm = host_vnode_create(tree->mp, tree->root, "worm", VDIR);
+	(void) host_xattr_set(tree->worm, k_wormxattr_xattr, &state, sizeof(state));
+	host_vnode_associate(tree->worm);
+	tree->tree = host_vnode_create(tree->mp, tree->root, "tree", VDIR);
+	host_vnode_associate(tree->tree);
+	tree->vnodes = calloc(files + (files / k_bench_tree_fanout) + 1, sizeof(tree->vnodes[0]));
+	if (tree->vnodes == NULL) {
+		host_panic("Out of memory\n");
+	}
+	for (int i = 0; i < files; i++) {
+		char name[32];
+		if ((i % k_bench_tree_fanout) == 0) {
+			(void) snprintf(name, sizeof(name), "dir%d", i / k_bench_tree_fanout);
+			dir = host_vnode_create(tree->mp, tree->tree, name, VDIR);
+			host_vnode_associate(dir);
+			tree->vnodes[tree->count++] = dir;
+		}
+		(void) snprintf(name, sizeof(name), "file%d", i);
+		struct vnode* vp = host_vnode_create(tree->mp, dir, name, VREG);
+		host_vnode_associate(vp);
+		(void) g_ops->mpo_vnode_check_open(&g_cred, vp, &vp->v_label, FFLAGS(O_WRONLY));
+		tree->vnodes[tree->count++] = vp;
+	}
+}
+
+
+/**
+ * @brief	moves a tree into its WORM directory and makes it WORM, then checks each file
+ *
+ * @param	tree		the tree
+ * @param	label		non zero to write the attribute of every vnode in the tree
+ * @param	moveNs		on return how long the move (and labeling) took
+ * @param	checkNs		on return how long checking every file took
+ *
+ * @return	the number of files the checks denied; all of them
+ */
+static int bench_tree_move(bench_tree_t* tree, int label, uint64_t* moveNs, uint64_t* checkNs) {
+	int retval = 0;
+	char value[] = "1";
+	uint64_t start = host_now_ns();
+	tree->tree->v_parent = tree->worm;
+	g_ops->mpo_vnode_notify_rename(&g_cred, tree->tree, &tree->tree->v_label, tree->worm, &tree->worm->v_label, &g_cn);
+	for (int i = 0; label && (i < 1 + tree->count); i++) {
+		struct vnode* vp = i ? tree->vnodes[i - 1]: tree->tree;
+		if (	(g_ops->mpo_vnode_check_setextattr(&g_cred, vp, &vp->v_label, k_wormxattr_xattr, NULL) == 0)
+			 && (mac_vnop_setxattr(vp, k_wormxattr_xattr, value, 1) == 0)) {
+			(void) g_ops->mpo_vnode_label_update_extattr(tree->mp, &tree->mp->mnt_label, vp, &vp->v_label, k_wormxattr_xattr);
+		}
+	}
+	*moveNs = host_now_ns() - start;
+	
+	start = host_now_ns();
+	for (int i = 0; i < tree->count; i++) {
+		struct vnode* vp = tree->vnodes[i];
+		if (vnode_isdir(vp) == 0) {
+			retval += g_ops->mpo_vnode_check_open(&g_cred, vp, &vp->v_label, FFLAGS(O_WRONLY)) != 0;
+		}
+	}
+	*checkNs = host_now_ns() - start;
+	return retval;
+}
+
+
+/**
+ * @brief	the -R benchmark; moves a tree of files into a WORM directory, on an enforced
+ *			mount and then on a derive mount
+ *
+ * @param	files	the number of files in the tree
+ */
+static void bench_tree(int files) {
+	static const char* modes[] = {"enforce", "derive"};
+	const char* rules = k_wormxattr_mount_default_modes "," k_bench_derive_fs "=derive";
+	
+	if (host_sysctlbyname("security.mac.wormxattr.mount_modes", NULL, NULL, rules, strlen(rules) + 1) != 0) {
+		host_panic("Unable to set mount_modes\n");
+	}
+	printf("files: %d, per directory: %d, xattr delay: %lluns\n\n", files, k_bench_tree_fanout, (unsigned long long) host_xattr_delay_ns);
+	printf("%-10s %14s %14s %14s %10s\n", "mode", "move ms", "check ms", "check ns/file", "denied");
+	for (int i = 0; i < (int) (sizeof(modes)/sizeof(modes[0])); i++) {
+		bench_tree_t tree = {0};
+		uint64_t moveNs = 0, checkNs = 0;
+		bench_tree_init(&tree, i ? k_bench_derive_fs: "hfs", files);
+		int denied = bench_tree_move(&tree, i == 0, &moveNs, &checkNs);
+		printf("%-10s %14.3f %14.3f %14.1f %10d\n", modes[i], (double) moveNs / 1e6, (double) checkNs / 1e6,
+			   (double) checkNs / files, denied);
+	}
+}
+
+
+/**
+ * @brief	runs the current case on a thread, once the threads are all ready
+ */
+static void* bench_thread(void* arg) {
+	bench_thread_t* t = arg;
+	bench_target_t* target = &t->target[g_which];
+	bench_fn_t fn = g_fn;
+	
+	(void) pthread_barrier_wait(&g_barrier);
+	uint64_t start = host_now_ns();
+	for (uint64_t i = 0; i < g_iterations; i++) {
+		t->sink += fn(t, target, i);
+	}
+	t->elapsed = host_now_ns() - start;
+	return NULL;
+}
+
+
+/**
+ * @brief	runs a case across all threads
+ *
+ * @param	threads		the thread states
+ * @param	fn			the case to run
+ * @param	which		k_bench_mutable or k_bench_worm
+ * @param	nsPerCall	on return the mean ns per call
+ * @param	mops		on return the aggregate throughput in million calls per second
+ */
+static void bench_run(bench_thread_t* threads, bench_fn_t fn, int which, double* nsPerCall, double* mops) {
+	uint64_t slowest = 0;
+	double total = 0;
+	
+	g_fn = fn;
+	g_which = which;
+	(void) pthread_barrier_init(&g_barrier, NULL, g_threads);
+	for (int i = 0; i < g_threads; i++) {
+		if (pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]) != 0) {
+			host_panic("Unable to create thread\n");
+		}
+	}
+	for (int i = 0; i < g_threads; i++) {
+		(void) pthread_join(threads[i].thread, NULL);
+		total += (double) threads[i].elapsed / (double) g_iterations;
+		if (threads[i].elapsed > slowest) {
+			slowest = threads[i].elapsed;
+		}
+	}
+	(void) pthread_barrier_destroy(&g_barrier);
+	
+	*nsPerCall = total / g_threads;
+	*mops = ((double) g_iterations * g_threads * 1000.0) / (double) slowest;
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-n iterations] [-t threads] [-p pool] [-d xattr_delay_ns] [-f filter] [-F] [-D] [-R files]\n", name);
+	fprintf(stderr, "  -n  calls per hook per thread (default %d)\n", k_bench_iterations);
+	fprintf(stderr, "  -t  number of threads calling the hooks (default 1)\n");
+	fprintf(stderr, "  -p  vnodes per thread recycled by the churn cases (default %d)\n", k_bench_pool);
+	fprintf(stderr, "  -d  simulated backing store latency for each xattr op (default 0)\n");
+	fprintf(stderr, "  -f  only run cases whose name contains filter\n");
+	fprintf(stderr, "  -F  mark the mutable targets mount WORM free\n");
+	fprintf(stderr, "  -D  defer inherited attribute writes to the persist worker\n");
+	fprintf(stderr, "  -R  instead, time moving a tree of files into a WORM directory; written vs derived\n");
+	exit(1);
+}
+
+
+int main(int argc, char* argv[]) {
+	const char* filter = NULL;
+	int tree = 0;
+	int ch = 0;
+	while ((ch = getopt(argc, argv, "n:t:p:d:f:FDR:h")) != -1) {
+		switch (ch) {
+			case 'n': g_iterations = strtoull(optarg, NULL, 0); break;
+			case 't': g_threads = atoi(optarg); break;
+			case 'p': g_pool = atoi(optarg); break;
+			case 'd': host_xattr_delay_ns = strtoull(optarg, NULL, 0); break;
+			case 'f': filter = optarg; break;
+			case 'F': g_free = 1; break;
+			case 'D': g_deferred = 1; break;
+			case 'R': tree = atoi(optarg); break;
+			default: usage(argv[0]);
+		}
+	}
+	if ((g_iterations == 0) || (g_threads <= 0) || (g_pool <= 0) || (tree < 0)) {
+		usage(argv[0]);
+	}
+	
+	// denials are formatted but not printed; we want the cost not the noise
+	host_log_sink = k_host_log_discard;
+	host_kern_start();
+	g_ops = host_policy_ops();
+	if (host_sysctlbyname("security.mac.wormxattr.persist.deferred", NULL, NULL, &g_deferred, sizeof(g_deferred)) != 0) {
+		host_panic("Unable to set persist.deferred\n");
+	}
+	g_cn.cn_nameptr = "file";
+	g_cn.cn_namelen = 4;
+	if (tree) {
+		bench_tree(tree);
+		host_kern_stop();
+		return 0;
+	}
+	
+	bench_thread_t* threads = calloc(g_threads, sizeof(*threads));
+	if (threads == NULL) {
+		host_panic("Out of memory\n");
+	}
+	for (int i = 0; i < g_threads; i++) {
+		bench_target_init(&threads[i], &threads[i].target[k_bench_mutable], 0);
+		bench_target_init(&threads[i], &threads[i].target[k_bench_worm], 1);
+	}
+	
+	printf("threads: %d, iterations: %llu, pool: %d, xattr delay: %lluns\n\n",
+		   g_threads, (unsigned long long) g_iterations, g_pool, (unsigned long long) host_xattr_delay_ns);
+	printf("%-32s %12s %12s %12s %12s\n", "hook", "mutable ns", "mutable Mops", "worm ns", "worm Mops");
+	for (bench_case_t* it = g_cases; it->name; it++) {
+		double ns[2] = {0}, mops[2] = {0};
+		if (filter && (strstr(it->name, filter) == NULL)) {
+			continue;
+		}
+		bench_run(threads, it->fn, k_bench_mutable, &ns[k_bench_mutable], &mops[k_bench_mutable]);
+		bench_run(threads, it->fn, k_bench_worm, &ns[k_bench_worm], &mops[k_bench_worm]);
+		printf("%-32s %12.1f %12.2f %12.1f %12.2f\n", it->name,
+			   ns[k_bench_mutable], mops[k_bench_mutable], ns[k_bench_worm], mops[k_bench_worm]);
+	}
+	if (g_deferred) {
+		static const char* stats[] = {"queued", "flushed", "sync_fallbacks", "failed", "batch_max_ns", "age_max_ns"};
+		int maxDepth = 0;
+		size_t len = sizeof(maxDepth);
+		(void) host_sysctlbyname("security.mac.wormxattr.persist.max_depth", &maxDepth, &len, NULL, 0);
+		printf("\npersist: max_depth %d", maxDepth);
+		for (int i = 0; i < (int) (sizeof(stats)/sizeof(stats[0])); i++) {
+			char name[128];
+			uint64_t value = 0;
+			len = sizeof(value);
+			(void) snprintf(name, sizeof(name), "security.mac.wormxattr.persist.%s", stats[i]);
+			(void) host_sysctlbyname(name, &value, &len, NULL, 0);
+			printf(", %s %llu", stats[i], (unsigned long long) value);
+		}
+		printf("\n");
+	}
+	host_kern_stop();
+	return 0;
+}
@@ -0,0 +1,934 @@
+//
+//  host_kern.c
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#define _GNU_SOURCE // sched_getcpu
+#include <sys/systm.h>
+#include <sys/proc.h>
+#include <sys/random.h>
+#include <sys/sysctl.h>
+#include <sys/uio.h>
+#include <kern/clock.h>
+#include <kern/locks.h>
+#include <kern/thread.h>
+#include <sched.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_kern.h"
+
+
+/*
+ * Definitions
+ */
+
+// the kext entry points; see wormxattr.c
+extern kern_return_t com_mountainstorm_kext_wormxattr_start(kmod_info_t* ki, void* data);
+extern kern_return_t com_mountainstorm_kext_wormxattr_stop(kmod_info_t* ki, void* data);
+
+host_log_t host_log_sink = k_host_log_stdout;
+uint64_t host_xattr_delay_ns = 0;
+int64_t host_clock_offset = 0;
+
+static struct mac_policy_conf* g_host_policy = NULL;
+static kmod_info_t g_host_kmod = {0, "com.mountainstorm.kext.wormxattr", "1.0"};
+static uint32_t g_host_vid = 0;
+static uint64_t g_host_fileid = 1;
+static int32_t g_host_fsid = 1;
+
+static pthread_mutex_t g_host_lock = PTHREAD_MUTEX_INITIALIZER;	// protects the lock and sysctl lists
+static lck_mtx_t* g_host_mutexes = NULL;
+
+/**
+ * @brief	a kernel thread; see kernel_thread_start
+ */
+struct __host_thread {
+	pthread_t			thread;
+	thread_continue_t	continuation;
+	void*				parameter;
+};
+
+static __thread thread_t g_host_current_thread = THREAD_NULL;
+
+// the root of the sysctl tree; the policy hangs its node off security.mac
+struct sysctl_oid_list sysctl__children;
+SYSCTL_NODE(, OID_AUTO, security, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "security");
+SYSCTL_NODE(_security, OID_AUTO, mac, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "TrustedBSD MAC policy controls");
+
+static struct host_xattr* host_xattr_find(struct vnode* vp, const char* name);
+static void host_xattr_delay(void);
+static void* host_thread_start(void* arg);
+static int host_sysctl_old(struct sysctl_req* req, const void* ptr, size_t len);
+static int host_sysctl_new(struct sysctl_req* req, void* ptr, size_t len);
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	loads the policy; as the kext loader would
+ */
+void host_kern_start(void) {
+	static int registered = 0;
+	if (registered == 0) {
+		sysctl_register_oid(&sysctl__security);
+		sysctl_register_oid(&sysctl__security_mac);
+		registered = 1;
+	}
+	if (com_mountainstorm_kext_wormxattr_start(&g_host_kmod, NULL) != KERN_SUCCESS) {
+		host_panic("Failed to start policy\n");
+	}
+}
+
+
+/**
+ * @brief	unloads the policy; as the kext loader would
+ */
+void host_kern_stop(void) {
+	(void) com_mountainstorm_kext_wormxattr_stop(&g_host_kmod, NULL);
+}
+
+
+/**
+ * @brief	gets the hooks registered by the policy
+ *
+ * @return	the registered policy ops; panics if the policy isn't loaded
+ */
+struct mac_policy_ops* host_policy_ops(void) {
+	if (g_host_policy == NULL) {
+		host_panic("Policy not registered\n");
+	}
+	return g_host_policy->mpc_ops;
+}
+
+
+/**
+ * @brief	gets the time from a monotonic clock
+ *
+ * @return	the current time in nanoseconds
+ */
+uint64_t host_now_ns(void) {
+	struct timespec ts;
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ull) + (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * @brief	creates a mount; if the policy is loaded its label is initialized and associated
+ *
+ * @param	fstypename		the file system type e.g. hfs, devfs
+ * @param	mntonname		the path the file system is mounted on
+ *
+ * @return	the new mount
+ */
+struct mount* host_mount_create(const char* fstypename, const char* mntonname) {
+	struct mount* mp = calloc(1, sizeof(*mp));
+	if (mp == NULL) {
+		host_panic("Out of memory\n");
+	}
+	mp->mnt_vfsstat.f_fsid.val[0] = __sync_fetch_and_add(&g_host_fsid, 1);
+	(void) snprintf(mp->mnt_vfsstat.f_fstypename, sizeof(mp->mnt_vfsstat.f_fstypename), "%s", fstypename);
+	(void) snprintf(mp->mnt_vfsstat.f_mntonname, sizeof(mp->mnt_vfsstat.f_mntonname), "%s", mntonname);
+	if (g_host_policy) {
+		struct mac_policy_ops* ops = g_host_policy->mpc_ops;
+		struct ucred cred = {0, 0};
+		if (ops->mpo_mount_label_init) {
+			ops->mpo_mount_label_init(&mp->mnt_label);
+		}
+		if (ops->mpo_mount_label_associate) {
+			ops->mpo_mount_label_associate(&cred, mp, &mp->mnt_label);
+		}
+	}
+	return mp;
+}
+
+
+/**
+ * @brief	unmounts and destroys a mount created with host_mount_create
+ *
+ * @param	mp		the mount to destroy
+ */
+void host_mount_destroy(struct mount* mp) {
+	if (g_host_policy) {
+		struct mac_policy_ops* ops = g_host_policy->mpc_ops;
+		struct ucred cred = {0, 0};
+		if (ops->mpo_mount_check_umount) {
+			(void) ops->mpo_mount_check_umount(&cred, mp, &mp->mnt_label);
+		}
+		if (ops->mpo_mount_label_destroy) {
+			ops->mpo_mount_label_destroy(&mp->mnt_label);
+		}
+	}
+	free(mp);
+}
+
+
+/**
+ * @brief	creates a vnode; the policy isn't told about it until host_vnode_associate
+ *
+ * @param	mp		the mount the vnode lives on
+ * @param	dvp		the parent directory vnode; NULL for the root of the mount (the first
+ *					vnode created with no parent becomes the mounts root)
+ * @param	name	the vnodes name within dvp
+ * @param	type	the vnode type e.g. VREG, VDIR
+ *
+ * @return	the new vnode
+ */
+struct vnode* host_vnode_create(struct mount* mp, struct vnode* dvp, const char* name, enum vtype type) {
+	struct vnode* vp = calloc(1, sizeof(*vp));
+	if (vp == NULL) {
+		host_panic("Out of memory\n");
+	}
+	vp->v_type = type;
+	vp->v_id = __sync_add_and_fetch(&g_host_vid, 1);
+	vp->v_fileid = __sync_fetch_and_add(&g_host_fileid, 1);
+	vp->v_mount = mp;
+	vp->v_parent = dvp;
+	(void) snprintf(vp->v_name, sizeof(vp->v_name), "%s", name);
+	(void) pthread_mutex_init(&vp->v_lock, NULL);
+	if ((dvp == NULL) && (mp->mnt_root == NULL)) {
+		mp->mnt_root = vp;
+	}
+	return vp;
+}
+
+
+/**
+ * @brief	tells the policy a vnode has been created for an existing file
+ *
+ * @param	vp		the vnode to associate a label with
+ */
+void host_vnode_associate(struct vnode* vp) {
+	struct mac_policy_ops* ops = host_policy_ops();
+	if (ops->mpo_vnode_label_associate_extattr) {
+		(void) ops->mpo_vnode_label_associate_extattr(vp->v_mount, &vp->v_mount->mnt_label, vp, &vp->v_label);
+	}
+}
+
+
+/**
+ * @brief	recycles a vnode, so it can be reused for another file
+ *
+ * @param	vp		the vnode to recycle
+ */
+void host_vnode_recycle(struct vnode* vp) {
+	struct mac_policy_ops* ops = host_policy_ops();
+	if (ops->mpo_vnode_label_recycle) {
+		ops->mpo_vnode_label_recycle(&vp->v_label);
+	}
+	vp->v_id = __sync_add_and_fetch(&g_host_vid, 1);
+}
+
+
+/**
+ * @brief	destroys a vnode created with host_vnode_create
+ *
+ * @param	vp		the vnode to destroy
+ */
+void host_vnode_destroy(struct vnode* vp) {
+	struct mac_policy_ops* ops = host_policy_ops();
+	if (ops->mpo_vnode_label_destroy) {
+		ops->mpo_vnode_label_destroy(&vp->v_label);
+	}
+	if (vp->v_mount->mnt_root == vp) {
+		vp->v_mount->mnt_root = NULL;
+	}
+	(void) pthread_mutex_destroy(&vp->v_lock);
+	free(vp);
+}
+
+
+/**
+ * @brief	sets an extended attribute without involving the policy
+ *
+ * @param	vp		the vnode to set the attribute on
+ * @param	name	the attribute name
+ * @param	value	the attribute value
+ * @param	len		the length of value
+ *
+ * @return	0 on success, else an errno
+ */
+int host_xattr_set(struct vnode* vp, const char* name, const void* value, size_t len) {
+	int retval = 0;
+	if (	(strlen(name) >= k_host_xattr_namelen)
+		 || (len > k_host_xattr_valuelen)) {
+		return E2BIG;
+	}
+	(void) pthread_mutex_lock(&vp->v_lock);
+	struct host_xattr* xattr = host_xattr_find(vp, name);
+	if (xattr == NULL) {
+		if (vp->v_xattr_count < k_host_xattr_max) {
+			xattr = &vp->v_xattrs[vp->v_xattr_count++];
+			(void) strcpy(xattr->name, name);
+		} else {
+			retval = ENOSPC;
+		}
+	}
+	if (xattr) {
+		(void) memcpy(xattr->value, value, len);
+		xattr->len = len;
+	}
+	(void) pthread_mutex_unlock(&vp->v_lock);
+	return retval;
+}
+
+
+/**
+ * @brief	removes an extended attribute without involving the policy
+ *
+ * @param	vp		the vnode to remove the attribute from
+ * @param	name	the attribute name
+ *
+ * @return	0 on success, else an errno
+ */
+int host_xattr_remove(struct vnode* vp, const char* name) {
+	int retval = ENOATTR;
+	(void) pthread_mutex_lock(&vp->v_lock);
+	struct host_xattr* xattr = host_xattr_find(vp, name);
+	if (xattr) {
+		*xattr = vp->v_xattrs[--vp->v_xattr_count];
+		retval = 0;
+	}
+	(void) pthread_mutex_unlock(&vp->v_lock);
+	return retval;
+}
+
+
+/**
+ * @brief	finds a named extended attribute; caller must hold v_lock
+ */
+static struct host_xattr* host_xattr_find(struct vnode* vp, const char* name) {
+	struct host_xattr* retval = NULL;
+	for (int i = 0; i < vp->v_xattr_count; i++) {
+		if (strcmp(vp->v_xattrs[i].name, name) == 0) {
+			retval = &vp->v_xattrs[i];
+			break;
+		}
+	}
+	return retval;
+}
+
+
+/**
+ * @brief	simulates the cost of going to the backing store for an attribute
+ */
+static void host_xattr_delay(void) {
+	if (host_xattr_delay_ns) {
+		uint64_t end = host_now_ns() + host_xattr_delay_ns;
+		while (host_now_ns() < end) {
+			// spin; we're simulating the time the file system takes
+		}
+	}
+}
+
+
+/**
+ * @brief	reads and/or writes a sysctl registered by the policy
+ *
+ * @param	name		the dotted sysctl name e.g. security.mac.wormxattr.audit_dropped
+ * @param	oldp		buffer for the current value; may be NULL
+ * @param	oldlenp		on entry the size of oldp, on return the size of the value; may be NULL
+ * @param	newp		the new value; NULL to only read
+ * @param	newlen		the size of newp
+ *
+ * @return	0 on success, else an errno
+ */
+int host_sysctlbyname(const char* name, void* oldp, size_t* oldlenp, const void* newp, size_t newlen) {
+	int retval = ENOENT;
+	char path[256] = {0};
+	struct sysctl_oid_list* list = &sysctl__children;
+	struct sysctl_oid* oid = NULL;
+	
+	(void) snprintf(path, sizeof(path), "%s", name);
+	(void) pthread_mutex_lock(&g_host_lock);
+	char* last = NULL;
+	for (char* component = strtok_r(path, ".", &last); component; component = strtok_r(NULL, ".", &last)) {
+		if (list == NULL) {
+			oid = NULL;
+			break;
+		}
+		for (oid = list->slh_first; oid; oid = oid->oid_link.sle_next) {
+			if (strcmp(oid->oid_name, component) == 0) {
+				break;
+			}
+		}
+		if (oid == NULL) {
+			break;
+		}
+		list = ((oid->oid_kind & CTLTYPE) == CTLTYPE_NODE) ? oid->oid_arg1: NULL;
+	}
+	(void) pthread_mutex_unlock(&g_host_lock);
+	
+	if (oid && ((oid->oid_kind & CTLTYPE) != CTLTYPE_NODE)) {
+		struct sysctl_req req = {0};
+		req.oldptr = oldp;
+		req.oldlen = oldlenp ? *oldlenp: 0;
+		req.oldfunc = host_sysctl_old;
+		req.newptr = newp;
+		req.newlen = newlen;
+		req.newfunc = host_sysctl_new;
+		if (newp && ((oid->oid_kind & CTLFLAG_WR) == 0)) {
+			retval = EPERM;
+		} else {
+			retval = oid->oid_handler(oid, oid->oid_arg1, oid->oid_arg2, &req);
+		}
+		if (oldlenp) {
+			*oldlenp = req.oldidx;
+		}
+	}
+	return retval;
+}
+
+
+static int host_sysctl_old(struct sysctl_req* req, const void* ptr, size_t len) {
+	int retval = 0;
+	if (req->oldptr) {
+		if ((req->oldidx + len) > req->oldlen) {
+			retval = ENOMEM;
+		} else {
+			(void) memcpy((char*) req->oldptr + req->oldidx, ptr, len);
+		}
+	}
+	req->oldidx += len;
+	return retval;
+}
+
+
+static int host_sysctl_new(struct sysctl_req* req, void* ptr, size_t len) {
+	int retval = 0;
+	if ((req->newidx + len) > req->newlen) {
+		retval = EINVAL;
+	} else {
+		(void) memcpy(ptr, (const char*) req->newptr + req->newidx, len);
+		req->newidx += len;
+	}
+	return retval;
+}
+
+
+static void* host_thread_start(void* arg) {
+	thread_t thread = arg;
+	g_host_current_thread = thread;
+	thread->continuation(thread->parameter, 0);
+	return NULL;
+}
+
+
+/*
+ * Kernel KPI
+ */
+
+int host_printf(const char* str, ...) {
+	va_list args;
+	
+	va_start(args, str);
+	int retval = host_vprintf(str, args);
+	va_end(args);
+	return retval;
+}
+
+
+int host_vprintf(const char* str, va_list args) {
+	int retval = 0;
+	if (host_log_sink == k_host_log_stdout) {
+		retval = vfprintf(stdout, str, args);
+	} else {
+		char buf[512];
+		retval = vsnprintf(buf, sizeof(buf), str, args);
+	}
+	return retval;
+}
+
+
+void host_panic(const char* str, ...) {
+	va_list args;
+	
+	va_start(args, str);
+	(void) fputs("panic: ", stderr);
+	(void) vfprintf(stderr, str, args);
+	va_end(args);
+	abort();
+}
+
+
+const char* OSKextGetCurrentIdentifier(void) {
+	return g_host_kmod.name;
+}
+
+
+uid_t kauth_cred_getuid(kauth_cred_t cred) {
+	return cred->cr_uid;
+}
+
+
+gid_t kauth_cred_getgid(kauth_cred_t cred) {
+	return cred->cr_gid;
+}
+
+
+struct vfsstatfs* vfs_statfs(mount_t mp) {
+	return &mp->mnt_vfsstat;
+}
+
+
+int vnode_isdir(vnode_t vp) {
+	return vp->v_type == VDIR;
+}
+
+
+int vnode_isvroot(vnode_t vp) {
+	return vp->v_mount->mnt_root == vp;
+}
+
+
+enum vtype vnode_vtype(vnode_t vp) {
+	return vp->v_type;
+}
+
+
+struct mount* vnode_mount(vnode_t vp) {
+	return vp->v_mount;
+}
+
+
+uint32_t vnode_vid(vnode_t vp) {
+	return vp->v_id;
+}
+
+
+int vn_getpath(vnode_t vp, char* buf, int* len) {
+	char* components[MAXPATHLEN / 2];
+	int count = 0;
+	for (struct vnode* it = vp; it && (it != vp->v_mount->mnt_root) && (count < (int) (sizeof(components)/sizeof(components[0]))); it = it->v_parent) {
+		components[count++] = it->v_name;
+	}
+	
+	int off = snprintf(buf, *len, "%s", vp->v_mount->mnt_vfsstat.f_mntonname);
+	while ((count > 0) && (off < *len)) {
+		off += snprintf(buf + off, *len - off, "/%s", components[--count]);
+	}
+	*len = (off < *len) ? off + 1: *len;
+	return 0;
+}
+
+
+int vnode_getattr(vnode_t vp, struct vnode_attr* vap, vfs_context_t ctx) {
+	if (vap->va_active & VNODE_ATTR_va_fileid) {
+		vap->va_fileid = vp->v_fileid;
+		vap->va_supported |= VNODE_ATTR_va_fileid;
+	}
+	if (	(vap->va_active & VNODE_ATTR_va_parentid)
+		 && (vp->v_parent != NULL)) {
+		vap->va_parentid = vp->v_parent->v_fileid;
+		vap->va_supported |= VNODE_ATTR_va_parentid;
+	}
+	return 0;
+}
+
+
+const char* vnode_getname(vnode_t vp) {
+	return vp->v_name[0] ? vp->v_name: NULL;
+}
+
+
+void vnode_putname(const char* name) {
+}
+
+
+vnode_t vnode_getparent(vnode_t vp) {
+	return vp->v_parent;
+}
+
+
+int vnode_getwithvid(vnode_t vp, uint32_t vid) {
+	return (vp && (vp->v_id == vid)) ? 0: ENOENT;
+}
+
+
+int vnode_put(vnode_t vp) {
+	return 0;
+}
+
+
+int vnode_ref(vnode_t vp) {
+	return 0;
+}
+
+
+void vnode_rele(vnode_t vp) {
+}
+
+
+int vnode_getwithref(vnode_t vp) {
+	return 0;
+}
+
+
+int vnode_lookup(const char* path, int flags, vnode_t* vpp, vfs_context_t ctx) {
+	return ENOENT; // the host has no namespace; vnodes are only reachable by pointer
+}
+
+
+vfs_context_t vfs_context_current(void) {
+	return NULL;
+}
+
+
+int mac_policy_register(struct mac_policy_conf *mpc, mac_policy_handle_t *handlep, void *xd) {
+	g_host_policy = mpc;
+	*mpc->mpc_field_off = 0; // we're the only policy so get the first slot
+	*handlep = 1;
+	if (mpc->mpc_ops->mpo_policy_init) {
+		mpc->mpc_ops->mpo_policy_init(mpc);
+	}
+	return 0;
+}
+
+
+int mac_policy_unregister(mac_policy_handle_t handle) {
+	g_host_policy = NULL;
+	return 0;
+}
+
+
+intptr_t mac_label_get(struct label *l, int slot) {
+	return l->l_perpolicy[slot];
+}
+
+
+void mac_label_set(struct label *l, int slot, intptr_t v) {
+	l->l_perpolicy[slot] = v;
+}
+
+
+int mac_vnop_setxattr(struct vnode *vp, const char *name, char *buf, size_t len) {
+	host_xattr_delay();
+	return host_xattr_set(vp, name, buf, len);
+}
+
+
+int mac_vnop_getxattr(struct vnode *vp, const char *name, char *buf, size_t len, size_t *attrlen) {
+	int retval = ENOATTR;
+	host_xattr_delay();
+	(void) pthread_mutex_lock(&vp->v_lock);
+	vp->v_xattr_reads++;
+	struct host_xattr* xattr = host_xattr_find(vp, name);
+	if (xattr) {
+		if (xattr->len > len) {
+			retval = ERANGE;
+		} else {
+			(void) memcpy(buf, xattr->value, xattr->len);
+			*attrlen = xattr->len;
+			retval = 0;
+		}
+	}
+	(void) pthread_mutex_unlock(&vp->v_lock);
+	return retval;
+}
+
+
+int mac_vnop_removexattr(struct vnode *vp, const char *name) {
+	host_xattr_delay();
+	return host_xattr_remove(vp, name);
+}
+
+
+user_ssize_t uio_resid(uio_t uio) {
+	return (user_ssize_t) uio->resid;
+}
+
+
+uio_t uio_duplicate(uio_t uio) {
+	uio_t retval = malloc(sizeof(*retval));
+	if (retval) {
+		*retval = *uio;
+	}
+	return retval;
+}
+
+
+void uio_free(uio_t uio) {
+	free(uio);
+}
+
+
+int uiomove(const char* cp, int n, struct uio* uio) {
+	size_t len = ((size_t) n < uio->resid) ? (size_t) n: uio->resid;
+	(void) memcpy((char*) cp, uio->base, len); // a write; from the uio into cp
+	uio->base += len;
+	uio->resid -= len;
+	return 0;
+}
+
+
+/**
+ * @brief	the cpus configured; every cpu_number is below it, as in the kernel
+ */
+unsigned int ml_get_max_cpus(void) {
+	static volatile unsigned int max = 0;
+	
+	if (max == 0) {
+		long retval = sysconf(_SC_NPROCESSORS_CONF);
+		max = (retval < 1) ? 1: (unsigned int) retval;
+	}
+	return max;
+}
+
+
+/**
+ * @brief	the kernel's is a load from per cpu data; sched_getcpu costs several times the
+ *			hooks which use it, so each thread asks again only every 64 calls.  The answer
+ *			can be stale after a migration; which is all the callers (per cpu counters) 
+ *			tolerate anyway
+ */
+int cpu_number(void) {
+	static __thread int cpu = 0;
+	static __thread unsigned calls = 0;
+	
+	if ((calls++ & 63) == 0) {
+		int retval = sched_getcpu();
+		cpu = (	(retval < 0)
+				|| ((unsigned int) retval >= ml_get_max_cpus())) ? 0: retval;
+	}
+	return cpu;
+}
+
+
+uint64_t mach_absolute_time(void) {
+	return host_now_ns();
+}
+
+
+void absolutetime_to_nanoseconds(uint64_t abstime, uint64_t* result) {
+	*result = abstime;
+}
+
+
+void nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t* result) {
+	*result = nanoseconds;
+}
+
+
+void clock_get_calendar_microtime(clock_sec_t* secs, clock_usec_t* microsecs) {
+	struct timeval tv;
+	(void) gettimeofday(&tv, NULL);
+	*secs = (clock_sec_t) (tv.tv_sec + host_clock_offset);
+	*microsecs = (clock_usec_t) tv.tv_usec;
+}
+
+
+void read_random(void* buffer, unsigned int numBytes) {
+	FILE* fp = fopen("/dev/urandom", "r");
+	if ((fp == NULL) || (fread(buffer, 1, numBytes, fp) != numBytes)) {
+		host_panic("Unable to read random data\n");
+	}
+	(void) fclose(fp);
+}
+
+
+lck_grp_t* lck_grp_alloc_init(const char* name, lck_grp_attr_t* attr) {
+	lck_grp_t* grp = calloc(1, sizeof(*grp));
+	if (grp) {
+		(void) snprintf(grp->name, sizeof(grp->name), "%s", name);
+	}
+	return grp;
+}
+
+
+void lck_grp_free(lck_grp_t* grp) {
+	free(grp);
+}
+
+
+lck_mtx_t* lck_mtx_alloc_init(lck_grp_t* grp, lck_attr_t* attr) {
+	lck_mtx_t* lck = calloc(1, sizeof(*lck));
+	if (lck) {
+		(void) pthread_mutex_init(&lck->mutex, NULL);
+		(void) pthread_cond_init(&lck->cond, NULL);
+		(void) pthread_mutex_lock(&g_host_lock);
+		lck->next = g_host_mutexes;
+		g_host_mutexes = lck;
+		(void) pthread_mutex_unlock(&g_host_lock);
+	}
+	return lck;
+}
+
+
+void lck_mtx_free(lck_mtx_t* lck, lck_grp_t* grp) {
+	(void) pthread_mutex_lock(&g_host_lock);
+	for (lck_mtx_t** it = &g_host_mutexes; *it; it = &(*it)->next) {
+		if (*it == lck) {
+			*it = lck->next;
+			break;
+		}
+	}
+	(void) pthread_mutex_unlock(&g_host_lock);
+	(void) pthread_cond_destroy(&lck->cond);
+	(void) pthread_mutex_destroy(&lck->mutex);
+	free(lck);
+}
+
+
+void lck_mtx_lock(lck_mtx_t* lck) {
+	(void) pthread_mutex_lock(&lck->mutex);
+}
+
+
+void lck_mtx_unlock(lck_mtx_t* lck) {
+	(void) pthread_mutex_unlock(&lck->mutex);
+}
+
+
+int msleep(void* chan, lck_mtx_t* mtx, int pri, const char* wmesg, struct timespec* ts) {
+	int retval = 0;
+	if (ts) {
+		struct timespec abstime;
+		(void) clock_gettime(CLOCK_REALTIME, &abstime);
+		abstime.tv_sec += ts->tv_sec;
+		abstime.tv_nsec += ts->tv_nsec;
+		if (abstime.tv_nsec >= 1000000000) {
+			abstime.tv_sec++;
+			abstime.tv_nsec -= 1000000000;
+		}
+		if (pthread_cond_timedwait(&mtx->cond, &mtx->mutex, &abstime) == ETIMEDOUT) {
+			retval = EWOULDBLOCK;
+		}
+	} else {
+		(void) pthread_cond_wait(&mtx->cond, &mtx->mutex);
+	}
+	return retval;
+}
+
+
+void wakeup(void* chan) {
+	// we don't track channels; wake everyone and let them recheck their condition
+	(void) pthread_mutex_lock(&g_host_lock);
+	for (lck_mtx_t* it = g_host_mutexes; it; it = it->next) {
+		(void) pthread_cond_broadcast(&it->cond);
+	}
+	(void) pthread_mutex_unlock(&g_host_lock);
+}
+
+
+kern_return_t kernel_thread_start(thread_continue_t continuation, void* parameter, thread_t* new_thread) {
+	kern_return_t retval = KERN_FAILURE;
+	thread_t thread = calloc(1, sizeof(*thread));
+	if (thread) {
+		thread->continuation = continuation;
+		thread->parameter = parameter;
+		if (pthread_create(&thread->thread, NULL, host_thread_start, thread) == 0) {
+			(void) pthread_detach(thread->thread);
+			*new_thread = thread;
+			retval = KERN_SUCCESS;
+		} else {
+			free(thread);
+		}
+	}
+	return retval;
+}
+
+
+void thread_deallocate(thread_t thread) {
+	// the thread owns its own structure; freed when it terminates
+}
+
+
+kern_return_t thread_terminate(thread_t thread) {
+	if (thread == g_host_current_thread) {
+		free(thread);
+		pthread_exit(NULL);
+	}
+	return KERN_FAILURE; // we only support threads terminating themselves
+}
+
+
+thread_t current_thread(void) {
+	return g_host_current_thread;
+}
+
+
+void sysctl_register_oid(struct sysctl_oid* oidp) {
+	(void) pthread_mutex_lock(&g_host_lock);
+	oidp->oid_link.sle_next = oidp->oid_parent->slh_first;
+	oidp->oid_parent->slh_first = oidp;
+	(void) pthread_mutex_unlock(&g_host_lock);
+}
+
+
+void sysctl_unregister_oid(struct sysctl_oid* oidp) {
+	(void) pthread_mutex_lock(&g_host_lock);
+	for (struct sysctl_oid** it = &oidp->oid_parent->slh_first; *it; it = &(*it)->oid_link.sle_next) {
+		if (*it == oidp) {
+			*it = oidp->oid_link.sle_next;
+			break;
+		}
+	}
+	(void) pthread_mutex_unlock(&g_host_lock);
+}
+
+
+int sysctl_handle_int SYSCTL_HANDLER_ARGS {
+	int value = arg1 ? *(int*) arg1: arg2;
+	int retval = SYSCTL_OUT(req, &value, sizeof(value));
+	if ((retval == 0) && req->newptr) {
+		retval = arg1 ? SYSCTL_IN(req, arg1, sizeof(int)): EPERM;
+	}
+	return retval;
+}
+
+
+int sysctl_handle_quad SYSCTL_HANDLER_ARGS {
+	int retval = SYSCTL_OUT(req, arg1, sizeof(int64_t));
+	if ((retval == 0) && req->newptr) {
+		retval = SYSCTL_IN(req, arg1, sizeof(int64_t));
+	}
+	return retval;
+}
+
+
+int sysctl_handle_string SYSCTL_HANDLER_ARGS {
+	int retval = SYSCTL_OUT(req, arg1, strlen(arg1) + 1);
+	if ((retval == 0) && req->newptr) {
+		size_t len = req->newlen - req->newidx;
+		if (len >= (size_t) arg2) {
+			retval = EINVAL;
+		} else {
+			retval = SYSCTL_IN(req, arg1, len);
+			((char*) arg1)[len] = '\0';
+		}
+	}
+	return retval;
+}
+
+
+int sysctl_handle_opaque SYSCTL_HANDLER_ARGS {
+	int retval = SYSCTL_OUT(req, arg1, arg2);
+	if ((retval == 0) && req->newptr) {
+		retval = SYSCTL_IN(req, arg1, arg2);
+	}
+	return retval;
+}
@@ -0,0 +1,140 @@
+//
+//  host_kern.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_kern_h
+#define wormxattr_host_kern_h
+
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <mach/mach_types.h>
+#include <sys/kauth.h>
+#include <sys/mount.h>
+#include <sys/vnode.h>
+#include <security/mac_policy.h>
+
+
+/*
+ * Description
+ *
+ * The host runtime stands in for the parts of xnu the policy uses; credentials,
+ * mounts, vnodes with an in memory extended attribute store, labels and policy
+ * registration.  The policy sources are compiled unchanged against it so that
+ * benchmarks and tests can call the hooks directly from userspace.
+ */
+
+
+/*
+ * Defines
+ */
+
+#ifndef __private_extern__
+#define __private_extern__				extern __attribute__((visibility("hidden")))
+#endif
+
+#define k_host_label_slots				4
+#define k_host_xattr_max				8
+#define k_host_xattr_namelen			128
+#define k_host_xattr_valuelen			64
+
+
+/*
+ * Definitions
+ */
+
+struct ucred {
+	uid_t		cr_uid;
+	gid_t		cr_gid;
+};
+
+struct label {
+	intptr_t	l_perpolicy[k_host_label_slots];
+};
+
+/**
+ * @brief	a single extended attribute stored against a host vnode
+ */
+struct host_xattr {
+	char		name[k_host_xattr_namelen];
+	size_t		len;
+	char		value[k_host_xattr_valuelen];
+};
+
+struct mount {
+	struct vfsstatfs	mnt_vfsstat;
+	struct label		mnt_label;
+	struct vnode*		mnt_root;
+};
+
+struct vnode {
+	enum vtype			v_type;
+	uint32_t			v_id;
+	uint64_t			v_fileid;
+	struct mount*		v_mount;
+	struct vnode*		v_parent;
+	char				v_name[NAME_MAX + 1];
+	struct label		v_label;
+	pthread_mutex_t		v_lock;
+	int					v_xattr_count;
+	int					v_xattr_reads;		// mac_vnop_getxattr calls; so cases can check none were made
+	struct host_xattr	v_xattrs[k_host_xattr_max];
+};
+
+/**
+ * @brief	where kernel printf output is sent
+ */
+typedef enum {
+	k_host_log_stdout = 0,	// formatted and written to stdout
+	k_host_log_discard,		// formatted (so the cost is paid) then dropped
+} host_log_t;
+
+extern host_log_t host_log_sink;
+extern uint64_t host_xattr_delay_ns;
+extern int64_t host_clock_offset;			// seconds added to the calendar clock
+
+extern void host_kern_start(void);
+extern void host_kern_stop(void);
+extern struct mac_policy_ops* host_policy_ops(void);
+
+extern struct mount* host_mount_create(const char* fstypename, const char* mntonname);
+extern void host_mount_destroy(struct mount* mp);
+
+extern struct vnode* host_vnode_create(struct mount* mp, struct vnode* dvp, const char* name, enum vtype type);
+extern void host_vnode_associate(struct vnode* vp);
+extern void host_vnode_recycle(struct vnode* vp);
+extern void host_vnode_destroy(struct vnode* vp);
+
+extern int host_xattr_set(struct vnode* vp, const char* name, const void* value, size_t len);
+extern int host_xattr_remove(struct vnode* vp, const char* name);
+
+extern int host_sysctlbyname(const char* name, void* oldp, size_t* oldlenp, const void* newp, size_t newlen);
+
+extern uint64_t host_now_ns(void);
+extern void host_panic(const char* str, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+
+#endif
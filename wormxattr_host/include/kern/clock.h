@@ -0,0 +1,45 @@
+//
+//  clock.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_kern_clock_h
+#define wormxattr_host_kern_clock_h
+
+
+/*
+ * Stand-in for the xnu <kern/clock.h>; absolute time is in nanoseconds
+ */
+
+#include <stdint.h>
+
+typedef unsigned long clock_sec_t;
+typedef uint32_t clock_usec_t;
+
+extern uint64_t mach_absolute_time(void);
+extern void absolutetime_to_nanoseconds(uint64_t abstime, uint64_t* result);
+extern void nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t* result);
+extern void clock_get_calendar_microtime(clock_sec_t* secs, clock_usec_t* microsecs);
+
+
+#endif
@@ -0,0 +1,60 @@
+//
+//  locks.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_kern_locks_h
+#define wormxattr_host_kern_locks_h
+
+
+/*
+ * Stand-in for the xnu <kern/locks.h>; mutexes are pthread mutexes
+ */
+
+#include <pthread.h>
+
+typedef struct __lck_grp_t {
+	char				name[64];
+} lck_grp_t;
+
+typedef struct __lck_mtx_t {
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;	// used by msleep/wakeup
+	struct __lck_mtx_t*	next;
+} lck_mtx_t;
+
+typedef void lck_grp_attr_t;
+typedef void lck_attr_t;
+
+#define LCK_GRP_ATTR_NULL				((lck_grp_attr_t*) 0)
+#define LCK_ATTR_NULL					((lck_attr_t*) 0)
+
+extern lck_grp_t* lck_grp_alloc_init(const char* name, lck_grp_attr_t* attr);
+extern void lck_grp_free(lck_grp_t* grp);
+extern lck_mtx_t* lck_mtx_alloc_init(lck_grp_t* grp, lck_attr_t* attr);
+extern void lck_mtx_free(lck_mtx_t* lck, lck_grp_t* grp);
+extern void lck_mtx_lock(lck_mtx_t* lck);
+extern void lck_mtx_unlock(lck_mtx_t* lck);
+
+
+#endif
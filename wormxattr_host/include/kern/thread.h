@@ -0,0 +1,48 @@
+//
+//  thread.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_kern_thread_h
+#define wormxattr_host_kern_thread_h
+
+
+/*
+ * Stand-in for the xnu <kern/thread.h>; kernel threads are pthreads
+ */
+
+#include <mach/mach_types.h>
+
+typedef struct __host_thread* thread_t;
+typedef int wait_result_t;
+typedef void (*thread_continue_t)(void* parameter, wait_result_t wresult);
+
+#define THREAD_NULL						((thread_t) 0)
+
+extern kern_return_t kernel_thread_start(thread_continue_t continuation, void* parameter, thread_t* new_thread);
+extern void thread_deallocate(thread_t thread);
+extern kern_return_t thread_terminate(thread_t thread);
+extern thread_t current_thread(void);
+
+
+#endif
@@ -0,0 +1,80 @@
+//
+//  OSAtomic.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_libkern_OSAtomic_h
+#define wormxattr_host_libkern_OSAtomic_h
+
+
+/*
+ * Stand-in for the xnu <libkern/OSAtomic.h>; implemented with the compiler builtins
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int32_t SInt32;
+typedef int64_t SInt64;
+typedef uint32_t UInt32;
+typedef uint64_t UInt64;
+typedef bool Boolean;
+
+static inline Boolean OSCompareAndSwap(UInt32 oldValue, UInt32 newValue, volatile UInt32* address) {
+	return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+
+static inline Boolean OSCompareAndSwap64(UInt64 oldValue, UInt64 newValue, volatile UInt64* address) {
+	return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+
+static inline Boolean OSCompareAndSwapPtr(void* oldValue, void* newValue, void* volatile* address) {
+	return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+
+static inline SInt32 OSAddAtomic(SInt32 amount, volatile SInt32* address) {
+	return __sync_fetch_and_add(address, amount);
+}
+
+static inline SInt64 OSAddAtomic64(SInt64 amount, volatile SInt64* address) {
+	return __sync_fetch_and_add(address, amount);
+}
+
+static inline SInt32 OSIncrementAtomic(volatile SInt32* address) {
+	return __sync_fetch_and_add(address, 1);
+}
+
+static inline SInt32 OSDecrementAtomic(volatile SInt32* address) {
+	return __sync_fetch_and_sub(address, 1);
+}
+
+static inline SInt64 OSIncrementAtomic64(volatile SInt64* address) {
+	return __sync_fetch_and_add(address, 1);
+}
+
+static inline void OSMemoryBarrier(void) {
+	__sync_synchronize();
+}
+
+
+#endif
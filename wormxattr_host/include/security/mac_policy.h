@@ -0,0 +1,157 @@
+//
+//  mac_policy.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_security_mac_policy_h
+#define wormxattr_host_security_mac_policy_h
+
+
+/*
+ * Stand-in for the xnu <security/mac_policy.h>; only the hooks and KPI's
+ * used by the policy are declared.  Signatures match the xnu originals.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/kauth.h>
+
+struct attrlist;
+struct componentname;
+struct label;
+struct mac_policy_conf;
+struct mount;
+struct uio;
+struct vnode;
+struct vnode_attr;
+
+
+/*
+ * Policy hooks
+ */
+
+typedef void mpo_policy_init_t(struct mac_policy_conf *mpc);
+
+typedef int mpo_mount_check_umount_t(kauth_cred_t cred, struct mount *mp, struct label *mlabel);
+typedef void mpo_mount_label_associate_t(kauth_cred_t cred, struct mount *mp, struct label *mntlabel);
+typedef void mpo_mount_label_destroy_t(struct label *label);
+typedef void mpo_mount_label_init_t(struct label *label);
+
+typedef int mpo_vnode_check_access_t(kauth_cred_t cred, struct vnode *vp, struct label *label, int acc_mode);
+typedef int mpo_vnode_check_create_t(kauth_cred_t cred, struct vnode *dvp, struct label *dlabel, struct componentname *cnp, struct vnode_attr *vap);
+typedef int mpo_vnode_check_deleteextattr_t(kauth_cred_t cred, struct vnode *vp, struct label *vlabel, const char *name);
+typedef int mpo_vnode_check_exchangedata_t(kauth_cred_t cred, struct vnode *v1, struct label *vl1, struct vnode *v2, struct label *vl2);
+typedef int mpo_vnode_check_link_t(kauth_cred_t cred, struct vnode *dvp, struct label *dlabel, struct vnode *vp, struct label *label, struct componentname *cnp);
+typedef int mpo_vnode_check_open_t(kauth_cred_t cred, struct vnode *vp, struct label *label, int acc_mode);
+typedef int mpo_vnode_check_rename_from_t(kauth_cred_t cred, struct vnode *dvp, struct label *dlabel, struct vnode *vp, struct label *label, struct componentname *cnp);
+typedef int mpo_vnode_check_rename_to_t(kauth_cred_t cred, struct vnode *dvp, struct label *dlabel, struct vnode *vp, struct label *label, int samedir, struct componentname *cnp);
+typedef int mpo_vnode_check_select_t(kauth_cred_t cred, struct vnode *vp, struct label *label, int which);
+typedef int mpo_vnode_check_setattrlist_t(kauth_cred_t cred, struct vnode *vp, struct label *vlabel, struct attrlist *alist);
+typedef int mpo_vnode_check_setextattr_t(kauth_cred_t cred, struct vnode *vp, struct label *label, const char *name, struct uio *uio);
+typedef int mpo_vnode_check_setflags_t(kauth_cred_t cred, struct vnode *vp, struct label *label, u_long flags);
+typedef int mpo_vnode_check_setmode_t(kauth_cred_t cred, struct vnode *vp, struct label *label, mode_t mode);
+typedef int mpo_vnode_check_setowner_t(kauth_cred_t cred, struct vnode *vp, struct label *label, uid_t uid, gid_t gid);
+typedef int mpo_vnode_check_setutimes_t(kauth_cred_t cred, struct vnode *vp, struct label *label, struct timespec atime, struct timespec mtime);
+typedef int mpo_vnode_check_truncate_t(kauth_cred_t active_cred, kauth_cred_t file_cred, struct vnode *vp, struct label *label);
+typedef int mpo_vnode_check_unlink_t(kauth_cred_t cred, struct vnode *dvp, struct label *dlabel, struct vnode *vp, struct label *label, struct componentname *cnp);
+typedef int mpo_vnode_label_associate_extattr_t(struct mount *mp, struct label *mntlabel, struct vnode *vp, struct label *vlabel);
+typedef void mpo_vnode_label_copy_t(struct label *src, struct label *dest);
+typedef void mpo_vnode_label_destroy_t(struct label *label);
+typedef void mpo_vnode_label_recycle_t(struct label *label);
+typedef int mpo_vnode_label_update_extattr_t(struct mount *mp, struct label *mntlabel, struct vnode *vp, struct label *vlabel, const char *name);
+typedef int mpo_vnode_notify_create_t(kauth_cred_t cred, struct mount *mp, struct label *mntlabel, struct vnode *dvp, struct label *dlabel, struct vnode *vp, struct label *vlabel, struct componentname *cnp);
+typedef void mpo_vnode_notify_rename_t(kauth_cred_t cred, struct vnode *vp, struct label *label, struct vnode *dvp, struct label *dlabel, struct componentname *cnp);
+
+struct mac_policy_ops {
+	mpo_policy_init_t						*mpo_policy_init;
+	mpo_mount_check_umount_t				*mpo_mount_check_umount;
+	mpo_mount_label_associate_t				*mpo_mount_label_associate;
+	mpo_mount_label_destroy_t				*mpo_mount_label_destroy;
+	mpo_mount_label_init_t					*mpo_mount_label_init;
+	mpo_vnode_check_access_t				*mpo_vnode_check_access;
+	mpo_vnode_check_create_t				*mpo_vnode_check_create;
+	mpo_vnode_check_deleteextattr_t			*mpo_vnode_check_deleteextattr;
+	mpo_vnode_check_exchangedata_t			*mpo_vnode_check_exchangedata;
+	mpo_vnode_check_link_t					*mpo_vnode_check_link;
+	mpo_vnode_check_open_t					*mpo_vnode_check_open;
+	mpo_vnode_check_rename_from_t			*mpo_vnode_check_rename_from;
+	mpo_vnode_check_rename_to_t				*mpo_vnode_check_rename_to;
+	mpo_vnode_check_select_t				*mpo_vnode_check_select;
+	mpo_vnode_check_setattrlist_t			*mpo_vnode_check_setattrlist;
+	mpo_vnode_check_setextattr_t			*mpo_vnode_check_setextattr;
+	mpo_vnode_check_setflags_t				*mpo_vnode_check_setflags;
+	mpo_vnode_check_setmode_t				*mpo_vnode_check_setmode;
+	mpo_vnode_check_setowner_t				*mpo_vnode_check_setowner;
+	mpo_vnode_check_setutimes_t				*mpo_vnode_check_setutimes;
+	mpo_vnode_check_truncate_t				*mpo_vnode_check_truncate;
+	mpo_vnode_check_unlink_t				*mpo_vnode_check_unlink;
+	mpo_vnode_label_associate_extattr_t		*mpo_vnode_label_associate_extattr;
+	mpo_vnode_label_copy_t					*mpo_vnode_label_copy;
+	mpo_vnode_label_destroy_t				*mpo_vnode_label_destroy;
+	mpo_vnode_label_recycle_t				*mpo_vnode_label_recycle;
+	mpo_vnode_label_update_extattr_t		*mpo_vnode_label_update_extattr;
+	mpo_vnode_notify_create_t				*mpo_vnode_notify_create;
+	mpo_vnode_notify_rename_t				*mpo_vnode_notify_rename;
+};
+
+
+/*
+ * Policy registration
+ */
+
+typedef unsigned int mac_policy_handle_t;
+
+#define MPC_LOADTIME_FLAG_NOTLATE		0x00000001
+#define MPC_LOADTIME_FLAG_UNLOADOK		0x00000002
+
+struct mac_policy_conf {
+	const char				*mpc_name;
+	const char				*mpc_fullname;
+	const char				**mpc_labelnames;
+	unsigned int			mpc_labelname_count;
+	struct mac_policy_ops	*mpc_ops;
+	int						mpc_loadtime_flags;
+	int						*mpc_field_off;
+	int						mpc_runtime_flags;
+	struct mac_policy_conf	*mpc_list;
+	void					*mpc_data;
+};
+
+extern int mac_policy_register(struct mac_policy_conf *mpc, mac_policy_handle_t *handlep, void *xd);
+extern int mac_policy_unregister(mac_policy_handle_t handle);
+
+
+/*
+ * Label and vnode KPI
+ */
+
+extern intptr_t mac_label_get(struct label *l, int slot);
+extern void mac_label_set(struct label *l, int slot, intptr_t v);
+
+extern int mac_vnop_setxattr(struct vnode *vp, const char *name, char *buf, size_t len);
+extern int mac_vnop_getxattr(struct vnode *vp, const char *name, char *buf, size_t len, size_t *attrlen);
+extern int mac_vnop_removexattr(struct vnode *vp, const char *name);
+
+
+#endif
@@ -0,0 +1,46 @@
+//
+//  malloc.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_malloc_h
+#define wormxattr_host_sys_malloc_h
+
+
+/*
+ * Stand-in for the xnu <sys/malloc.h>; allocations come from the C heap
+ */
+
+#include <stdlib.h>
+
+#define M_TEMP							80
+
+#define M_WAITOK						0x0000
+#define M_NOWAIT						0x0001
+#define M_ZERO							0x0004
+
+#define _MALLOC(size, type, flags)		(((flags) & M_ZERO) ? calloc(1, (size)): malloc(size))
+#define _FREE(addr, type)				free(addr)
+
+
+#endif
@@ -0,0 +1,59 @@
+//
+//  mount.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_mount_h
+#define wormxattr_host_sys_mount_h
+
+
+/*
+ * Stand-in for the xnu <sys/mount.h>
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+#define MFSTYPENAMELEN					16
+
+typedef struct mount* mount_t;
+
+// glibc has its own fsid_t; so ours is renamed
+#define fsid_t							host_fsid_t
+
+typedef struct fsid { 
+	int32_t		val[2]; 
+} fsid_t;
+
+struct vfsstatfs {
+	fsid_t		f_fsid;
+	char		f_fstypename[MFSTYPENAMELEN];
+	char		f_mntonname[MAXPATHLEN];
+	char		f_mntfromname[MAXPATHLEN];
+};
+
+extern struct vfsstatfs* vfs_statfs(mount_t mp);
+
+
+#endif
@@ -0,0 +1,48 @@
+//
+//  proc.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_proc_h
+#define wormxattr_host_sys_proc_h
+
+
+/*
+ * Stand-in for the xnu <sys/proc.h>; sleep/wakeup
+ */
+
+#include <time.h>
+#include <kern/locks.h>
+
+#define PZERO							22
+#define PRIBIO							(PZERO + 8)
+
+#ifndef EWOULDBLOCK
+#define EWOULDBLOCK						EAGAIN
+#endif
+
+extern int msleep(void* chan, lck_mtx_t* mtx, int pri, const char* wmesg, struct timespec* ts);
+extern void wakeup(void* chan);
+
+
+#endif
@@ -0,0 +1,128 @@
+//
+//  sysctl.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_sysctl_h
+#define wormxattr_host_sys_sysctl_h
+
+
+/*
+ * Stand-in for the xnu <sys/sysctl.h>; oids are registered into an in memory
+ * tree which the host runtime can read/write by name (see host_sysctlbyname)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CTLTYPE							0xf
+#define CTLTYPE_NODE					1
+#define CTLTYPE_INT						2
+#define CTLTYPE_STRING					3
+#define CTLTYPE_QUAD					4
+#define CTLTYPE_OPAQUE					5
+
+#define CTLFLAG_RD						0x80000000
+#define CTLFLAG_WR						0x40000000
+#define CTLFLAG_RW						(CTLFLAG_RD | CTLFLAG_WR)
+#define CTLFLAG_ANYBODY					0x10000000
+#define CTLFLAG_LOCKED					0x00800000
+
+#define OID_AUTO						(-1)
+
+struct sysctl_oid;
+
+struct sysctl_req {
+	void*		oldptr;
+	size_t		oldlen;
+	size_t		oldidx;
+	int			(*oldfunc)(struct sysctl_req* req, const void* ptr, size_t len);
+	const void*	newptr;
+	size_t		newlen;
+	size_t		newidx;
+	int			(*newfunc)(struct sysctl_req* req, void* ptr, size_t len);
+};
+
+#define SYSCTL_HANDLER_ARGS				(struct sysctl_oid* oidp, void* arg1, int arg2, struct sysctl_req* req)
+#define SYSCTL_IN(r, p, l)				((r)->newfunc)(r, p, l)
+#define SYSCTL_OUT(r, p, l)				((r)->oldfunc)(r, p, l)
+
+struct sysctl_oid_list {
+	struct sysctl_oid*		slh_first;
+};
+
+struct sysctl_oid {
+	struct sysctl_oid_list*	oid_parent;
+	struct {
+		struct sysctl_oid*	sle_next;
+	} oid_link;
+	int						oid_number;
+	int						oid_kind;
+	void*					oid_arg1;
+	int						oid_arg2;
+	const char*				oid_name;
+	int						(*oid_handler) SYSCTL_HANDLER_ARGS;
+	const char*				oid_fmt;
+	const char*				oid_descr;
+	int						oid_version;
+	int						oid_refcnt;
+};
+
+#define SYSCTL_DECL(name)				extern struct sysctl_oid_list sysctl_##name##_children
+
+#define SYSCTL_OID(parent, nbr, name, kind, a1, a2, handler, fmt, descr) \
+	struct sysctl_oid sysctl_##parent##_##name = { \
+		&sysctl_##parent##_children, {0}, nbr, kind, a1, a2, #name, handler, fmt, descr, 1, 0 }
+
+#define SYSCTL_NODE(parent, nbr, name, access, handler, descr) \
+	struct sysctl_oid_list sysctl_##parent##_##name##_children; \
+	SYSCTL_OID(parent, nbr, name, CTLTYPE_NODE | access, (void*) &sysctl_##parent##_##name##_children, 0, handler, "N", descr)
+
+#define SYSCTL_INT(parent, nbr, name, access, ptr, val, descr) \
+	SYSCTL_OID(parent, nbr, name, CTLTYPE_INT | access, ptr, val, sysctl_handle_int, "I", descr)
+
+#define SYSCTL_UINT(parent, nbr, name, access, ptr, val, descr) \
+	SYSCTL_OID(parent, nbr, name, CTLTYPE_INT | access, ptr, val, sysctl_handle_int, "IU", descr)
+
+#define SYSCTL_QUAD(parent, nbr, name, access, ptr, descr) \
+	SYSCTL_OID(parent, nbr, name, CTLTYPE_QUAD | access, ptr, 0, sysctl_handle_quad, "Q", descr)
+
+#define SYSCTL_STRING(parent, nbr, name, access, arg, len, descr) \
+	SYSCTL_OID(parent, nbr, name, CTLTYPE_STRING | access, arg, len, sysctl_handle_string, "A", descr)
+
+#define SYSCTL_OPAQUE(parent, nbr, name, access, ptr, len, fmt, descr) \
+	SYSCTL_OID(parent, nbr, name, CTLTYPE_OPAQUE | access, ptr, len, sysctl_handle_opaque, fmt, descr)
+
+#define SYSCTL_PROC(parent, nbr, name, access, ptr, arg, handler, fmt, descr) \
+	SYSCTL_OID(parent, nbr, name, access, ptr, arg, handler, fmt, descr)
+
+extern void sysctl_register_oid(struct sysctl_oid* oidp);
+extern void sysctl_unregister_oid(struct sysctl_oid* oidp);
+
+extern int sysctl_handle_int SYSCTL_HANDLER_ARGS;
+extern int sysctl_handle_quad SYSCTL_HANDLER_ARGS;
+extern int sysctl_handle_string SYSCTL_HANDLER_ARGS;
+extern int sysctl_handle_opaque SYSCTL_HANDLER_ARGS;
+
+
+#endif
@@ -0,0 +1,84 @@
+//
+//  systm.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_systm_h
+#define wormxattr_host_sys_systm_h
+
+
+/*
+ * Stand-in for the xnu <sys/systm.h>; provides the kernel printf/panic and 
+ * libc style routines the policy sources use, routed through the host runtime
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+
+/*
+ * Defines
+ */
+
+#define __private_extern__				extern __attribute__((visibility("hidden")))
+
+#ifndef ENOATTR
+#define ENOATTR							ENODATA
+#endif
+
+
+/*
+ * Definitions
+ */
+
+struct label; // xnu headers pre define this before the policy headers see it
+
+extern int host_printf(const char* str, ...) __attribute__((format(printf, 1, 2)));
+extern int host_vprintf(const char* str, va_list args);
+extern void host_panic(const char* str, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+#define printf(str, ...)				host_printf(str, ##__VA_ARGS__)
+#define vprintf(str, args)				host_vprintf(str, args)
+#define panic(str, ...)					host_panic(str, ##__VA_ARGS__)
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+// libkern provides strlcpy; older glibc doesn't
+static inline size_t strlcpy(char* dst, const char* src, size_t size) {
+	size_t len = strlen(src);
+	if (size) {
+		size_t n = (len < size) ? len: size - 1;
+		(void) memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+	return len;
+}
+#endif
+
+
+#endif
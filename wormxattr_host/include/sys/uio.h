@@ -0,0 +1,57 @@
+//
+//  uio.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_uio_h
+#define wormxattr_host_sys_uio_h
+
+
+/*
+ * Stand-in for the xnu <sys/uio.h>; a uio is a single buffer being written from
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef ssize_t user_ssize_t;
+
+/**
+ * @brief	a single buffer; callers (the tests) build them directly
+ *
+ * @field	base	the data not yet moved
+ * @field	resid	the bytes not yet moved
+ */
+struct uio {
+	const char*		base;
+	size_t			resid;
+};
+typedef struct uio* uio_t;
+
+extern user_ssize_t uio_resid(uio_t uio);
+extern uio_t uio_duplicate(uio_t uio);
+extern void uio_free(uio_t uio);
+extern int uiomove(const char* cp, int n, struct uio* uio);
+
+
+#endif
@@ -0,0 +1,97 @@
+//
+//  vnode.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_sys_vnode_h
+#define wormxattr_host_sys_vnode_h
+
+
+/*
+ * Stand-in for the xnu <sys/vnode.h>; vnodes are provided by the host runtime
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+typedef struct vnode* vnode_t;
+typedef struct vfs_context* vfs_context_t;
+
+#define NULLVP							((struct vnode*) NULL)
+
+enum vtype { VNON, VREG, VDIR, VBLK, VCHR, VLNK, VSOCK, VFIFO, VBAD, VSTR, VCPLX };
+
+#define VEXEC							0x040
+#define VWRITE							0x080
+#define VREAD							0x100
+
+struct componentname {
+	uint32_t	cn_nameiop;
+	uint32_t	cn_flags;
+	char*		cn_pnbuf;
+	int			cn_pnlen;
+	char*		cn_nameptr;
+	int			cn_namelen;
+	uint32_t	cn_hash;
+	uint32_t	cn_consume;
+};
+
+/**
+ * @brief	the attributes the host supports getting; a subset of xnu's
+ */
+struct vnode_attr {
+	uint64_t	va_supported;
+	uint64_t	va_active;
+	int			va_vaflags;
+	uint64_t	va_fileid;
+	uint64_t	va_parentid;
+};
+
+#define VNODE_ATTR_va_fileid			(1ll << 0)
+#define VNODE_ATTR_va_parentid			(1ll << 1)
+
+#define VATTR_INIT(v)					do { (v)->va_supported = (v)->va_active = 0ll; (v)->va_vaflags = 0; } while (0)
+#define VATTR_WANTED(v, a)				((v)->va_active |= VNODE_ATTR_ ## a)
+#define VATTR_IS_SUPPORTED(v, a)		((v)->va_supported & VNODE_ATTR_ ## a)
+
+extern int vnode_isdir(vnode_t vp);
+extern int vnode_isvroot(vnode_t vp);
+extern enum vtype vnode_vtype(vnode_t vp);
+extern struct mount* vnode_mount(vnode_t vp);
+extern uint32_t vnode_vid(vnode_t vp);
+extern int vn_getpath(vnode_t vp, char* buf, int* len);
+extern int vnode_getattr(vnode_t vp, struct vnode_attr* vap, vfs_context_t ctx);
+extern const char* vnode_getname(vnode_t vp);
+extern void vnode_putname(const char* name);
+extern vnode_t vnode_getparent(vnode_t vp);
+extern int vnode_getwithvid(vnode_t vp, uint32_t vid);
+extern int vnode_put(vnode_t vp);
+extern int vnode_ref(vnode_t vp);
+extern void vnode_rele(vnode_t vp);
+extern int vnode_getwithref(vnode_t vp);
+extern int vnode_lookup(const char* path, int flags, vnode_t* vpp, vfs_context_t ctx);
+extern vfs_context_t vfs_context_current(void);
+
+
+#endif
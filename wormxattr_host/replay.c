@@ -0,0 +1,477 @@
+//
+//  replay.c
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/fcntl.h>
+
+#include "host_kern.h"
+#include "trace.h"
+#include "wormxattr.h"
+
+
+/*
+ * Description
+ *
+ * Replays a recorded trace (see trace.h; strace2trace makes one from strace output)
+ * through the policy hooks at full speed.  Each thread replays the whole trace 
+ * against its own mount and vnodes, as N clients running the same workload would,
+ * so results are deterministic however many threads are used.  Reported are the 
+ * aggregate events per second, and per hook the calls, denials and time spent.
+ *
+ * Every hook call is timed; the clock read (~20ns) is included in the hook times
+ * but not in the events per second of a run with -q.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_replay_uid					501
+#define k_replay_gid					20
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the hooks a replay calls; indexes per hook statistics
+ */
+enum {
+	k_hook_associate = 0,
+	k_hook_notify_create,
+	k_hook_check_open,
+	k_hook_check_unlink,
+	k_hook_check_rename_from,
+	k_hook_notify_rename,
+	k_hook_check_setextattr,
+	k_hook_update_extattr,
+	k_hook_check_truncate,
+	k_hook_check_create,
+	k_hook_check_rename_to,
+	k_hook_count
+};
+
+static const char* g_hook_names[k_hook_count] = {
+	"vnode_label_associate_extattr",
+	"vnode_notify_create",
+	"vnode_check_open",
+	"vnode_check_unlink",
+	"vnode_check_rename_from",
+	"vnode_notify_rename",
+	"vnode_check_setextattr",
+	"vnode_label_update_extattr",
+	"vnode_check_truncate",
+	"vnode_check_create",
+	"vnode_check_rename_to",
+};
+
+/**
+ * @brief	per hook statistics
+ */
+typedef struct __replay_hook_t {
+	uint64_t	calls;
+	uint64_t	denied;
+	uint64_t	ns;
+} replay_hook_t;
+
+/**
+ * @brief	per thread state
+ */
+typedef struct __replay_thread_t {
+	pthread_t		thread;
+	struct mount*	mp;
+	struct vnode**	vnodes;			// indexed by trace vnode
+	struct vnode**	removed;		// unlinked vnodes; kept until teardown as children may refer to them
+	uint64_t		elapsed;
+	uint64_t		skipped;		// events against vnodes which were removed
+	replay_hook_t	hooks[k_hook_count];
+} replay_thread_t;
+
+
+static struct mac_policy_ops* g_ops = NULL;
+static struct ucred g_cred = {k_replay_uid, k_replay_gid};
+static struct componentname g_cn = {0};
+
+static const trace_header_t* g_header = NULL;
+static const trace_event_t* g_events = NULL;
+static int g_threads = 1;
+static int g_loops = 1;
+static int g_timed = 1;
+static int g_deferred = 0;
+
+static pthread_barrier_t g_barrier;
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	reads and validates a trace; so the replay itself needs no checks
+ *
+ * @param	path	the trace file
+ *
+ * @return	the trace (header followed by events)
+ */
+static trace_header_t* replay_load(const char* path) {
+	FILE* f = fopen(path, "rb");
+	trace_header_t header = {0};
+	trace_header_t* retval = NULL;
+	uint8_t* seen = NULL;
+
+	if (f == NULL) {
+		host_panic("Unable to open %s; %s\n", path, strerror(errno));
+	}
+	if (	(fread(&header, sizeof(header), 1, f) != 1)
+		 || (header.magic != k_trace_magic)
+		 || (header.version != k_trace_version)
+		 || (header.vnodes == 0)) {
+		host_panic("%s isn't a trace\n", path);
+	}
+	retval = malloc(sizeof(header) + (size_t) header.events * sizeof(trace_event_t));
+	seen = calloc(header.vnodes, 1);
+	if ((retval == NULL) || (seen == NULL)) {
+		host_panic("Out of memory\n");
+	}
+	*retval = header;
+	trace_event_t* events = (trace_event_t*) (retval + 1);
+	if (fread(events, sizeof(trace_event_t), header.events, f) != header.events) {
+		host_panic("%s is truncated\n", path);
+	}
+	(void) fclose(f);
+
+	seen[k_trace_root] = 1;
+	for (uint32_t i = 0; i < header.events; i++) {
+		trace_event_t* ev = &events[i];
+		int introduces = (ev->op == k_trace_exist) || (ev->op == k_trace_create);
+		if (	(ev->op >= k_trace_ops)
+			 || (ev->vnode >= header.vnodes)
+			 || (ev->dir >= header.vnodes)
+			 || ((ev->op == k_trace_rename) && (ev->arg >= header.vnodes))
+			 || (introduces && seen[ev->vnode])
+			 || (!introduces && !seen[ev->vnode])) {
+			host_panic("%s: event %u is invalid\n", path, i);
+		}
+		seen[ev->vnode] = 1;
+	}
+	free(seen);
+	return retval;
+}
+
+
+/**
+ * @brief	accounts for a hook call
+ */
+static inline void replay_hook(replay_thread_t* t, int hook, int error, uint64_t start) {
+	replay_hook_t* h = &t->hooks[hook];
+	h->calls++;
+	if (error) {
+		h->denied++;
+	}
+	if (g_timed) {
+		h->ns += host_now_ns() - start;
+	}
+}
+
+
+static inline uint64_t replay_now(void) {
+	return g_timed ? host_now_ns(): 0;
+}
+
+
+/**
+ * @brief	replays a single event, calling the hooks the kernel would
+ *
+ * @param	t		the thread
+ * @param	ev		the event
+ */
+static void replay_event(replay_thread_t* t, const trace_event_t* ev) {
+	struct vnode* vp = t->vnodes[ev->vnode];
+	struct vnode* dvp = t->vnodes[ev->dir];
+	uint64_t start = 0;
+	int error = 0;
+
+	if (	((vp == NULL) && (ev->op != k_trace_exist) && (ev->op != k_trace_create))
+		 || (dvp == NULL)) {
+		t->skipped++; // it, or its directory, was removed (or the directory denied its creation)
+		return;
+	}
+	switch (ev->op) {
+		case k_trace_exist:
+			vp = host_vnode_create(t->mp, dvp, "exist", (ev->flags & k_trace_flag_dir) ? VDIR: VREG);
+			if (ev->flags & k_trace_flag_worm) {
+				char state = 1;
+				(void) host_xattr_set(vp, k_wormxattr_xattr, &state, sizeof(state));
+			}
+			start = replay_now();
+			error = g_ops->mpo_vnode_label_associate_extattr(t->mp, &t->mp->mnt_label, vp, &vp->v_label);
+			replay_hook(t, k_hook_associate, error, start);
+			t->vnodes[ev->vnode] = vp;
+			break;
+
+		case k_trace_create:
+			start = replay_now();
+			error = g_ops->mpo_vnode_check_create(&g_cred, dvp, &dvp->v_label, &g_cn, NULL);
+			replay_hook(t, k_hook_check_create, error, start);
+			if (error == 0) {
+			vp = host_vnode_create(t->mp, dvp, "create", (ev->flags & k_trace_flag_dir) ? VDIR: VREG);
+			start = replay_now();
+			error = g_ops->mpo_vnode_notify_create(&g_cred, t->mp, &t->mp->mnt_label, dvp, &dvp->v_label, vp, &vp->v_label, &g_cn);
+			replay_hook(t, k_hook_notify_create, error, start);
+			t->vnodes[ev->vnode] = vp;
+			}
+			break;
+
+		case k_trace_open: {
+			int mode = O_RDONLY;
+			if (ev->arg & k_trace_open_write) {
+				mode = (ev->arg & k_trace_open_read) ? O_RDWR: O_WRONLY;
+			}
+			mode = FFLAGS(mode);
+			mode |= (ev->arg & k_trace_open_trunc) ? O_TRUNC: 0;
+			mode |= (ev->arg & k_trace_open_append) ? O_APPEND: 0;
+			start = replay_now();
+			error = g_ops->mpo_vnode_check_open(&g_cred, vp, &vp->v_label, mode);
+			replay_hook(t, k_hook_check_open, error, start);
+			break;
+		}
+
+		case k_trace_unlink:
+			start = replay_now();
+			error = g_ops->mpo_vnode_check_unlink(&g_cred, dvp, &dvp->v_label, vp, &vp->v_label, &g_cn);
+			replay_hook(t, k_hook_check_unlink, error, start);
+			if (error == 0) {
+				t->removed[ev->vnode] = vp;
+				t->vnodes[ev->vnode] = NULL;
+			}
+			break;
+
+		case k_trace_rename: {
+			struct vnode* tdvp = t->vnodes[ev->arg];
+			if (tdvp == NULL) {
+				t->skipped++;
+				break;
+			}
+			start = replay_now();
+			error = g_ops->mpo_vnode_check_rename_from(&g_cred, dvp, &dvp->v_label, vp, &vp->v_label, &g_cn);
+			replay_hook(t, k_hook_check_rename_from, error, start);
+			if (error == 0) {
+				start = replay_now();
+				error = g_ops->mpo_vnode_check_rename_to(&g_cred, tdvp, &tdvp->v_label, NULL, NULL, tdvp == dvp, &g_cn);
+				replay_hook(t, k_hook_check_rename_to, error, start);
+			}
+			if (error == 0) {
+				vp->v_parent = tdvp;
+				start = replay_now();
+				g_ops->mpo_vnode_notify_rename(&g_cred, vp, &vp->v_label, tdvp, &tdvp->v_label, &g_cn);
+				replay_hook(t, k_hook_notify_rename, 0, start);
+			}
+			break;
+		}
+
+		case k_trace_setxattr: {
+			const char* name = (ev->flags & k_trace_flag_worm) ? k_wormxattr_xattr: "com.mountainstorm.Test";
+			char state = 1;
+			start = replay_now();
+			error = g_ops->mpo_vnode_check_setextattr(&g_cred, vp, &vp->v_label, name, NULL);
+			replay_hook(t, k_hook_check_setextattr, error, start);
+			if (	(error == 0)
+				 && (host_xattr_set(vp, name, &state, sizeof(state)) == 0)) {
+				start = replay_now();
+				error = g_ops->mpo_vnode_label_update_extattr(t->mp, &t->mp->mnt_label, vp, &vp->v_label, name);
+				replay_hook(t, k_hook_update_extattr, error, start);
+			}
+			break;
+		}
+
+		case k_trace_truncate:
+			start = replay_now();
+			error = g_ops->mpo_vnode_check_truncate(&g_cred, NULL, vp, &vp->v_label);
+			replay_hook(t, k_hook_check_truncate, error, start);
+			break;
+	}
+}
+
+
+/**
+ * @brief	creates a thread's mount and root, ready for a replay
+ */
+static void replay_setup(replay_thread_t* t) {
+	t->mp = host_mount_create("hfs", "/Volumes/replay");
+	t->vnodes[k_trace_root] = host_vnode_create(t->mp, NULL, "", VDIR);
+	host_vnode_associate(t->vnodes[k_trace_root]);
+}
+
+
+/**
+ * @brief	destroys a thread's mount and vnodes; deferred attribute writes are flushed first
+ */
+static void replay_teardown(replay_thread_t* t) {
+	struct ucred root = {0, 0};
+	(void) g_ops->mpo_mount_check_umount(&root, t->mp, &t->mp->mnt_label);
+	for (uint32_t i = g_header->vnodes; i > 0; i--) {
+		if (t->vnodes[i - 1]) {
+			host_vnode_destroy(t->vnodes[i - 1]);
+			t->vnodes[i - 1] = NULL;
+		}
+		if (t->removed[i - 1]) {
+			host_vnode_destroy(t->removed[i - 1]);
+			t->removed[i - 1] = NULL;
+		}
+	}
+	host_mount_destroy(t->mp);
+	t->mp = NULL;
+}
+
+
+/**
+ * @brief	replays the trace g_loops times on a thread, once the threads are all ready
+ */
+static void* replay_thread(void* arg) {
+	replay_thread_t* t = arg;
+
+	for (int loop = 0; loop < g_loops; loop++) {
+		replay_setup(t);
+		(void) pthread_barrier_wait(&g_barrier);
+		uint64_t start = host_now_ns();
+		for (uint32_t i = 0; i < g_header->events; i++) {
+			replay_event(t, &g_events[i]);
+		}
+		t->elapsed += host_now_ns() - start;
+		replay_teardown(t);
+	}
+	return NULL;
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-t threads] [-l loops] [-d xattr_delay_ns] [-q] [-D] trace\n", name);
+	fprintf(stderr, "  -t  number of threads, each replaying the whole trace (default 1)\n");
+	fprintf(stderr, "  -l  times each thread replays the trace (default 1)\n");
+	fprintf(stderr, "  -d  simulated backing store latency for each xattr op (default 0)\n");
+	fprintf(stderr, "  -q  don't time each hook; only events per second are reported\n");
+	fprintf(stderr, "  -D  defer inherited attribute writes to the persist worker\n");
+	exit(1);
+}
+
+
+int main(int argc, char* argv[]) {
+	int ch = 0;
+	while ((ch = getopt(argc, argv, "t:l:d:qDh")) != -1) {
+		switch (ch) {
+			case 't': g_threads = atoi(optarg); break;
+			case 'l': g_loops = atoi(optarg); break;
+			case 'd': host_xattr_delay_ns = strtoull(optarg, NULL, 0); break;
+			case 'q': g_timed = 0; break;
+			case 'D': g_deferred = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+	if ((optind != argc - 1) || (g_threads <= 0) || (g_loops <= 0)) {
+		usage(argv[0]);
+	}
+	g_header = replay_load(argv[optind]);
+	g_events = (const trace_event_t*) (g_header + 1);
+
+	host_log_sink = k_host_log_discard;
+	host_kern_start();
+	g_ops = host_policy_ops();
+	if (host_sysctlbyname("security.mac.wormxattr.persist.deferred", NULL, NULL, &g_deferred, sizeof(g_deferred)) != 0) {
+		host_panic("Unable to set persist.deferred\n");
+	}
+	g_cn.cn_nameptr = "file";
+	g_cn.cn_namelen = 4;
+
+	replay_thread_t* threads = calloc(g_threads, sizeof(*threads));
+	if (threads == NULL) {
+		host_panic("Out of memory\n");
+	}
+	for (int i = 0; i < g_threads; i++) {
+		threads[i].vnodes = calloc(g_header->vnodes, sizeof(threads[i].vnodes[0]));
+		threads[i].removed = calloc(g_header->vnodes, sizeof(threads[i].removed[0]));
+		if ((threads[i].vnodes == NULL) || (threads[i].removed == NULL)) {
+			host_panic("Out of memory\n");
+		}
+	}
+	(void) pthread_barrier_init(&g_barrier, NULL, g_threads);
+	for (int i = 0; i < g_threads; i++) {
+		if (pthread_create(&threads[i].thread, NULL, replay_thread, &threads[i]) != 0) {
+			host_panic("Unable to create thread\n");
+		}
+	}
+
+	replay_hook_t total[k_hook_count] = {{0}};
+	uint64_t slowest = 0, skipped = 0, calls = 0, denied = 0;
+	for (int i = 0; i < g_threads; i++) {
+		(void) pthread_join(threads[i].thread, NULL);
+		if (threads[i].elapsed > slowest) {
+			slowest = threads[i].elapsed;
+		}
+		skipped += threads[i].skipped;
+		for (int h = 0; h < k_hook_count; h++) {
+			total[h].calls += threads[i].hooks[h].calls;
+			total[h].denied += threads[i].hooks[h].denied;
+			total[h].ns += threads[i].hooks[h].ns;
+		}
+		free(threads[i].vnodes);
+		free(threads[i].removed);
+	}
+	(void) pthread_barrier_destroy(&g_barrier);
+
+	uint64_t events = (uint64_t) g_header->events * g_loops * g_threads;
+	printf("threads: %d, loops: %d, events: %u, vnodes: %u, xattr delay: %lluns\n\n",
+		   g_threads, g_loops, g_header->events, g_header->vnodes, (unsigned long long) host_xattr_delay_ns);
+	printf("%-32s %12s %12s %12s %8s\n", "hook", "calls", "denied", "ns/call", "time %");
+	uint64_t ns = 0;
+	for (int h = 0; h < k_hook_count; h++) {
+		ns += total[h].ns;
+	}
+	for (int h = 0; h < k_hook_count; h++) {
+		calls += total[h].calls;
+		denied += total[h].denied;
+		if (total[h].calls == 0) {
+			continue;
+		}
+		printf("%-32s %12llu %12llu %12.1f %8.1f\n", g_hook_names[h],
+			   (unsigned long long) total[h].calls, (unsigned long long) total[h].denied,
+			   g_timed ? (double) total[h].ns / (double) total[h].calls: 0.0,
+			   (g_timed && ns) ? (100.0 * (double) total[h].ns) / (double) ns: 0.0);
+	}
+	printf("\nevents: %llu (%llu skipped), hook calls: %llu, denied: %llu, %.0f events/sec\n",
+		   (unsigned long long) events, (unsigned long long) skipped, (unsigned long long) calls,
+		   (unsigned long long) denied, slowest ? ((double) events * 1e9) / (double) slowest: 0.0);
+
+	host_kern_stop();
+	free(threads);
+	free((void*) g_header);
+	return 0;
+}
@@ -0,0 +1,705 @@
+//
+//  strace2trace.c
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#define _GNU_SOURCE // asprintf
+
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+
+/*
+ * Description
+ *
+ * Converts strace text output into a trace for replay, e.g. a real ingest or backup
+ * workload captured with:
+ *
+ *	strace -f -qq -y -e trace=%file,%desc -o ingest.log <command>
+ *
+ * open/openat/creat, mkdir/mkdirat, unlink/unlinkat/rmdir, rename/renameat/renameat2,
+ * setxattr/lsetxattr and truncate calls which succeeded are converted; everything 
+ * else is skipped.  Paths are tracked so each file gets a vnode; files used before 
+ * they were created in the trace are introduced (with their directories) as existing.
+ * Relative paths are taken relative to the -C directory, or to the directory a file
+ * descriptor refers to when strace was run with -y.  Calls split across lines by 
+ * strace -f (unfinished/resumed) are skipped; -qq with -f keeps them rare.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_conv_line_max					65536
+#define k_conv_args_max					8
+#define k_conv_worm_max					64
+#define k_conv_worm_xattr				"com.mountainstorm.Worm"
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	a path we know a vnode for
+ */
+typedef struct __conv_entry_t {
+	char*		path;			// NULL if empty; g_tombstone if removed
+	uint32_t	vnode;
+	int			dir;
+} conv_entry_t;
+
+/**
+ * @brief	a parsed syscall argument; strings are unescaped
+ */
+typedef struct __conv_arg_t {
+	char*		text;
+	int			quoted;
+} conv_arg_t;
+
+
+static char g_tombstone[] = "";
+static conv_entry_t* g_table = NULL;
+static size_t g_table_size = 0;
+static size_t g_table_used = 0;
+
+static FILE* g_out = NULL;
+static uint32_t g_vnodes = 1;			// the root is vnode 0
+static uint32_t g_events = 0;
+static const char* g_root = "/";
+static size_t g_root_len = 1;
+static const char* g_cwd = "/";
+static const char* g_worm[k_conv_worm_max];
+static int g_worm_count = 0;
+
+static unsigned long g_lines = 0;
+static unsigned long g_converted = 0;
+static unsigned long g_skipped = 0;
+
+
+/*
+ * Path table
+ */
+
+static uint64_t conv_hash(const char* s) {
+	uint64_t h = 14695981039346656037ull;
+	while (*s) {
+		h = (h ^ (uint8_t) *s++) * 1099511628211ull;
+	}
+	return h;
+}
+
+
+/**
+ * @brief	finds the slot for a path; the matching entry, or the first free slot
+ */
+static conv_entry_t* conv_slot(const char* path) {
+	size_t mask = g_table_size - 1;
+	conv_entry_t* free = NULL;
+	for (size_t i = conv_hash(path) & mask;; i = (i + 1) & mask) {
+		conv_entry_t* e = &g_table[i];
+		if (e->path == NULL) {
+			return free ? free: e;
+		}
+		if (e->path == g_tombstone) {
+			if (free == NULL) {
+				free = e;
+			}
+		} else if (strcmp(e->path, path) == 0) {
+			return e;
+		}
+	}
+}
+
+
+static conv_entry_t* conv_find(const char* path) {
+	conv_entry_t* e = conv_slot(path);
+	return (e->path && (e->path != g_tombstone)) ? e: NULL;
+}
+
+
+static void conv_insert(const char* path, uint32_t vnode, int dir);
+
+
+static void conv_grow(void) {
+	conv_entry_t* old = g_table;
+	size_t size = g_table_size;
+	g_table_size = size ? size * 2: 4096;
+	g_table = calloc(g_table_size, sizeof(*g_table));
+	if (g_table == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	g_table_used = 0;
+	for (size_t i = 0; i < size; i++) {
+		if (old[i].path && (old[i].path != g_tombstone)) {
+			conv_entry_t* e = conv_slot(old[i].path);
+			*e = old[i];
+			g_table_used++;
+		}
+	}
+	free(old);
+}
+
+
+static void conv_insert(const char* path, uint32_t vnode, int dir) {
+	if ((g_table_used + 1) * 2 > g_table_size) {
+		conv_grow();
+	}
+	conv_entry_t* e = conv_slot(path);
+	if ((e->path == NULL) || (e->path == g_tombstone)) {
+		e->path = strdup(path);
+		if (e->path == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		g_table_used++;
+	}
+	e->vnode = vnode;
+	e->dir = dir;
+}
+
+
+static void conv_remove(conv_entry_t* e) {
+	free(e->path);
+	e->path = g_tombstone;
+	g_table_used--;
+}
+
+
+/**
+ * @brief	removes (or with to, renames) every path below a directory
+ *
+ * @param	from	the directory
+ * @param	to		the directories new path; NULL to remove its descendants
+ */
+static void conv_move_children(const char* from, const char* to) {
+	size_t len = strlen(from);
+	conv_entry_t* moved = NULL;
+	size_t count = 0;
+
+	for (size_t i = 0; i < g_table_size; i++) {
+		conv_entry_t* e = &g_table[i];
+		if (	e->path && (e->path != g_tombstone)
+			 && (strncmp(e->path, from, len) == 0)
+			 && (e->path[len] == '/')) {
+			if (to) {
+				char* path = NULL;
+				if (asprintf(&path, "%s%s", to, e->path + len) == -1) {
+					fprintf(stderr, "Out of memory\n");
+					exit(1);
+				}
+				moved = realloc(moved, (count + 1) * sizeof(*moved));
+				if (moved == NULL) {
+					fprintf(stderr, "Out of memory\n");
+					exit(1);
+				}
+				moved[count] = *e;
+				moved[count++].path = path;
+			}
+			conv_remove(e);
+		}
+	}
+	for (size_t i = 0; i < count; i++) {
+		conv_insert(moved[i].path, moved[i].vnode, moved[i].dir);
+		free(moved[i].path);
+	}
+	free(moved);
+}
+
+
+/*
+ * Trace output
+ */
+
+static void conv_emit(trace_op_t op, int flags, uint32_t vnode, uint32_t dir, uint32_t arg) {
+	trace_event_t ev = {0};
+	ev.op = (uint8_t) op;
+	ev.flags = (uint8_t) flags;
+	ev.vnode = vnode;
+	ev.dir = dir;
+	ev.arg = arg;
+	if (fwrite(&ev, sizeof(ev), 1, g_out) != 1) {
+		fprintf(stderr, "Unable to write trace; %s\n", strerror(errno));
+		exit(1);
+	}
+	g_events++;
+}
+
+
+static int conv_is_worm(const char* path) {
+	for (int i = 0; i < g_worm_count; i++) {
+		size_t len = strlen(g_worm[i]);
+		if (	(strncmp(path, g_worm[i], len) == 0)
+			 && ((path[len] == '\0') || (path[len] == '/'))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * @brief	the vnode of a paths parent directory; introducing it if needed
+ */
+static uint32_t conv_parent(const char* path);
+
+
+/**
+ * @brief	the vnode for a path; introducing it (and its parents) as existing if needed
+ *
+ * @param	path	a normalized path within the root
+ * @param	dir		non zero if the path is a directory
+ */
+static uint32_t conv_vnode(const char* path, int dir) {
+	if (strcmp(path, g_root) == 0) {
+		return k_trace_root;
+	}
+	conv_entry_t* e = conv_find(path);
+	if (e == NULL) {
+		uint32_t parent = conv_parent(path);
+		uint32_t vnode = g_vnodes++;
+		int flags = (dir ? k_trace_flag_dir: 0) | (conv_is_worm(path) ? k_trace_flag_worm: 0);
+		conv_emit(k_trace_exist, flags, vnode, parent, 0);
+		conv_insert(path, vnode, dir);
+		return vnode;
+	}
+	return e->vnode;
+}
+
+
+static uint32_t conv_parent(const char* path) {
+	const char* slash = strrchr(path, '/');
+	size_t len = slash - path;
+	char parent[PATH_MAX];
+
+	if ((len < g_root_len) || (len == 0)) {
+		return k_trace_root;
+	}
+	memcpy(parent, path, len);
+	parent[len] = '\0';
+	return conv_vnode(parent, 1);
+}
+
+
+/*
+ * Parsing
+ */
+
+/**
+ * @brief	normalizes a path; resolving it against a base and removing ., .. and //
+ *
+ * @param	base	the directory relative paths are relative to
+ * @param	path	the path
+ * @param	out		the normalized path; PATH_MAX bytes
+ *
+ * @return	non zero if the path is within the root
+ */
+static int conv_path(const char* base, const char* path, char* out) {
+	char joined[PATH_MAX * 2];
+	size_t len = 0;
+
+	(void) snprintf(joined, sizeof(joined), "%s/%s", (path[0] == '/') ? "": base, path);
+	for (char* p = joined; *p;) {
+		char* end = strchr(p, '/');
+		size_t n = end ? (size_t) (end - p): strlen(p);
+		if ((n == 0) || ((n == 1) && (p[0] == '.'))) {
+			// nothing
+		} else if ((n == 2) && (p[0] == '.') && (p[1] == '.')) {
+			while ((len > 0) && (out[--len] != '/'));
+		} else {
+			if (len + n + 2 > PATH_MAX) {
+				return 0;
+			}
+			out[len++] = '/';
+			memcpy(out + len, p, n);
+			len += n;
+		}
+		p += n + (end ? 1: 0);
+	}
+	if (len == 0) {
+		out[len++] = '/';
+	}
+	out[len] = '\0';
+	return	(strcmp(g_root, "/") == 0)
+		 || ((strncmp(out, g_root, g_root_len) == 0) && ((out[g_root_len] == '\0') || (out[g_root_len] == '/')));
+}
+
+
+/**
+ * @brief	splits a syscalls arguments; strings are unescaped in place
+ *
+ * @param	p		the text following the opening parenthesis
+ * @param	args	the arguments
+ *
+ * @return	the number of arguments, or -1 if the call isn't complete
+ */
+static int conv_args(char* p, conv_arg_t* args) {
+	int count = 0;
+	while (*p && (count < k_conv_args_max)) {
+		int depth = 0;
+		while (*p == ' ') {
+			p++;
+		}
+		if (*p == ')') {
+			return count;
+		}
+		conv_arg_t* arg = &args[count++];
+		arg->text = p;
+		arg->quoted = (*p == '"');
+		if (arg->quoted) {
+			char* out = ++p;
+			arg->text = out;
+			while (*p && (*p != '"')) {
+				if (*p == '\\' && p[1]) {
+					p++;
+					if ((*p >= '0') && (*p <= '7')) {
+						int v = 0;
+						for (int i = 0; (i < 3) && (*p >= '0') && (*p <= '7'); i++) {
+							v = (v * 8) + (*p++ - '0');
+						}
+						*out++ = (char) v;
+						continue;
+					} else if ((*p == 'x') && isxdigit((unsigned char) p[1])) {
+						*out++ = (char) strtol(p + 1, &p, 16);
+						continue;
+					}
+					switch (*p) {
+						case 'n': *out++ = '\n'; break;
+						case 't': *out++ = '\t'; break;
+						default: *out++ = *p; break;
+					}
+					p++;
+				} else {
+					*out++ = *p++;
+				}
+			}
+			if (*p != '"') {
+				return -1;
+			}
+			*out = '\0';
+			p++;
+		}
+		// skip to the end of the argument; "..." after a string, <path> after an fd (with -y)
+		while (*p && (depth || ((*p != ',') && (*p != ')')))) {
+			if ((*p == '{') || (*p == '[') || (*p == '(') || (*p == '<')) {
+				depth++;
+			} else if (((*p == '}') || (*p == ']') || (*p == ')') || (*p == '>')) && depth) {
+				depth--;
+			}
+			p++;
+		}
+		if (*p == '\0') {
+			return -1;
+		}
+		int end = (*p == ')');
+		if (!arg->quoted) {
+			char* e = p;
+			while ((e > arg->text) && (e[-1] == ' ')) {
+				e--;
+			}
+			*e = '\0';
+		} else {
+			*p = '\0';
+		}
+		p++;
+		if (end) {
+			return count;
+		}
+	}
+	return -1;
+}
+
+
+/**
+ * @brief	resolves a path argument, given the directory fd argument (if any) before it
+ *
+ * @param	dirfd	the directory fd argument; NULL for calls without one
+ * @param	path	the path argument
+ * @param	out		the normalized path; PATH_MAX bytes
+ *
+ * @return	non zero if the path is usable
+ */
+static int conv_at(const conv_arg_t* dirfd, const conv_arg_t* path, char* out) {
+	const char* base = g_cwd;
+	char dir[PATH_MAX];
+
+	if (!path->quoted) {
+		return 0;
+	}
+	if (	dirfd && (path->text[0] != '/')
+		 && (strncmp(dirfd->text, "AT_FDCWD", 8) != 0)) {
+		// only usable with strace -y; "3</some/dir>"
+		const char* lt = strchr(dirfd->text, '<');
+		const char* gt = lt ? strrchr(lt, '>'): NULL;
+		if ((gt == NULL) || ((size_t) (gt - lt) >= sizeof(dir))) {
+			return 0;
+		}
+		memcpy(dir, lt + 1, gt - lt - 1);
+		dir[gt - lt - 1] = '\0';
+		base = dir;
+	}
+	return conv_path(base, path->text, out);
+}
+
+
+static void conv_open(const char* path, const char* flags) {
+	uint32_t access = k_trace_open_read;
+	conv_entry_t* e = conv_find(path);
+	uint32_t vnode = 0;
+
+	if (strstr(flags, "O_WRONLY")) {
+		access = k_trace_open_write;
+	} else if (strstr(flags, "O_RDWR")) {
+		access = k_trace_open_read | k_trace_open_write;
+	}
+	access |= strstr(flags, "O_TRUNC") ? k_trace_open_trunc: 0;
+	access |= strstr(flags, "O_APPEND") ? k_trace_open_append: 0;
+
+	if ((e == NULL) && strstr(flags, "O_CREAT") && (strcmp(path, g_root) != 0)) {
+		uint32_t parent = conv_parent(path);
+		vnode = g_vnodes++;
+		// the kernel doesn't check opens of the files they create
+		conv_emit(k_trace_create, 0, vnode, parent, 0);
+		conv_insert(path, vnode, 0);
+	} else {
+		vnode = conv_vnode(path, strstr(flags, "O_DIRECTORY") != NULL);
+		conv_emit(k_trace_open, 0, vnode, 0, access);
+	}
+}
+
+
+static void conv_mkdir(const char* path) {
+	if ((conv_find(path) == NULL) && (strcmp(path, g_root) != 0)) {
+		uint32_t parent = conv_parent(path);
+		uint32_t vnode = g_vnodes++;
+		conv_emit(k_trace_create, k_trace_flag_dir, vnode, parent, 0);
+		conv_insert(path, vnode, 1);
+	}
+}
+
+
+static void conv_unlink(const char* path, int dir) {
+	if (strcmp(path, g_root) != 0) {
+		uint32_t vnode = conv_vnode(path, dir);
+		conv_emit(k_trace_unlink, 0, vnode, conv_parent(path), 0);
+		conv_move_children(path, NULL);
+		conv_remove(conv_find(path));
+	}
+}
+
+
+static void conv_rename(const char* from, const char* to) {
+	if ((strcmp(from, g_root) == 0) || (strcmp(to, g_root) == 0) || (strcmp(from, to) == 0)) {
+		return;
+	}
+	uint32_t vnode = conv_vnode(from, 0);
+	int dir = conv_find(from)->dir;
+	uint32_t fromDir = conv_parent(from);
+	uint32_t toDir = conv_parent(to);
+	conv_entry_t* e = conv_find(to);
+	if (e) {
+		// replaced; its vnode is gone
+		conv_move_children(to, NULL);
+		conv_remove(e);
+	}
+	conv_emit(k_trace_rename, 0, vnode, fromDir, toDir);
+	conv_remove(conv_find(from));
+	conv_insert(to, vnode, dir);
+	if (dir) {
+		conv_move_children(from, to);
+	}
+}
+
+
+static void conv_setxattr(const char* path, const char* name) {
+	const char* bare = (strncmp(name, "user.", 5) == 0) ? name + 5: name;
+	int worm = (strcmp(bare, k_conv_worm_xattr) == 0);
+	conv_emit(k_trace_setxattr, worm ? k_trace_flag_worm: 0, conv_vnode(path, 0), 0, 0);
+}
+
+
+/**
+ * @brief	converts one line of strace output
+ *
+ * @return	non zero if the line produced events
+ */
+static int conv_line(char* line) {
+	char path[PATH_MAX], path2[PATH_MAX];
+	conv_arg_t args[k_conv_args_max];
+	char* p = line;
+	char* name = NULL;
+	char* result = NULL;
+	int argc = 0;
+
+	// skip the pid ("123 " or "[pid 123] ") and timestamp ("12:34:56.789012 ") prefixes
+	for (;;) {
+		if (strncmp(p, "[pid", 4) == 0) {
+			if ((p = strchr(p, ']')) == NULL) {
+				return 0;
+			}
+			p++;
+		} else if (isdigit((unsigned char) *p)) {
+			p += strcspn(p, " ");
+		} else {
+			break;
+		}
+		while (*p == ' ') {
+			p++;
+		}
+	}
+	if (	(strstr(p, "<unfinished") != NULL)
+		 || (strncmp(p, "<...", 4) == 0)) {
+		return 0;
+	}
+	name = p;
+	p += strcspn(p, "(");
+	if (*p != '(') {
+		return 0;
+	}
+	*p++ = '\0';
+	// the result; only calls which succeeded are of interest
+	result = strrchr(p, '=');
+	if ((result == NULL) || (result[1] != ' ') || !isdigit((unsigned char) result[2])) {
+		return 0;
+	}
+	if ((argc = conv_args(p, args)) < 0) {
+		return 0;
+	}
+
+	if (	((strcmp(name, "open") == 0) && (argc >= 2) && conv_at(NULL, &args[0], path))
+		 || ((strcmp(name, "openat") == 0) && (argc >= 3) && conv_at(&args[0], &args[1], path))) {
+		conv_open(path, args[(name[4] == 'a') ? 2: 1].text);
+	} else if ((strcmp(name, "creat") == 0) && (argc >= 1) && conv_at(NULL, &args[0], path)) {
+		conv_open(path, "O_WRONLY|O_CREAT|O_TRUNC");
+	} else if (	((strcmp(name, "mkdir") == 0) && (argc >= 1) && conv_at(NULL, &args[0], path))
+			 || ((strcmp(name, "mkdirat") == 0) && (argc >= 2) && conv_at(&args[0], &args[1], path))) {
+		conv_mkdir(path);
+	} else if (	((strcmp(name, "unlink") == 0) && (argc >= 1) && conv_at(NULL, &args[0], path))
+			 || ((strcmp(name, "rmdir") == 0) && (argc >= 1) && conv_at(NULL, &args[0], path))
+			 || ((strcmp(name, "unlinkat") == 0) && (argc >= 3) && conv_at(&args[0], &args[1], path))) {
+		conv_unlink(path, (name[0] == 'r') || ((argc >= 3) && strstr(args[2].text, "AT_REMOVEDIR")));
+	} else if (	((strcmp(name, "rename") == 0) && (argc >= 2)
+				 && conv_at(NULL, &args[0], path) && conv_at(NULL, &args[1], path2))
+			 || (((strcmp(name, "renameat") == 0) || (strcmp(name, "renameat2") == 0)) && (argc >= 4)
+				 && conv_at(&args[0], &args[1], path) && conv_at(&args[2], &args[3], path2))) {
+		conv_rename(path, path2);
+	} else if (	((strcmp(name, "setxattr") == 0) || (strcmp(name, "lsetxattr") == 0))
+			 && (argc >= 2) && conv_at(NULL, &args[0], path) && args[1].quoted) {
+		conv_setxattr(path, args[1].text);
+	} else if ((strcmp(name, "truncate") == 0) && (argc >= 1) && conv_at(NULL, &args[0], path)) {
+		conv_emit(k_trace_truncate, 0, conv_vnode(path, 0), 0, 0);
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+ * Implementation
+ */
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-r root] [-C cwd] [-w path]... strace.log trace\n", name);
+	fprintf(stderr, "  -r  only paths below root are part of the traced mount (default /)\n");
+	fprintf(stderr, "  -C  the directory relative paths are relative to (default /)\n");
+	fprintf(stderr, "  -w  path (and everything below it) was WORM before the trace started\n");
+	exit(1);
+}
+
+
+int main(int argc, char* argv[]) {
+	static char line[k_conv_line_max];
+	static char root[PATH_MAX], cwd[PATH_MAX];
+	trace_header_t header = {0};
+	FILE* in = NULL;
+	int ch = 0;
+
+	while ((ch = getopt(argc, argv, "r:C:w:h")) != -1) {
+		switch (ch) {
+			case 'r':
+				(void) conv_path("/", optarg, root);
+				g_root = root;
+				g_root_len = strlen(root);
+				break;
+			case 'C':
+				(void) conv_path("/", optarg, cwd);
+				g_cwd = cwd;
+				break;
+			case 'w':
+				if (g_worm_count == k_conv_worm_max) {
+					usage(argv[0]);
+				}
+				g_worm[g_worm_count] = malloc(PATH_MAX);
+				(void) conv_path("/", optarg, (char*) g_worm[g_worm_count++]);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (optind != argc - 2) {
+		usage(argv[0]);
+	}
+	if ((in = (strcmp(argv[optind], "-") == 0) ? stdin: fopen(argv[optind], "r")) == NULL) {
+		fprintf(stderr, "Unable to open %s; %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+	if ((g_out = fopen(argv[optind + 1], "wb")) == NULL) {
+		fprintf(stderr, "Unable to create %s; %s\n", argv[optind + 1], strerror(errno));
+		return 1;
+	}
+	conv_grow();
+
+	// the header is rewritten once the counts are known
+	(void) fwrite(&header, sizeof(header), 1, g_out);
+	while (fgets(line, sizeof(line), in)) {
+		g_lines++;
+		if (conv_line(line)) {
+			g_converted++;
+		} else {
+			g_skipped++;
+		}
+	}
+	header.magic = k_trace_magic;
+	header.version = k_trace_version;
+	header.vnodes = g_vnodes;
+	header.events = g_events;
+	if (	(fseek(g_out, 0, SEEK_SET) != 0)
+		 || (fwrite(&header, sizeof(header), 1, g_out) != 1)
+		 || (fclose(g_out) != 0)) {
+		fprintf(stderr, "Unable to write %s; %s\n", argv[optind + 1], strerror(errno));
+		return 1;
+	}
+	fprintf(stderr, "%lu lines, %lu converted, %lu skipped; %u events, %u vnodes\n",
+			g_lines, g_converted, g_skipped, g_events, g_vnodes);
+	return 0;
+}
@@ -0,0 +1,1156 @@
+//
+//  test.c
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "host_kern.h"
+#include "wormxattr.h"
+#include "wormxattr_class.h"
+#include "wormxattr_mount.h"
+#include "wormxattr_policy.h"
+
+
+/*
+ * Description
+ *
+ * The regression suite; the cases of wormxattr_test (access, open modes, rename,
+ * unlink, the extended attributes, chflags, chmod, chown, utimes, truncate and
+ * inheritance on create) run in process against the host compiled policy.  Each
+ * case gets the fixture wormxattr_test's setUp makes (a mutable file and directory
+ * and a WORM file and directory) on its own mount, and makes the calls a system call
+ * would; the policy check, then (if it's granted) the change to the simulated
+ * vnodes and the notification.  Cases share nothing, so they're run in parallel.
+ *
+ * The class cases use names added by the class_names sysctl, and the mount mode cases
+ * file system types the mount_modes sysctl derives, ignores or doesn't inherit on; set
+ * once, before any case runs.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_test_uid						501
+#define k_test_gid						20
+#define k_test_threads					4
+#define k_test_message_max				256
+#define k_test_attribute				"com.mountainstorm.Test"
+#define k_test_hold						"com.mountainstorm.Test.Hold"
+#define k_test_scratch					"com.mountainstorm.Test.Scratch"
+#define k_test_tenant					"com.mountainstorm.Test.Tenant"
+#define k_test_extra					"com.mountainstorm.Test.Extra"
+#define k_test_class_retired			16		// k_wormxattr_class_retired_max
+#define k_test_class_names				k_test_hold "=hold," k_test_scratch "=scratch," k_test_tenant "=worm"
+#define k_test_derive_fs				"derivefs"
+#define k_test_ignore_fs				"ignorefs"
+#define k_test_noinherit_fs				"noinheritfs"
+#define k_test_mount_modes				k_wormxattr_mount_default_modes "," k_test_derive_fs "=derive\n" \
+										k_test_ignore_fs "=ignore\r\n\t" k_test_noinherit_fs "=noinherit"
+#ifndef ENOATTR
+#define ENOATTR							ENODATA	// as the host runtime
+#endif
+#ifndef UF_HIDDEN
+#define UF_HIDDEN						0x00008000
+#endif
+
+/**
+ * @brief	checks a call returned what was expected; recording a failure (and carrying
+ *			on) if it didn't
+ */
+#define test_expect(t, expr, expected)	test_check((t), __LINE__, #expr, (long) (expr), (long) (expected))
+#define test_expect_worm(t, vp, worm)	test_check((t), __LINE__, "is_worm(" #vp ")", (long) test_has_worm(vp), (long) (worm))
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the state of a case; its fixture and result
+ *
+ * @field	mp				the cases mount
+ * @field	root			the root of the mount; the working directory of the case
+ * @field	mutableFile		root/mutableFile
+ * @field	mutableDir		root/mutableDir
+ * @field	wormFile		root/wormFile; tagged WORM
+ * @field	wormDir			root/wormDir; tagged WORM
+ * @field	cred			the caller; k_test_uid
+ * @field	failures		the number of checks which failed
+ * @field	message			the first failure
+ */
+typedef struct __test_t {
+	struct mount*	mp;
+	struct vnode*	root;
+	struct vnode*	mutableFile;
+	struct vnode*	mutableDir;
+	struct vnode*	wormFile;
+	struct vnode*	wormDir;
+	struct ucred	cred;
+	int				failures;
+	char			message[k_test_message_max];
+} test_t;
+
+typedef void (*test_fn_t)(test_t* t);
+
+/**
+ * @brief	a case; its name and body
+ */
+typedef struct __test_case_t {
+	const char*		name;
+	test_fn_t		fn;
+} test_case_t;
+
+static struct mac_policy_ops* g_ops = NULL;
+static struct timespec g_time = {0};
+
+static const char* g_filter = NULL;
+static int g_verbose = 0;
+static int g_next = 0;
+static int g_failed = 0;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*
+ * Fixture and checks
+ */
+
+static struct vnode* test_vnode(test_t* t, struct vnode* dvp, const char* name, enum vtype type, int worm) {
+	struct vnode* vp = host_vnode_create(dvp ? dvp->v_mount: t->mp, dvp, name, type);
+	if (worm) {
+		(void) host_xattr_set(vp, k_wormxattr_xattr, "0", 1);
+	}
+	host_vnode_associate(vp);
+	return vp;
+}
+
+
+/**
+ * @brief	builds a cases fixture; as wormxattr_test's setUp
+ */
+static void test_setup(test_t* t, int index) {
+	char path[64];
+	
+	(void) snprintf(path, sizeof(path), "/Volumes/test%d", index);
+	memset(t, 0, sizeof(*t));
+	t->cred.cr_uid = k_test_uid;
+	t->cred.cr_gid = k_test_gid;
+	t->mp = host_mount_create("hfs", path);
+	t->root = test_vnode(t, NULL, "", VDIR, 0);
+	t->mutableFile = test_vnode(t, t->root, "mutableFile", VREG, 0);
+	t->mutableDir = test_vnode(t, t->root, "mutableDir", VDIR, 0);
+	t->wormFile = test_vnode(t, t->root, "wormFile", VREG, 1);
+	t->wormDir = test_vnode(t, t->root, "wormDir", VDIR, 1);
+}
+
+
+/**
+ * @brief	frees a cases fixture; vnodes the case created are left (they're small)
+ */
+static void test_teardown(test_t* t) {
+	host_vnode_destroy(t->wormDir);
+	host_vnode_destroy(t->wormFile);
+	host_vnode_destroy(t->mutableDir);
+	host_vnode_destroy(t->mutableFile);
+	host_vnode_destroy(t->root);
+	host_mount_destroy(t->mp);
+}
+
+
+static void test_check(test_t* t, int line, const char* expr, long value, long expected) {
+	if (value != expected) {
+		if (t->failures++ == 0) {
+			(void) snprintf(t->message, sizeof(t->message), "test.c:%d: %s returned %ld, expected %ld", line, expr, value, expected);
+		}
+	}
+}
+
+
+/**
+ * @brief	checks if a vnode carries our attribute; as getxattr would
+ */
+static int test_has_worm(struct vnode* vp) {
+	char value[64];
+	size_t len = 0;
+	return mac_vnop_getxattr(vp, k_wormxattr_xattr, value, sizeof(value), &len) == 0;
+}
+
+
+/*
+ * Simulated system calls; the policy check then, if granted, the change
+ */
+
+static int sys_access(test_t* t, struct vnode* vp, int mode) {
+	return g_ops->mpo_vnode_check_access(&t->cred, vp, &vp->v_label, mode);
+}
+
+
+static int sys_open(test_t* t, struct vnode* vp, int oflags) {
+	return g_ops->mpo_vnode_check_open(&t->cred, vp, &vp->v_label, FFLAGS(oflags));
+}
+
+
+static int sys_removexattr(test_t* t, struct vnode* vp, const char* name) {
+	int retval = g_ops->mpo_vnode_check_deleteextattr(&t->cred, vp, &vp->v_label, name);
+	if (	retval == 0
+		 && (retval = host_xattr_remove(vp, name)) == 0) {
+		(void) g_ops->mpo_vnode_label_update_extattr(vp->v_mount, &vp->v_mount->mnt_label, vp, &vp->v_label, name);
+	}
+	return retval;
+}
+
+
+static int sys_setxattr_value(test_t* t, struct vnode* vp, const char* name, const char* value) {
+	struct uio uio = {value, strlen(value)};
+	int retval = g_ops->mpo_vnode_check_setextattr(&t->cred, vp, &vp->v_label, name, &uio);
+	if (	retval == 0
+		 && (retval = host_xattr_set(vp, name, value, strlen(value))) == 0) {
+		(void) g_ops->mpo_vnode_label_update_extattr(vp->v_mount, &vp->v_mount->mnt_label, vp, &vp->v_label, name);
+	}
+	return retval;
+}
+
+
+static int sys_setxattr(test_t* t, struct vnode* vp, const char* name) {
+	return sys_setxattr_value(t, vp, name, "1");
+}
+
+
+static int sys_exchangedata(test_t* t, struct vnode* v1, struct vnode* v2) {
+	return g_ops->mpo_vnode_check_exchangedata(&t->cred, v1, &v1->v_label, v2, &v2->v_label);
+}
+
+
+static int sys_rename(test_t* t, struct vnode* vp, struct vnode* tdvp) {
+	struct componentname cn = {0};
+	int retval = 0;
+	
+	cn.cn_nameptr = vp->v_name;
+	cn.cn_namelen = (int) strlen(vp->v_name);
+	if (	(retval = g_ops->mpo_vnode_check_rename_from(&t->cred, vp->v_parent, &vp->v_parent->v_label, vp, &vp->v_label, &cn)) == 0
+		 && (retval = g_ops->mpo_vnode_check_rename_to(&t->cred, tdvp, &tdvp->v_label, NULL, NULL, tdvp == vp->v_parent, &cn)) == 0) {
+		vp->v_parent = tdvp;
+		g_ops->mpo_vnode_notify_rename(&t->cred, vp, &vp->v_label, tdvp, &tdvp->v_label, &cn);
+	}
+	return retval;
+}
+
+
+static int sys_unlink(test_t* t, struct vnode* vp) {
+	struct componentname cn = {0};
+	
+	cn.cn_nameptr = vp->v_name;
+	cn.cn_namelen = (int) strlen(vp->v_name);
+	return g_ops->mpo_vnode_check_unlink(&t->cred, vp->v_parent, &vp->v_parent->v_label, vp, &vp->v_label, &cn);
+}
+
+
+static int sys_link(test_t* t, struct vnode* vp, struct vnode* tdvp) {
+	struct componentname cn = {0};
+	
+	cn.cn_nameptr = vp->v_name;
+	cn.cn_namelen = (int) strlen(vp->v_name);
+	return g_ops->mpo_vnode_check_link(&t->cred, tdvp, &tdvp->v_label, vp, &vp->v_label, &cn);
+}
+
+
+static int sys_chflags(test_t* t, struct vnode* vp, u_long flags) {
+	return g_ops->mpo_vnode_check_setflags(&t->cred, vp, &vp->v_label, flags);
+}
+
+
+static int sys_chmod(test_t* t, struct vnode* vp, mode_t mode) {
+	return g_ops->mpo_vnode_check_setmode(&t->cred, vp, &vp->v_label, mode);
+}
+
+
+static int sys_chown(test_t* t, struct vnode* vp) {
+	return g_ops->mpo_vnode_check_setowner(&t->cred, vp, &vp->v_label, k_test_uid, k_test_gid);
+}
+
+
+static int sys_utimes(test_t* t, struct vnode* vp) {
+	return g_ops->mpo_vnode_check_setutimes(&t->cred, vp, &vp->v_label, g_time, g_time);
+}
+
+
+static int sys_setattrlist(test_t* t, struct vnode* vp) {
+	return g_ops->mpo_vnode_check_setattrlist(&t->cred, vp, &vp->v_label, NULL);
+}
+
+
+static int sys_truncate(test_t* t, struct vnode* vp) {
+	int retval = EISDIR; // the file system refuses before the policy is asked
+	if (vnode_isdir(vp) == 0) {
+		retval = g_ops->mpo_vnode_check_truncate(&t->cred, NULL, vp, &vp->v_label);
+	}
+	return retval;
+}
+
+
+static int sys_check_create(test_t* t, struct vnode* dvp, const char* name) {
+	struct componentname cn = {0};
+	
+	cn.cn_nameptr = (char*) name;
+	cn.cn_namelen = (int) strlen(name);
+	return g_ops->mpo_vnode_check_create(&t->cred, dvp, &dvp->v_label, &cn, NULL);
+}
+
+
+static struct vnode* sys_create(test_t* t, struct vnode* dvp, const char* name, enum vtype type) {
+	struct mount* mp = dvp->v_mount;
+	struct vnode* vp = host_vnode_create(mp, dvp, name, type);
+	struct componentname cn = {0};
+	
+	cn.cn_nameptr = vp->v_name;
+	cn.cn_namelen = (int) strlen(vp->v_name);
+	g_ops->mpo_vnode_label_associate_extattr(mp, &mp->mnt_label, vp, &vp->v_label);
+	(void) g_ops->mpo_vnode_notify_create(&t->cred, mp, &mp->mnt_label, dvp, &dvp->v_label, vp, &vp->v_label, &cn);
+	return vp;
+}
+
+
+/*
+ * Cases
+ */
+
+static void test_access(test_t* t, struct vnode* vp, int mutable) {
+	test_expect(t, sys_access(t, vp, VREAD), 0);
+	test_expect(t, sys_access(t, vp, VEXEC), 0);
+	test_expect(t, sys_access(t, vp, 0), 0);
+	test_expect(t, sys_access(t, vp, VWRITE), mutable ? 0: EPERM);
+	test_expect(t, sys_access(t, vp, VREAD | VWRITE | VEXEC), mutable ? 0: EPERM);
+}
+
+
+static void test_check_access_mutable_file(test_t* t)		{ test_access(t, t->mutableFile, 1); }
+static void test_check_access_mutable_dir(test_t* t)		{ test_access(t, t->mutableDir, 1); }
+static void test_check_access_immutable_file(test_t* t)		{ test_access(t, t->wormFile, 0); }
+static void test_check_access_immutable_dir(test_t* t)		{ test_access(t, t->wormDir, 1); } // directory access isn't affected
+
+
+static void test_check_deleteextattr(test_t* t) {
+	test_expect(t, sys_removexattr(t, t->mutableFile, k_wormxattr_xattr), ENOATTR);
+	test_expect(t, sys_removexattr(t, t->mutableDir, k_wormxattr_xattr), ENOATTR);
+	test_expect(t, sys_removexattr(t, t->wormFile, k_wormxattr_xattr), EPERM);
+	test_expect(t, sys_removexattr(t, t->wormDir, k_wormxattr_xattr), EPERM);
+	test_expect_worm(t, t->wormFile, 1);
+}
+
+
+static void test_check_deleteextattr_root(test_t* t) {
+	// the super user can remove the attribute; and the file is mutable again
+	t->cred.cr_uid = 0;
+	test_expect(t, sys_removexattr(t, t->wormFile, k_wormxattr_xattr), 0);
+	test_expect(t, sys_removexattr(t, t->wormDir, k_wormxattr_xattr), 0);
+	t->cred.cr_uid = k_test_uid;
+	test_expect(t, sys_open(t, t->wormFile, O_WRONLY), 0);
+	test_expect(t, sys_chmod(t, t->wormDir, 0700), 0);
+}
+
+
+static void test_check_exchangedata(test_t* t) {
+	test_expect(t, sys_exchangedata(t, t->mutableFile, t->wormFile), EPERM);
+	test_expect(t, sys_exchangedata(t, t->wormFile, t->mutableFile), EPERM);
+	test_expect(t, sys_exchangedata(t, t->mutableFile, t->mutableFile), 0);
+}
+
+
+static void test_open(test_t* t, struct vnode* vp, int mutable) {
+	int expected = mutable ? 0: EPERM;
+	test_expect(t, sys_open(t, vp, O_RDONLY), 0);
+	test_expect(t, sys_open(t, vp, O_WRONLY), expected);
+	test_expect(t, sys_open(t, vp, O_RDWR), expected);
+	test_expect(t, sys_open(t, vp, O_APPEND), expected);
+	test_expect(t, sys_open(t, vp, O_TRUNC), expected);
+}
+
+
+static void test_check_open_mutable_file(test_t* t)			{ test_open(t, t->mutableFile, 1); }
+static void test_check_open_immutable_file(test_t* t)		{ test_open(t, t->wormFile, 0); }
+
+
+static void test_check_open_dir(test_t* t) {
+	test_expect(t, sys_open(t, t->mutableDir, O_RDONLY), 0);
+	test_expect(t, sys_open(t, t->wormDir, O_RDONLY), 0);
+}
+
+
+static void test_check_rename_from_mutable_vnode(test_t* t) {
+	test_expect(t, sys_rename(t, t->mutableFile, t->mutableDir), 0);
+	test_expect_worm(t, t->mutableFile, 0);
+	test_expect(t, sys_rename(t, t->wormFile, t->mutableDir), 0);
+	test_expect(t, sys_rename(t, t->mutableFile, t->root), 0);
+	test_expect(t, sys_rename(t, t->wormFile, t->root), 0);
+}
+
+
+static void test_check_rename_from_immutable_vnode(test_t* t) {
+	test_expect(t, sys_rename(t, t->mutableFile, t->wormDir), 0);
+	test_expect_worm(t, t->mutableFile, 1);
+	test_expect(t, sys_rename(t, t->wormFile, t->wormDir), 0);
+	test_expect(t, sys_rename(t, t->mutableFile, t->root), EPERM);
+	test_expect(t, sys_rename(t, t->wormFile, t->root), EPERM);
+}
+
+
+static void test_check_setextattr(test_t* t) {
+	test_expect(t, sys_setxattr(t, t->mutableFile, k_test_attribute), 0);
+	test_expect(t, sys_setxattr(t, t->mutableDir, k_test_attribute), 0);
+	test_expect(t, sys_setxattr(t, t->wormFile, k_test_attribute), EPERM);
+	test_expect(t, sys_setxattr(t, t->wormDir, k_test_attribute), EPERM);
+}
+
+
+static void test_check_setextattr_worm(test_t* t) {
+	// setting our attribute makes it WORM at once
+	test_expect(t, sys_setxattr(t, t->mutableFile, k_wormxattr_xattr), 0);
+	test_expect(t, sys_open(t, t->mutableFile, O_WRONLY), EPERM);
+	test_expect(t, sys_setxattr(t, t->mutableFile, k_wormxattr_xattr), EPERM);
+}
+
+
+static void test_check_setattrlist(test_t* t) {
+	test_expect(t, sys_setattrlist(t, t->mutableFile), 0);
+	test_expect(t, sys_setattrlist(t, t->mutableDir), 0);
+	test_expect(t, sys_setattrlist(t, t->wormFile), EPERM);
+	test_expect(t, sys_setattrlist(t, t->wormDir), EPERM);
+}
+
+
+static void test_check_setflags(test_t* t) {
+	test_expect(t, sys_chflags(t, t->mutableFile, UF_HIDDEN), 0);
+	test_expect(t, sys_chflags(t, t->mutableDir, UF_HIDDEN), 0);
+	test_expect(t, sys_chflags(t, t->wormFile, UF_HIDDEN), EPERM);
+	test_expect(t, sys_chflags(t, t->wormDir, UF_HIDDEN), EPERM);
+}
+
+
+static void test_check_setmode(test_t* t) {
+	test_expect(t, sys_chmod(t, t->mutableFile, S_IRUSR), 0);
+	test_expect(t, sys_chmod(t, t->mutableDir, S_IRUSR), 0);
+	test_expect(t, sys_chmod(t, t->wormFile, S_IRUSR), EPERM);
+	test_expect(t, sys_chmod(t, t->wormDir, S_IRUSR), EPERM);
+}
+
+
+static void test_check_setowner(test_t* t) {
+	test_expect(t, sys_chown(t, t->mutableFile), 0);
+	test_expect(t, sys_chown(t, t->mutableDir), 0);
+	test_expect(t, sys_chown(t, t->wormFile), EPERM);
+	test_expect(t, sys_chown(t, t->wormDir), EPERM);
+}
+
+
+static void test_check_setutimes(test_t* t) {
+	test_expect(t, sys_utimes(t, t->mutableFile), 0);
+	test_expect(t, sys_utimes(t, t->mutableDir), 0);
+	test_expect(t, sys_utimes(t, t->wormFile), EPERM);
+	test_expect(t, sys_utimes(t, t->wormDir), EPERM);
+}
+
+
+static void test_check_truncate(test_t* t) {
+	test_expect(t, sys_truncate(t, t->mutableFile), 0);
+	test_expect(t, sys_truncate(t, t->mutableDir), EISDIR);
+	test_expect(t, sys_truncate(t, t->wormFile), EPERM);
+	test_expect(t, sys_truncate(t, t->wormDir), EISDIR);
+}
+
+
+static void test_check_unlink(test_t* t) {
+	struct vnode* vp = sys_create(t, t->wormDir, "file", VREG);
+	struct vnode* mutable = sys_create(t, t->root, "file", VREG);
+	
+	test_expect(t, sys_unlink(t, t->mutableFile), 0);
+	test_expect(t, sys_unlink(t, t->mutableDir), 0);
+	test_expect(t, sys_unlink(t, t->wormFile), EPERM);
+	test_expect(t, sys_unlink(t, t->wormDir), EPERM);
+	test_expect(t, sys_unlink(t, vp), EPERM);
+	test_expect(t, sys_unlink(t, mutable), 0);
+}
+
+
+static void test_notify_create(test_t* t) {
+	struct vnode* file = sys_create(t, t->wormDir, "file", VREG);
+	struct vnode* dir = sys_create(t, t->wormDir, "dir", VDIR);
+	struct vnode* link = sys_create(t, t->wormDir, "softlink", VLNK);
+	struct vnode* nested = sys_create(t, dir, "nested", VREG);
+	struct vnode* mutable = sys_create(t, t->mutableDir, "file", VREG);
+	
+	test_expect_worm(t, file, 1);
+	test_expect_worm(t, dir, 1);
+	test_expect_worm(t, link, 1);
+	test_expect_worm(t, nested, 1);
+	test_expect_worm(t, mutable, 0);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, mutable, O_WRONLY), 0);
+}
+
+
+static void test_notify_create_fresh_label(test_t* t) {
+	// the inherited attribute is found again after the vnode is recycled
+	struct vnode* file = sys_create(t, t->wormDir, "file", VREG);
+	
+	host_vnode_recycle(file);
+	host_vnode_associate(file);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+}
+
+
+static void test_notify_create_retention(test_t* t) {
+	// a retention directory's children inherit its retention; expired retention is mutable
+	struct vnode* future = test_vnode(t, t->root, "future", VDIR, 0);
+	struct vnode* past = test_vnode(t, t->root, "past", VDIR, 0);
+	char value[64];
+	size_t len = 0;
+	
+	(void) snprintf(value, sizeof(value), "retain=%llu", (unsigned long long) wormxattr_policy_now() + 3600);
+	(void) host_xattr_set(future, k_wormxattr_xattr, value, strlen(value));
+	(void) g_ops->mpo_vnode_label_update_extattr(t->mp, &t->mp->mnt_label, future, &future->v_label, k_wormxattr_xattr);
+	(void) host_xattr_set(past, k_wormxattr_xattr, "retain=1", 8);
+	(void) g_ops->mpo_vnode_label_update_extattr(t->mp, &t->mp->mnt_label, past, &past->v_label, k_wormxattr_xattr);
+	
+	struct vnode* file = sys_create(t, future, "file", VREG);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, mac_vnop_getxattr(file, k_wormxattr_xattr, value + 32, 32, &len), 0);
+	test_expect(t, len == strlen(value) && memcmp(value, value + 32, len) == 0, 1);
+	test_expect(t, sys_open(t, past, O_RDONLY), 0);
+	test_expect(t, sys_chmod(t, past, 0700), 0);
+	file = sys_create(t, past, "file", VREG);
+	test_expect_worm(t, file, 0);
+}
+
+
+static void test_class_hold(test_t* t) {
+	// a hold denies what WORM does, outlasts expired retention and isn't inherited
+	struct vnode* vp = test_vnode(t, t->root, "held", VREG, 0);
+	struct vnode* dir = test_vnode(t, t->root, "heldDir", VDIR, 0);
+	
+	(void) host_xattr_set(vp, k_wormxattr_xattr, "retain=1", 8);
+	(void) host_xattr_set(vp, k_test_hold, "1", 1);
+	test_open(t, vp, 0);
+	test_expect(t, sys_chmod(t, vp, S_IRUSR), EPERM);
+	test_expect(t, sys_unlink(t, vp), EPERM);
+	test_expect(t, sys_removexattr(t, vp, k_test_hold), EPERM);
+	t->cred.cr_uid = 0;
+	test_expect(t, sys_removexattr(t, vp, k_test_hold), 0);
+	t->cred.cr_uid = k_test_uid;
+	test_expect(t, sys_open(t, vp, O_WRONLY), 0);
+	
+	(void) host_xattr_set(dir, k_test_hold, "1", 1);
+	struct vnode* file = sys_create(t, dir, "file", VREG);
+	test_expect(t, sys_open(t, file, O_WRONLY), 0);
+	test_expect(t, sys_unlink(t, file), EPERM);
+	test_expect_worm(t, file, 0);
+}
+
+
+static void test_class_scratch(test_t* t) {
+	// scratch only protects the contents; the file can be renamed, changed and removed
+	struct vnode* vp = test_vnode(t, t->root, "scratch", VREG, 0);
+	struct vnode* dir = test_vnode(t, t->root, "scratchDir", VDIR, 0);
+	
+	(void) host_xattr_set(vp, k_test_scratch, "1", 1);
+	test_open(t, vp, 0);
+	test_access(t, vp, 0);
+	test_expect(t, sys_truncate(t, vp), EPERM);
+	test_expect(t, sys_exchangedata(t, vp, t->mutableFile), EPERM);
+	test_expect(t, sys_chmod(t, vp, S_IRUSR), 0);
+	test_expect(t, sys_setxattr(t, vp, k_test_attribute), 0);
+	test_expect(t, sys_removexattr(t, vp, k_test_scratch), EPERM);
+	test_expect(t, sys_rename(t, vp, t->mutableDir), 0);
+	test_expect(t, sys_unlink(t, vp), 0);
+	
+	(void) host_xattr_set(dir, k_test_scratch, "1", 1);
+	struct vnode* file = sys_create(t, dir, "file", VREG);
+	test_expect(t, sys_open(t, file, O_WRONLY), 0);
+	test_expect(t, sys_unlink(t, file), 0);
+	test_expect(t, sys_chmod(t, dir, 0700), 0);
+}
+
+
+static void test_class_tenant(test_t* t) {
+	// a tenants name is in the worm class; the latest retention wins and children inherit it
+	struct vnode* dir = test_vnode(t, t->root, "tenant", VDIR, 0);
+	char value[64];
+	
+	(void) snprintf(value, sizeof(value), "retain=%llu", (unsigned long long) wormxattr_policy_now() + 3600);
+	(void) host_xattr_set(dir, k_test_tenant, value, strlen(value));
+	(void) host_xattr_set(dir, k_wormxattr_xattr, "retain=1", 8);
+	test_expect(t, sys_chmod(t, dir, 0700), EPERM);
+	struct vnode* file = sys_create(t, dir, "file", VREG);
+	test_expect_worm(t, file, 1);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	
+	test_expect(t, sys_setxattr(t, t->mutableFile, k_test_tenant), 0);
+	test_expect(t, sys_open(t, t->mutableFile, O_WRONLY), EPERM);
+}
+
+
+#define test_rule_uses(name, worm, hold, scratch, append, sealed) \
+	test_expect(t, wormxattr_policy_uses_dir(k_wormxattr_rule_##name), \
+				(wormxattr_policy_guards(k_wormxattr_rule_##name, 0, 0) != wormxattr_policy_guards(k_wormxattr_rule_##name, 1, 0)) \
+			 || (wormxattr_policy_guards(k_wormxattr_rule_##name, 0, 1) != wormxattr_policy_guards(k_wormxattr_rule_##name, 1, 1))); \
+	test_expect(t, wormxattr_policy_uses_root(k_wormxattr_rule_##name), \
+				(wormxattr_policy_guards(k_wormxattr_rule_##name, 0, 0) != wormxattr_policy_guards(k_wormxattr_rule_##name, 0, 1)) \
+			 || (wormxattr_policy_guards(k_wormxattr_rule_##name, 1, 0) != wormxattr_policy_guards(k_wormxattr_rule_##name, 1, 1)));
+
+static void test_rules(test_t* t) {
+	// a rule depends on the kind of vnode, or the caller, only if a case differs by it
+	wormxattr_policy_rules(test_rule_uses)
+	test_expect(t, k_wormxattr_class_mask <= k_wormxattr_rule_case_mask, 1);
+	test_expect(t, wormxattr_policy_uses_dir(k_wormxattr_rule_access_write), 1);
+	test_expect(t, wormxattr_policy_uses_root(k_wormxattr_rule_setmode), 0);
+	test_expect(t, wormxattr_policy_uses_root(k_wormxattr_rule_deleteextattr), 1);
+}
+
+
+static void test_append(test_t* t) {
+	// an append only file can only be appended to, until it's finalized to WORM
+	struct vnode* vp = test_vnode(t, t->root, "log", VREG, 0);
+	
+	(void) host_xattr_set(vp, k_wormxattr_xattr, k_wormxattr_value_append, strlen(k_wormxattr_value_append));
+	test_expect(t, sys_open(t, vp, O_RDONLY), 0);
+	test_expect(t, sys_open(t, vp, O_WRONLY | O_APPEND), 0);
+	test_expect(t, sys_open(t, vp, O_RDWR | O_APPEND), EPERM);
+	test_expect(t, sys_open(t, vp, O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, vp, O_WRONLY | O_APPEND | O_TRUNC), EPERM);
+	test_expect(t, sys_truncate(t, vp), EPERM);
+	test_expect(t, sys_chmod(t, vp, S_IRUSR), EPERM);
+	test_expect(t, sys_unlink(t, vp), EPERM);
+	test_expect(t, sys_removexattr(t, vp, k_wormxattr_xattr), EPERM);
+	test_expect(t, sys_setxattr(t, vp, k_test_attribute), EPERM);
+}
+
+
+static void test_append_finalize(test_t* t) {
+	// setting the attribute to a WORM value finalizes; nothing else changes it
+	struct vnode* vp = test_vnode(t, t->root, "log", VREG, 0);
+	struct vnode* expired = test_vnode(t, t->root, "expired", VREG, 0);
+	
+	(void) host_xattr_set(vp, k_wormxattr_xattr, k_wormxattr_value_append, strlen(k_wormxattr_value_append));
+	(void) host_xattr_set(expired, k_wormxattr_xattr, k_wormxattr_value_append, strlen(k_wormxattr_value_append));
+	test_expect(t, sys_setxattr_value(t, vp, k_wormxattr_xattr, k_wormxattr_value_append), EPERM);
+	test_expect(t, sys_setxattr_value(t, vp, k_test_hold, "1"), EPERM);
+	test_expect(t, sys_setxattr_value(t, expired, k_wormxattr_xattr, "retain=1"), EPERM);
+	test_expect(t, g_ops->mpo_vnode_check_setextattr(&t->cred, vp, &vp->v_label, k_wormxattr_xattr, NULL), EPERM);
+	test_expect(t, sys_setxattr_value(t, vp, k_wormxattr_xattr, "1"), 0);
+	test_open(t, vp, 0);
+	test_expect(t, sys_setxattr_value(t, vp, k_wormxattr_xattr, "1"), EPERM);
+	test_expect(t, sys_open(t, expired, O_WRONLY | O_APPEND), 0);
+}
+
+
+static void test_append_weaken(test_t* t) {
+	// the value stored isn't the one checked (it changed in user memory); the label is kept
+	struct vnode* vp = test_vnode(t, t->root, "log", VREG, 0);
+	struct uio uio = {"1", 1};
+	char value[64];
+	size_t len = 0;
+	
+	(void) host_xattr_set(vp, k_wormxattr_xattr, k_wormxattr_value_append, strlen(k_wormxattr_value_append));
+	test_expect(t, g_ops->mpo_vnode_check_setextattr(&t->cred, vp, &vp->v_label, k_wormxattr_xattr, &uio), 0);
+	(void) host_xattr_set(vp, k_wormxattr_xattr, "retain=1", 8);
+	(void) g_ops->mpo_vnode_label_update_extattr(vp->v_mount, &vp->v_mount->mnt_label, vp, &vp->v_label, k_wormxattr_xattr);
+	test_expect(t, sys_open(t, vp, O_WRONLY), EPERM);
+	test_expect(t, sys_unlink(t, vp), EPERM);
+	test_expect(t, sys_open(t, vp, O_WRONLY | O_APPEND), 0);
+	test_expect(t, mac_vnop_getxattr(vp, k_wormxattr_xattr, value, sizeof(value), &len), 0);
+	test_expect(t, wormxattr_value_is_append(value, len), 1);
+	g_ops->mpo_vnode_label_recycle(&vp->v_label);
+	test_expect(t, sys_open(t, vp, O_WRONLY), EPERM);
+}
+
+
+static void test_append_inherit(test_t* t) {
+	// an append only directory's children are append only
+	struct vnode* dir = test_vnode(t, t->root, "logs", VDIR, 0);
+	char value[64];
+	size_t len = 0;
+	
+	(void) host_xattr_set(dir, k_wormxattr_xattr, k_wormxattr_value_append, strlen(k_wormxattr_value_append));
+	test_expect(t, sys_chmod(t, dir, 0700), EPERM);
+	struct vnode* file = sys_create(t, dir, "file", VREG);
+	test_expect(t, mac_vnop_getxattr(file, k_wormxattr_xattr, value, sizeof(value), &len), 0);
+	test_expect(t, wormxattr_value_is_append(value, len), 1);
+	test_expect(t, sys_open(t, file, O_WRONLY | O_APPEND), 0);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_unlink(t, file), EPERM);
+}
+
+
+static void test_sealed(test_t* t) {
+	// a sealed directory takes no new entries; a WORM one does (they inherit its state)
+	struct vnode* dir = test_vnode(t, t->root, "sealed", VDIR, 0);
+	struct vnode* entry = test_vnode(t, dir, "entry", VREG, 0);
+	
+	(void) host_xattr_set(dir, k_wormxattr_xattr, k_wormxattr_value_sealed, strlen(k_wormxattr_value_sealed));
+	test_expect(t, sys_check_create(t, dir, "new"), EPERM);
+	test_expect(t, sys_link(t, t->mutableFile, dir), EPERM);
+	test_expect(t, sys_rename(t, t->mutableFile, dir), EPERM);
+	test_expect(t, sys_unlink(t, entry), EPERM);
+	test_expect(t, sys_rename(t, entry, t->root), EPERM);
+	test_expect(t, sys_chmod(t, dir, 0700), EPERM);
+	test_expect(t, sys_open(t, entry, O_RDONLY), 0);
+	test_expect(t, sys_check_create(t, t->wormDir, "new"), 0);
+	test_expect(t, sys_link(t, t->mutableFile, t->wormDir), 0);
+	test_expect(t, sys_rename(t, t->mutableFile, t->wormDir), 0);
+	test_expect(t, sys_check_create(t, t->mutableDir, "new"), 0);
+}
+
+
+static void test_sealed_seal(test_t* t) {
+	// sealing is the one change a WORM directory allows; a sealed one allows none
+	intptr_t value = wormxattr_policy_label(k_wormxattr_value_sealed "\n", strlen(k_wormxattr_value_sealed) + 1);
+	
+	test_expect(t, value == k_wormxattr_label_sealed, 1);
+	test_expect(t, wormxattr_policy_active(value), k_wormxattr_class_worm | k_wormxattr_class_sealed);
+	test_expect(t, sys_setxattr_value(t, t->wormFile, k_wormxattr_xattr, k_wormxattr_value_sealed), EPERM);
+	test_expect(t, sys_setxattr_value(t, t->wormDir, k_wormxattr_xattr, "retain=1"), EPERM);
+	test_expect(t, sys_setxattr_value(t, t->wormDir, k_test_hold, k_wormxattr_value_sealed), EPERM);
+	test_expect(t, sys_check_create(t, t->wormDir, "new"), 0);
+	test_expect(t, sys_setxattr_value(t, t->wormDir, k_wormxattr_xattr, k_wormxattr_value_sealed), 0);
+	test_expect(t, sys_check_create(t, t->wormDir, "new"), EPERM);
+	test_expect(t, sys_setxattr_value(t, t->wormDir, k_wormxattr_xattr, k_wormxattr_value_sealed), EPERM);
+	test_expect(t, sys_removexattr(t, t->wormDir, k_wormxattr_xattr), EPERM);
+	test_expect(t, sys_setxattr_value(t, t->mutableDir, k_wormxattr_xattr, k_wormxattr_value_sealed), 0);
+	test_expect(t, sys_link(t, t->mutableFile, t->mutableDir), EPERM);
+}
+
+
+static void test_sealed_weaken(test_t* t) {
+	// sealing checks its copy of the value, but an expired retention is stored; still WORM
+	struct vnode* dir = t->wormDir;
+	struct uio uio = {k_wormxattr_value_sealed, strlen(k_wormxattr_value_sealed)};
+	char value[64];
+	size_t len = 0;
+	
+	test_expect(t, g_ops->mpo_vnode_check_setextattr(&t->cred, dir, &dir->v_label, k_wormxattr_xattr, &uio), 0);
+	(void) host_xattr_set(dir, k_wormxattr_xattr, "retain=1", 8);
+	(void) g_ops->mpo_vnode_label_update_extattr(dir->v_mount, &dir->v_mount->mnt_label, dir, &dir->v_label, k_wormxattr_xattr);
+	test_expect(t, sys_chmod(t, dir, 0700), EPERM);
+	test_expect(t, sys_rename(t, t->wormFile, dir), 0);
+	test_expect(t, sys_unlink(t, t->wormFile), EPERM);
+	test_expect(t, mac_vnop_getxattr(dir, k_wormxattr_xattr, value, sizeof(value), &len), 0);
+	test_expect(t, wormxattr_value_parse(value, len) == k_wormxattr_retain_forever, 1);
+	g_ops->mpo_vnode_label_recycle(&dir->v_label);
+	test_expect(t, sys_chmod(t, dir, 0700), EPERM);
+	
+	// and a sealed directory stays sealed; even if still WORM
+	test_expect(t, sys_setxattr_value(t, dir, k_wormxattr_xattr, k_wormxattr_value_sealed), 0);
+	(void) host_xattr_set(dir, k_wormxattr_xattr, "1", 1);
+	(void) g_ops->mpo_vnode_label_update_extattr(dir->v_mount, &dir->v_mount->mnt_label, dir, &dir->v_label, k_wormxattr_xattr);
+	test_expect(t, sys_check_create(t, dir, "new"), EPERM);
+	test_expect(t, mac_vnop_getxattr(dir, k_wormxattr_xattr, value, sizeof(value), &len), 0);
+	test_expect(t, wormxattr_value_is_sealed(value, len), 1);
+}
+
+
+/**
+ * @brief	makes a mount of a file system type the mount_modes sysctl names, for a case; 
+ *			left, as its vnodes are
+ *
+ * @return	its root
+ */
+static struct vnode* test_mode_root(test_t* t, const char* fs, const char* path) {
+	struct mount* mp = host_mount_create(fs, path);
+	struct vnode* root = host_vnode_create(mp, NULL, "", VDIR);
+	host_vnode_associate(root);
+	return root;
+}
+
+
+static void test_ignore(test_t* t) {
+	// nothing on an ignored mount is WORM, or has its attributes read; even if unknown
+	struct vnode* root = test_mode_root(t, k_test_ignore_fs, "/Volumes/ignore");
+	struct vnode* dir = host_vnode_create(root->v_mount, root, "worm", VDIR);
+	struct vnode* file = host_vnode_create(root->v_mount, dir, "file", VREG);
+	struct vnode* moved = test_vnode(t, root, "moved", VREG, 0);
+	
+	// as a single label file system leaves them; never associated
+	(void) host_xattr_set(dir, k_wormxattr_xattr, "0", 1);
+	(void) host_xattr_set(file, k_wormxattr_xattr, "0", 1);
+	test_expect(t, sys_open(t, file, O_WRONLY), 0);
+	test_expect(t, sys_unlink(t, file), 0);
+	test_expect(t, sys_chmod(t, dir, 0700), 0);
+	struct vnode* created = sys_create(t, dir, "new", VREG);
+	test_expect(t, sys_open(t, created, O_WRONLY), 0);
+	test_expect(t, sys_rename(t, moved, dir), 0);
+	test_expect(t, sys_open(t, moved, O_WRONLY), 0);
+	test_expect(t, dir->v_xattr_reads + file->v_xattr_reads + created->v_xattr_reads + moved->v_xattr_reads, 0);
+	test_expect_worm(t, created, 0);
+	test_expect_worm(t, moved, 0);
+}
+
+
+static void test_mount_slots(test_t* t) {
+	// more mounts than slots; those which don't fit, or reuse a removed one, keep their mode
+	struct mount* mps[k_wormxattr_mount_slots + 8];
+	int count = (int) (sizeof(mps) / sizeof(mps[0]));
+	
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < count; i++) {
+			mps[i] = host_mount_create(k_test_ignore_fs, "/Volumes/ignore");
+		}
+		for (int i = 0; i < count; i++) {
+			struct vnode* root = host_vnode_create(mps[i], NULL, "", VDIR);
+			struct vnode* file = host_vnode_create(mps[i], root, "file", VREG);
+			(void) host_xattr_set(file, k_wormxattr_xattr, "0", 1);
+			test_expect(t, sys_open(t, file, O_WRONLY), 0);
+			test_expect(t, file->v_xattr_reads, 0);
+		}
+		for (int i = 0; i < count; i += 2) {
+			host_mount_destroy(mps[i]);
+		}
+	}
+}
+
+
+static void test_noinherit(test_t* t) {
+	// attributes are honoured on a noinherit mount, but new or moved children aren't tagged
+	struct vnode* root = test_mode_root(t, k_test_noinherit_fs, "/Volumes/noinherit");
+	struct vnode* dir = test_vnode(t, root, "worm", VDIR, 1);
+	struct vnode* file = test_vnode(t, dir, "file", VREG, 1);
+	struct vnode* moved = test_vnode(t, root, "moved", VREG, 0);
+	
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_chmod(t, dir, 0700), EPERM);
+	struct vnode* created = sys_create(t, dir, "new", VREG);
+	test_expect_worm(t, created, 0);
+	test_expect(t, sys_open(t, created, O_WRONLY), 0);
+	test_expect(t, sys_unlink(t, created), EPERM); // its directory is still WORM
+	test_expect(t, sys_rename(t, moved, dir), 0);
+	test_expect_worm(t, moved, 0);
+	test_expect(t, sys_open(t, moved, O_WRONLY), 0);
+}
+
+
+/**
+ * @brief	makes a mount of the derived file system type for a case
+ *
+ * @return	its root
+ */
+static struct vnode* test_derive_root(test_t* t) {
+	return test_mode_root(t, k_test_derive_fs, "/Volumes/derive");
+}
+
+
+static void test_derive_rename(test_t* t) {
+	// a tree moved into a WORM directory is WORM; its derived, nothing is written
+	struct vnode* root = test_derive_root(t);
+	struct vnode* worm = test_vnode(t, root, "worm", VDIR, 1);
+	struct vnode* tree = test_vnode(t, root, "tree", VDIR, 0);
+	struct vnode* sub = test_vnode(t, tree, "sub", VDIR, 0);
+	struct vnode* file = test_vnode(t, sub, "file", VREG, 0);
+	struct vnode* loose = test_vnode(t, root, "loose", VREG, 0);
+	struct vnode* held = test_vnode(t, tree, "held", VDIR, 0);
+	struct vnode* kept = test_vnode(t, held, "file", VREG, 0);
+	
+	(void) host_xattr_set(held, k_test_hold, "1", 1);
+	test_expect(t, sys_open(t, file, O_WRONLY), 0);
+	test_expect(t, sys_open(t, kept, O_WRONLY), 0);
+	test_expect(t, sys_chmod(t, sub, 0700), 0);
+	test_expect(t, sys_open(t, loose, O_WRONLY), 0);
+	test_expect(t, sys_rename(t, tree, worm), 0);
+	test_expect(t, sys_rename(t, loose, worm), 0);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_unlink(t, file), EPERM);
+	test_expect(t, sys_chmod(t, sub, 0700), EPERM);
+	test_expect(t, sys_rename(t, sub, root), EPERM);
+	test_expect(t, sys_open(t, loose, O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, kept, O_WRONLY), EPERM); // a hold doesn't stop the derivation
+	test_expect_worm(t, tree, 0);
+	test_expect_worm(t, file, 0);
+	test_expect_worm(t, loose, 0);
+	
+	// and is found again after the vnode is recycled
+	host_vnode_recycle(file);
+	host_vnode_associate(file);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+}
+
+
+static void test_derive_create(test_t* t) {
+	// new children derive what they'd have inherited; worm and append, with retention
+	struct vnode* root = test_derive_root(t);
+	struct vnode* worm = test_vnode(t, root, "worm", VDIR, 1);
+	struct vnode* append = test_vnode(t, root, "append", VDIR, 0);
+	struct vnode* future = test_vnode(t, root, "future", VDIR, 0);
+	struct vnode* past = test_vnode(t, root, "past", VDIR, 0);
+	struct vnode* held = test_vnode(t, root, "held", VDIR, 0);
+	char value[64];
+	
+	(void) host_xattr_set(append, k_wormxattr_xattr, k_wormxattr_value_append, strlen(k_wormxattr_value_append));
+	(void) snprintf(value, sizeof(value), "retain=%llu", (unsigned long long) wormxattr_policy_now() + 3600);
+	(void) host_xattr_set(future, k_wormxattr_xattr, value, strlen(value));
+	(void) host_xattr_set(past, k_wormxattr_xattr, "retain=1", 8);
+	(void) host_xattr_set(held, k_test_hold, "1", 1);
+	
+	struct vnode* file = sys_create(t, worm, "file", VREG);
+	struct vnode* nested = sys_create(t, sys_create(t, worm, "dir", VDIR), "file", VREG);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, nested, O_WRONLY), EPERM);
+	test_expect_worm(t, file, 0);
+	file = sys_create(t, append, "file", VREG);
+	test_expect(t, sys_open(t, file, O_WRONLY | O_APPEND), 0);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, sys_create(t, future, "file", VREG), O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, sys_create(t, past, "file", VREG), O_WRONLY), 0);
+	file = sys_create(t, held, "file", VREG);
+	test_expect(t, sys_open(t, file, O_WRONLY), 0);
+	test_expect(t, sys_unlink(t, file), EPERM);
+	
+	// a hold (or scratch) below a WORM directory doesn't hide it from what's below
+	held = test_vnode(t, worm, "held", VDIR, 0);
+	(void) host_xattr_set(held, k_test_hold, "1", 1);
+	test_expect(t, sys_open(t, test_vnode(t, held, "old", VREG, 0), O_WRONLY), EPERM);
+	test_expect(t, sys_open(t, sys_create(t, held, "file", VREG), O_WRONLY), EPERM);
+	test_expect(t, wormxattr_policy_active(wormxattr_get_label(&held->v_label)), k_wormxattr_class_worm | k_wormxattr_class_hold);
+}
+
+
+static void test_derive_link(test_t* t) {
+	// a derived WORM file can't be linked elsewhere, where it would derive mutable
+	struct vnode* root = test_derive_root(t);
+	struct vnode* worm = test_vnode(t, root, "worm", VDIR, 1);
+	struct vnode* other = test_vnode(t, root, "other", VDIR, 0);
+	struct vnode* file = test_vnode(t, worm, "file", VREG, 0);
+	struct vnode* loose = test_vnode(t, other, "loose", VREG, 0);
+	
+	test_expect(t, sys_link(t, file, other), EPERM);
+	test_expect(t, sys_link(t, loose, root), 0);
+	
+	// without a parent what it derives can't be known; its WORM
+	struct vnode* orphan = host_vnode_create(root->v_mount, NULL, "orphan", VREG);
+	host_vnode_associate(orphan);
+	test_expect(t, sys_open(t, orphan, O_WRONLY), EPERM);
+}
+
+
+static void test_derive_attribute(test_t* t) {
+	// marking a directory makes its existing descendants WORM
+	struct vnode* root = test_derive_root(t);
+	struct vnode* dir = test_vnode(t, root, "dir", VDIR, 0);
+	struct vnode* sub = test_vnode(t, dir, "sub", VDIR, 0);
+	struct vnode* file = test_vnode(t, sub, "file", VREG, 0);
+	
+	test_expect(t, sys_open(t, file, O_WRONLY), 0);
+	test_expect(t, sys_setxattr_value(t, dir, k_wormxattr_xattr, "1"), 0);
+	test_expect(t, sys_open(t, file, O_WRONLY), EPERM);
+	test_expect(t, sys_setxattr(t, sub, k_test_attribute), EPERM);
+	test_expect(t, sys_setxattr(t, root, k_test_attribute), 0);
+}
+
+
+static int test_class_names_set(const char* names) {
+	return host_sysctlbyname("security.mac.wormxattr.class_names", NULL, NULL, names, strlen(names) + 1);
+}
+
+
+static void test_class_names(test_t* t) {
+	// invalid names are refused, and leave the names as they were
+	char names[512] = {0};
+	size_t len = sizeof(names);
+	
+	test_expect(t, test_class_names_set("com.mountainstorm.Test.Other=bogus"), EINVAL);
+	test_expect(t, test_class_names_set("com.mountainstorm.Test.Other"), EINVAL);
+	test_expect(t, test_class_names_set(k_test_hold "=hold," k_test_hold "=scratch"), EINVAL);
+	test_expect(t, test_class_names_set(k_wormxattr_xattr "=hold"), EINVAL);
+	test_expect(t, test_class_names_set(k_wormxattr_free_xattr "=worm"), EINVAL);
+	test_expect(t, test_class_names_set("com.mountainstorm.A.Test.Hold=hold,com.mountainstorm.B.Test.Hold=hold"), EINVAL);
+	test_expect(t, test_class_names_set("a=worm,b=worm,c=worm,d=worm,e=worm,f=worm,g=worm,h=worm"), EINVAL);
+	test_expect(t, host_sysctlbyname("security.mac.wormxattr.class_names", names, &len, NULL, 0), 0);
+	test_expect(t, strcmp(names, k_test_class_names), 0);
+	
+	// the same names replace nothing; changes, while other cases run, retire a table each 
+	// until no more can be kept
+	for (int i = 0; i < 64; i++) {
+		test_expect(t, test_class_names_set(k_test_class_names), 0);
+	}
+	int changes = 0;
+	while (	(changes < 2 * k_test_class_retired)
+		   && (test_class_names_set((changes & 1) ? k_test_class_names: k_test_class_names "," k_test_extra "=hold") == 0)) {
+		changes++;
+	}
+	test_expect(t, changes, k_test_class_retired - 1); // the cases set them first
+	test_expect(t, test_class_names_set(k_test_class_names), EBUSY);
+	test_expect(t, wormxattr_class_match(k_test_extra), k_wormxattr_class_hold);
+	test_expect(t, wormxattr_class_match(k_test_hold), k_wormxattr_class_hold);
+}
+
+
+static test_case_t g_cases[] = {
+	{"check_access_mutable_file",			test_check_access_mutable_file},
+	{"check_access_mutable_dir",			test_check_access_mutable_dir},
+	{"check_access_immutable_file",			test_check_access_immutable_file},
+	{"check_access_immutable_dir",			test_check_access_immutable_dir},
+	{"check_deleteextattr",					test_check_deleteextattr},
+	{"check_deleteextattr_root",			test_check_deleteextattr_root},
+	{"check_exchangedata",					test_check_exchangedata},
+	{"check_open_mutable_file",				test_check_open_mutable_file},
+	{"check_open_immutable_file",			test_check_open_immutable_file},
+	{"check_open_dir",						test_check_open_dir},
+	{"check_rename_from_mutable_vnode",		test_check_rename_from_mutable_vnode},
+	{"check_rename_from_immutable_vnode",	test_check_rename_from_immutable_vnode},
+	{"check_setextattr",					test_check_setextattr},
+	{"check_setextattr_worm",				test_check_setextattr_worm},
+	{"check_setattrlist",					test_check_setattrlist},
+	{"check_setflags",						test_check_setflags},
+	{"check_setmode",						test_check_setmode},
+	{"check_setowner",						test_check_setowner},
+	{"check_setutimes",						test_check_setutimes},
+	{"check_truncate",						test_check_truncate},
+	{"check_unlink",						test_check_unlink},
+	{"notify_create",						test_notify_create},
+	{"notify_create_fresh_label",			test_notify_create_fresh_label},
+	{"notify_create_retention",				test_notify_create_retention},
+	{"class_hold",							test_class_hold},
+	{"class_scratch",						test_class_scratch},
+	{"class_tenant",						test_class_tenant},
+	{"class_names",							test_class_names},
+	{"rules",								test_rules},
+	{"append",								test_append},
+	{"append_finalize",						test_append_finalize},
+	{"append_weaken",						test_append_weaken},
+	{"append_inherit",						test_append_inherit},
+	{"sealed",								test_sealed},
+	{"sealed_seal",							test_sealed_seal},
+	{"sealed_weaken",						test_sealed_weaken},
+	{"ignore",								test_ignore},
+	{"mount_slots",							test_mount_slots},
+	{"noinherit",							test_noinherit},
+	{"derive_rename",						test_derive_rename},
+	{"derive_create",						test_derive_create},
+	{"derive_link",							test_derive_link},
+	{"derive_attribute",					test_derive_attribute},
+	{NULL, NULL}
+};
+
+
+/*
+ * Implementation
+ */
+
+/**
+ * @brief	runs cases until there are none left
+ */
+static void* test_thread(void* arg) {
+	for (;;) {
+		int index = __sync_fetch_and_add(&g_next, 1);
+		test_case_t* it = &g_cases[index];
+		test_t t;
+		
+		if (it->name == NULL) {
+			__sync_fetch_and_sub(&g_next, 1); // leave g_next on the terminator
+			break;
+		}
+		if (	g_filter
+			 && strstr(it->name, g_filter) == NULL) {
+			continue;
+		}
+		test_setup(&t, index);
+		it->fn(&t);
+		test_teardown(&t);
+		
+		(void) pthread_mutex_lock(&g_lock);
+		if (t.failures) {
+			g_failed++;
+			printf("FAIL %-40s %s\n", it->name, t.message);
+		} else if (g_verbose) {
+			printf("ok   %s\n", it->name);
+		}
+		(void) pthread_mutex_unlock(&g_lock);
+	}
+	return NULL;
+}
+
+
+static void usage(const char* name) {
+	fprintf(stderr, "usage: %s [-t threads] [-f filter] [-v]\n", name);
+	fprintf(stderr, "  -t  number of threads running cases (default %d)\n", k_test_threads);
+	fprintf(stderr, "  -f  only run cases whose name contains filter\n");
+	fprintf(stderr, "  -v  list the cases which pass\n");
+	exit(2);
+}
+
+
+int main(int argc, char* argv[]) {
+	int threads = k_test_threads;
+	int count = 0;
+	int ch = 0;
+	while ((ch = getopt(argc, argv, "t:f:vh")) != -1) {
+		switch (ch) {
+			case 't': threads = atoi(optarg); break;
+			case 'f': g_filter = optarg; break;
+			case 'v': g_verbose = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+	if (threads <= 0) {
+		usage(argv[0]);
+	}
+	
+	// denials are audited; we want the results not the noise
+	host_log_sink = k_host_log_discard;
+	host_kern_start();
+	g_ops = host_policy_ops();
+	if (test_class_names_set(k_test_class_names) != 0) {
+		host_panic("Unable to set the class names\n");
+	}
+	if (host_sysctlbyname("security.mac.wormxattr.mount_modes", NULL, NULL, k_test_mount_modes, strlen(k_test_mount_modes) + 1) != 0) {
+		host_panic("Unable to set the mount modes\n");
+	}
+	
+	pthread_t* tids = calloc(threads, sizeof(*tids));
+	if (tids == NULL) {
+		host_panic("Out of memory\n");
+	}
+	uint64_t start = host_now_ns();
+	for (int i = 0; i < threads; i++) {
+		if (pthread_create(&tids[i], NULL, test_thread, NULL) != 0) {
+			host_panic("Unable to create thread\n");
+		}
+	}
+	for (int i = 0; i < threads; i++) {
+		(void) pthread_join(tids[i], NULL);
+	}
+	uint64_t elapsed = host_now_ns() - start;
+	for (test_case_t* it = g_cases; it->name; it++) {
+		count += (g_filter == NULL) || (strstr(it->name, g_filter) != NULL);
+	}
+	printf("%d cases, %d failed, in %.1fms\n", count, g_failed, (double) elapsed / 1e6);
+	host_kern_stop();
+	free(tids);
+	return g_failed ? 1: 0;
+}
@@ -0,0 +1,119 @@
+//
+//  trace.h
+//  wormxattr_host
+//
+//  Created by Mountainstorm on 17/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#ifndef wormxattr_host_trace_h
+#define wormxattr_host_trace_h
+
+
+#include <stdint.h>
+
+
+/*
+ * Description
+ *
+ * The binary trace replayed by replay and written by strace2trace.  A trace is a 
+ * header followed by fixed size events, all little endian.  Events name synthetic 
+ * vnodes by index; vnode 0 is the root of the (single) mount and every other vnode
+ * is introduced by an exist or create event, naming its parent directory, before 
+ * it is used.  Vnode indexes aren't reused; a file recreated after an unlink gets
+ * a new index.
+ */
+
+
+/*
+ * Defines
+ */
+
+#define k_trace_magic					0x52545857		// "WXTR"
+#define k_trace_version					1
+#define k_trace_root					0
+
+// event flags
+#define k_trace_flag_dir				0x01	// exist/create; the vnode is a directory
+#define k_trace_flag_worm				0x02	// exist/setxattr; our attribute is set
+
+// open event access; in arg
+#define k_trace_open_read				0x01
+#define k_trace_open_write				0x02
+#define k_trace_open_trunc				0x04
+#define k_trace_open_append				0x08
+
+
+/*
+ * Definitions
+ */
+
+/**
+ * @brief	the event types; each maps to the hooks the kernel would call for it
+ */
+typedef enum {
+	k_trace_exist = 0,		// a vnode for a file which existed before the trace; vnode, dir
+	k_trace_create,			// a file created in dir; vnode, dir
+	k_trace_open,			// vnode opened; vnode, arg (k_trace_open_*)
+	k_trace_unlink,			// vnode removed from dir; vnode, dir
+	k_trace_rename,			// vnode moved from dir to arg; vnode, dir, arg
+	k_trace_setxattr,		// an attribute set on vnode; ours if k_trace_flag_worm
+	k_trace_truncate,		// vnode truncated; vnode
+	k_trace_ops
+} trace_op_t;
+
+/**
+ * @brief	the trace file header
+ *
+ * @field	magic		k_trace_magic
+ * @field	version		k_trace_version
+ * @field	reserved	0
+ * @field	vnodes		the number of vnodes used (including the root)
+ * @field	events		the number of events following the header
+ */
+typedef struct {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	reserved;
+	uint32_t	vnodes;
+	uint32_t	events;
+} trace_header_t;
+
+/**
+ * @brief	a single event
+ *
+ * @field	op			the trace_op_t
+ * @field	flags		k_trace_flag_*
+ * @field	reserved	0
+ * @field	vnode		the vnode the event applies to
+ * @field	dir			the vnodes (current) parent directory; exist, create, unlink, rename
+ * @field	arg			open; the access, rename; the new parent directory
+ */
+typedef struct {
+	uint8_t		op;
+	uint8_t		flags;
+	uint16_t	reserved;
+	uint32_t	vnode;
+	uint32_t	dir;
+	uint32_t	arg;
+} trace_event_t;
+
+
+#endif